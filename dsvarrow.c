@@ -0,0 +1,294 @@
+
+/*****************************************************************************/
+/*    Name: dsvarrow.c                                                       */
+/*   Title: Delimiter-Separated-Value to Arrow Converter                     */
+/* Purpose: Convert a DSV file to an Apache Arrow IPC stream of typed record */
+/*          batches, for columnar tools to load without parsing text.        */
+/*  Author: Peter Schultz (sxpws)                                            */
+/*****************************************************************************/
+/* UA AUDIT TRAIL                                                            */
+/*                                                                           */
+/* 2026/10/18 sxpws Initial commit                                           */
+/*                                                                           */
+/* UA AUDIT TRAIL END                                                        */
+/*****************************************************************************/
+
+/* Usage: dsvarrow [-i dialect] [-H] [-t types] [-n null] [-b rows] [-s]
+ *                 [file]
+ *
+ *  -i dialect      dialect of the input (default psv; see dsvtool.h)
+ *  -H              the first record is the column names (default: columns
+ *                  are named by number, counting from 1)
+ *  -t types        comma-separated types of the columns in order: utf8,
+ *                  int64, float64 or dict (default utf8 for every column)
+ *  -n null         value that stands for a null field when not quoted
+ *  -b rows         rows per record batch (default 65536)
+ *  -s              report the counts and the time taken on stderr
+ *
+ * The input, or stdin when there is none or for "-", is written to stdout
+ * as an Arrow IPC stream by ua_dsv_arrow, which pyarrow.ipc.open_stream
+ * reads from a pipe or a memory map. There are as many columns as there
+ * are types or fields in the first record, whichever is more; dict columns
+ * are dictionary encoded, for strings with few distinct values.
+ *
+ * Records are those ua_dsv_scan finds. A record with a field that is not a
+ * number of its column's type is reported on stderr and left out. The exit
+ * status is 0 when every record was converted, 1 when some were left out
+ * and 2 on trouble.
+ *
+ *  cc -O2 dsvarrow.c dsvtool.c gua2csv.c -o dsvarrow -lpthread
+ *
+ * Conversion is one scan: batches must go out in order and dictionaries
+ * grow with every record, so there is nothing to split among threads that
+ * would not have to be put back together in order anyway.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dsvtool.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* {{{ REGION: CONVERSION */
+
+static struct dsvtool_dialect arrow_in;
+static const char* arrow_null;
+static int arrow_header;
+static size_t arrow_batch_rows;
+
+static enum UADsvArrowType* arrow_types;
+static size_t arrow_ntypes;
+static size_t arrow_types_cap;
+
+struct arrow_scan {
+    struct ua_dsv_arrow_writer* writer;
+    uint64_t records;
+    uint64_t rejected;
+    int failed;                 /* the writer failed; errno says why */
+
+    const char** fields;        /* NULL for values in chars */
+    size_t* lens;
+    unsigned char* nulls;
+    size_t nfields;
+    size_t fields_cap;
+    size_t lens_cap;
+    size_t nulls_cap;
+    char* chars;
+    size_t chars_len;
+    size_t chars_cap;
+};
+
+static void* arrow_grow(void* p, size_t* cap, size_t need, size_t size) {
+    size_t n = *cap ? *cap : 64;
+    while (n < need) n *= 2;
+    if (n != *cap) {
+        p = realloc(p, n * size);
+        if (!p) dsvtool_oom("records");
+        *cap = n;
+    }
+    return p;
+}
+
+static int arrow_parse_types(const char* spec) {
+    static const char* const names[] = {"utf8", "int64", "float64", "dict"};
+    const char* s = spec;
+
+    while (*s) {
+        size_t n = strcspn(s, ",");
+        size_t i;
+        for (i = 0; i < 4; ++i) {
+            if (strlen(names[i]) == n && !strncmp(names[i], s, n)) break;
+        }
+        if (i == 4) {
+            fprintf(stderr, "bad type \"%.*s\"\n", (int)n, s);
+            return FALSE;
+        }
+        arrow_types = arrow_grow(arrow_types, &arrow_types_cap,
+                                 arrow_ntypes + 1, sizeof(*arrow_types));
+        arrow_types[arrow_ntypes++] = (enum UADsvArrowType)i;
+        s += n;
+        if (*s) ++s;
+    }
+    return TRUE;
+}
+
+/* start the stream once the first record tells how many columns there are,
+ * naming them after it under -H */
+static int arrow_start(struct arrow_scan* s) {
+    size_t n = s->nfields > arrow_ntypes ? s->nfields : arrow_ntypes;
+    struct ua_dsv_arrow_column* columns;
+    char* names;
+    size_t i;
+
+    columns = calloc(n + 1, sizeof(*columns));
+    names = calloc(n + 1, 24);
+    if (!columns || !names) dsvtool_oom("columns");
+    for (i = 0; i < n; ++i) {
+        columns[i].type = i < arrow_ntypes ? arrow_types[i] : UA_ARROW_UTF8;
+        if (arrow_header && i < s->nfields) {
+            char* name = malloc(s->lens[i] + 1);
+            if (!name) dsvtool_oom("columns");
+            memcpy(name, s->fields[i] ? s->fields[i] : "", s->lens[i]);
+            name[s->lens[i]] = '\0';
+            columns[i].name = name;
+        } else {
+            sprintf(names + 24*i, "%lu", (unsigned long)i + 1);
+            columns[i].name = names + 24*i;
+        }
+    }
+    s->writer = ua_dsv_arrow_new(stdout, columns, n, arrow_batch_rows);
+    if (!s->writer) {
+        fprintf(stderr, "stdout: %s\n", strerror(errno));
+        s->failed = TRUE;
+    }
+    for (i = 0; arrow_header && i < n && i < s->nfields; ++i) {
+        free((char*)columns[i].name);
+    }
+    free(columns);
+    free(names);
+    return !s->failed;
+}
+
+static int arrow_on_field(void* user, const char* field, size_t len,
+                          int flags) {
+    struct arrow_scan* s = user;
+
+    s->fields = arrow_grow(s->fields, &s->fields_cap, s->nfields + 1,
+                           sizeof(*s->fields));
+    s->lens = arrow_grow(s->lens, &s->lens_cap, s->nfields + 1,
+                         sizeof(*s->lens));
+    s->nulls = arrow_grow(s->nulls, &s->nulls_cap, s->nfields + 1, 1);
+    s->nulls[s->nfields] = arrow_null && !(flags & UA_DSV_FIELD_QUOTED) &&
+                           strlen(arrow_null) == len &&
+                           memcmp(field, arrow_null, len) == 0;
+    if (flags & UA_DSV_FIELD_UNESCAPE) {
+        s->chars = arrow_grow(s->chars, &s->chars_cap,
+                              s->chars_len + len + 1, 1);
+        s->fields[s->nfields] = NULL;
+        s->lens[s->nfields] = ua_dsv_unescape_u8(field, len, arrow_in.quote,
+                                                 s->chars + s->chars_len);
+        s->chars_len += s->lens[s->nfields];
+    } else {
+        s->fields[s->nfields] = field;
+        s->lens[s->nfields] = len;
+    }
+    s->nfields += 1;
+    return TRUE;
+}
+
+static int arrow_on_record(void* user, const char* record, size_t len,
+                           size_t nfields) {
+    struct arrow_scan* s = user;
+    size_t off = 0, i;
+    int ok;
+
+    (void)record;
+    (void)len;
+    for (i = 0; i < nfields; ++i) {
+        if (!s->fields[i]) {
+            s->fields[i] = s->chars + off;
+            off += s->lens[i];
+        }
+    }
+    if (!s->writer) {
+        if (!arrow_start(s)) return FALSE;
+        if (arrow_header) goto next;
+    }
+
+    for (i = 0; i < nfields; ++i) {
+        if (s->nulls[i]) s->fields[i] = NULL;
+    }
+    s->records += 1;
+    ok = ua_dsv_arrow_add(s->writer, s->fields, s->lens, nfields);
+    if (!ok && (errno == EINVAL || errno == EOVERFLOW)) {
+        fprintf(stderr, "record %" PRIu64 ": %s\n", s->records,
+                errno == EINVAL ? "not a number" : "string too long");
+        s->rejected += 1;
+    } else if (!ok) {
+        fprintf(stderr, "stdout: %s\n", strerror(errno));
+        s->failed = TRUE;
+        return FALSE;
+    }
+
+next:
+    s->nfields = 0;
+    s->chars_len = 0;
+    return TRUE;
+}
+
+/* }}} REGION: CONVERSION */
+
+/* {{{ REGION: DRIVER */
+
+int main(int argc, char** argv) {
+    const char* in_spec = "psv";
+    const char* path = "-";
+    int summary = FALSE;
+    struct dsvtool_input in;
+    struct arrow_scan s;
+    double started;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:Ht:n:b:s")) != -1) {
+        switch (opt) {
+            case 'i': in_spec = optarg; break;
+            case 'H': arrow_header = TRUE; break;
+            case 't':
+                if (!arrow_parse_types(optarg)) goto usage;
+                break;
+            case 'n': arrow_null = optarg; break;
+            case 'b':
+                arrow_batch_rows = (size_t)strtoul(optarg, NULL, 10);
+                break;
+            case 's': summary = TRUE; break;
+            default:
+                goto usage;
+        }
+    }
+    if (argc - optind > 1 || !dsvtool_parse_dialect(in_spec, &arrow_in)) {
+        goto usage;
+    }
+    if (optind < argc) path = argv[optind];
+
+    started = dsvtool_now();
+    if (!dsvtool_input_open(path, &in)) return 2;
+    setvbuf(stdout, NULL, _IOFBF, 1u << 20);
+    memset(&s, 0, sizeof(s));
+    ua_dsv_scan_u8(in.data, in.len, arrow_in.quote, arrow_in.delim,
+                   arrow_on_field, arrow_on_record, &s);
+    /* an empty input still makes a stream, of the declared columns */
+    if (!s.failed && !s.writer) arrow_start(&s);
+    if (!s.failed && !ua_dsv_arrow_finish(s.writer)) {
+        fprintf(stderr, "stdout: %s\n", strerror(errno));
+        s.failed = TRUE;
+    }
+    if (summary) {
+        double elapsed = dsvtool_now() - started;
+        fprintf(stderr, "dsvarrow: %" PRIu64 " records, %" PRIu64 " left "
+                        "out, %.1f MB, %.3f s, %.1f MB/s\n",
+                s.records, s.rejected, (double)in.len / 1e6, elapsed,
+                (double)in.len / 1e6 / elapsed);
+    }
+
+    ua_dsv_arrow_free(s.writer);
+    dsvtool_input_close(&in);
+    free(s.fields);
+    free(s.lens);
+    free(s.nulls);
+    free(s.chars);
+    free(arrow_types);
+    if (s.failed) return 2;
+    return s.rejected > 0 ? 1 : 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-i dialect] [-H] [-t types] [-n null] "
+                    "[-b rows] [-s] [file]\n", argv[0]);
+    return 2;
+}
+
+/* }}} REGION: DRIVER */
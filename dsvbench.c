@@ -0,0 +1,570 @@
+
+/*****************************************************************************/
+/*    Name: dsvbench.c                                                       */
+/*   Title: Delimiter-Separated-Value Library Benchmark                      */
+/* Purpose: Measure the throughput of the gua2csv parser and formatter over  */
+/*          deterministic synthetic datasets.                                */
+/*  Author: Peter Schultz (sxpws)                                            */
+/*****************************************************************************/
+/* UA AUDIT TRAIL                                                            */
+/*                                                                           */
+/* 2026/10/18 sxpws Initial commit                                           */
+/* 2026/10/18 sxpws Count allocations with ua_dsv_stats                      */
+/* 2026/10/18 sxpws Measure every operation under each allocator             */
+/* 2026/10/18 sxpws Added ua_parse_dsv_into                                  */
+/* 2026/10/18 sxpws Added ua_dsv_scan                                        */
+/* 2026/10/18 sxpws Document UA_DSV_GENERIC for dialect comparisons          */
+/* 2026/10/18 sxpws Added ua_dsv_transcode                                   */
+/* 2026/10/18 sxpws Added lazy rows                                          */
+/*                                                                           */
+/* UA AUDIT TRAIL END                                                        */
+/*****************************************************************************/
+
+/* Usage: dsvbench [-r rows] [-t seconds] [-s seed] [-d dataset] [-o op]
+ *                 [-a allocator]
+ *
+ *  -r rows     rows per dataset (default 20000, long rows use 1/40th)
+ *  -t seconds  minimum time to spend on each measurement (default 0.5)
+ *  -s seed     seed for the dataset generator (default 1)
+ *  -d dataset  only run the named dataset
+ *  -o op       only run the named operation
+ *  -a alloc    only run the named allocator: malloc, arena or pool
+ *
+ * Every (operation, dataset, engine, allocator) is written to stdout as one
+ * CSV record:
+ *
+ *  op,dataset,engine,allocator,rows,bytes,seconds,mb_per_s,rows_per_s,
+ *  allocs_per_row
+ *
+ * allocator is the ua_dsv_allocator installed while measuring: malloc (the
+ * default), arena (reset after every row) or pool.
+ *
+ * bytes is the size of the dataset as char text, so that the TMCHAR and the
+ * char engine are measured against the same amount of data. allocs_per_row
+ * is the library's own count of calloc and realloc calls, taken from a
+ * ua_dsv_stats attached for the whole run (counting only, without timing, so
+ * the figures include the cost of leaving the counters on):
+ *
+ *  cc -O2 dsvbench.c gua2csv.c -o dsvbench
+ *
+ * The csv and psv datasets use the fixed dialects the library has
+ * instantiations for; build with -DUA_DSV_GENERIC as well to measure them
+ * through the runtime-dialect code instead.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gua2csv.h"
+
+/* collected for every measurement; see bench_measure */
+static struct ua_dsv_stats bench_stats;
+
+/* {{{ REGION: DATASETS */
+
+struct bench_data {
+    const char* name;
+    char quote;
+    char delim;
+    enum UAQuoteStyle quoting;
+    size_t nrows;
+    size_t bytes;
+    char** rows8;               /* generated records */
+    TMCHAR** rowsw;             /* the same records, widened */
+    const char*** parsed8;      /* formatter input */
+    const TMCHAR*** parsedw;
+};
+
+/* xorshift64*: deterministic across platforms, unlike rand() */
+static unsigned long long bench_state = 1;
+
+static unsigned long bench_rand(unsigned long n) {
+    bench_state ^= bench_state >> 12;
+    bench_state ^= bench_state << 25;
+    bench_state ^= bench_state >> 27;
+    return (unsigned long)((bench_state * 2685821657736338717ULL) >> 33) % n;
+}
+
+static const char bench_alnum[] =
+    "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+/* text buffer that only grows */
+struct bench_text {
+    char* s;
+    size_t len;
+    size_t cap;
+};
+
+static void text_putc(struct bench_text* t, char c) {
+    if (t->len + 2 > t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 256;
+        t->s = realloc(t->s, t->cap);
+        if (!t->s) {
+            fprintf(stderr, "dsvbench: out of memory\n");
+            exit(1);
+        }
+    }
+    t->s[t->len++] = c;
+    t->s[t->len] = '\0';
+}
+
+static void text_word(struct bench_text* t, size_t len) {
+    size_t i;
+    for (i = 0; i < len; ++i) {
+        text_putc(t, bench_alnum[bench_rand(sizeof(bench_alnum)-1)]);
+    }
+}
+
+/* Field shapes:
+ *  'w'  short unquoted word
+ *  'q'  quoted text with an embedded delimiter and a doubled quote
+ *  'n'  quoted text with an embedded newline
+ *  'l'  long unquoted text
+ */
+static void text_field(struct bench_text* t, const struct bench_data* d,
+                       char shape) {
+    switch (shape) {
+        case 'q':
+            text_putc(t, d->quote);
+            text_word(t, 2 + bench_rand(8));
+            text_putc(t, d->delim);
+            text_word(t, 1 + bench_rand(4));
+            text_putc(t, d->quote);
+            text_putc(t, d->quote);
+            text_word(t, 2 + bench_rand(6));
+            text_putc(t, d->quote);
+            break;
+        case 'n':
+            text_putc(t, d->quote);
+            text_word(t, 4 + bench_rand(16));
+            text_putc(t, '\n');
+            text_word(t, 4 + bench_rand(16));
+            text_putc(t, d->quote);
+            break;
+        case 'l':
+            text_word(t, 2048 + bench_rand(6144));
+            break;
+        default:
+            text_word(t, 3 + bench_rand(8));
+            break;
+    }
+}
+
+struct bench_shape {
+    const char* name;
+    char quote;
+    char delim;
+    enum UAQuoteStyle quoting;
+    size_t fields;
+    const char* pattern;    /* field shapes, repeated across the record */
+    size_t divisor;         /* fraction of the requested row count */
+};
+
+static const struct bench_shape bench_shapes[] = {
+    {"narrow", '"', ',', QUOTE_NEEDED, 8, "w", 1},
+    {"wide", '"', ',', QUOTE_NEEDED, 120, "w", 10},
+    {"quoted", '"', ',', QUOTE_NEEDED, 10, "q", 1},
+    {"newlines", '"', ',', QUOTE_NEEDED, 6, "wn", 1},
+    {"long", '"', ',', QUOTE_NEEDED, 4, "l", 40},
+    {"psv", '\0', '|', QUOTE_NONE, 10, "w", 1}
+};
+
+static void bench_generate(struct bench_data* d, const struct bench_shape* sh,
+                           size_t nrows) {
+    struct bench_text t = {NULL, 0, 0};
+    size_t i, j, k;
+
+    d->name = sh->name;
+    d->quote = sh->quote;
+    d->delim = sh->delim;
+    d->quoting = sh->quoting;
+    d->nrows = nrows / sh->divisor ? nrows / sh->divisor : 1;
+    d->bytes = 0;
+    d->rows8 = calloc(d->nrows, sizeof(char*));
+    d->rowsw = calloc(d->nrows, sizeof(TMCHAR*));
+    d->parsed8 = calloc(d->nrows, sizeof(const char**));
+    d->parsedw = calloc(d->nrows, sizeof(const TMCHAR**));
+
+    for (i = 0; i < d->nrows; ++i) {
+        t.len = 0;
+        for (j = 0; j < sh->fields; ++j) {
+            if (j != 0) {
+                text_putc(&t, d->delim);
+            }
+            text_field(&t, d, sh->pattern[j % strlen(sh->pattern)]);
+        }
+        d->bytes += t.len;
+        d->rows8[i] = strdup(t.s);
+        d->rowsw[i] = calloc(t.len+1, sizeof(TMCHAR));
+        for (k = 0; k < t.len; ++k) {
+            d->rowsw[i][k] = (TMCHAR)(unsigned char)t.s[k];
+        }
+        d->parsed8[i] = ua_parse_dsv_u8(d->rows8[i], d->quote, d->delim);
+        d->parsedw[i] = ua_parse_dsv(d->rowsw[i], d->quote, d->delim);
+    }
+    free(t.s);
+}
+
+static void bench_release(struct bench_data* d) {
+    size_t i;
+    for (i = 0; i < d->nrows; ++i) {
+        free(d->rows8[i]);
+        free(d->rowsw[i]);
+        ua_free_dsv_u8(d->parsed8[i]);
+        ua_free_dsv(d->parsedw[i]);
+    }
+    free(d->rows8);
+    free(d->rowsw);
+    free(d->parsed8);
+    free(d->parsedw);
+}
+
+/* }}} REGION: DATASETS */
+
+/* {{{ REGION: OPERATIONS */
+
+/* keeps the compiler from discarding results */
+static volatile unsigned long bench_sink = 0;
+
+/* arena of the running measurement, if any */
+static struct ua_dsv_arena* bench_arena = NULL;
+
+/* end of one row of a per-row loop: an arena is reset here, as an embedding
+ * program would once it is done with the row */
+static void bench_row_done(void) {
+    if (bench_arena) {
+        ua_dsv_arena_reset(bench_arena);
+    }
+}
+
+static void op_strcount_u8(const struct bench_data* d) {
+    size_t i;
+    for (i = 0; i < d->nrows; ++i) {
+        bench_sink += ua_strcount_u8(d->rows8[i], d->delim);
+    }
+}
+
+static void op_strcount_tm(const struct bench_data* d) {
+    size_t i;
+    for (i = 0; i < d->nrows; ++i) {
+        bench_sink += ua_strcount(d->rowsw[i], d->delim);
+    }
+}
+
+static void op_dsvtok_u8(const struct bench_data* d) {
+    size_t i;
+    for (i = 0; i < d->nrows; ++i) {
+        const char* r = d->rows8[i];
+        const char* out = NULL;
+        while (r && *r) {
+            r = ua_dsvtok_u8(r, &out, d->quote, d->delim);
+            ua_dsv_free(out);
+        }
+        bench_row_done();
+    }
+}
+
+static void op_dsvtok_tm(const struct bench_data* d) {
+    size_t i;
+    for (i = 0; i < d->nrows; ++i) {
+        const TMCHAR* r = d->rowsw[i];
+        const TMCHAR* out = NULL;
+        while (r && *r) {
+            r = ua_dsvtok(r, &out, d->quote, d->delim);
+            ua_dsv_free(out);
+        }
+        bench_row_done();
+    }
+}
+
+static void op_parse_u8(const struct bench_data* d) {
+    size_t i;
+    for (i = 0; i < d->nrows; ++i) {
+        ua_free_dsv_u8(ua_parse_dsv_u8(d->rows8[i], d->quote, d->delim));
+        bench_row_done();
+    }
+}
+
+static void op_parse_tm(const struct bench_data* d) {
+    size_t i;
+    for (i = 0; i < d->nrows; ++i) {
+        ua_free_dsv(ua_parse_dsv(d->rowsw[i], d->quote, d->delim));
+        bench_row_done();
+    }
+}
+
+/* one row per pass, reused for every line; never reset with the arena */
+static void op_parse_into_u8(const struct bench_data* d) {
+    struct ua_dsv_row_u8 row;
+    size_t i;
+    ua_dsv_row_init_u8(&row);
+    for (i = 0; i < d->nrows; ++i) {
+        ua_parse_dsv_into_u8(&row, d->rows8[i], d->quote, d->delim);
+        bench_sink += row.nfields;
+    }
+    ua_dsv_row_free_u8(&row);
+}
+
+static void op_parse_into_tm(const struct bench_data* d) {
+    struct ua_dsv_row row;
+    size_t i;
+    ua_dsv_row_init(&row);
+    for (i = 0; i < d->nrows; ++i) {
+        ua_parse_dsv_into(&row, d->rowsw[i], d->quote, d->delim);
+        bench_sink += row.nfields;
+    }
+    ua_dsv_row_free(&row);
+}
+
+/* a consumer that reads two fields of each row: the first and the last */
+static void op_parse_lazy_u8(const struct bench_data* d) {
+    struct ua_dsv_lazy_row_u8 row;
+    size_t i, len;
+    ua_dsv_lazy_init_u8(&row);
+    for (i = 0; i < d->nrows; ++i) {
+        ua_parse_dsv_lazy_u8(&row, d->rows8[i], d->quote, d->delim);
+        ua_dsv_lazy_get_u8(&row, 0, &len);
+        bench_sink += len;
+        ua_dsv_lazy_get_u8(&row, row.nfields - 1, &len);
+        bench_sink += len;
+    }
+    ua_dsv_lazy_free_u8(&row);
+}
+
+static void op_parse_lazy_tm(const struct bench_data* d) {
+    struct ua_dsv_lazy_row row;
+    size_t i, len;
+    ua_dsv_lazy_init(&row);
+    for (i = 0; i < d->nrows; ++i) {
+        ua_parse_dsv_lazy(&row, d->rowsw[i], d->quote, d->delim);
+        ua_dsv_lazy_get(&row, 0, &len);
+        bench_sink += len;
+        ua_dsv_lazy_get(&row, row.nfields - 1, &len);
+        bench_sink += len;
+    }
+    ua_dsv_lazy_free(&row);
+}
+
+static int scan_field_u8(void* user, const char* field, size_t len,
+                         int flags) {
+    (void)user;
+    (void)field;
+    bench_sink += len + (unsigned long)flags;
+    return 1;
+}
+
+static int scan_field_tm(void* user, const TMCHAR* field, size_t len,
+                         int flags) {
+    (void)user;
+    (void)field;
+    bench_sink += len + (unsigned long)flags;
+    return 1;
+}
+
+static void op_scan_u8(const struct bench_data* d) {
+    size_t i;
+    for (i = 0; i < d->nrows; ++i) {
+        ua_dsv_scan_u8(d->rows8[i], strlen(d->rows8[i]), d->quote, d->delim,
+                       scan_field_u8, NULL, NULL);
+    }
+}
+
+static void op_scan_tm(const struct bench_data* d) {
+    size_t i;
+    for (i = 0; i < d->nrows; ++i) {
+        ua_dsv_scan(d->rowsw[i], tmstrlen(d->rowsw[i]), d->quote, d->delim,
+                    scan_field_tm, NULL, NULL);
+    }
+}
+
+static void op_format_u8(const struct bench_data* d) {
+    size_t i;
+    for (i = 0; i < d->nrows; ++i) {
+        ua_dsv_free(ua_format_dsv_u8(d->parsed8[i], d->quoting,
+                                     d->quote, d->delim, '\0'));
+        bench_row_done();
+    }
+}
+
+static void op_format_tm(const struct bench_data* d) {
+    size_t i;
+    for (i = 0; i < d->nrows; ++i) {
+        ua_dsv_free(ua_format_dsv(d->parsedw[i], d->quoting,
+                                  d->quote, d->delim, '\0'));
+        bench_row_done();
+    }
+}
+
+/* psv datasets are converted to CSV, the others to PSV */
+static void op_transcode_u8(const struct bench_data* d) {
+    int to_csv = d->quote == '\0';
+    size_t i;
+    for (i = 0; i < d->nrows; ++i) {
+        char* out = NULL;
+        size_t len = 0, cap = 0;
+        ua_dsv_transcode_u8(d->rows8[i], strlen(d->rows8[i]), TRUE,
+                            d->quote, d->delim, &out, &len, &cap,
+                            to_csv ? QUOTE_NEEDED : QUOTE_NONE,
+                            to_csv ? '"' : '\0', to_csv ? ',' : '|', '\0');
+        bench_sink += len;
+        ua_dsv_free(out);
+        bench_row_done();
+    }
+}
+
+static void op_transcode_tm(const struct bench_data* d) {
+    int to_csv = d->quote == '\0';
+    size_t i;
+    for (i = 0; i < d->nrows; ++i) {
+        TMCHAR* out = NULL;
+        size_t len = 0, cap = 0;
+        ua_dsv_transcode(d->rowsw[i], tmstrlen(d->rowsw[i]), TRUE,
+                         d->quote, d->delim, &out, &len, &cap,
+                         to_csv ? QUOTE_NEEDED : QUOTE_NONE,
+                         to_csv ? '"' : '\0', to_csv ? ',' : '|', '\0');
+        bench_sink += len;
+        ua_dsv_free(out);
+        bench_row_done();
+    }
+}
+
+struct bench_op {
+    const char* name;
+    const char* engine;
+    void (*run)(const struct bench_data* d);
+};
+
+static const struct bench_op bench_ops[] = {
+    {"ua_strcount", "u8", op_strcount_u8},
+    {"ua_strcount", "tmchar", op_strcount_tm},
+    {"ua_dsvtok", "u8", op_dsvtok_u8},
+    {"ua_dsvtok", "tmchar", op_dsvtok_tm},
+    {"ua_parse_dsv", "u8", op_parse_u8},
+    {"ua_parse_dsv", "tmchar", op_parse_tm},
+    {"ua_parse_dsv_into", "u8", op_parse_into_u8},
+    {"ua_parse_dsv_into", "tmchar", op_parse_into_tm},
+    {"ua_parse_dsv_lazy", "u8", op_parse_lazy_u8},
+    {"ua_parse_dsv_lazy", "tmchar", op_parse_lazy_tm},
+    {"ua_dsv_scan", "u8", op_scan_u8},
+    {"ua_dsv_scan", "tmchar", op_scan_tm},
+    {"ua_format_dsv", "u8", op_format_u8},
+    {"ua_format_dsv", "tmchar", op_format_tm},
+    {"ua_dsv_transcode", "u8", op_transcode_u8},
+    {"ua_dsv_transcode", "tmchar", op_transcode_tm}
+};
+
+/* }}} REGION: OPERATIONS */
+
+/* {{{ REGION: DRIVER */
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static const char* const bench_allocators[] = {"malloc", "arena", "pool"};
+
+static void bench_measure(const struct bench_op* op,
+                          const struct bench_data* d, const char* allocator,
+                          double min_time) {
+    struct ua_dsv_pool* pool = NULL;
+    struct ua_dsv_allocator a;
+    unsigned long passes = 0;
+    unsigned long allocs;
+    double start, elapsed;
+
+    if (!strcmp(allocator, "arena")) {
+        bench_arena = ua_dsv_arena_new(0);
+        a = ua_dsv_arena_allocator(bench_arena);
+        ua_dsv_set_allocator(&a);
+    } else if (!strcmp(allocator, "pool")) {
+        pool = ua_dsv_pool_new();
+        a = ua_dsv_pool_allocator(pool);
+        ua_dsv_set_allocator(&a);
+    }
+
+    /* warm up caches and the allocator */
+    op->run(d);
+
+    ua_dsv_stats_reset(&bench_stats);
+    start = bench_now();
+    do {
+        op->run(d);
+        passes += 1;
+        elapsed = bench_now() - start;
+    } while (elapsed < min_time);
+    allocs = (unsigned long)bench_stats.allocs;
+
+    ua_dsv_set_allocator(NULL);
+    ua_dsv_arena_free(bench_arena);
+    ua_dsv_pool_free(pool);
+    bench_arena = NULL;
+
+    printf("%s,%s,%s,%s,%lu,%lu,%.6f,%.3f,%.1f,%.3f\n",
+           op->name, d->name, op->engine, allocator,
+           (unsigned long)(d->nrows * passes),
+           (unsigned long)(d->bytes * passes),
+           elapsed,
+           (double)d->bytes * passes / elapsed / 1e6,
+           (double)d->nrows * passes / elapsed,
+           (double)allocs / ((double)d->nrows * passes));
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    size_t nrows = 20000;
+    double min_time = 0.5;
+    const char* only_data = NULL;
+    const char* only_op = NULL;
+    const char* only_alloc = NULL;
+    size_t i, j, k;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:t:s:d:o:a:")) != -1) {
+        switch (opt) {
+            case 'r': nrows = strtoul(optarg, NULL, 10); break;
+            case 't': min_time = strtod(optarg, NULL); break;
+            case 's': bench_state = strtoull(optarg, NULL, 10) | 1; break;
+            case 'd': only_data = optarg; break;
+            case 'o': only_op = optarg; break;
+            case 'a': only_alloc = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-r rows] [-t seconds] [-s seed] "
+                                "[-d dataset] [-o op] [-a allocator]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    ua_dsv_stats_attach(&bench_stats);
+    printf("op,dataset,engine,allocator,rows,bytes,seconds,mb_per_s,"
+           "rows_per_s,allocs_per_row\n");
+    for (i = 0; i < sizeof(bench_shapes)/sizeof(bench_shapes[0]); ++i) {
+        struct bench_data d;
+        if (only_data && strcmp(only_data, bench_shapes[i].name)) {
+            continue;
+        }
+        bench_generate(&d, &bench_shapes[i], nrows);
+        for (j = 0; j < sizeof(bench_ops)/sizeof(bench_ops[0]); ++j) {
+            if (only_op && strcmp(only_op, bench_ops[j].name)) {
+                continue;
+            }
+            for (k = 0; k < sizeof(bench_allocators)/sizeof(char*); ++k) {
+                if (only_alloc && strcmp(only_alloc, bench_allocators[k])) {
+                    continue;
+                }
+                bench_measure(&bench_ops[j], &d, bench_allocators[k],
+                              min_time);
+            }
+        }
+        bench_release(&d);
+    }
+    return 0;
+}
+
+/* }}} REGION: DRIVER */
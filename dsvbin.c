@@ -0,0 +1,386 @@
+
+/*****************************************************************************/
+/*    Name: dsvbin.c                                                         */
+/*   Title: Delimiter-Separated-Value Binary Row Converter                   */
+/* Purpose: Convert DSV files to the binary row format of ua_dsv_bin and     */
+/*          back, so that internal hops between programs skip quoting.       */
+/*  Author: Peter Schultz (sxpws)                                            */
+/*****************************************************************************/
+/* UA AUDIT TRAIL                                                            */
+/*                                                                           */
+/* 2026/10/18 sxpws Initial commit                                           */
+/* 2026/10/18 sxpws Split and repair chunks with dsvtool                     */
+/*                                                                           */
+/* UA AUDIT TRAIL END                                                        */
+/*****************************************************************************/
+
+/* Usage: dsvbin [-i dialect] [-H] [-n null] [-j threads] [-c MiB] [file]
+ *        dsvbin -d [-o dialect] [-H] [-n null] [file]
+ *
+ *  -d              decode: convert a binary row stream to DSV
+ *  -i dialect      dialect of the input (default psv; see dsvtool.h)
+ *  -o dialect      dialect to write when decoding (default psv)
+ *  -H              the first record is the column names: encoding takes
+ *                  it as the schema, decoding writes the schema as one
+ *                  unless it has no columns
+ *  -n null         value that stands for a null field (default empty)
+ *  -j threads      worker threads to encode with (default: one per CPU)
+ *  -c MiB          split the input into chunks of this size (default 8)
+ *
+ * The input, or stdin when there is none or for "-", is written to stdout.
+ * Encoding turns every record ua_dsv_scan finds into a row of its
+ * unescaped fields, so a blank line is a row without fields; a field that
+ * is not quoted and equals the null value is null. Decoding formats every
+ * row as a record with ua_dsv_format_field, writing the null value for null
+ * fields and quoting fields that equal it, so that a stream decoded and
+ * encoded again with the same dialect and null value keeps its nulls. It
+ * cannot when the dialect has no quote, or for a last field that is null
+ * when the null value is empty, since an unquoted empty last field is no
+ * field at all; give -n a value such as \N where that matters.
+ *
+ * The exit status is 0 on success, 1 if the input could not be converted
+ * and 2 on bad usage.
+ *
+ *  cc -O2 dsvbin.c dsvtool.c gua2csv.c -o dsvbin -lpthread
+ *
+ * Chunks are split by dsvtool_split_chunks and encoded in parallel, each
+ * into its own buffer; the buffers are written in order once the chunks
+ * whose guess was wrong have been encoded again. Decoding reads the stream
+ * in place, a row at a time.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dsvtool.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* {{{ REGION: ENCODING */
+
+static struct dsvtool_dialect bin_dialect;
+static const char* bin_null = "";
+static size_t bin_null_len;
+static int bin_header;
+static size_t bin_chunk_size = 8u << 20;
+
+/* stands for a null field among the fields of a record */
+static const char bin_null_field[1];
+
+struct bin_chunk {
+    struct dsvtool_chunk span;  /* first, as dsvtool.h asks */
+    const struct dsvtool_input* in;
+    struct dsvtool_buf rows;
+    struct dsvtool_buf schema;  /* the first record, under -H */
+    int failed;
+};
+
+/* the fields of the record being scanned, which are only encoded once it
+ * is known to end in the chunk */
+struct bin_scan {
+    struct bin_chunk* c;
+    const char* base;
+    const char* limit;
+    int final;                  /* the chunk ends the input */
+    size_t done;                /* end of the last record, from base */
+    int schema;                 /* the next record is the schema */
+
+    const char** fields;        /* NULL for values in chars */
+    size_t* lens;
+    size_t nfields;
+    size_t fields_cap;
+    size_t lens_cap;
+    char* chars;
+    size_t chars_len;
+    size_t chars_cap;
+};
+
+static void* bin_grow(void* p, size_t* cap, size_t need, size_t size) {
+    size_t n = *cap ? *cap : 64;
+    while (n < need) n *= 2;
+    if (n != *cap) {
+        p = realloc(p, n * size);
+        if (!p) dsvtool_oom("records");
+        *cap = n;
+    }
+    return p;
+}
+
+static int bin_on_field(void* user, const char* field, size_t len,
+                        int flags) {
+    struct bin_scan* s = user;
+
+    s->fields = bin_grow(s->fields, &s->fields_cap, s->nfields + 1,
+                         sizeof(*s->fields));
+    s->lens = bin_grow(s->lens, &s->lens_cap, s->nfields + 1,
+                       sizeof(*s->lens));
+    if (flags & UA_DSV_FIELD_UNESCAPE) {
+        s->chars = bin_grow(s->chars, &s->chars_cap,
+                            s->chars_len + len + 1, 1);
+        s->fields[s->nfields] = NULL;
+        s->lens[s->nfields] = ua_dsv_unescape_u8(field, len,
+                                                 bin_dialect.quote,
+                                                 s->chars + s->chars_len);
+        s->chars_len += s->lens[s->nfields];
+    } else if (!(flags & UA_DSV_FIELD_QUOTED) && len == bin_null_len &&
+               memcmp(field, bin_null, len) == 0) {
+        s->fields[s->nfields] = bin_null_field;
+        s->lens[s->nfields] = 0;
+    } else {
+        s->fields[s->nfields] = field;
+        s->lens[s->nfields] = len;
+    }
+    s->nfields += 1;
+    return TRUE;
+}
+
+static int bin_on_record(void* user, const char* record, size_t len,
+                         size_t nfields) {
+    struct bin_scan* s = user;
+    struct dsvtool_buf* out;
+    const char* end = record + len;
+    size_t eol = 0, off = 0, n, i;
+
+    s->nfields = 0;
+    s->chars_len = 0;
+    /* the record runs into the next chunk, which encodes it */
+    if (!s->final && (end >= s->limit ||
+                      (*end == '\r' && end + 1 >= s->limit))) {
+        return FALSE;
+    }
+    if (end < s->limit && (*end == '\r' || *end == '\n')) {
+        eol = *end == '\r' && end + 1 < s->limit && end[1] == '\n' ? 2 : 1;
+    }
+    s->done = (size_t)(end - s->base) + eol;
+
+    for (i = 0; i < nfields; ++i) {
+        if (!s->fields[i]) {
+            s->fields[i] = s->chars + off;
+            off += s->lens[i];
+        } else if (s->fields[i] == bin_null_field) {
+            /* column names are never null */
+            s->fields[i] = s->schema ? "" : NULL;
+        }
+    }
+    out = s->schema ? &s->c->schema : &s->c->rows;
+    n = s->schema ? ua_dsv_bin_put_header(NULL, s->fields, s->lens, nfields)
+                  : ua_dsv_bin_put_row(NULL, s->fields, s->lens, nfields);
+    if (n == 0) {
+        fprintf(stderr, "record at %lu: %s\n",
+                (unsigned long)(record - s->c->in->data), strerror(errno));
+        s->c->failed = TRUE;
+        return FALSE;
+    }
+    dsvtool_buf_reserve(out, n);
+    if (s->schema) {
+        ua_dsv_bin_put_header(out->s + out->len, s->fields, s->lens, nfields);
+    } else {
+        ua_dsv_bin_put_row(out->s + out->len, s->fields, s->lens, nfields);
+    }
+    out->len += n;
+    s->schema = FALSE;
+    return TRUE;
+}
+
+/* encode the records of @param c that end by its limit, starting from its
+ * start; the last chunk encodes everything that is left */
+static void bin_chunk_run(struct bin_chunk* c) {
+    struct bin_scan s;
+
+    memset(&s, 0, sizeof(s));
+    s.c = c;
+    s.base = c->in->data + c->span.start;
+    s.limit = c->in->data + c->span.limit;
+    s.final = c->span.limit == c->in->len;
+    s.schema = bin_header && c->span.start == 0;
+    c->rows.len = 0;
+    c->schema.len = 0;
+    c->failed = FALSE;
+    ua_dsv_scan_u8(s.base, c->span.limit - c->span.start, bin_dialect.quote,
+                   bin_dialect.delim, bin_on_field, bin_on_record, &s);
+    c->span.end = c->span.start + s.done;
+    free(s.fields);
+    free(s.lens);
+    free(s.chars);
+}
+
+static void bin_chunk_task(void* arg) {
+    bin_chunk_run(arg);
+}
+
+static int bin_encode(const struct dsvtool_input* in, unsigned threads) {
+    struct dsvtool_pool* pool;
+    struct bin_chunk* chunks;
+    struct dsvtool_buf* schema = NULL;
+    size_t nchunks, i;
+    int ok = TRUE;
+
+    chunks = dsvtool_split_chunks(in, bin_chunk_size, sizeof(*chunks),
+                                  &nchunks);
+    pool = dsvtool_pool_new(threads);
+    for (i = 0; i < nchunks; ++i) {
+        chunks[i].in = in;
+        dsvtool_pool_submit(pool, bin_chunk_task, &chunks[i]);
+    }
+    dsvtool_pool_wait(pool);
+    dsvtool_pool_free(pool);
+    dsvtool_repair_chunks(chunks, nchunks, sizeof(*chunks), bin_chunk_task);
+
+    /* the schema is in whichever chunk encoded the first record */
+    for (i = 0; i < nchunks; ++i) {
+        if (chunks[i].failed) ok = FALSE;
+        if (chunks[i].schema.len) schema = &chunks[i].schema;
+    }
+    if (ok && !schema) {
+        schema = &chunks[0].schema;
+        dsvtool_buf_reserve(schema, ua_dsv_bin_put_header(NULL, NULL,
+                                                          NULL, 0));
+        schema->len = ua_dsv_bin_put_header(schema->s, NULL, NULL, 0);
+    }
+    if (ok) {
+        ok = dsvtool_write(STDOUT_FILENO, schema->s, schema->len);
+        for (i = 0; ok && i < nchunks; ++i) {
+            ok = dsvtool_write(STDOUT_FILENO, chunks[i].rows.s,
+                               chunks[i].rows.len);
+        }
+        if (!ok) fprintf(stderr, "stdout: %s\n", strerror(errno));
+    }
+
+    for (i = 0; i < nchunks; ++i) {
+        dsvtool_buf_free(&chunks[i].rows);
+        dsvtool_buf_free(&chunks[i].schema);
+    }
+    free(chunks);
+    return ok;
+}
+
+/* }}} REGION: ENCODING */
+
+/* {{{ REGION: DECODING */
+
+#define BIN_FLUSH (1u << 20)
+
+/* append @param row as a record, with the null value for null fields and
+ * quotes around fields that would read as null */
+static void bin_put_record(struct dsvtool_buf* buf,
+                           const struct ua_dsv_bin_row* row) {
+    size_t i;
+    for (i = 0; i < row->nfields; ++i) {
+        const char* field = row->fields[i];
+        size_t len = field ? row->lens[i] : bin_null_len;
+        enum UAQuoteStyle quoting = bin_dialect.quoting;
+
+        /* worst case: delimiter, quotes and every character escaped */
+        dsvtool_buf_reserve(buf, 2 * len + 3);
+        if (i != 0) {
+            buf->s[buf->len++] = bin_dialect.delim;
+        }
+        if (!field) {
+            memcpy(buf->s + buf->len, bin_null, len);
+            buf->len += len;
+            continue;
+        }
+        if (len == bin_null_len && memcmp(field, bin_null, len) == 0) {
+            quoting = QUOTE_ALL;
+        }
+        buf->len += ua_dsv_format_field_u8(buf->s + buf->len, field, len,
+                                           i+1 == row->nfields, quoting,
+                                           bin_dialect.quote,
+                                           bin_dialect.delim,
+                                           bin_dialect.escape);
+    }
+    dsvtool_buf_put(buf, "\n", 1);
+}
+
+static int bin_decode(const struct dsvtool_input* in) {
+    struct ua_dsv_bin_reader reader;
+    struct ua_dsv_bin_row row;
+    struct dsvtool_buf buf;
+    int ok = TRUE, got;
+
+    if (!ua_dsv_bin_open(&reader, in->data, in->len)) {
+        fprintf(stderr, "not a binary row stream: %s\n", strerror(errno));
+        return FALSE;
+    }
+    memset(&buf, 0, sizeof(buf));
+    ua_dsv_bin_row_init(&row);
+    if (bin_header && reader.columns.nfields) {
+        bin_put_record(&buf, &reader.columns);
+    }
+    while (ok && (got = ua_dsv_bin_next(&reader, &row)) != 0) {
+        if (got < 0) {
+            if (errno == ENOMEM) dsvtool_oom("rows");
+            fprintf(stderr, "row at %lu: %s\n", (unsigned long)reader.offset,
+                    strerror(errno));
+            ok = FALSE;
+            break;
+        }
+        bin_put_record(&buf, &row);
+        if (buf.len >= BIN_FLUSH) {
+            ok = dsvtool_write(STDOUT_FILENO, buf.s, buf.len);
+            if (!ok) fprintf(stderr, "stdout: %s\n", strerror(errno));
+            buf.len = 0;
+        }
+    }
+    if (ok && !dsvtool_write(STDOUT_FILENO, buf.s, buf.len)) {
+        fprintf(stderr, "stdout: %s\n", strerror(errno));
+        ok = FALSE;
+    }
+    ua_dsv_bin_row_free(&row);
+    ua_dsv_bin_close(&reader);
+    dsvtool_buf_free(&buf);
+    return ok;
+}
+
+/* }}} REGION: DECODING */
+
+/* {{{ REGION: DRIVER */
+
+int main(int argc, char** argv) {
+    const char* in_spec = "psv";
+    const char* out_spec = "psv";
+    const char* path = "-";
+    unsigned threads = 0;
+    int decode = FALSE;
+    struct dsvtool_input in;
+    int opt, ok;
+
+    while ((opt = getopt(argc, argv, "di:o:Hn:j:c:")) != -1) {
+        switch (opt) {
+            case 'd': decode = TRUE; break;
+            case 'i': in_spec = optarg; break;
+            case 'o': out_spec = optarg; break;
+            case 'H': bin_header = TRUE; break;
+            case 'n': bin_null = optarg; break;
+            case 'j': threads = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 'c':
+                bin_chunk_size = (size_t)(strtod(optarg, NULL) * 1048576);
+                break;
+            default:
+                goto usage;
+        }
+    }
+    if (argc - optind > 1 || bin_chunk_size == 0 ||
+        !dsvtool_parse_dialect(decode ? out_spec : in_spec, &bin_dialect)) {
+        goto usage;
+    }
+    if (optind < argc) path = argv[optind];
+    bin_null_len = strlen(bin_null);
+
+    if (!dsvtool_input_open(path, &in)) return 1;
+    ok = decode ? bin_decode(&in) : bin_encode(&in, threads);
+    dsvtool_input_close(&in);
+    return ok ? 0 : 1;
+
+usage:
+    fprintf(stderr, "usage: %s [-i dialect] [-H] [-n null] [-j threads] "
+                    "[-c MiB] [file]\n"
+                    "       %s -d [-o dialect] [-H] [-n null] [file]\n",
+            argv[0], argv[0]);
+    return 2;
+}
+
+/* }}} REGION: DRIVER */
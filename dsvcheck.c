@@ -0,0 +1,212 @@
+
+/*****************************************************************************/
+/*    Name: dsvcheck.c                                                       */
+/*   Title: Delimiter-Separated-Value Record Shape Validator                 */
+/* Purpose: Check the shape of every record of a DSV file before it is       */
+/*          loaded, passing good records through and quarantining bad ones.  */
+/*  Author: Peter Schultz (sxpws)                                            */
+/*****************************************************************************/
+/* UA AUDIT TRAIL                                                            */
+/*                                                                           */
+/* 2026/10/18 sxpws Initial commit                                           */
+/*                                                                           */
+/* UA AUDIT TRAIL END                                                        */
+/*****************************************************************************/
+
+/* Usage: dsvcheck [-i dialect] [-n fields] [-l length] [-q quarantine]
+ *                 [-Q dialect] [-s] [file]
+ *
+ *  -i dialect      dialect of the input (default psv; see dsvtool.h)
+ *  -n fields       fields every record must have (default: as many as the
+ *                  first record that has any)
+ *  -l length       longest field value allowed (default: no limit)
+ *  -q quarantine   write bad records to this file
+ *  -Q dialect      dialect of the quarantine file (default csv)
+ *  -s              report the counts and the time taken on stderr
+ *
+ * The input, or stdin when there is none or for "-", is checked by
+ * ua_dsv_check_u8 in one scan. Good records are written to stdout as they
+ * are in the input, EOL included, without being parsed again; a last record
+ * without an EOL gets a "\n". Bad records are counted and, with -q, written
+ * to the quarantine file as records of their line number, their problems
+ * ("fields", "length" and "quote", separated by '+'), their number of
+ * fields and their text without its EOL.
+ *
+ * Blank lines are bad records, with no fields. A quoted field that is never
+ * closed would take the rest of the input: only its first line is a bad
+ * record, and checking goes on from the next line.
+ *
+ * The exit status is 0 when every record is good, 1 when some are bad and
+ * 2 on trouble.
+ *
+ *  cc -O2 dsvcheck.c dsvtool.c gua2csv.c -o dsvcheck -lpthread
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dsvtool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* {{{ REGION: CHECKING */
+
+#define CHECK_FLUSH (1u << 20)
+
+static struct dsvtool_dialect check_in;
+static struct dsvtool_dialect check_q;
+
+struct check_output {
+    struct dsvtool_buf good;
+    struct dsvtool_buf bad;
+    int fd;                     /* of the quarantine, or -1 */
+    uint64_t records;
+    uint64_t bad_records;
+    int failed;                 /* a write failed; errno says why */
+};
+
+static int check_flush(struct check_output* out, size_t at_least) {
+    if (out->good.len >= at_least) {
+        if (!dsvtool_write(STDOUT_FILENO, out->good.s, out->good.len)) {
+            fprintf(stderr, "stdout: %s\n", strerror(errno));
+            return FALSE;
+        }
+        out->good.len = 0;
+    }
+    if (out->bad.len >= at_least && out->fd >= 0) {
+        if (!dsvtool_write(out->fd, out->bad.s, out->bad.len)) {
+            fprintf(stderr, "quarantine: %s\n", strerror(errno));
+            return FALSE;
+        }
+        out->bad.len = 0;
+    }
+    return TRUE;
+}
+
+/* the record's text without its EOL */
+static size_t check_text(const char* record, size_t len) {
+    if (len > 0 && record[len - 1] == '\n') --len;
+    if (len > 0 && record[len - 1] == '\r') --len;
+    return len;
+}
+
+static int check_on_record(void* user, const char* record, size_t len,
+                           uint64_t line, size_t nfields, int problems) {
+    struct check_output* out = user;
+
+    out->records += 1;
+    if (!problems) {
+        dsvtool_buf_put(&out->good, record, len);
+        if (check_text(record, len) == len) {
+            dsvtool_buf_put(&out->good, "\n", 1);
+        }
+    } else {
+        out->bad_records += 1;
+        if (out->fd >= 0) {
+            char numbers[2][32];
+            char why[32] = "";
+            const char* fields[4];
+            size_t lens[4];
+
+            if (problems & UA_DSV_BAD_FIELDS) strcat(why, "+fields");
+            if (problems & UA_DSV_BAD_LENGTH) strcat(why, "+length");
+            if (problems & UA_DSV_BAD_QUOTE) strcat(why, "+quote");
+            lens[0] = (size_t)sprintf(numbers[0], "%" PRIu64, line);
+            fields[0] = numbers[0];
+            fields[1] = why + 1;
+            lens[1] = strlen(why + 1);
+            lens[2] = (size_t)sprintf(numbers[1], "%lu",
+                                      (unsigned long)nfields);
+            fields[2] = numbers[1];
+            fields[3] = record;
+            lens[3] = check_text(record, len);
+            dsvtool_put_record(&out->bad, fields, lens, 4, &check_q);
+        }
+    }
+    if (!check_flush(out, CHECK_FLUSH)) {
+        out->failed = TRUE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* }}} REGION: CHECKING */
+
+/* {{{ REGION: DRIVER */
+
+int main(int argc, char** argv) {
+    const char* in_spec = "psv";
+    const char* q_spec = "csv";
+    const char* quarantine = NULL;
+    const char* path = "-";
+    size_t nfields = 0;
+    size_t max_len = 0;
+    int summary = FALSE;
+    struct dsvtool_input in;
+    struct check_output out;
+    double started;
+    int opt, ok;
+
+    while ((opt = getopt(argc, argv, "i:n:l:q:Q:s")) != -1) {
+        switch (opt) {
+            case 'i': in_spec = optarg; break;
+            case 'n': nfields = (size_t)strtoul(optarg, NULL, 10); break;
+            case 'l': max_len = (size_t)strtoul(optarg, NULL, 10); break;
+            case 'q': quarantine = optarg; break;
+            case 'Q': q_spec = optarg; break;
+            case 's': summary = TRUE; break;
+            default:
+                goto usage;
+        }
+    }
+    if (argc - optind > 1 || !dsvtool_parse_dialect(in_spec, &check_in) ||
+        !dsvtool_parse_dialect(q_spec, &check_q)) {
+        goto usage;
+    }
+    if (optind < argc) path = argv[optind];
+
+    memset(&out, 0, sizeof(out));
+    out.fd = -1;
+    if (quarantine) {
+        out.fd = open(quarantine, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (out.fd < 0) {
+            fprintf(stderr, "%s: %s\n", quarantine, strerror(errno));
+            return 2;
+        }
+    }
+    started = dsvtool_now();
+    if (!dsvtool_input_open(path, &in)) return 2;
+
+    ua_dsv_check_u8(in.data, in.len, check_in.quote, check_in.delim, nfields,
+                    max_len, check_on_record, &out);
+    ok = !out.failed && check_flush(&out, 0);
+    if (out.fd >= 0 && close(out.fd) != 0 && ok) {
+        fprintf(stderr, "%s: %s\n", quarantine, strerror(errno));
+        ok = FALSE;
+    }
+    if (summary) {
+        double elapsed = dsvtool_now() - started;
+        fprintf(stderr, "dsvcheck: %" PRIu64 " records, %" PRIu64 " bad, "
+                        "%.1f MB, %.3f s, %.1f MB/s\n",
+                out.records, out.bad_records, (double)in.len / 1e6, elapsed,
+                (double)in.len / 1e6 / elapsed);
+    }
+
+    dsvtool_input_close(&in);
+    dsvtool_buf_free(&out.good);
+    dsvtool_buf_free(&out.bad);
+    if (!ok) return 2;
+    return out.bad_records > 0 ? 1 : 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-i dialect] [-n fields] [-l length] "
+                    "[-q quarantine] [-Q dialect] [-s] [file]\n", argv[0]);
+    return 2;
+}
+
+/* }}} REGION: DRIVER */
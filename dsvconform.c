@@ -0,0 +1,966 @@
+
+/*****************************************************************************/
+/*    Name: dsvconform.c                                                     */
+/*   Title: Delimiter-Separated-Value Conformance Harness                    */
+/* Purpose: Differentially test every DSV parsing path against a frozen     */
+/*          copy of the original ua_dsvtok state machine.                    */
+/*  Author: Peter Schultz (sxpws)                                            */
+/*****************************************************************************/
+/* UA AUDIT TRAIL                                                            */
+/*                                                                           */
+/* 2026/10/18 sxpws Initial commit                                           */
+/* 2026/10/18 sxpws Check ua_parse_dsv_into                                  */
+/* 2026/10/18 sxpws Check ua_dsv_scan                                        */
+/* 2026/10/18 sxpws Check the push parser                                    */
+/* 2026/10/18 sxpws Check ua_dsv_transcode                                   */
+/* 2026/10/18 sxpws Check lazy rows                                          */
+/* 2026/10/18 sxpws Reference is a frozen copy of the original ua_dsvtok     */
+/*                                                                           */
+/* UA AUDIT TRAIL END                                                        */
+/*****************************************************************************/
+
+/* Usage: dsvconform [-n iterations] [-s seed] [-l maxlen] [-i impl]
+ *
+ *  -n iterations   random inputs to try per dialect (default 100000)
+ *  -s seed         seed for the input generator (default 1)
+ *  -l maxlen       longest input to generate (default 48)
+ *  -i impl         only test the named implementation
+ *
+ * Build:  cc dsvconform.c gua2csv.c -o dsvconform
+ * Fuzz:   clang -DFUZZ -fsanitize=fuzzer dsvconform.c gua2csv.c
+ *
+ * Every implementation registered in conform_impls below is fed the same
+ * input as the reference, which is a copy of ua_dsvtok as it was before any
+ * fast path was written and is never changed: ua_dsvtok itself is now built
+ * on the same span finder as the others, so it is checked like them. On
+ * the first divergence the input is minimized, both outputs are printed,
+ * and the harness exits with status 1. Under FUZZ, the first byte of each
+ * fuzzer input selects the dialect and a divergence aborts.
+ *
+ * There are two kinds of implementation:
+ *
+ *  CONFORM_TOKEN   same contract as ua_dsvtok: each call must return the
+ *                  same field and the same resume position as the reference
+ *                  for every position the reference visits.
+ *
+ *  CONFORM_RECORD  produces whole records from a buffer. The reference
+ *                  splits records at an EOL outside of quotes ("\r\n" counts
+ *                  once) and their fields are exactly what ua_parse_dsv
+ *                  returns for that record. Implementations flagged with
+ *                  CONFORM_FIRST only see the first record. Converters are
+ *                  checked by scanning what they produce.
+ *
+ * A fast path must be registered here before it is switched on anywhere.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "gua2csv.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/* {{{ REGION: EVENT LOG */
+
+/* Parsers describe their output as a log of TMCHAR units: the characters of
+ * each field followed by LOG_FIELD, and LOG_RECORD after each record. The
+ * generator never produces these two characters. */
+enum {
+    LOG_FIELD = 0x1f,
+    LOG_RECORD = 0x1e
+};
+
+struct conform_log {
+    TMCHAR* s;
+    size_t len;
+    size_t cap;
+};
+
+static void log_put(struct conform_log* log, TMCHAR c) {
+    if (log->len == log->cap) {
+        log->cap = log->cap ? log->cap * 2 : 64;
+        log->s = realloc(log->s, log->cap * sizeof(TMCHAR));
+        if (!log->s) {
+            fprintf(stderr, "dsvconform: out of memory\n");
+            exit(2);
+        }
+    }
+    log->s[log->len++] = c;
+}
+
+static void log_field(struct conform_log* log, const TMCHAR* s, size_t len) {
+    size_t i;
+    for (i = 0; i < len; ++i) {
+        log_put(log, s[i]);
+    }
+    log_put(log, LOG_FIELD);
+}
+
+static void log_string(struct conform_log* log, const TMCHAR* s) {
+    size_t len = 0;
+    while (s[len]) { ++len; }
+    log_field(log, s, len);
+}
+
+static void log_record(struct conform_log* log) {
+    log_put(log, LOG_RECORD);
+}
+
+static int log_equal(const struct conform_log* a, const struct conform_log* b) {
+    if (a->len != b->len) {
+        return FALSE;
+    }
+    /* an empty log may have no storage at all */
+    return a->len == 0 || !memcmp(a->s, b->s, a->len * sizeof(TMCHAR));
+}
+
+static void print_char(FILE* f, unsigned long c) {
+    switch (c) {
+        case '\r': fputs("\\r", f); break;
+        case '\n': fputs("\\n", f); break;
+        case '\t': fputs("\\t", f); break;
+        case '"': fputs("\\\"", f); break;
+        case '\\': fputs("\\\\", f); break;
+        default:
+            if (c >= 0x20 && c < 0x7f) {
+                fputc((int)c, f);
+            } else {
+                fprintf(f, "\\x%02lx", c);
+            }
+            break;
+    }
+}
+
+static void log_number(struct conform_log* log, size_t n) {
+    TMCHAR digits[24];
+    size_t len = 0;
+    do {
+        digits[sizeof(digits)/sizeof(digits[0]) - ++len] =
+            (TMCHAR)('0' + n % 10);
+        n /= 10;
+    } while (n);
+    log_field(log, digits + sizeof(digits)/sizeof(digits[0]) - len, len);
+}
+
+static void log_print(FILE* f, const struct conform_log* log) {
+    int in_field = FALSE;
+    size_t i;
+    fputs("  [", f);
+    for (i = 0; i < log->len; ++i) {
+        if (log->s[i] == LOG_RECORD) {
+            fputs(i+1 < log->len ? "]\n  [" : "]", f);
+            continue;
+        }
+        if (!in_field) {
+            fputc('"', f);
+            in_field = TRUE;
+        }
+        if (log->s[i] == LOG_FIELD) {
+            fputs("\" ", f);
+            in_field = FALSE;
+        } else {
+            print_char(f, (unsigned long)log->s[i]);
+        }
+    }
+    fputc('\n', f);
+}
+
+/* }}} REGION: EVENT LOG */
+
+/* {{{ REGION: REFERENCE */
+
+static int conform_iseol(TMCHAR c) {
+    return c == '\r' || c == '\n' || c == '\0';
+}
+
+static size_t conform_strlen(const TMCHAR* s) {
+    size_t n = 0;
+    while (s[n]) { ++n; }
+    return n;
+}
+
+enum {
+    REF_START,
+    REF_IN_UNQUOTE,
+    REF_IN_QUOTE,
+    REF_ESCAPE_IN_QUOTE
+};
+
+/* The original ua_dsvtok, one character at a time. Keep it as it is: it is
+ * what every other parser is held to. *out is allocated with calloc. */
+static const TMCHAR* conform_dsvtok(const TMCHAR* line, const TMCHAR** out,
+                                    TMCHAR quot, TMCHAR delim) {
+    const TMCHAR* end = line;
+    int state = REF_START;
+    TMCHAR* buffer;
+    TMCHAR* bufpos;
+    size_t len;
+    int done = FALSE;
+
+    /* end condition: return an empty string */
+    if (conform_iseol(*line)) {
+        *out = calloc(1, sizeof(TMCHAR));
+        return *out ? line : NULL;
+    }
+
+    /* nothing is inserted, so the line is an upper limit */
+    buffer = bufpos = calloc(conform_strlen(line)+1, sizeof(TMCHAR));
+    if (!buffer) {
+        return NULL;
+    }
+
+    while (!done) {
+        TMCHAR c = *end;
+        switch (state) {
+            case REF_START:
+                if (quot && c == quot) {
+                    state = REF_IN_QUOTE;
+                } else if (c == delim || conform_iseol(c)) {
+                    done = TRUE;
+                } else if (c == ' ') {
+                    /* eat initial whitespace */
+                } else {
+                    *bufpos++ = c;
+                    state = REF_IN_UNQUOTE;
+                }
+                break;
+            case REF_IN_UNQUOTE:
+                if (c == delim || conform_iseol(c)) {
+                    done = TRUE;
+                } else {
+                    *bufpos++ = c;
+                }
+                break;
+            case REF_IN_QUOTE:
+                if (quot && c == quot) {
+                    state = REF_ESCAPE_IN_QUOTE;
+                } else if (c == '\0') {
+                    done = TRUE;
+                } else {
+                    /* EOLs are allowed here */
+                    *bufpos++ = c;
+                }
+                break;
+            case REF_ESCAPE_IN_QUOTE:
+                if (quot && c == quot) {
+                    /* escaped quote, emit one quote */
+                    *bufpos++ = c;
+                    state = REF_IN_QUOTE;
+                } else if (c == delim || conform_iseol(c)) {
+                    done = TRUE;
+                } else {
+                    /* rogue quote: emit '"' and the character literally */
+                    *bufpos++ = '"';
+                    *bufpos++ = c;
+                    state = REF_IN_QUOTE;
+                }
+                break;
+            default:
+                abort();
+        }
+        /* never traverse past a NIL */
+        if (c != '\0') {
+            ++end;
+        }
+    }
+
+    /* trim ending whitespace (stopping at empty) */
+    len = (size_t)(bufpos - buffer);
+    while (len > 0 && buffer[len-1] == ' ') {
+        buffer[--len] = '\0';
+    }
+    *out = buffer;
+    return end;
+}
+
+/* The reference token log: every call to conform_dsvtok the record loop makes,
+ * with the field returned and how far the call advanced. */
+static void reference_tokens(const TMCHAR* input, TMCHAR quote, TMCHAR delim,
+                             struct conform_log* log) {
+    const TMCHAR* r = input;
+    while (*r) {
+        const TMCHAR* out = NULL;
+        const TMCHAR* next = conform_dsvtok(r, &out, quote, delim);
+        if (!next) {
+            fprintf(stderr, "dsvconform: reference ran out of memory\n");
+            exit(2);
+        }
+        log_string(log, out);
+        log_number(log, (size_t)(next - r));
+        log_record(log);
+        free((void*)out);
+        if (next == r) {
+            /* the tokenizer does not move past an EOL it starts on */
+            next = r + 1;
+        }
+        r = next;
+    }
+}
+
+/* The reference record log, built from conform_dsvtok alone. A buffer holds no
+ * records until it holds a character, but a single-record parser always
+ * returns one, possibly empty, record. */
+static void reference_records(const TMCHAR* input, TMCHAR quote,
+                              TMCHAR delim, int first_only,
+                              struct conform_log* log) {
+    const TMCHAR* r = input;
+    if (first_only && *r == '\0') {
+        log_record(log);
+    }
+    while (*r) {
+        TMCHAR term;
+        for (;;) {
+            const TMCHAR* out = NULL;
+            const TMCHAR* next;
+            if (conform_iseol(*r)) {
+                /* a field starting on the terminator is not a field */
+                term = *r;
+                if (term) {
+                    ++r;
+                }
+                break;
+            }
+            next = conform_dsvtok(r, &out, quote, delim);
+            if (!next) {
+                fprintf(stderr, "dsvconform: reference ran out of memory\n");
+                exit(2);
+            }
+            log_string(log, out);
+            free((void*)out);
+            r = next;
+            if (*r == '\0') {
+                term = '\0';
+                break;
+            }
+            if (r[-1] != delim) {
+                term = r[-1];
+                break;
+            }
+        }
+        log_record(log);
+        if (term == '\r' && *r == '\n') {
+            ++r;
+        }
+        if (first_only) {
+            break;
+        }
+    }
+}
+
+/* }}} REGION: REFERENCE */
+
+/* {{{ REGION: IMPLEMENTATIONS */
+
+/* Narrow and widen test inputs. The generator only produces ASCII, so this is
+ * lossless in both directions. */
+static char* conform_narrow(const TMCHAR* s) {
+    size_t i, n = 0;
+    char* out;
+    while (s[n]) { ++n; }
+    out = calloc(n+1, 1);
+    for (i = 0; i < n; ++i) {
+        out[i] = (char)s[i];
+    }
+    return out;
+}
+
+static const TMCHAR* tok_u8(const TMCHAR* line, const TMCHAR** out,
+                            TMCHAR quote, TMCHAR delim) {
+    char* narrow = conform_narrow(line);
+    const char* field = NULL;
+    const char* next = ua_dsvtok_u8(narrow, &field, (char)quote, (char)delim);
+    TMCHAR* wide;
+    size_t i, n;
+    if (!next) {
+        free(narrow);
+        return NULL;
+    }
+    n = strlen(field);
+    wide = calloc(n+1, sizeof(TMCHAR));
+    for (i = 0; i < n; ++i) {
+        wide[i] = (TMCHAR)(unsigned char)field[i];
+    }
+    *out = wide;
+    free((void*)field);
+    line += next - narrow;
+    free(narrow);
+    return line;
+}
+
+static void rec_parse_dsv(const TMCHAR* input, TMCHAR quote, TMCHAR delim,
+                          struct conform_log* log) {
+    const TMCHAR** fields = ua_parse_dsv(input, quote, delim);
+    size_t i;
+    for (i = 0; fields[i]; ++i) {
+        log_string(log, fields[i]);
+    }
+    log_record(log);
+    ua_free_dsv(fields);
+}
+
+static void rec_parse_dsv_u8(const TMCHAR* input, TMCHAR quote, TMCHAR delim,
+                             struct conform_log* log) {
+    char* narrow = conform_narrow(input);
+    const char** fields = ua_parse_dsv_u8(narrow, (char)quote, (char)delim);
+    size_t i, j;
+    for (i = 0; fields[i]; ++i) {
+        for (j = 0; fields[i][j]; ++j) {
+            log_put(log, (TMCHAR)(unsigned char)fields[i][j]);
+        }
+        log_put(log, LOG_FIELD);
+    }
+    log_record(log);
+    ua_free_dsv_u8(fields);
+    free(narrow);
+}
+
+/* quote of the input being scanned, for ua_dsv_unescape */
+static TMCHAR conform_quote;
+
+/* one row for every input, so that stale storage would show up */
+static struct ua_dsv_row conform_row;
+
+static void rec_parse_dsv_into(const TMCHAR* input, TMCHAR quote,
+                               TMCHAR delim, struct conform_log* log) {
+    size_t i, j;
+    if (!ua_parse_dsv_into(&conform_row, input, quote, delim)) {
+        fprintf(stderr, "dsvconform: ua_parse_dsv_into ran out of memory\n");
+        exit(2);
+    }
+    /* log by length, so that a wrong length diverges from the reference */
+    for (i = 0; i < conform_row.nfields; ++i) {
+        for (j = 0; j < conform_row.lens[i]; ++j) {
+            log_put(log, conform_row.fields[i][j]);
+        }
+        log_put(log, LOG_FIELD);
+    }
+    if (conform_row.fields[i]) {
+        log_put(log, LOG_FIELD);
+    }
+    log_record(log);
+}
+
+/* shared like conform_row; fields are resolved from the last one back, so
+ * that a value written over a neighbour would show up */
+static struct ua_dsv_lazy_row conform_lazy;
+
+static void rec_parse_dsv_lazy(const TMCHAR* input, TMCHAR quote,
+                               TMCHAR delim, struct conform_log* log) {
+    size_t i, j, len;
+    if (!ua_parse_dsv_lazy(&conform_lazy, input, quote, delim)) {
+        fprintf(stderr, "dsvconform: ua_parse_dsv_lazy ran out of memory\n");
+        exit(2);
+    }
+    for (i = conform_lazy.nfields; i-- > 0; ) {
+        ua_dsv_lazy_get(&conform_lazy, i, NULL);
+    }
+    for (i = 0; i < conform_lazy.nfields; ++i) {
+        const TMCHAR* value = ua_dsv_lazy_get(&conform_lazy, i, &len);
+        for (j = 0; j < len; ++j) {
+            log_put(log, value[j]);
+        }
+        log_put(log, LOG_FIELD);
+    }
+    log_record(log);
+}
+
+static int scan_field(void* user, const TMCHAR* field, size_t len,
+                      int flags) {
+    struct conform_log* log = user;
+    if (flags & UA_DSV_FIELD_UNESCAPE) {
+        /* unescaping never lengthens a field */
+        TMCHAR* value = calloc(len+1, sizeof(TMCHAR));
+        len = ua_dsv_unescape(field, len, conform_quote, value);
+        log_field(log, value, len);
+        free(value);
+    } else {
+        log_field(log, field, len);
+    }
+    return TRUE;
+}
+
+static int scan_record(void* user, const TMCHAR* record, size_t len,
+                       size_t nfields) {
+    (void)record;
+    (void)len;
+    (void)nfields;
+    log_record((struct conform_log*)user);
+    return TRUE;
+}
+
+static void rec_scan(const TMCHAR* input, TMCHAR quote, TMCHAR delim,
+                     struct conform_log* log) {
+    size_t len = 0;
+    while (input[len]) {
+        ++len;
+    }
+    conform_quote = quote;
+    if (ua_dsv_scan(input, len, quote, delim,
+                    scan_field, scan_record, log) != len) {
+        /* report a short scan as a stray record */
+        log_record(log);
+    }
+}
+
+static int scan_field_u8(void* user, const char* field, size_t len,
+                         int flags) {
+    struct conform_log* log = user;
+    char* value = NULL;
+    size_t i;
+    if (flags & UA_DSV_FIELD_UNESCAPE) {
+        value = calloc(len+1, 1);
+        len = ua_dsv_unescape_u8(field, len, (char)conform_quote, value);
+        field = value;
+    }
+    for (i = 0; i < len; ++i) {
+        log_put(log, (TMCHAR)(unsigned char)field[i]);
+    }
+    log_put(log, LOG_FIELD);
+    free(value);
+    return TRUE;
+}
+
+static int scan_record_u8(void* user, const char* record, size_t len,
+                          size_t nfields) {
+    (void)record;
+    (void)len;
+    (void)nfields;
+    log_record((struct conform_log*)user);
+    return TRUE;
+}
+
+static void rec_scan_u8(const TMCHAR* input, TMCHAR quote, TMCHAR delim,
+                        struct conform_log* log) {
+    char* narrow = conform_narrow(input);
+    size_t len = strlen(narrow);
+    conform_quote = quote;
+    if (ua_dsv_scan_u8(narrow, len, (char)quote, (char)delim,
+                       scan_field_u8, scan_record_u8, log) != len) {
+        log_record(log);
+    }
+    free(narrow);
+}
+
+static int push_field(void* user, const TMCHAR* field, size_t len,
+                      int flags) {
+    (void)flags;
+    log_field((struct conform_log*)user, field, len);
+    return TRUE;
+}
+
+/* feed the input in pieces of 1, 2, 3, ... characters, wrapping at 7, so
+ * that every kind of boundary is crossed somewhere */
+static void rec_push(const TMCHAR* input, TMCHAR quote, TMCHAR delim,
+                     struct conform_log* log) {
+    struct ua_dsv_parser* p = ua_dsv_parser_new(quote, delim, push_field,
+                                                scan_record, log);
+    size_t len = 0;
+    size_t i, piece = 1;
+    while (input[len]) {
+        ++len;
+    }
+    for (i = 0; i < len; i += piece, piece = piece % 7 + 1) {
+        ua_dsv_feed(p, input + i, len - i < piece ? len - i : piece);
+    }
+    ua_dsv_finish(p);
+    ua_dsv_parser_free(p);
+}
+
+static int push_field_u8(void* user, const char* field, size_t len,
+                         int flags) {
+    struct conform_log* log = user;
+    size_t i;
+    (void)flags;
+    for (i = 0; i < len; ++i) {
+        log_put(log, (TMCHAR)(unsigned char)field[i]);
+    }
+    log_put(log, LOG_FIELD);
+    return TRUE;
+}
+
+/* the same, one character at a time */
+static void rec_push_u8(const TMCHAR* input, TMCHAR quote, TMCHAR delim,
+                        struct conform_log* log) {
+    char* narrow = conform_narrow(input);
+    struct ua_dsv_parser_u8* p = ua_dsv_parser_new_u8(
+        (char)quote, (char)delim, push_field_u8, scan_record_u8, log);
+    size_t i;
+    for (i = 0; narrow[i]; ++i) {
+        ua_dsv_feed_u8(p, narrow + i, 1);
+    }
+    ua_dsv_finish_u8(p);
+    ua_dsv_parser_free_u8(p);
+    free(narrow);
+}
+
+/* convert to CSV, then read that back with the CSV scanner */
+static void rec_transcode(const TMCHAR* input, TMCHAR quote, TMCHAR delim,
+                          struct conform_log* log) {
+    TMCHAR* out = NULL;
+    size_t len = 0;
+    size_t out_len = 0, out_cap = 0;
+    while (input[len]) {
+        ++len;
+    }
+    if (ua_dsv_transcode(input, len, TRUE, quote, delim, &out, &out_len,
+                         &out_cap, QUOTE_NEEDED, '"', ',', 0) != len) {
+        log_record(log);
+    }
+    conform_quote = '"';
+    if (ua_dsv_scan(out, out_len, '"', ',',
+                    scan_field, scan_record, log) != out_len) {
+        log_record(log);
+    }
+    ua_dsv_free(out);
+}
+
+/* the same, with the input arriving one character at a time: each call
+ * converts what it can of the characters not yet converted */
+static void rec_transcode_u8(const TMCHAR* input, TMCHAR quote,
+                             TMCHAR delim, struct conform_log* log) {
+    char* narrow = conform_narrow(input);
+    size_t len = strlen(narrow);
+    char* out = NULL;
+    size_t out_len = 0, out_cap = 0;
+    size_t done = 0, i;
+    for (i = 0; i <= len; ++i) {
+        size_t n = ua_dsv_transcode_u8(narrow + done, i - done, i == len,
+                                       (char)quote, (char)delim,
+                                       &out, &out_len, &out_cap,
+                                       QUOTE_NEEDED, '"', ',', 0);
+        if (n == (size_t)-1) {
+            log_record(log);
+            break;
+        }
+        done += n;
+    }
+    if (done != len) {
+        log_record(log);
+    }
+    conform_quote = '"';
+    if (ua_dsv_scan_u8(out, out_len, '"', ',',
+                       scan_field_u8, scan_record_u8, log) != out_len) {
+        log_record(log);
+    }
+    ua_dsv_free(out);
+    free(narrow);
+}
+
+enum {
+    CONFORM_TOKEN = 1,
+    CONFORM_RECORD = 2,
+    CONFORM_FIRST = 4       /* CONFORM_RECORD: first record only */
+};
+
+/* dialect value meaning "any" */
+#define CONFORM_ANY (-1)
+
+struct conform_impl {
+    const char* name;
+    int kind;
+    int quote;      /* restrict to one dialect, or CONFORM_ANY */
+    int delim;
+    const TMCHAR* (*tok)(const TMCHAR* line, const TMCHAR** out,
+                         TMCHAR quote, TMCHAR delim);
+    void (*rec)(const TMCHAR* input, TMCHAR quote, TMCHAR delim,
+                struct conform_log* log);
+};
+
+static const struct conform_impl conform_impls[] = {
+    {"ua_dsvtok", CONFORM_TOKEN, CONFORM_ANY, CONFORM_ANY, ua_dsvtok, NULL},
+    {"ua_dsvtok_u8", CONFORM_TOKEN, CONFORM_ANY, CONFORM_ANY, tok_u8, NULL},
+    {"ua_parse_dsv", CONFORM_RECORD | CONFORM_FIRST, CONFORM_ANY, CONFORM_ANY,
+        NULL, rec_parse_dsv},
+    {"ua_parse_dsv_u8", CONFORM_RECORD | CONFORM_FIRST,
+        CONFORM_ANY, CONFORM_ANY, NULL, rec_parse_dsv_u8},
+    {"ua_parse_dsv_into", CONFORM_RECORD | CONFORM_FIRST,
+        CONFORM_ANY, CONFORM_ANY, NULL, rec_parse_dsv_into},
+    {"ua_parse_dsv_lazy", CONFORM_RECORD | CONFORM_FIRST,
+        CONFORM_ANY, CONFORM_ANY, NULL, rec_parse_dsv_lazy},
+    {"ua_dsv_scan", CONFORM_RECORD, CONFORM_ANY, CONFORM_ANY, NULL, rec_scan},
+    {"ua_dsv_scan_u8", CONFORM_RECORD, CONFORM_ANY, CONFORM_ANY,
+        NULL, rec_scan_u8},
+    {"ua_dsv_feed", CONFORM_RECORD, CONFORM_ANY, CONFORM_ANY, NULL, rec_push},
+    {"ua_dsv_feed_u8", CONFORM_RECORD, CONFORM_ANY, CONFORM_ANY,
+        NULL, rec_push_u8},
+    {"ua_dsv_transcode", CONFORM_RECORD, CONFORM_ANY, CONFORM_ANY,
+        NULL, rec_transcode},
+    {"ua_dsv_transcode_u8", CONFORM_RECORD, CONFORM_ANY, CONFORM_ANY,
+        NULL, rec_transcode_u8}
+};
+
+#define CONFORM_NIMPLS (sizeof(conform_impls)/sizeof(conform_impls[0]))
+
+/* }}} REGION: IMPLEMENTATIONS */
+
+/* {{{ REGION: DIFFERENTIAL CHECK */
+
+struct conform_dialect {
+    const char* name;
+    char quote;
+    char delim;
+};
+
+static const struct conform_dialect conform_dialects[] = {
+    {"csv", '"', ','},
+    {"psv", '\0', '|'},
+    {"ssv", '\'', ';'},
+    {"tsv", '"', '\t'}
+};
+
+#define CONFORM_NDIALECTS \
+    (sizeof(conform_dialects)/sizeof(conform_dialects[0]))
+
+static int impl_applies(const struct conform_impl* impl,
+                        const struct conform_dialect* d) {
+    return (impl->quote == CONFORM_ANY || impl->quote == d->quote) &&
+           (impl->delim == CONFORM_ANY || impl->delim == d->delim);
+}
+
+static TMCHAR* conform_widen(const char* s, size_t n) {
+    TMCHAR* w = calloc(n+1, sizeof(TMCHAR));
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        w[i] = (TMCHAR)(unsigned char)s[i];
+    }
+    return w;
+}
+
+/* Run one implementation against the reference. Returns TRUE when they
+ * agree; otherwise fills both logs for reporting. */
+static int conform_check(const struct conform_impl* impl,
+                         const struct conform_dialect* d,
+                         const char* input, size_t len,
+                         struct conform_log* ref, struct conform_log* alt) {
+    TMCHAR* w = conform_widen(input, len);
+    ref->len = 0;
+    alt->len = 0;
+
+    if (impl->kind & CONFORM_TOKEN) {
+        const TMCHAR* r = w;
+        reference_tokens(w, d->quote, d->delim, ref);
+        while (*r) {
+            const TMCHAR* out = NULL;
+            const TMCHAR* next = impl->tok(r, &out, d->quote, d->delim);
+            if (!next) {
+                log_put(alt, LOG_RECORD);
+                break;
+            }
+            log_string(alt, out);
+            log_number(alt, (size_t)(next - r));
+            log_record(alt);
+            ua_dsv_free(out);
+            if (next < r || next > w + len) {
+                break;
+            }
+            r = next == r ? r + 1 : next;
+        }
+    } else {
+        reference_records(w, d->quote, d->delim,
+                          impl->kind & CONFORM_FIRST, ref);
+        impl->rec(w, d->quote, d->delim, alt);
+    }
+
+    free(w);
+    return log_equal(ref, alt);
+}
+
+/* Shrink a failing input: drop ever smaller chunks for as long as the
+ * divergence survives. Returns the new length; input is edited in place. */
+static size_t conform_minimize(const struct conform_impl* impl,
+                               const struct conform_dialect* d,
+                               char* input, size_t len) {
+    struct conform_log ref = {NULL, 0, 0};
+    struct conform_log alt = {NULL, 0, 0};
+    char* trial = calloc(len+1, 1);
+    size_t chunk, at;
+    int shrunk = TRUE;
+
+    while (shrunk) {
+        shrunk = FALSE;
+        for (chunk = len / 2 ? len / 2 : 1; chunk >= 1; chunk /= 2) {
+            at = 0;
+            while (at + chunk <= len) {
+                memcpy(trial, input, at);
+                memcpy(trial + at, input + at + chunk, len - at - chunk);
+                trial[len - chunk] = '\0';
+                if (!conform_check(impl, d, trial, len - chunk, &ref, &alt)) {
+                    memcpy(input, trial, len - chunk + 1);
+                    len -= chunk;
+                    shrunk = TRUE;
+                } else {
+                    at += 1;
+                }
+            }
+        }
+    }
+
+    free(trial);
+    free(ref.s);
+    free(alt.s);
+    return len;
+}
+
+static void conform_report(const struct conform_impl* impl,
+                           const struct conform_dialect* d,
+                           char* input, size_t len) {
+    struct conform_log ref = {NULL, 0, 0};
+    struct conform_log alt = {NULL, 0, 0};
+    size_t i;
+
+    len = conform_minimize(impl, d, input, len);
+    conform_check(impl, d, input, len, &ref, &alt);
+
+    fprintf(stderr, "DIVERGENCE: %s (%s)\n  input: \"", impl->name, d->name);
+    for (i = 0; i < len; ++i) {
+        print_char(stderr, (unsigned char)input[i]);
+    }
+    fprintf(stderr, "\"\nreference:\n");
+    log_print(stderr, &ref);
+    fprintf(stderr, "%s:\n", impl->name);
+    log_print(stderr, &alt);
+
+    free(ref.s);
+    free(alt.s);
+}
+
+/* Check every applicable implementation; returns the number that diverged
+ * (each one is reported). */
+static int conform_all(const struct conform_dialect* d, const char* input,
+                       size_t len, const char* only) {
+    struct conform_log ref = {NULL, 0, 0};
+    struct conform_log alt = {NULL, 0, 0};
+    int failures = 0;
+    size_t i;
+
+    for (i = 0; i < CONFORM_NIMPLS; ++i) {
+        const struct conform_impl* impl = &conform_impls[i];
+        if (!impl_applies(impl, d) || (only && strcmp(only, impl->name))) {
+            continue;
+        }
+        if (!conform_check(impl, d, input, len, &ref, &alt)) {
+            char* copy = calloc(len+1, 1);
+            memcpy(copy, input, len);
+            conform_report(impl, d, copy, len);
+            free(copy);
+            failures += 1;
+        }
+    }
+
+    free(ref.s);
+    free(alt.s);
+    return failures;
+}
+
+/* }}} REGION: DIFFERENTIAL CHECK */
+
+/* {{{ REGION: DRIVERS */
+
+#ifdef FUZZ
+
+#include <stdint.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    const struct conform_dialect* d;
+    size_t len = 0;
+    char* input;
+
+    if (size == 0) {
+        return 0;
+    }
+    d = &conform_dialects[data[0] % CONFORM_NDIALECTS];
+    input = calloc(size, 1);
+    /* the reference cannot see past a NIL, and the log reserves two
+     * characters of its own */
+    for (len = 0; len + 1 < size; ++len) {
+        uint8_t c = data[len+1];
+        if (c == '\0') {
+            break;
+        }
+        input[len] = (c == LOG_FIELD || c == LOG_RECORD) ? ' ' : (char)c;
+    }
+    if (conform_all(d, input, len, NULL)) {
+        abort();
+    }
+    free(input);
+    return 0;
+}
+
+#else
+
+/* xorshift64*: deterministic across platforms, unlike rand() */
+static unsigned long long conform_state = 1;
+
+static unsigned long conform_rand(unsigned long n) {
+    conform_state ^= conform_state >> 12;
+    conform_state ^= conform_state << 25;
+    conform_state ^= conform_state >> 27;
+    return (unsigned long)((conform_state * 2685821657736338717ULL) >> 33) % n;
+}
+
+/* Inputs are drawn mostly from the characters the state machine treats
+ * specially, so short inputs reach every transition. */
+static size_t conform_generate(const struct conform_dialect* d, char* out,
+                               size_t maxlen) {
+    static const char others[] = "ab \t\"'|,;";
+    size_t len = conform_rand(maxlen + 1);
+    size_t i;
+    for (i = 0; i < len; ++i) {
+        switch (conform_rand(10)) {
+            case 0:
+            case 1: out[i] = d->quote ? d->quote : '"'; break;
+            case 2:
+            case 3: out[i] = d->delim; break;
+            case 4: out[i] = ' '; break;
+            case 5: out[i] = conform_rand(2) ? '\r' : '\n'; break;
+            case 6: out[i] = others[conform_rand(sizeof(others)-1)]; break;
+            default: out[i] = 'a' + (char)conform_rand(3); break;
+        }
+    }
+    out[len] = '\0';
+    return len;
+}
+
+int main(int argc, char** argv) {
+    unsigned long iterations = 100000;
+    size_t maxlen = 48;
+    const char* only = NULL;
+    unsigned long n;
+    size_t i;
+    char* input;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:l:i:")) != -1) {
+        switch (opt) {
+            case 'n': iterations = strtoul(optarg, NULL, 10); break;
+            case 's': conform_state = strtoull(optarg, NULL, 10) | 1; break;
+            case 'l': maxlen = strtoul(optarg, NULL, 10); break;
+            case 'i': only = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-n iterations] [-s seed] "
+                                "[-l maxlen] [-i impl]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    input = calloc(maxlen+1, 1);
+    for (i = 0; i < CONFORM_NDIALECTS; ++i) {
+        const struct conform_dialect* d = &conform_dialects[i];
+        for (n = 0; n < iterations; ++n) {
+            size_t len = conform_generate(d, input, maxlen);
+            if (conform_all(d, input, len, only)) {
+                free(input);
+                return 1;
+            }
+        }
+        fprintf(stderr, "%s: %lu inputs agree\n", d->name, iterations);
+    }
+    free(input);
+    return 0;
+}
+
+#endif /* def FUZZ */
+
+/* }}} REGION: DRIVERS */
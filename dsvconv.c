@@ -0,0 +1,303 @@
+
+/*****************************************************************************/
+/*    Name: dsvconv.c                                                        */
+/*   Title: Delimiter-Separated-Value Converter                              */
+/* Purpose: Convert many DSV files between dialects at once, spreading files */
+/*          and chunks of large files over a work-stealing thread pool.      */
+/*  Author: Peter Schultz (sxpws)                                            */
+/*****************************************************************************/
+/* UA AUDIT TRAIL                                                            */
+/*                                                                           */
+/* 2026/10/18 sxpws Initial commit                                           */
+/* 2026/10/18 sxpws Convert with ua_dsv_transcode                            */
+/* 2026/10/18 sxpws Split and repair chunks with dsvtool                     */
+/*                                                                           */
+/* UA AUDIT TRAIL END                                                        */
+/*****************************************************************************/
+
+/* Usage: dsvconv [-i dialect] [-o dialect] [-j threads] [-c MiB]
+ *                [-d directory] [-x extension] file...
+ *
+ *  -i dialect      dialect of the inputs (default psv; see dsvtool.h)
+ *  -o dialect      dialect to write (default csv)
+ *  -j threads      worker threads (default: one per CPU)
+ *  -c MiB          split inputs larger than this into chunks (default 8)
+ *  -d directory    write outputs there instead of next to each input
+ *  -x extension    extension of the outputs (default: the -o preset name)
+ *
+ * Each input is converted to a file of the same name with its extension
+ * replaced; an input of "-" is read from stdin and written to stdout. Records
+ * are exactly those ua_dsv_scan finds, and are converted by ua_dsv_transcode,
+ * one per line. A NIL byte ends an input.
+ *
+ * Aggregate throughput is reported on stderr when all files are done. The
+ * exit status is 0 on success, 1 if any file failed and 2 on bad usage.
+ *
+ *  cc -O2 dsvconv.c dsvtool.c gua2csv.c -o dsvconv -lpthread
+ *
+ * Chunks of a large file are converted in parallel, split and repaired by
+ * dsvtool_split_chunks and dsvtool_repair_chunks.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dsvtool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* {{{ REGION: CONVERSION */
+
+static struct dsvtool_dialect conv_in;
+static struct dsvtool_dialect conv_out;
+static struct dsvtool_pool* conv_pool;
+static size_t conv_chunk_size = 8u << 20;
+
+static atomic_ulong conv_records;
+static atomic_ulong conv_bytes_in;
+static atomic_ulong conv_bytes_out;
+static atomic_int conv_failed;
+
+struct conv_chunk {
+    struct dsvtool_chunk span;  /* first, as dsvtool.h asks */
+    struct conv_file* file;
+    char* out;                  /* released with ua_dsv_free */
+    size_t out_len;
+    size_t out_cap;
+    unsigned long records;
+};
+
+struct conv_file {
+    const char* path;
+    char* out_path;             /* NULL for stdout */
+    struct dsvtool_input in;
+    struct conv_chunk* chunks;
+    size_t nchunks;
+    atomic_size_t remaining;    /* chunks not converted yet */
+};
+
+/* convert the records of @param c that end by its limit, starting from its
+ * start; the last chunk converts everything that is left */
+static void conv_chunk_run(void* arg) {
+    struct conv_chunk* c = arg;
+    const struct dsvtool_input* in = &c->file->in;
+    int last = c->span.limit == in->len;
+    struct ua_dsv_stats stats;
+    size_t used;
+
+    memset(&stats, 0, sizeof(stats));
+    ua_dsv_stats_attach(&stats);
+    c->out_len = 0;
+    used = ua_dsv_transcode_u8(in->data + c->span.start,
+                               c->span.limit - c->span.start,
+                               last, conv_in.quote, conv_in.delim,
+                               &c->out, &c->out_len, &c->out_cap,
+                               conv_out.quoting, conv_out.quote,
+                               conv_out.delim, conv_out.escape);
+    ua_dsv_stats_attach(NULL);
+    if (used == (size_t)-1) dsvtool_oom(c->file->path);
+    c->span.end = c->span.start + used;
+    c->records = (unsigned long)stats.records_formatted;
+}
+
+/* all chunks are converted: repair wrong guesses and write the output */
+static void conv_file_finish(struct conv_file* f) {
+    unsigned long records = 0;
+    size_t bytes = 0;
+    size_t i;
+    int fd = STDOUT_FILENO;
+    int ok = TRUE;
+
+    dsvtool_repair_chunks(f->chunks, f->nchunks, sizeof(*f->chunks),
+                          conv_chunk_run);
+    for (i = 0; i < f->nchunks; ++i) {
+        records += f->chunks[i].records;
+        bytes += f->chunks[i].out_len;
+    }
+
+    if (f->out_path) {
+        fd = open(f->out_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            fprintf(stderr, "%s: %s\n", f->out_path, strerror(errno));
+            ok = FALSE;
+        }
+    }
+    for (i = 0; ok && i < f->nchunks; ++i) {
+        ok = dsvtool_write(fd, f->chunks[i].out, f->chunks[i].out_len);
+        if (!ok) {
+            fprintf(stderr, "%s: %s\n",
+                    f->out_path ? f->out_path : "stdout", strerror(errno));
+        }
+    }
+    if (f->out_path && fd >= 0 && close(fd) != 0 && ok) {
+        fprintf(stderr, "%s: %s\n", f->out_path, strerror(errno));
+        ok = FALSE;
+    }
+
+    if (ok) {
+        atomic_fetch_add(&conv_records, records);
+        atomic_fetch_add(&conv_bytes_in, f->in.len);
+        atomic_fetch_add(&conv_bytes_out, bytes);
+    } else {
+        atomic_store(&conv_failed, TRUE);
+    }
+
+    for (i = 0; i < f->nchunks; ++i) {
+        ua_dsv_free(f->chunks[i].out);
+    }
+    free(f->chunks);
+    f->chunks = NULL;
+    dsvtool_input_close(&f->in);
+}
+
+static void conv_chunk_task(void* arg) {
+    struct conv_chunk* c = arg;
+    conv_chunk_run(c);
+    if (atomic_fetch_sub(&c->file->remaining, 1) == 1) {
+        conv_file_finish(c->file);
+    }
+}
+
+static void conv_file_task(void* arg) {
+    struct conv_file* f = arg;
+    size_t i;
+
+    if (!dsvtool_input_open(f->path, &f->in)) {
+        atomic_store(&conv_failed, TRUE);
+        return;
+    }
+    f->chunks = dsvtool_split_chunks(&f->in, conv_chunk_size,
+                                     sizeof(*f->chunks), &f->nchunks);
+    for (i = 0; i < f->nchunks; ++i) {
+        f->chunks[i].file = f;
+    }
+    atomic_store(&f->remaining, f->nchunks);
+
+    /* the pool hands the chunks this worker does not get to to others */
+    for (i = 1; i < f->nchunks; ++i) {
+        dsvtool_pool_submit(conv_pool, conv_chunk_task, &f->chunks[i]);
+    }
+    conv_chunk_task(&f->chunks[0]);
+}
+
+/* }}} REGION: CONVERSION */
+
+/* {{{ REGION: DRIVER */
+
+/* @param dir/basename(@param path) with its extension replaced by @param ext
+ */
+static char* conv_out_path(const char* path, const char* dir,
+                           const char* ext) {
+    const char* base = strrchr(path, '/');
+    const char* dot;
+    size_t prefix, stem;
+    char* out;
+
+    base = base ? base + 1 : path;
+    dot = strrchr(base, '.');
+    stem = dot && dot != base ? (size_t)(dot - base) : strlen(base);
+    prefix = dir ? strlen(dir) + 1 : (size_t)(base - path);
+
+    out = malloc(prefix + stem + strlen(ext) + 2);
+    if (!out) dsvtool_oom("paths");
+    if (dir) {
+        sprintf(out, "%s/", dir);
+    } else {
+        /* the input's own directory */
+        memcpy(out, path, prefix);
+    }
+    memcpy(out + prefix, base, stem);
+    sprintf(out + prefix + stem, ".%s", ext);
+    return out;
+}
+
+int main(int argc, char** argv) {
+    const char* in_spec = "psv";
+    const char* out_spec = "csv";
+    const char* dir = NULL;
+    const char* ext = NULL;
+    char* preset = NULL;
+    unsigned threads = 0;
+    struct conv_file* files;
+    double started, elapsed;
+    size_t nfiles, i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:o:j:c:d:x:")) != -1) {
+        switch (opt) {
+            case 'i': in_spec = optarg; break;
+            case 'o': out_spec = optarg; break;
+            case 'j': threads = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 'c':
+                conv_chunk_size = (size_t)(strtod(optarg, NULL) * 1048576);
+                break;
+            case 'd': dir = optarg; break;
+            case 'x': ext = optarg; break;
+            default:
+                goto usage;
+        }
+    }
+    if (optind == argc || conv_chunk_size == 0 ||
+        !dsvtool_parse_dialect(in_spec, &conv_in) ||
+        !dsvtool_parse_dialect(out_spec, &conv_out)) {
+        goto usage;
+    }
+    if (!ext) {
+        preset = strndup(out_spec, strcspn(out_spec, "/"));
+        if (!preset) dsvtool_oom("paths");
+        ext = preset;
+    }
+
+    nfiles = (size_t)(argc - optind);
+    files = calloc(nfiles, sizeof(*files));
+    if (!files) dsvtool_oom("files");
+    for (i = 0; i < nfiles; ++i) {
+        files[i].path = argv[optind + i];
+        if (strcmp(files[i].path, "-")) {
+            files[i].out_path = conv_out_path(files[i].path, dir, ext);
+            if (!strcmp(files[i].out_path, files[i].path)) {
+                fprintf(stderr, "%s: output would overwrite the input\n",
+                        files[i].path);
+                return 2;
+            }
+        }
+    }
+
+    started = dsvtool_now();
+    conv_pool = dsvtool_pool_new(threads);
+    for (i = 0; i < nfiles; ++i) {
+        dsvtool_pool_submit(conv_pool, conv_file_task, &files[i]);
+    }
+    dsvtool_pool_wait(conv_pool);
+    elapsed = dsvtool_now() - started;
+
+    fprintf(stderr, "dsvconv: %lu files, %lu records, %.1f MB in, "
+                    "%.1f MB out, %.3f s, %.1f MB/s, %u threads, "
+                    "%lu steals\n",
+            (unsigned long)nfiles, atomic_load(&conv_records),
+            (double)atomic_load(&conv_bytes_in) / 1e6,
+            (double)atomic_load(&conv_bytes_out) / 1e6, elapsed,
+            (double)atomic_load(&conv_bytes_in) / 1e6 / elapsed,
+            dsvtool_pool_size(conv_pool), dsvtool_pool_steals(conv_pool));
+    dsvtool_pool_free(conv_pool);
+
+    for (i = 0; i < nfiles; ++i) {
+        free(files[i].out_path);
+    }
+    free(files);
+    free(preset);
+    return atomic_load(&conv_failed) ? 1 : 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-i dialect] [-o dialect] [-j threads] "
+                    "[-c MiB] [-d directory] [-x extension] file...\n",
+            argv[0]);
+    return 2;
+}
+
+/* }}} REGION: DRIVER */
@@ -0,0 +1,517 @@
+
+/*****************************************************************************/
+/*    Name: dsvdiff.c                                                        */
+/*   Title: Delimiter-Separated-Value Extract Difference                     */
+/* Purpose: Report the keys inserted, deleted and changed between two DSV    */
+/*          extracts by comparing fingerprints of their records.             */
+/*  Author: Peter Schultz (sxpws)                                            */
+/*****************************************************************************/
+/* UA AUDIT TRAIL                                                            */
+/*                                                                           */
+/* 2026/10/18 sxpws Initial commit                                           */
+/* 2026/10/18 sxpws Split and repair chunks with dsvtool                     */
+/*                                                                           */
+/* UA AUDIT TRAIL END                                                        */
+/*****************************************************************************/
+
+/* Usage: dsvdiff [-i dialect] [-o dialect] [-k columns] [-j threads]
+ *                [-c MiB] [-s] old new
+ *
+ *  -i dialect      dialect of the extracts (default psv; see dsvtool.h)
+ *  -o dialect      dialect to write (default: the -i dialect)
+ *  -k columns      key columns, counting from 1 and separated by commas,
+ *                  like 1,3 (default 1)
+ *  -j threads      worker threads (default: one per CPU)
+ *  -c MiB          split extracts into chunks of this size (default 8)
+ *  -s              report the counts and the time taken on stderr
+ *
+ * Each key that is in new but not in old is written as a record of "+"
+ * followed by its key values, each key in old but not in new as "-" and
+ * each key in both whose records differ as "~", in no particular order. A
+ * missing key column counts as empty and blank lines are ignored; a key on
+ * several records is changed when the set of its records changed.
+ *
+ * Records are compared by their values, as ua_dsv_scan finds and unescapes
+ * them, so quoting and spacing that the dialect trims do not count as a
+ * difference. The exit status is 0 when the extracts have the same keys and
+ * records, 1 when they differ and 2 on trouble.
+ *
+ *  cc -O2 dsvdiff.c dsvtool.c gua2csv.c -o dsvdiff -lpthread
+ *
+ * Chunks of both extracts are scanned in parallel, split by
+ * dsvtool_split_chunks. Each record is reduced to a 64-bit hash of its key
+ * values and a 64-bit hash of all its values, and filed by the top bits of
+ * the key hash into one of 64 partitions. The partitions are then sorted
+ * and compared in parallel too; the text of a record is only looked at
+ * again to write the key of a difference. Two keys, or two records of one
+ * key, with the same hash would be taken as equal; with 64 bits each that
+ * is unlikely enough to ignore.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dsvtool.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* {{{ REGION: FINGERPRINTS */
+
+#define DIFF_MAX_KEYS 64
+#define DIFF_PART_BITS 6
+#define DIFF_PARTS (1 << DIFF_PART_BITS)
+
+static struct dsvtool_dialect diff_in;
+static struct dsvtool_dialect diff_out;
+static size_t diff_keys[DIFF_MAX_KEYS];
+static size_t diff_nkeys;
+static size_t diff_chunk_size = 8u << 20;
+
+/* the fingerprint of a record */
+struct diff_row {
+    uint64_t key;
+    uint64_t row;
+    size_t offset;              /* of the record in its extract */
+};
+
+struct diff_rows {
+    struct diff_row* rows;
+    size_t n;
+    size_t cap;
+};
+
+struct diff_chunk {
+    struct dsvtool_chunk span;  /* first, as dsvtool.h asks */
+    const struct dsvtool_input* in;
+    struct diff_rows parts[DIFF_PARTS];
+};
+
+struct diff_file {
+    const char* path;
+    struct dsvtool_input in;
+    struct diff_chunk* chunks;
+    size_t nchunks;
+};
+
+#define DIFF_K1 0x9e3779b97f4a7c15u
+#define DIFF_K2 0xff51afd7ed558ccdu
+
+static uint64_t diff_mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53u;
+    h ^= h >> 29;
+    return h;
+}
+
+/* hash of a value, eight bytes at a time */
+static uint64_t diff_hash(const char* s, size_t len) {
+    uint64_t h = len * DIFF_K1;
+    uint64_t w;
+
+    for (; len >= 8; s += 8, len -= 8) {
+        memcpy(&w, s, 8);
+        h = (h ^ diff_mix(w * DIFF_K2)) * DIFF_K1;
+    }
+    if (len > 0) {
+        w = 0;
+        memcpy(&w, s, len);
+        h = (h ^ diff_mix(w * DIFF_K2)) * DIFF_K1;
+    }
+    return diff_mix(h);
+}
+
+/* the state of one chunk's scan */
+struct diff_scan {
+    struct diff_chunk* c;
+    const char* base;
+    const char* limit;
+    int final;                  /* the chunk ends the extract */
+    size_t done;                /* end of the last record, from base */
+    size_t field;               /* of the record being scanned */
+    uint64_t row;
+    uint64_t keys[DIFF_MAX_KEYS];
+    char* value;                /* unescaped values */
+    size_t value_cap;
+};
+
+static uint64_t diff_empty;     /* hash of a missing key value */
+
+static void diff_scan_reset(struct diff_scan* s) {
+    size_t k;
+    s->field = 0;
+    s->row = DIFF_K2;
+    for (k = 0; k < diff_nkeys; ++k) {
+        s->keys[k] = diff_empty;
+    }
+}
+
+static int diff_on_field(void* user, const char* field, size_t len,
+                         int flags) {
+    struct diff_scan* s = user;
+    uint64_t h;
+    size_t k;
+
+    if (flags & UA_DSV_FIELD_UNESCAPE) {
+        if (len + 1 > s->value_cap) {
+            s->value_cap = (len + 1) * 2;
+            free(s->value);
+            s->value = malloc(s->value_cap);
+            if (!s->value) dsvtool_oom("values");
+        }
+        len = ua_dsv_unescape_u8(field, len, diff_in.quote, s->value);
+        field = s->value;
+    }
+    h = diff_hash(field, len);
+    s->row = (s->row ^ h) * DIFF_K1 + s->field;
+    for (k = 0; k < diff_nkeys; ++k) {
+        if (diff_keys[k] == s->field) s->keys[k] = h;
+    }
+    s->field += 1;
+    return TRUE;
+}
+
+static int diff_on_record(void* user, const char* record, size_t len,
+                          size_t nfields) {
+    struct diff_scan* s = user;
+    const char* end = record + len;
+    size_t eol = 0, k;
+    uint64_t key = DIFF_K1;
+    struct diff_rows* part;
+
+    /* the record runs into the next chunk, which scans it */
+    if (!s->final && (end >= s->limit ||
+                      (*end == '\r' && end + 1 >= s->limit))) {
+        return FALSE;
+    }
+    if (end < s->limit && (*end == '\r' || *end == '\n')) {
+        eol = *end == '\r' && end + 1 < s->limit && end[1] == '\n' ? 2 : 1;
+    }
+    s->done = (size_t)(end - s->base) + eol;
+
+    if (nfields > 0) {
+        for (k = 0; k < diff_nkeys; ++k) {
+            key = (key ^ s->keys[k]) * DIFF_K2;
+        }
+        key = diff_mix(key);
+        part = &s->c->parts[key >> (64 - DIFF_PART_BITS)];
+        if (part->n == part->cap) {
+            part->cap = part->cap ? part->cap * 2 : 256;
+            part->rows = realloc(part->rows, part->cap * sizeof(*part->rows));
+            if (!part->rows) dsvtool_oom("fingerprints");
+        }
+        part->rows[part->n].key = key;
+        part->rows[part->n].row = diff_mix(s->row ^ nfields);
+        part->rows[part->n].offset = (size_t)(record - s->c->in->data);
+        part->n += 1;
+    }
+    diff_scan_reset(s);
+    return TRUE;
+}
+
+/* fingerprint the records of @param c that end by its limit, starting from
+ * its start; the last chunk takes everything that is left */
+static void diff_chunk_run(struct diff_chunk* c) {
+    struct diff_scan s;
+    size_t i;
+
+    memset(&s, 0, sizeof(s));
+    s.c = c;
+    s.base = c->in->data + c->span.start;
+    s.limit = c->in->data + c->span.limit;
+    s.final = c->span.limit == c->in->len;
+    diff_scan_reset(&s);
+    for (i = 0; i < DIFF_PARTS; ++i) {
+        c->parts[i].n = 0;
+    }
+    ua_dsv_scan_u8(s.base, c->span.limit - c->span.start, diff_in.quote,
+                   diff_in.delim, diff_on_field, diff_on_record, &s);
+    c->span.end = c->span.start + s.done;
+    free(s.value);
+}
+
+static void diff_chunk_task(void* arg) {
+    diff_chunk_run(arg);
+}
+
+/* parse a comma-separated list of columns counting from 1 into @param cols
+ * counting from 0; returns how many, or 0 on a bad @param spec */
+static size_t diff_columns(const char* spec, size_t* cols) {
+    size_t n = 0;
+    char* end;
+
+    for (;;) {
+        unsigned long c = strtoul(spec, &end, 10);
+        if (end == spec || c == 0 || n == DIFF_MAX_KEYS) return 0;
+        cols[n++] = (size_t)(c - 1);
+        if (*end == '\0') return n;
+        if (*end != ',') return 0;
+        spec = end + 1;
+    }
+}
+
+/* }}} REGION: FINGERPRINTS */
+
+/* {{{ REGION: COMPARISON */
+
+enum { DIFF_INSERTED, DIFF_DELETED, DIFF_CHANGED };
+
+/* one partition of both extracts */
+struct diff_part {
+    struct diff_file* files;    /* old and new */
+    size_t index;
+    struct dsvtool_buf out;
+    unsigned long counts[3];
+
+    /* the marker and key values of the record being written; fields[k+1]
+     * is NULL for a value at offs[k] in values */
+    const char* fields[DIFF_MAX_KEYS + 1];
+    size_t lens[DIFF_MAX_KEYS + 1];
+    size_t offs[DIFF_MAX_KEYS];
+    size_t field;
+    char* values;
+    size_t values_len;
+    size_t values_cap;
+};
+
+static int diff_row_compare(const void* a, const void* b) {
+    const struct diff_row* x = a;
+    const struct diff_row* y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    if (x->row != y->row) return x->row < y->row ? -1 : 1;
+    return 0;
+}
+
+/* the rows of partition @param index of @param f, sorted */
+static struct diff_row* diff_gather(const struct diff_file* f, size_t index,
+                                    size_t* n) {
+    struct diff_row* rows;
+    size_t total = 0, i;
+
+    for (i = 0; i < f->nchunks; ++i) {
+        total += f->chunks[i].parts[index].n;
+    }
+    rows = malloc((total ? total : 1) * sizeof(*rows));
+    if (!rows) dsvtool_oom("fingerprints");
+    for (*n = 0, i = 0; i < f->nchunks; ++i) {
+        struct diff_rows* p = &f->chunks[i].parts[index];
+        if (p->n > 0) {
+            memcpy(rows + *n, p->rows, p->n * sizeof(*rows));
+            *n += p->n;
+        }
+        free(p->rows);
+        p->rows = NULL;
+    }
+    qsort(rows, total, sizeof(*rows), diff_row_compare);
+    return rows;
+}
+
+static int diff_key_field(void* user, const char* field, size_t len,
+                          int flags) {
+    struct diff_part* p = user;
+    size_t k;
+
+    for (k = 0; k < diff_nkeys; ++k) {
+        if (diff_keys[k] != p->field) continue;
+        if (flags & UA_DSV_FIELD_UNESCAPE) {
+            if (p->values_len + len + 1 > p->values_cap) {
+                p->values_cap = (p->values_len + len + 1) * 2;
+                p->values = realloc(p->values, p->values_cap);
+                if (!p->values) dsvtool_oom("values");
+            }
+            p->fields[k + 1] = NULL;
+            p->offs[k] = p->values_len;
+            p->lens[k + 1] = ua_dsv_unescape_u8(field, len, diff_in.quote,
+                                                p->values + p->values_len);
+            p->values_len += p->lens[k + 1];
+        } else {
+            p->fields[k + 1] = field;
+            p->lens[k + 1] = len;
+        }
+    }
+    p->field += 1;
+    return TRUE;
+}
+
+static int diff_key_record(void* user, const char* record, size_t len,
+                           size_t nfields) {
+    (void)user;
+    (void)record;
+    (void)len;
+    (void)nfields;
+    return FALSE;
+}
+
+/* write @param marker and the key of the record at @param offset of
+ * @param f */
+static void diff_put_key(struct diff_part* p, const char* marker,
+                         const struct diff_file* f, size_t offset) {
+    size_t k;
+
+    p->fields[0] = marker;
+    p->lens[0] = 1;
+    for (k = 0; k < diff_nkeys; ++k) {
+        p->fields[k + 1] = "";
+        p->lens[k + 1] = 0;
+    }
+    p->field = 0;
+    p->values_len = 0;
+    ua_dsv_scan_u8(f->in.data + offset, f->in.len - offset, diff_in.quote,
+                   diff_in.delim, diff_key_field, diff_key_record, p);
+    for (k = 0; k < diff_nkeys; ++k) {
+        if (!p->fields[k + 1]) p->fields[k + 1] = p->values + p->offs[k];
+    }
+    dsvtool_put_record(&p->out, p->fields, p->lens, diff_nkeys + 1,
+                       &diff_out);
+}
+
+/* compare partition @param p of the old and new extracts */
+static void diff_part_task(void* arg) {
+    struct diff_part* p = arg;
+    size_t n0, n1, i = 0, j = 0;
+    struct diff_row* old = diff_gather(&p->files[0], p->index, &n0);
+    struct diff_row* new = diff_gather(&p->files[1], p->index, &n1);
+
+    while (i < n0 || j < n1) {
+        uint64_t key = j == n1 || (i < n0 && old[i].key < new[j].key)
+            ? old[i].key : new[j].key;
+        size_t i0 = i, j0 = j;
+        int changed = FALSE;
+
+        while (i < n0 && old[i].key == key) ++i;
+        while (j < n1 && new[j].key == key) ++j;
+        if (i == i0) {
+            diff_put_key(p, "+", &p->files[1], new[j0].offset);
+            p->counts[DIFF_INSERTED] += 1;
+            continue;
+        }
+        if (j == j0) {
+            diff_put_key(p, "-", &p->files[0], old[i0].offset);
+            p->counts[DIFF_DELETED] += 1;
+            continue;
+        }
+        /* the rows of a key are sorted by their hash, so equal sets of
+         * records line up */
+        changed = i - i0 != j - j0;
+        for (; !changed && i0 < i; ++i0, ++j0) {
+            changed = old[i0].row != new[j0].row;
+        }
+        if (changed) {
+            diff_put_key(p, "~", &p->files[1], new[j - 1].offset);
+            p->counts[DIFF_CHANGED] += 1;
+        }
+    }
+    free(old);
+    free(new);
+}
+
+/* }}} REGION: COMPARISON */
+
+/* {{{ REGION: DRIVER */
+
+int main(int argc, char** argv) {
+    const char* in_spec = "psv";
+    const char* out_spec = NULL;
+    const char* keys = "1";
+    unsigned threads = 0;
+    int summary = FALSE;
+    struct dsvtool_pool* pool;
+    struct diff_file files[2];
+    struct diff_part* parts;
+    unsigned long counts[3] = {0, 0, 0};
+    double started;
+    size_t i, j;
+    int opt, ok = TRUE;
+
+    while ((opt = getopt(argc, argv, "i:o:k:j:c:s")) != -1) {
+        switch (opt) {
+            case 'i': in_spec = optarg; break;
+            case 'o': out_spec = optarg; break;
+            case 'k': keys = optarg; break;
+            case 'j': threads = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 'c':
+                diff_chunk_size = (size_t)(strtod(optarg, NULL) * 1048576);
+                break;
+            case 's': summary = TRUE; break;
+            default:
+                goto usage;
+        }
+    }
+    diff_nkeys = diff_columns(keys, diff_keys);
+    if (argc - optind != 2 || diff_nkeys == 0 || diff_chunk_size == 0 ||
+        !dsvtool_parse_dialect(in_spec, &diff_in) ||
+        !dsvtool_parse_dialect(out_spec ? out_spec : in_spec, &diff_out)) {
+        goto usage;
+    }
+    diff_empty = diff_hash("", 0);
+
+    started = dsvtool_now();
+    memset(files, 0, sizeof(files));
+    for (i = 0; i < 2; ++i) {
+        files[i].path = argv[optind + i];
+        if (!dsvtool_input_open(files[i].path, &files[i].in)) return 2;
+    }
+    pool = dsvtool_pool_new(threads);
+    for (i = 0; i < 2; ++i) {
+        files[i].chunks = dsvtool_split_chunks(&files[i].in, diff_chunk_size,
+                                               sizeof(*files[i].chunks),
+                                               &files[i].nchunks);
+        for (j = 0; j < files[i].nchunks; ++j) {
+            files[i].chunks[j].in = &files[i].in;
+            dsvtool_pool_submit(pool, diff_chunk_task, &files[i].chunks[j]);
+        }
+    }
+    dsvtool_pool_wait(pool);
+    for (i = 0; i < 2; ++i) {
+        dsvtool_repair_chunks(files[i].chunks, files[i].nchunks,
+                              sizeof(*files[i].chunks), diff_chunk_task);
+    }
+
+    parts = calloc(DIFF_PARTS, sizeof(*parts));
+    if (!parts) dsvtool_oom("partitions");
+    for (i = 0; i < DIFF_PARTS; ++i) {
+        parts[i].files = files;
+        parts[i].index = i;
+        dsvtool_pool_submit(pool, diff_part_task, &parts[i]);
+    }
+    dsvtool_pool_wait(pool);
+    dsvtool_pool_free(pool);
+
+    for (i = 0; i < DIFF_PARTS; ++i) {
+        if (ok && !dsvtool_write(STDOUT_FILENO, parts[i].out.s,
+                                 parts[i].out.len)) {
+            fprintf(stderr, "stdout: %s\n", strerror(errno));
+            ok = FALSE;
+        }
+        for (j = 0; j < 3; ++j) {
+            counts[j] += parts[i].counts[j];
+        }
+        dsvtool_buf_free(&parts[i].out);
+        free(parts[i].values);
+    }
+    free(parts);
+    if (summary) {
+        fprintf(stderr, "dsvdiff: %lu inserted, %lu deleted, %lu changed, "
+                        "%.1f MB in, %.3f s\n",
+                counts[DIFF_INSERTED], counts[DIFF_DELETED],
+                counts[DIFF_CHANGED],
+                (double)(files[0].in.len + files[1].in.len) / 1e6,
+                dsvtool_now() - started);
+    }
+    for (i = 0; i < 2; ++i) {
+        free(files[i].chunks);
+        dsvtool_input_close(&files[i].in);
+    }
+    if (!ok) return 2;
+    return counts[0] + counts[1] + counts[2] > 0 ? 1 : 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-i dialect] [-o dialect] [-k columns] "
+                    "[-j threads] [-c MiB] [-s] old new\n", argv[0]);
+    return 2;
+}
+
+/* }}} REGION: DRIVER */
@@ -0,0 +1,245 @@
+
+/*****************************************************************************/
+/*    Name: dsvgroup.c                                                       */
+/*   Title: Delimiter-Separated-Value Group By                               */
+/* Purpose: Summarize DSV input by key columns in one streaming pass, with   */
+/*          the record count and the sum, minimum and maximum of columns.    */
+/*  Author: Peter Schultz (sxpws)                                            */
+/*****************************************************************************/
+/* UA AUDIT TRAIL                                                            */
+/*                                                                           */
+/* 2026/10/18 sxpws Initial commit                                           */
+/*                                                                           */
+/* UA AUDIT TRAIL END                                                        */
+/*****************************************************************************/
+
+/* Usage: dsvgroup [-i dialect] [-o dialect] [-k columns] [-v columns] [-H]
+ *                 [-m MiB] [-T directory] [file...]
+ *
+ *  -i dialect      dialect of the inputs (default psv; see dsvtool.h)
+ *  -o dialect      dialect to write (default: the -i dialect)
+ *  -k columns      group by these columns, counting from 1 and separated by
+ *                  commas, like 1,3 (default: all records are one group)
+ *  -v columns      summarize these columns
+ *  -H              write a header record first
+ *  -m MiB          memory for groups before partitions are spilled to disk
+ *                  (default 256)
+ *  -T directory    directory for the partitions (default $TMPDIR or /tmp)
+ *
+ * The inputs, or stdin when there are none or for "-", are read as a stream
+ * and aggregated together by ua_dsv_agg. Each group is written as one
+ * record: its key values, its number of records and, for each -v column,
+ * the sum, minimum and maximum of the fields that are numbers. The minimum
+ * and maximum are empty when there are none. Groups come in no particular
+ * order; pipe them to dsvsort to order them.
+ *
+ *  cc -O2 dsvgroup.c dsvtool.c gua2csv.c -o dsvgroup -lpthread
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dsvtool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* {{{ REGION: GROUPING */
+
+#define GROUP_MAX_COLUMNS 64
+#define GROUP_READ (1u << 16)
+
+static struct dsvtool_dialect group_in;
+static struct dsvtool_dialect group_out;
+
+struct group_output {
+    struct dsvtool_buf buf;
+    const char* fields[GROUP_MAX_COLUMNS + 1 + 3 * GROUP_MAX_COLUMNS];
+    size_t lens[GROUP_MAX_COLUMNS + 1 + 3 * GROUP_MAX_COLUMNS];
+    char numbers[1 + 3 * GROUP_MAX_COLUMNS][32];
+};
+
+/* parse a comma-separated list of columns counting from 1 into @param cols
+ * counting from 0; returns how many, or 0 on a bad @param spec */
+static size_t group_columns(const char* spec, size_t* cols) {
+    size_t n = 0;
+    char* end;
+
+    for (;;) {
+        unsigned long c = strtoul(spec, &end, 10);
+        if (end == spec || c == 0 || n == GROUP_MAX_COLUMNS) return 0;
+        cols[n++] = (size_t)(c - 1);
+        if (*end == '\0') return n;
+        if (*end != ',') return 0;
+        spec = end + 1;
+    }
+}
+
+/* feed @param path, or stdin for "-", to @param parser */
+static int group_read(const char* path, struct ua_dsv_parser_u8* parser) {
+    char buf[GROUP_READ];
+    int fd = strcmp(path, "-") ? open(path, O_RDONLY) : STDIN_FILENO;
+    int ok = fd >= 0;
+
+    while (ok) {
+        ssize_t got = read(fd, buf, sizeof(buf));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) {
+            ok = got == 0;
+            break;
+        }
+        /* the aggregation failed, or the parser ran out of memory; either
+         * way errno says why */
+        if (!ua_dsv_feed_u8(parser, buf, (size_t)got)) {
+            ok = FALSE;
+            break;
+        }
+    }
+    if (!ok) fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    if (fd > STDIN_FILENO) close(fd);
+    return ok;
+}
+
+static int group_write(void* user, const char* const* keys,
+                       const size_t* lens, size_t nkeys, uint64_t count,
+                       const struct ua_dsv_agg_value* values,
+                       size_t nvalues) {
+    struct group_output* out = user;
+    size_t n = 0, i, k = 0;
+
+    for (i = 0; i < nkeys; ++i) {
+        out->fields[n] = keys[i];
+        out->lens[n++] = lens[i];
+    }
+    out->lens[n] = (size_t)sprintf(out->numbers[k], "%" PRIu64, count);
+    out->fields[n++] = out->numbers[k++];
+    for (i = 0; i < nvalues; ++i) {
+        const struct ua_dsv_agg_value* v = &values[i];
+        out->lens[n] = (size_t)sprintf(out->numbers[k], "%.15g", v->sum);
+        out->fields[n++] = out->numbers[k++];
+        out->lens[n] = v->count
+            ? (size_t)sprintf(out->numbers[k], "%.15g", v->min) : 0;
+        out->fields[n++] = out->numbers[k++];
+        out->lens[n] = v->count
+            ? (size_t)sprintf(out->numbers[k], "%.15g", v->max) : 0;
+        out->fields[n++] = out->numbers[k++];
+    }
+    dsvtool_put_record(&out->buf, out->fields, out->lens, n, &group_out);
+    if (out->buf.len >= GROUP_READ) {
+        if (!dsvtool_write(STDOUT_FILENO, out->buf.s, out->buf.len)) {
+            return FALSE;
+        }
+        out->buf.len = 0;
+    }
+    return TRUE;
+}
+
+/* a header record naming the columns after those of the input */
+static void group_header(struct group_output* out, const size_t* keys,
+                         size_t nkeys, const size_t* values, size_t nvalues) {
+    static const char* const stats[] = {"sum", "min", "max"};
+    char names[GROUP_MAX_COLUMNS * 4][32];
+    size_t n = 0, i, s;
+
+    for (i = 0; i < nkeys; ++i, ++n) {
+        out->lens[n] = (size_t)sprintf(names[n], "column%lu",
+                                       (unsigned long)keys[i] + 1);
+        out->fields[n] = names[n];
+    }
+    out->fields[n] = "count";
+    out->lens[n++] = 5;
+    for (i = 0; i < nvalues; ++i) {
+        for (s = 0; s < 3; ++s, ++n) {
+            out->lens[n] = (size_t)sprintf(names[n], "%s%lu", stats[s],
+                                           (unsigned long)values[i] + 1);
+            out->fields[n] = names[n];
+        }
+    }
+    dsvtool_put_record(&out->buf, out->fields, out->lens, n, &group_out);
+}
+
+/* }}} REGION: GROUPING */
+
+/* {{{ REGION: DRIVER */
+
+int main(int argc, char** argv) {
+    const char* in_spec = "psv";
+    const char* out_spec = NULL;
+    const char* tmpdir = NULL;
+    size_t keys[GROUP_MAX_COLUMNS];
+    size_t values[GROUP_MAX_COLUMNS];
+    size_t nkeys = 0, nvalues = 0;
+    double budget = 256;
+    int header = FALSE;
+    struct ua_dsv_agg* agg;
+    struct ua_dsv_parser_u8* parser;
+    struct group_output* out;
+    int opt, i, ok = TRUE;
+
+    while ((opt = getopt(argc, argv, "i:o:k:v:Hm:T:")) != -1) {
+        switch (opt) {
+            case 'i': in_spec = optarg; break;
+            case 'o': out_spec = optarg; break;
+            case 'k':
+                nkeys = group_columns(optarg, keys);
+                if (nkeys == 0) goto usage;
+                break;
+            case 'v':
+                nvalues = group_columns(optarg, values);
+                if (nvalues == 0) goto usage;
+                break;
+            case 'H': header = TRUE; break;
+            case 'm': budget = strtod(optarg, NULL); break;
+            case 'T': tmpdir = optarg; break;
+            default:
+                goto usage;
+        }
+    }
+    if (!(budget > 0) || !dsvtool_parse_dialect(in_spec, &group_in) ||
+        !dsvtool_parse_dialect(out_spec ? out_spec : in_spec, &group_out)) {
+        goto usage;
+    }
+
+    agg = ua_dsv_agg_new(group_in.quote, keys, nkeys, values, nvalues,
+                         (size_t)(budget * 1048576), tmpdir);
+    parser = agg ? ua_dsv_parser_new_u8(group_in.quote, group_in.delim,
+                                        ua_dsv_agg_on_field,
+                                        ua_dsv_agg_on_record, agg)
+                 : NULL;
+    out = calloc(1, sizeof(*out));
+    if (!agg || !parser || !out) dsvtool_oom("groups");
+
+    if (optind == argc) {
+        ok = group_read("-", parser);
+    }
+    for (i = optind; ok && i < argc; ++i) {
+        ok = group_read(argv[i], parser);
+    }
+    if (ok) {
+        if (header) {
+            group_header(out, keys, nkeys, values, nvalues);
+        }
+        ok = ua_dsv_finish_u8(parser) &&
+             ua_dsv_agg_finish(agg, group_write, out) &&
+             dsvtool_write(STDOUT_FILENO, out->buf.s, out->buf.len);
+        if (!ok) fprintf(stderr, "dsvgroup: %s\n", strerror(errno));
+    }
+
+    ua_dsv_parser_free_u8(parser);
+    ua_dsv_agg_free(agg);
+    dsvtool_buf_free(&out->buf);
+    free(out);
+    return ok ? 0 : 1;
+
+usage:
+    fprintf(stderr, "usage: %s [-i dialect] [-o dialect] [-k columns] "
+                    "[-v columns] [-H] [-m MiB] [-T directory] [file...]\n",
+            argv[0]);
+    return 2;
+}
+
+/* }}} REGION: DRIVER */
@@ -0,0 +1,636 @@
+
+/*****************************************************************************/
+/*    Name: dsvjoin.c                                                        */
+/*   Title: Delimiter-Separated-Value Join                                   */
+/* Purpose: Join two DSV files on key columns with a hash table built from   */
+/*          the smaller one, partitioning both to disk when it is too big.   */
+/*  Author: Peter Schultz (sxpws)                                            */
+/*****************************************************************************/
+/* UA AUDIT TRAIL                                                            */
+/*                                                                           */
+/* 2026/10/18 sxpws Initial commit                                           */
+/*                                                                           */
+/* UA AUDIT TRAIL END                                                        */
+/*****************************************************************************/
+
+/* Usage: dsvjoin [-i dialect] [-o dialect] [-t type] [-1 columns]
+ *                [-2 columns] [-m MiB] [-T directory] file1 file2
+ *
+ *  -i dialect      dialect of the inputs (default psv; see dsvtool.h)
+ *  -o dialect      dialect to write (default: the -i dialect)
+ *  -t type         inner (the default), left or anti
+ *  -1 columns      key columns of file1, counting from 1 and separated by
+ *                  commas, like 1,3 (default 1)
+ *  -2 columns      key columns of file2, as many (default: as for file1)
+ *  -m MiB          memory for the hash table (default 256)
+ *  -T directory    directory for partitions (default $TMPDIR or /tmp)
+ *
+ * An inner join writes every pair of records of file1 and file2 with equal
+ * keys, as the fields of the file1 record followed by those of the file2
+ * record. A left join also writes each file1 record that matches none,
+ * followed by as many empty fields as the first record of file2 has. An
+ * anti join writes only the file1 records that match none, as they are.
+ * Keys compare as field values, byte by byte; a record without all of its
+ * key columns matches nothing. Output is formatted as ua_format_dsv formats
+ * it, in no particular order.
+ *
+ *  cc -O2 dsvjoin.c dsvtool.c gua2csv.c -o dsvjoin -lpthread
+ *
+ * The hash table is built from the smaller file, whichever it is, and the
+ * other file is streamed against it; when file1 is the one in the table,
+ * records that no file2 record matched are found after streaming. If the
+ * table grows past its memory, both files are split into 16 partitions by
+ * their key hash (a grace hash join), and each pair of partitions is joined
+ * the same way, split again by other bits of the hash if need be.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dsvtool.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* {{{ REGION: RECORDS */
+
+#define JOIN_MAX_KEYS 64
+#define JOIN_PART_BITS 4
+#define JOIN_PARTS (1 << JOIN_PART_BITS)
+#define JOIN_MAX_DEPTH 8        /* partitions of partitions... */
+#define JOIN_FLUSH (1u << 20)
+
+enum join_type { JOIN_INNER, JOIN_LEFT, JOIN_ANTI };
+
+static struct dsvtool_dialect join_in;
+static struct dsvtool_dialect join_out;
+static enum join_type join_type = JOIN_INNER;
+static size_t join_keys[2][JOIN_MAX_KEYS];
+static size_t join_nkeys;
+static size_t join_width2;      /* fields of the first file2 record */
+static size_t join_budget;
+static const char* join_tmpdir;
+
+struct join_field {
+    const char* s;
+    size_t len;
+};
+
+/* called with each record of a source, with the values of its fields */
+typedef int (*join_visit_fn)(void* user, const struct join_field* fields,
+                             size_t nfields);
+
+/* an input file, or a partition of one; neither for an empty partition */
+struct join_source {
+    const struct dsvtool_input* in;
+    FILE* file;
+};
+
+static void join_fail(const char* what) {
+    fprintf(stderr, "%s: %s\n", what, strerror(errno));
+    exit(1);
+}
+
+static void* join_grow(void* p, size_t* cap, size_t need, size_t size) {
+    size_t n = *cap ? *cap : 64;
+    while (n < need) n *= 2;
+    if (n != *cap) {
+        p = realloc(p, n * size);
+        if (!p) dsvtool_oom("records");
+        *cap = n;
+    }
+    return p;
+}
+
+/* the fields of one record of text, with values that needed unescaping in
+ * chars until the record is complete */
+struct join_scan {
+    join_visit_fn fn;
+    void* user;
+    struct join_field* fields;
+    size_t nfields;
+    size_t fields_cap;
+    char* chars;
+    size_t chars_len;
+    size_t chars_cap;
+};
+
+static int join_on_field(void* user, const char* field, size_t len,
+                         int flags) {
+    struct join_scan* s = user;
+    struct join_field* f;
+
+    s->fields = join_grow(s->fields, &s->fields_cap, s->nfields + 1,
+                          sizeof(*s->fields));
+    f = &s->fields[s->nfields++];
+    if (flags & UA_DSV_FIELD_UNESCAPE) {
+        s->chars = join_grow(s->chars, &s->chars_cap, s->chars_len + len + 1,
+                             1);
+        f->s = NULL;
+        f->len = ua_dsv_unescape_u8(field, len, join_in.quote,
+                                    s->chars + s->chars_len);
+        s->chars_len += f->len;
+    } else {
+        f->s = field;
+        f->len = len;
+    }
+    return TRUE;
+}
+
+static int join_on_record(void* user, const char* record, size_t len,
+                          size_t nfields) {
+    struct join_scan* s = user;
+    size_t off = 0, i;
+    int more;
+
+    (void)record;
+    (void)len;
+    for (i = 0; i < nfields; ++i) {
+        if (!s->fields[i].s) {
+            s->fields[i].s = s->chars + off;
+            off += s->fields[i].len;
+        }
+    }
+    more = s->fn(s->user, s->fields, nfields);
+    s->nfields = 0;
+    s->chars_len = 0;
+    return more;
+}
+
+/* partitions hold records as their number of fields, the field lengths and
+ * then the field values */
+static void join_part_put(FILE* part, const struct join_field* fields,
+                          size_t nfields) {
+    size_t i;
+    fwrite(&nfields, sizeof(nfields), 1, part);
+    for (i = 0; i < nfields; ++i) {
+        fwrite(&fields[i].len, sizeof(fields[i].len), 1, part);
+    }
+    for (i = 0; i < nfields; ++i) {
+        fwrite(fields[i].s, 1, fields[i].len, part);
+    }
+}
+
+static int join_part_read(FILE* part, struct join_scan* s) {
+    size_t n, total = 0, i;
+    char* p;
+
+    if (fread(&n, sizeof(n), 1, part) != 1) {
+        if (ferror(part)) join_fail(join_tmpdir);
+        return FALSE;
+    }
+    s->fields = join_grow(s->fields, &s->fields_cap, n, sizeof(*s->fields));
+    for (i = 0; i < n; ++i) {
+        if (fread(&s->fields[i].len, sizeof(size_t), 1, part) != 1) {
+            join_fail(join_tmpdir);
+        }
+        total += s->fields[i].len;
+    }
+    s->chars = join_grow(s->chars, &s->chars_cap, total + 1, 1);
+    if (fread(s->chars, 1, total, part) != total) join_fail(join_tmpdir);
+    for (p = s->chars, i = 0; i < n; ++i) {
+        s->fields[i].s = p;
+        p += s->fields[i].len;
+    }
+    s->nfields = n;
+    return TRUE;
+}
+
+/* call @param fn with every record of @param src until it returns false */
+static void join_visit(const struct join_source* src, join_visit_fn fn,
+                       void* user) {
+    struct join_scan s;
+
+    memset(&s, 0, sizeof(s));
+    s.fn = fn;
+    s.user = user;
+    if (src->in) {
+        ua_dsv_scan_u8(src->in->data, src->in->len, join_in.quote,
+                       join_in.delim, join_on_field, join_on_record, &s);
+    } else if (src->file) {
+        rewind(src->file);
+        while (join_part_read(src->file, &s) &&
+               fn(user, s.fields, s.nfields)) {
+        }
+    }
+    free(s.fields);
+    free(s.chars);
+}
+
+/* a new partition, removed as soon as it is closed */
+static FILE* join_part_new(void) {
+    char* path = malloc(strlen(join_tmpdir) + sizeof("/dsvjoinXXXXXX"));
+    FILE* fp;
+    int fd;
+
+    if (!path) dsvtool_oom("paths");
+    sprintf(path, "%s/dsvjoinXXXXXX", join_tmpdir);
+    fd = mkstemp(path);
+    if (fd < 0) join_fail(join_tmpdir);
+    unlink(path);
+    free(path);
+    fp = fdopen(fd, "w+b");
+    if (!fp) join_fail(join_tmpdir);
+    return fp;
+}
+
+/* }}} REGION: RECORDS */
+
+/* {{{ REGION: KEYS */
+
+/* the hash of the key of a record of file @param side (0 or 1), or false
+ * if the record does not have all its key columns */
+static int join_hash(int side, const struct join_field* fields,
+                     size_t nfields, uint64_t* hash) {
+    uint64_t h = 0x9e3779b97f4a7c15u;
+    size_t k, i;
+
+    for (k = 0; k < join_nkeys; ++k) {
+        const struct join_field* f;
+        if (join_keys[side][k] >= nfields) return FALSE;
+        f = &fields[join_keys[side][k]];
+        h = (h ^ f->len) * 0xff51afd7ed558ccdu;
+        for (i = 0; i < f->len; ++i) {
+            h = (h ^ (unsigned char)f->s[i]) * 0x100000001b3u;
+        }
+    }
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53u;
+    h ^= h >> 33;
+    *hash = h;
+    return TRUE;
+}
+
+static int join_key_equal(int side_a, const struct join_field* a,
+                          int side_b, const struct join_field* b) {
+    size_t k;
+    for (k = 0; k < join_nkeys; ++k) {
+        const struct join_field* x = &a[join_keys[side_a][k]];
+        const struct join_field* y = &b[join_keys[side_b][k]];
+        if (x->len != y->len || memcmp(x->s, y->s, x->len)) return FALSE;
+    }
+    return TRUE;
+}
+
+/* parse a comma-separated list of columns counting from 1 into @param cols
+ * counting from 0; returns how many, or 0 on a bad @param spec */
+static size_t join_columns(const char* spec, size_t* cols) {
+    size_t n = 0;
+    char* end;
+
+    for (;;) {
+        unsigned long c = strtoul(spec, &end, 10);
+        if (end == spec || c == 0 || n == JOIN_MAX_KEYS) return 0;
+        cols[n++] = (size_t)(c - 1);
+        if (*end == '\0') return n;
+        if (*end != ',') return 0;
+        spec = end + 1;
+    }
+}
+
+/* }}} REGION: KEYS */
+
+/* {{{ REGION: OUTPUT */
+
+static struct dsvtool_buf join_buf;
+static const char** join_out_fields;
+static size_t* join_out_lens;
+static size_t join_out_cap;
+
+/* write the fields of a file1 record followed by those of a file2 record,
+ * or by empty fields for a left join without one */
+static void join_emit(const struct join_field* f1, size_t n1,
+                      const struct join_field* f2, size_t n2) {
+    size_t n = 0, i;
+
+    if (!f2 && join_type == JOIN_LEFT) n2 = join_width2;
+    if (n1 + n2 > join_out_cap) {
+        join_out_cap = (n1 + n2) * 2;
+        join_out_fields = realloc(join_out_fields,
+                                  join_out_cap * sizeof(*join_out_fields));
+        join_out_lens = realloc(join_out_lens,
+                                join_out_cap * sizeof(*join_out_lens));
+        if (!join_out_fields || !join_out_lens) dsvtool_oom("output");
+    }
+    for (i = 0; i < n1; ++i, ++n) {
+        join_out_fields[n] = f1[i].s;
+        join_out_lens[n] = f1[i].len;
+    }
+    for (i = 0; i < n2; ++i, ++n) {
+        join_out_fields[n] = f2 ? f2[i].s : "";
+        join_out_lens[n] = f2 ? f2[i].len : 0;
+    }
+    dsvtool_put_record(&join_buf, join_out_fields, join_out_lens, n,
+                       &join_out);
+    if (join_buf.len >= JOIN_FLUSH) {
+        if (!dsvtool_write(STDOUT_FILENO, join_buf.s, join_buf.len)) {
+            join_fail("stdout");
+        }
+        join_buf.len = 0;
+    }
+}
+
+/* }}} REGION: OUTPUT */
+
+/* {{{ REGION: JOIN */
+
+/* a record of the build side, in the arena */
+struct join_rec {
+    struct join_rec* next;      /* in its bucket */
+    struct join_rec* after;     /* in the order of the build side */
+    uint64_t hash;
+    size_t nfields;
+    int keyed;                  /* has all its key columns */
+    int matched;
+    struct join_field fields[1];
+};
+
+struct join_table {
+    int side;                   /* of the build side: 0 for file1 */
+    unsigned depth;
+    struct ua_dsv_arena* arena;
+    struct ua_dsv_allocator alloc;
+    struct join_rec** buckets;
+    size_t nbuckets;
+    size_t nrecs;
+    struct join_rec* first;
+    struct join_rec* last;
+    size_t used;                /* bytes of records and buckets */
+    int over;                   /* did not fit */
+};
+
+static void join_rehash(struct join_table* t) {
+    size_t n = t->nbuckets ? t->nbuckets * 2 : 1024;
+    struct join_rec** buckets = calloc(n, sizeof(*buckets));
+    struct join_rec* r;
+
+    if (!buckets) dsvtool_oom("table");
+    for (r = t->first; r; r = r->after) {
+        if (r->keyed) {
+            r->next = buckets[r->hash & (n - 1)];
+            buckets[r->hash & (n - 1)] = r;
+        }
+    }
+    free(t->buckets);
+    t->used += (n - t->nbuckets) * sizeof(*buckets);
+    t->buckets = buckets;
+    t->nbuckets = n;
+}
+
+static int join_build_record(void* user, const struct join_field* fields,
+                             size_t nfields) {
+    struct join_table* t = user;
+    size_t chars = 0, size, i;
+    struct join_rec* r;
+    char* p;
+
+    for (i = 0; i < nfields; ++i) {
+        chars += fields[i].len;
+    }
+    size = sizeof(*r) + nfields * sizeof(r->fields[0]) + chars;
+    if (join_budget && t->used + size > join_budget &&
+        t->depth < JOIN_MAX_DEPTH) {
+        t->over = TRUE;
+        return FALSE;
+    }
+    r = t->alloc.alloc(t->alloc.ctx, size);
+    if (!r) dsvtool_oom("table");
+    t->used += size;
+
+    r->after = NULL;
+    r->nfields = nfields;
+    r->matched = FALSE;
+    p = (char*)&r->fields[nfields + 1];
+    for (i = 0; i < nfields; ++i) {
+        memcpy(p, fields[i].s, fields[i].len);
+        r->fields[i].s = p;
+        r->fields[i].len = fields[i].len;
+        p += fields[i].len;
+    }
+    if (t->last) {
+        t->last->after = r;
+    } else {
+        t->first = r;
+    }
+    t->last = r;
+
+    /* rehashed with the records before it, then added */
+    r->keyed = FALSE;
+    if (join_hash(t->side, fields, nfields, &r->hash)) {
+        if (t->nrecs >= t->nbuckets) join_rehash(t);
+        r->keyed = TRUE;
+        r->next = t->buckets[r->hash & (t->nbuckets - 1)];
+        t->buckets[r->hash & (t->nbuckets - 1)] = r;
+        t->nrecs += 1;
+    }
+    return TRUE;
+}
+
+static int join_probe_record(void* user, const struct join_field* fields,
+                             size_t nfields) {
+    struct join_table* t = user;
+    int side = !t->side;
+    uint64_t hash;
+    int matched = FALSE;
+    struct join_rec* r;
+
+    if (join_hash(side, fields, nfields, &hash)) {
+        for (r = t->buckets[hash & (t->nbuckets - 1)]; r; r = r->next) {
+            if (r->hash != hash ||
+                !join_key_equal(t->side, r->fields, side, fields)) {
+                continue;
+            }
+            matched = TRUE;
+            r->matched = TRUE;
+            if (join_type == JOIN_ANTI) {
+                if (side == 0) break;
+            } else if (side == 0) {
+                join_emit(fields, nfields, r->fields, r->nfields);
+            } else {
+                join_emit(r->fields, r->nfields, fields, nfields);
+            }
+        }
+    }
+    /* file1 records are kept by left and anti joins */
+    if (!matched && side == 0 && join_type != JOIN_INNER) {
+        join_emit(fields, nfields, NULL, 0);
+    }
+    return TRUE;
+}
+
+struct join_split {
+    FILE* parts[JOIN_PARTS];
+    int side;
+    unsigned shift;             /* to the hash bits of the partition */
+};
+
+static int join_partition_record(void* user, const struct join_field* fields,
+                                 size_t nfields) {
+    struct join_split* split = user;
+    uint64_t hash;
+    size_t i = 0;
+
+    /* records without a key match nothing, wherever they go */
+    if (join_hash(split->side, fields, nfields, &hash)) {
+        i = (size_t)(hash >> split->shift) & (JOIN_PARTS - 1);
+    }
+    if (!split->parts[i]) split->parts[i] = join_part_new();
+    join_part_put(split->parts[i], fields, nfields);
+    return TRUE;
+}
+
+/* split @param src of file @param side into partitions by the hash bits
+ * of @param depth */
+static void join_partition(const struct join_source* src, int side,
+                           unsigned depth, FILE** parts) {
+    struct join_split split;
+    size_t i;
+
+    memset(&split, 0, sizeof(split));
+    split.side = side;
+    split.shift = 64 - JOIN_PART_BITS * (depth + 1);
+    join_visit(src, join_partition_record, &split);
+    for (i = 0; i < JOIN_PARTS; ++i) {
+        parts[i] = split.parts[i];
+        if (parts[i] && (fflush(parts[i]) != 0 || ferror(parts[i]))) {
+            join_fail(join_tmpdir);
+        }
+    }
+}
+
+/* join the records of @param build, of file @param side, with those of
+ * @param probe, of the other file */
+static void join_run(const struct join_source* build,
+                     const struct join_source* probe, int side,
+                     unsigned depth) {
+    struct join_table t;
+    struct join_rec* r;
+
+    memset(&t, 0, sizeof(t));
+    t.side = side;
+    t.depth = depth;
+    t.arena = ua_dsv_arena_new(0);
+    if (!t.arena) dsvtool_oom("table");
+    t.alloc = ua_dsv_arena_allocator(t.arena);
+    join_rehash(&t);
+    join_visit(build, join_build_record, &t);
+
+    if (t.over) {
+        FILE* bparts[JOIN_PARTS];
+        FILE* pparts[JOIN_PARTS];
+        size_t i;
+
+        ua_dsv_arena_free(t.arena);
+        free(t.buckets);
+        join_partition(build, side, depth, bparts);
+        join_partition(probe, !side, depth, pparts);
+        for (i = 0; i < JOIN_PARTS; ++i) {
+            struct join_source b = {NULL, bparts[i]};
+            struct join_source p = {NULL, pparts[i]};
+            if (bparts[i] || pparts[i]) {
+                join_run(&b, &p, side, depth + 1);
+            }
+            if (bparts[i]) fclose(bparts[i]);
+            if (pparts[i]) fclose(pparts[i]);
+        }
+        return;
+    }
+
+    join_visit(probe, join_probe_record, &t);
+    /* file1 records in the table that no file2 record matched */
+    if (side == 0 && join_type != JOIN_INNER) {
+        for (r = t.first; r; r = r->after) {
+            if (!r->matched) join_emit(r->fields, r->nfields, NULL, 0);
+        }
+    }
+    ua_dsv_arena_free(t.arena);
+    free(t.buckets);
+}
+
+static int join_first_record(void* user, const struct join_field* fields,
+                             size_t nfields) {
+    (void)fields;
+    *(size_t*)user = nfields;
+    return FALSE;
+}
+
+/* }}} REGION: JOIN */
+
+/* {{{ REGION: DRIVER */
+
+int main(int argc, char** argv) {
+    const char* in_spec = "psv";
+    const char* out_spec = NULL;
+    const char* type = "inner";
+    const char* keys1 = "1";
+    const char* keys2 = NULL;
+    double budget = 256;
+    struct dsvtool_input in[2];
+    struct join_source src[2];
+    int opt, build;
+
+    while ((opt = getopt(argc, argv, "i:o:t:1:2:m:T:")) != -1) {
+        switch (opt) {
+            case 'i': in_spec = optarg; break;
+            case 'o': out_spec = optarg; break;
+            case 't': type = optarg; break;
+            case '1': keys1 = optarg; break;
+            case '2': keys2 = optarg; break;
+            case 'm': budget = strtod(optarg, NULL); break;
+            case 'T': join_tmpdir = optarg; break;
+            default:
+                goto usage;
+        }
+    }
+    if (!strcmp(type, "left")) {
+        join_type = JOIN_LEFT;
+    } else if (!strcmp(type, "anti")) {
+        join_type = JOIN_ANTI;
+    } else if (strcmp(type, "inner")) {
+        goto usage;
+    }
+    join_nkeys = join_columns(keys1, join_keys[0]);
+    if (argc - optind != 2 || join_nkeys == 0 || !(budget > 0) ||
+        join_columns(keys2 ? keys2 : keys1, join_keys[1]) != join_nkeys ||
+        !dsvtool_parse_dialect(in_spec, &join_in) ||
+        !dsvtool_parse_dialect(out_spec ? out_spec : in_spec, &join_out)) {
+        goto usage;
+    }
+    join_budget = (size_t)(budget * 1048576);
+    if (!join_tmpdir) join_tmpdir = getenv("TMPDIR");
+    if (!join_tmpdir || !*join_tmpdir) join_tmpdir = "/tmp";
+
+    if (!dsvtool_input_open(argv[optind], &in[0]) ||
+        !dsvtool_input_open(argv[optind + 1], &in[1])) {
+        return 1;
+    }
+    src[0].in = &in[0];
+    src[0].file = NULL;
+    src[1].in = &in[1];
+    src[1].file = NULL;
+    join_visit(&src[1], join_first_record, &join_width2);
+
+    build = in[0].len < in[1].len ? 0 : 1;
+    join_run(&src[build], &src[!build], build, 0);
+    if (!dsvtool_write(STDOUT_FILENO, join_buf.s, join_buf.len)) {
+        join_fail("stdout");
+    }
+
+    dsvtool_input_close(&in[0]);
+    dsvtool_input_close(&in[1]);
+    dsvtool_buf_free(&join_buf);
+    free(join_out_fields);
+    free(join_out_lens);
+    return 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-i dialect] [-o dialect] [-t type] "
+                    "[-1 columns] [-2 columns] [-m MiB] [-T directory] "
+                    "file1 file2\n", argv[0]);
+    return 2;
+}
+
+/* }}} REGION: DRIVER */
@@ -0,0 +1,745 @@
+
+/*****************************************************************************/
+/*    Name: dsvsort.c                                                        */
+/*   Title: Delimiter-Separated-Value Sort                                   */
+/* Purpose: Sort DSV files by key columns within a memory budget: sorted     */
+/*          runs are made in parallel and merged with a loser tree.          */
+/*  Author: Peter Schultz (sxpws)                                            */
+/*****************************************************************************/
+/* UA AUDIT TRAIL                                                            */
+/*                                                                           */
+/* 2026/10/18 sxpws Initial commit                                           */
+/* 2026/10/18 sxpws Split and repair chunks with dsvtool                     */
+/*                                                                           */
+/* UA AUDIT TRAIL END                                                        */
+/*****************************************************************************/
+
+/* Usage: dsvsort [-i dialect] [-o dialect] [-k key]... [-m MiB] [-j threads]
+ *                [-T directory] file...
+ *
+ *  -i dialect      dialect of the inputs (default psv; see dsvtool.h)
+ *  -o dialect      dialect to write (default: the -i dialect)
+ *  -k key          sort by column N, counting from 1, optionally followed
+ *                  by n to compare numbers and r to reverse the order, like
+ *                  2 or 3nr; repeat -k for further keys (default: all
+ *                  columns in order, as text)
+ *  -m MiB          memory for sorting records, shared by the threads
+ *                  (default 256)
+ *  -j threads      worker threads (default: one per CPU)
+ *  -T directory    directory for the sorted runs (default $TMPDIR or /tmp)
+ *
+ * The records of all inputs are sorted together and written to stdout, one
+ * per line, formatted as ua_format_dsv formats them, so the output parses
+ * back to the same fields. Records are exactly those ua_dsv_scan finds, and
+ * keys are field values with their quotes resolved: a delimiter or newline
+ * inside quotes is part of a key like any other character.
+ *
+ * Text compares byte by byte. A number is a whole field strtod accepts; a
+ * field that is not one, or a column a record does not have, sorts before
+ * all numbers (and a missing text column sorts as an empty one). The sort
+ * is stable: records with equal keys keep their input order.
+ *
+ *  cc -O2 dsvsort.c dsvtool.c gua2csv.c -o dsvsort -lpthread
+ *
+ * Inputs are mapped and split into chunks by dsvtool_split_chunks. Each
+ * worker collects records of a chunk until its share of the memory is used,
+ * sorts them and writes them to a temporary run file, so a chunk may make
+ * several runs. Runs are then merged with a loser tree, which finds the next
+ * record with one comparison per level; with more runs than can be merged
+ * at once, groups of them are first merged into longer runs in parallel.
+ * Input that fits one chunk and one run is written without a run file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dsvtool.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* {{{ REGION: KEYS */
+
+#define SORT_MAX_KEYS 16
+
+struct sort_key {
+    size_t column;              /* counting from 0 */
+    int numeric;
+    int reverse;
+};
+
+static struct sort_key sort_keys[SORT_MAX_KEYS];
+static size_t sort_nkeys;
+static size_t sort_nnum;        /* numeric keys */
+
+struct sort_field {
+    const char* s;
+    size_t len;
+};
+
+struct sort_rec {
+    const struct sort_field* fields;
+    size_t nfields;
+    const double* num;          /* values of the numeric keys, in order */
+    size_t ordinal;             /* position in its run's input */
+};
+
+static const struct sort_field sort_empty = {"", 0};
+
+/* the number in @param f, or NAN if it is not one */
+static double sort_number(const struct sort_field* f) {
+    char tmp[64];
+    char* end;
+    double value;
+
+    if (f->len == 0 || f->len >= sizeof(tmp)) return NAN;
+    memcpy(tmp, f->s, f->len);
+    tmp[f->len] = '\0';
+    value = strtod(tmp, &end);
+    return *end == '\0' ? value : NAN;
+}
+
+/* the values of the numeric keys of @param fields into @param num */
+static void sort_numbers(const struct sort_field* fields, size_t nfields,
+                         double* num) {
+    size_t i;
+    for (i = 0; i < sort_nkeys; ++i) {
+        const struct sort_key* k = &sort_keys[i];
+        if (!k->numeric) continue;
+        *num++ = k->column < nfields ? sort_number(&fields[k->column]) : NAN;
+    }
+}
+
+static int sort_compare_text(const struct sort_field* a,
+                             const struct sort_field* b) {
+    size_t n = a->len < b->len ? a->len : b->len;
+    int c = n ? memcmp(a->s, b->s, n) : 0;
+    if (c) return c;
+    return (a->len > b->len) - (a->len < b->len);
+}
+
+/* order of @param a and @param b by the keys alone */
+static int sort_compare(const struct sort_rec* a, const struct sort_rec* b) {
+    size_t i, num = 0;
+    int c;
+
+    if (sort_nkeys == 0) {
+        size_t n = a->nfields < b->nfields ? a->nfields : b->nfields;
+        for (i = 0; i < n; ++i) {
+            c = sort_compare_text(&a->fields[i], &b->fields[i]);
+            if (c) return c;
+        }
+        return (a->nfields > b->nfields) - (a->nfields < b->nfields);
+    }
+
+    for (i = 0; i < sort_nkeys; ++i) {
+        const struct sort_key* k = &sort_keys[i];
+        if (k->numeric) {
+            double x = a->num[num];
+            double y = b->num[num];
+            num += 1;
+            if (isnan(x) || isnan(y)) {
+                c = !isnan(x) - !isnan(y);
+            } else {
+                c = (x > y) - (x < y);
+            }
+        } else {
+            c = sort_compare_text(
+                k->column < a->nfields ? &a->fields[k->column] : &sort_empty,
+                k->column < b->nfields ? &b->fields[k->column] : &sort_empty);
+        }
+        if (c) return k->reverse ? -c : c;
+    }
+    return 0;
+}
+
+static int sort_qsort_compare(const void* pa, const void* pb) {
+    const struct sort_rec* a = pa;
+    const struct sort_rec* b = pb;
+    int c = sort_compare(a, b);
+    if (c) return c;
+    return (a->ordinal > b->ordinal) - (a->ordinal < b->ordinal);
+}
+
+/* parse a -k option into the next key */
+static int sort_parse_key(const char* spec) {
+    struct sort_key* k;
+    char* end;
+    unsigned long column;
+
+    if (sort_nkeys == SORT_MAX_KEYS) {
+        fprintf(stderr, "at most %d keys\n", SORT_MAX_KEYS);
+        return FALSE;
+    }
+    k = &sort_keys[sort_nkeys];
+    column = strtoul(spec, &end, 10);
+    if (end == spec || column == 0) return FALSE;
+    k->column = (size_t)(column - 1);
+    for (; *end; ++end) {
+        if (*end == 'n') {
+            k->numeric = TRUE;
+        } else if (*end == 'r') {
+            k->reverse = TRUE;
+        } else {
+            return FALSE;
+        }
+    }
+    sort_nnum += k->numeric ? 1 : 0;
+    sort_nkeys += 1;
+    return TRUE;
+}
+
+/* }}} REGION: KEYS */
+
+/* {{{ REGION: OUTPUT */
+
+static struct dsvtool_dialect sort_in;
+static struct dsvtool_dialect sort_out;
+static const char* sort_tmpdir;
+
+#define SORT_FLUSH (1u << 20)
+
+/* formats records onto stdout */
+struct sort_emitter {
+    struct dsvtool_buf buf;
+    const char** fields;
+    size_t* lens;
+    size_t cap;
+};
+
+static void sort_fail(const char* what) {
+    fprintf(stderr, "%s: %s\n", what, strerror(errno));
+    exit(1);
+}
+
+static void sort_emit_flush(struct sort_emitter* e) {
+    if (!dsvtool_write(STDOUT_FILENO, e->buf.s, e->buf.len)) {
+        sort_fail("stdout");
+    }
+    e->buf.len = 0;
+}
+
+static void sort_emit(struct sort_emitter* e, const struct sort_rec* rec) {
+    size_t i;
+    if (rec->nfields > e->cap) {
+        e->cap = rec->nfields * 2;
+        e->fields = realloc(e->fields, e->cap * sizeof(*e->fields));
+        e->lens = realloc(e->lens, e->cap * sizeof(*e->lens));
+        if (!e->fields || !e->lens) dsvtool_oom("output");
+    }
+    for (i = 0; i < rec->nfields; ++i) {
+        e->fields[i] = rec->fields[i].s;
+        e->lens[i] = rec->fields[i].len;
+    }
+    dsvtool_put_record(&e->buf, e->fields, e->lens, rec->nfields, &sort_out);
+    if (e->buf.len >= SORT_FLUSH) sort_emit_flush(e);
+}
+
+static void sort_emit_free(struct sort_emitter* e) {
+    sort_emit_flush(e);
+    dsvtool_buf_free(&e->buf);
+    free(e->fields);
+    free(e->lens);
+}
+
+/* a new run file, removed as soon as it is closed */
+static FILE* sort_run_new(void) {
+    char* path = malloc(strlen(sort_tmpdir) + sizeof("/dsvsortXXXXXX"));
+    FILE* fp;
+    int fd;
+
+    if (!path) dsvtool_oom("paths");
+    sprintf(path, "%s/dsvsortXXXXXX", sort_tmpdir);
+    fd = mkstemp(path);
+    if (fd < 0) sort_fail(sort_tmpdir);
+    unlink(path);
+    free(path);
+    fp = fdopen(fd, "w+b");
+    if (!fp) sort_fail(sort_tmpdir);
+    return fp;
+}
+
+/* runs hold records as their number of fields, the field lengths and then
+ * the field values, without quotes or separators */
+static void sort_run_put(FILE* run, const struct sort_rec* rec) {
+    size_t i;
+    fwrite(&rec->nfields, sizeof(rec->nfields), 1, run);
+    for (i = 0; i < rec->nfields; ++i) {
+        fwrite(&rec->fields[i].len, sizeof(rec->fields[i].len), 1, run);
+    }
+    for (i = 0; i < rec->nfields; ++i) {
+        fwrite(rec->fields[i].s, 1, rec->fields[i].len, run);
+    }
+}
+
+static void sort_run_end(FILE* run) {
+    if (fflush(run) != 0 || ferror(run)) sort_fail(sort_tmpdir);
+    rewind(run);
+}
+
+/* }}} REGION: OUTPUT */
+
+/* {{{ REGION: RUNS */
+
+static size_t sort_chunk_size;
+static size_t sort_batch_budget;
+static int sort_direct;         /* one chunk in all: write it to stdout */
+
+struct sort_chunk {
+    struct dsvtool_chunk span;  /* first, as dsvtool.h asks */
+    const struct dsvtool_input* in;
+    FILE** runs;
+    size_t nruns;
+};
+
+struct sort_file {
+    const char* path;
+    struct dsvtool_input in;
+    struct sort_chunk* chunks;
+    size_t nchunks;
+};
+
+/* the records of a chunk collected for one run */
+struct sort_batch {
+    const char* base;
+    const char* limit;
+    int final;                  /* the chunk ends the input */
+    int full;                   /* stopped at the memory budget */
+    size_t done;                /* end of the last record, from base */
+
+    struct sort_field* fields;  /* s is NULL for values in the arena */
+    size_t nfields;
+    size_t fields_cap;
+    char* arena;                /* values that needed unescaping */
+    size_t arena_len;
+    size_t arena_cap;
+    struct sort_rec* recs;      /* fields holds the index of the first */
+    size_t nrecs;
+    size_t recs_cap;
+    double* num;
+    size_t num_cap;
+
+    size_t rec_field0;          /* the record being collected */
+    size_t rec_arena0;
+};
+
+/* memory the records collected take; the arrays may have grown to twice
+ * that */
+static size_t sort_batch_heap(const struct sort_batch* b) {
+    return b->nfields * sizeof(*b->fields) + b->arena_len +
+           b->nrecs * (sizeof(*b->recs) + sort_nnum * sizeof(*b->num));
+}
+
+static void* sort_grow(void* p, size_t* cap, size_t need, size_t size) {
+    size_t n = *cap ? *cap : 256;
+    while (n < need) n *= 2;
+    if (n != *cap) {
+        p = realloc(p, n * size);
+        if (!p) dsvtool_oom("records");
+        *cap = n;
+    }
+    return p;
+}
+
+static int sort_on_field(void* user, const char* field, size_t len,
+                         int flags) {
+    struct sort_batch* b = user;
+    struct sort_field* f;
+
+    b->fields = sort_grow(b->fields, &b->fields_cap, b->nfields + 1,
+                          sizeof(*b->fields));
+    f = &b->fields[b->nfields++];
+    if (flags & UA_DSV_FIELD_UNESCAPE) {
+        b->arena = sort_grow(b->arena, &b->arena_cap, b->arena_len + len + 1,
+                             1);
+        f->s = NULL;
+        f->len = ua_dsv_unescape_u8(field, len, sort_in.quote,
+                                    b->arena + b->arena_len);
+        b->arena_len += f->len;
+    } else {
+        f->s = field;
+        f->len = len;
+    }
+    return TRUE;
+}
+
+static int sort_on_record(void* user, const char* record, size_t len,
+                          size_t nfields) {
+    struct sort_batch* b = user;
+    const char* end = record + len;
+    size_t eol = 0;
+    struct sort_rec* rec;
+
+    /* the record runs into the next chunk, which sorts it */
+    if (!b->final && (end >= b->limit ||
+                      (*end == '\r' && end + 1 >= b->limit))) {
+        b->nfields = b->rec_field0;
+        b->arena_len = b->rec_arena0;
+        return FALSE;
+    }
+    if (end < b->limit && (*end == '\r' || *end == '\n')) {
+        eol = *end == '\r' && end + 1 < b->limit && end[1] == '\n' ? 2 : 1;
+    }
+
+    b->recs = sort_grow(b->recs, &b->recs_cap, b->nrecs + 1,
+                        sizeof(*b->recs));
+    rec = &b->recs[b->nrecs];
+    rec->fields = (const struct sort_field*)(uintptr_t)b->rec_field0;
+    rec->nfields = nfields;
+    rec->ordinal = b->nrecs;
+    b->nrecs += 1;
+    b->rec_field0 = b->nfields;
+    b->rec_arena0 = b->arena_len;
+    b->done = (size_t)(end - b->base) + eol;
+
+    if (sort_batch_heap(b) >= sort_batch_budget) {
+        b->full = TRUE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* the arrays have stopped moving: point records at their fields and fields
+ * at their values, and work out the numeric keys */
+static void sort_batch_fix(struct sort_batch* b) {
+    size_t arena = 0;
+    size_t i;
+
+    for (i = 0; i < b->nfields; ++i) {
+        if (!b->fields[i].s) {
+            b->fields[i].s = b->arena + arena;
+            arena += b->fields[i].len;
+        }
+    }
+    if (sort_nnum) {
+        b->num = sort_grow(b->num, &b->num_cap, b->nrecs * sort_nnum,
+                           sizeof(*b->num));
+    }
+    for (i = 0; i < b->nrecs; ++i) {
+        struct sort_rec* rec = &b->recs[i];
+        rec->fields = b->fields + (uintptr_t)rec->fields;
+        if (sort_nnum) {
+            rec->num = b->num + i * sort_nnum;
+            sort_numbers(rec->fields, rec->nfields, b->num + i * sort_nnum);
+        }
+    }
+}
+
+/* sort the records of @param c that end by its limit, starting from its
+ * start, into runs, dropping those of an earlier run; the last chunk sorts
+ * everything that is left */
+static void sort_chunk_run(struct sort_chunk* c) {
+    struct sort_batch b;
+    size_t pos = c->span.start;
+    size_t i;
+
+    for (i = 0; i < c->nruns; ++i) {
+        fclose(c->runs[i]);
+    }
+    c->nruns = 0;
+
+    memset(&b, 0, sizeof(b));
+    do {
+        b.base = c->in->data + pos;
+        b.limit = c->in->data + c->span.limit;
+        b.final = c->span.limit == c->in->len;
+        b.full = FALSE;
+        b.done = 0;
+        b.nfields = b.arena_len = b.nrecs = 0;
+        b.rec_field0 = b.rec_arena0 = 0;
+        ua_dsv_scan_u8(b.base, c->span.limit - pos, sort_in.quote,
+                       sort_in.delim, sort_on_field, sort_on_record, &b);
+        if (b.nrecs == 0) break;
+
+        sort_batch_fix(&b);
+        qsort(b.recs, b.nrecs, sizeof(*b.recs), sort_qsort_compare);
+        if (sort_direct && pos == c->span.start && !b.full) {
+            struct sort_emitter e;
+            memset(&e, 0, sizeof(e));
+            for (i = 0; i < b.nrecs; ++i) {
+                sort_emit(&e, &b.recs[i]);
+            }
+            sort_emit_free(&e);
+        } else {
+            FILE* run = sort_run_new();
+            for (i = 0; i < b.nrecs; ++i) {
+                sort_run_put(run, &b.recs[i]);
+            }
+            sort_run_end(run);
+            c->runs = realloc(c->runs, (c->nruns + 1) * sizeof(*c->runs));
+            if (!c->runs) dsvtool_oom("runs");
+            c->runs[c->nruns++] = run;
+        }
+        pos += b.done;
+    } while (b.full);
+    c->span.end = pos;
+
+    free(b.fields);
+    free(b.arena);
+    free(b.recs);
+    free(b.num);
+}
+
+static void sort_chunk_task(void* arg) {
+    sort_chunk_run(arg);
+}
+
+/* }}} REGION: RUNS */
+
+/* {{{ REGION: MERGE */
+
+#define MERGE_FANIN 64
+#define MERGE_NONE ((size_t)-1)  /* wins every match while the tree fills */
+
+struct merge_input {
+    FILE* run;
+    struct sort_field* fields;
+    size_t fields_cap;
+    char* chars;
+    size_t chars_cap;
+    double num[SORT_MAX_KEYS];
+    struct sort_rec rec;
+    int done;
+};
+
+/* the next record of @param in, or done */
+static void merge_read(struct merge_input* in) {
+    size_t n, total = 0, i;
+    char* s;
+
+    if (fread(&n, sizeof(n), 1, in->run) != 1) {
+        if (ferror(in->run)) sort_fail(sort_tmpdir);
+        in->done = TRUE;
+        return;
+    }
+    in->fields = sort_grow(in->fields, &in->fields_cap, n,
+                           sizeof(*in->fields));
+    for (i = 0; i < n; ++i) {
+        if (fread(&in->fields[i].len, sizeof(size_t), 1, in->run) != 1) {
+            sort_fail(sort_tmpdir);
+        }
+        total += in->fields[i].len;
+    }
+    in->chars = sort_grow(in->chars, &in->chars_cap, total + 1, 1);
+    if (fread(in->chars, 1, total, in->run) != total) sort_fail(sort_tmpdir);
+    for (s = in->chars, i = 0; i < n; ++i) {
+        in->fields[i].s = s;
+        s += in->fields[i].len;
+    }
+    in->rec.fields = in->fields;
+    in->rec.nfields = n;
+    in->rec.num = in->num;
+    sort_numbers(in->fields, n, in->num);
+}
+
+/* does input @param a come before input @param b; equal records come in
+ * the order of their runs */
+static int merge_before(const struct merge_input* in, size_t a, size_t b) {
+    int c;
+    if (a == MERGE_NONE) return TRUE;
+    if (b == MERGE_NONE) return FALSE;
+    if (in[a].done) return FALSE;
+    if (in[b].done) return TRUE;
+    c = sort_compare(&in[a].rec, &in[b].rec);
+    return c < 0 || (c == 0 && a < b);
+}
+
+/* replay the matches of input @param s from its leaf up to the root: each
+ * node of @param tree keeps the loser of the match played there and the
+ * winner goes on, ending in tree[0] */
+static void merge_replay(const struct merge_input* in, size_t k,
+                         size_t* tree, size_t s) {
+    size_t t;
+    for (t = (s + k) / 2; t > 0; t /= 2) {
+        if (merge_before(in, tree[t], s)) {
+            size_t loser = s;
+            s = tree[t];
+            tree[t] = loser;
+        }
+    }
+    tree[0] = s;
+}
+
+/* merge @param k runs, closing them, into the run @param out or stdout when
+ * it is NULL */
+static void sort_merge(FILE** runs, size_t k, FILE* out) {
+    struct merge_input* in = calloc(k, sizeof(*in));
+    size_t* tree = malloc(k * sizeof(*tree));
+    struct sort_emitter e;
+    size_t i;
+
+    if (!in || !tree) dsvtool_oom("merge");
+    memset(&e, 0, sizeof(e));
+    for (i = 0; i < k; ++i) {
+        in[i].run = runs[i];
+        merge_read(&in[i]);
+        tree[i] = MERGE_NONE;
+    }
+    for (i = k; i > 0; --i) {
+        merge_replay(in, k, tree, i - 1);
+    }
+
+    while (k > 0 && !in[tree[0]].done) {
+        struct merge_input* win = &in[tree[0]];
+        if (out) {
+            sort_run_put(out, &win->rec);
+        } else {
+            sort_emit(&e, &win->rec);
+        }
+        merge_read(win);
+        merge_replay(in, k, tree, tree[0]);
+    }
+
+    if (out) {
+        sort_run_end(out);
+    } else {
+        sort_emit_free(&e);
+    }
+    for (i = 0; i < k; ++i) {
+        fclose(in[i].run);
+        free(in[i].fields);
+        free(in[i].chars);
+    }
+    free(in);
+    free(tree);
+}
+
+struct merge_group {
+    FILE** runs;
+    size_t k;
+    FILE* out;
+};
+
+static void merge_group_task(void* arg) {
+    struct merge_group* g = arg;
+    sort_merge(g->runs, g->k, g->out);
+}
+
+/* merge consecutive groups of runs until there are few enough to merge at
+ * once; returns the number of runs left in @param runs */
+static size_t sort_reduce(struct dsvtool_pool* pool, FILE** runs, size_t n) {
+    while (n > MERGE_FANIN) {
+        size_t ngroups = (n + MERGE_FANIN - 1) / MERGE_FANIN;
+        struct merge_group* groups = calloc(ngroups, sizeof(*groups));
+        size_t i;
+
+        if (!groups) dsvtool_oom("merge");
+        for (i = 0; i < ngroups; ++i) {
+            groups[i].runs = runs + i * MERGE_FANIN;
+            groups[i].k = i + 1 < ngroups ? MERGE_FANIN
+                                          : n - i * MERGE_FANIN;
+            groups[i].out = sort_run_new();
+            dsvtool_pool_submit(pool, merge_group_task, &groups[i]);
+        }
+        dsvtool_pool_wait(pool);
+        for (i = 0; i < ngroups; ++i) {
+            runs[i] = groups[i].out;
+        }
+        free(groups);
+        n = ngroups;
+    }
+    return n;
+}
+
+/* }}} REGION: MERGE */
+
+/* {{{ REGION: DRIVER */
+
+int main(int argc, char** argv) {
+    const char* in_spec = "psv";
+    const char* out_spec = NULL;
+    double budget = 256;
+    unsigned threads = 0;
+    struct dsvtool_pool* pool;
+    struct sort_file* files;
+    FILE** runs = NULL;
+    size_t nfiles, nchunks = 0, nruns = 0, i, j;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:o:k:m:j:T:")) != -1) {
+        switch (opt) {
+            case 'i': in_spec = optarg; break;
+            case 'o': out_spec = optarg; break;
+            case 'k':
+                if (!sort_parse_key(optarg)) goto usage;
+                break;
+            case 'm': budget = strtod(optarg, NULL); break;
+            case 'j': threads = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 'T': sort_tmpdir = optarg; break;
+            default:
+                goto usage;
+        }
+    }
+    if (optind == argc || !(budget > 0) ||
+        !dsvtool_parse_dialect(in_spec, &sort_in) ||
+        !dsvtool_parse_dialect(out_spec ? out_spec : in_spec, &sort_out)) {
+        goto usage;
+    }
+    if (!sort_tmpdir) sort_tmpdir = getenv("TMPDIR");
+    if (!sort_tmpdir || !*sort_tmpdir) sort_tmpdir = "/tmp";
+
+    pool = dsvtool_pool_new(threads);
+    sort_batch_budget = (size_t)(budget * 1048576) / dsvtool_pool_size(pool);
+    if (sort_batch_budget < 65536) sort_batch_budget = 65536;
+    /* records take at least as much memory as their text */
+    sort_chunk_size = sort_batch_budget;
+
+    nfiles = (size_t)(argc - optind);
+    files = calloc(nfiles, sizeof(*files));
+    if (!files) dsvtool_oom("files");
+    for (i = 0; i < nfiles; ++i) {
+        files[i].path = argv[optind + i];
+        if (!dsvtool_input_open(files[i].path, &files[i].in)) return 1;
+        files[i].chunks = dsvtool_split_chunks(&files[i].in, sort_chunk_size,
+                                               sizeof(*files[i].chunks),
+                                               &files[i].nchunks);
+        for (j = 0; j < files[i].nchunks; ++j) {
+            files[i].chunks[j].in = &files[i].in;
+        }
+        nchunks += files[i].nchunks;
+    }
+
+    sort_direct = nchunks == 1;
+    for (i = 0; i < nfiles; ++i) {
+        for (j = 0; j < files[i].nchunks; ++j) {
+            dsvtool_pool_submit(pool, sort_chunk_task, &files[i].chunks[j]);
+        }
+    }
+    dsvtool_pool_wait(pool);
+
+    for (i = 0; i < nfiles; ++i) {
+        dsvtool_repair_chunks(files[i].chunks, files[i].nchunks,
+                              sizeof(*files[i].chunks), sort_chunk_task);
+        for (j = 0; j < files[i].nchunks; ++j) {
+            struct sort_chunk* c = &files[i].chunks[j];
+            if (c->nruns > 0) {
+                runs = realloc(runs, (nruns + c->nruns) * sizeof(*runs));
+                if (!runs) dsvtool_oom("runs");
+                memcpy(runs + nruns, c->runs, c->nruns * sizeof(*runs));
+                nruns += c->nruns;
+            }
+            free(c->runs);
+        }
+        free(files[i].chunks);
+        dsvtool_input_close(&files[i].in);
+    }
+    free(files);
+
+    nruns = sort_reduce(pool, runs, nruns);
+    dsvtool_pool_free(pool);
+    if (nruns > 0) sort_merge(runs, nruns, NULL);
+    free(runs);
+    return 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-i dialect] [-o dialect] [-k key]... "
+                    "[-m MiB] [-j threads] [-T directory] file...\n",
+            argv[0]);
+    return 2;
+}
+
+/* }}} REGION: DRIVER */
@@ -0,0 +1,208 @@
+
+/*****************************************************************************/
+/*    Name: dsvtail.c                                                        */
+/*   Title: Delimiter-Separated-Value Follower                               */
+/* Purpose: Print the records appended to a DSV file as they are completed, */
+/*          optionally resuming from a saved offset.                         */
+/*  Author: Peter Schultz (sxpws)                                            */
+/*****************************************************************************/
+/* UA AUDIT TRAIL                                                            */
+/*                                                                           */
+/* 2026/10/18 sxpws Initial commit                                           */
+/* 2026/10/18 sxpws Stop on a failed wait                                    */
+/*                                                                           */
+/* UA AUDIT TRAIL END                                                        */
+/*****************************************************************************/
+
+/* Usage: dsvtail [-i dialect] [-o dialect] [-s statefile] [-f] file
+ *
+ *  -i dialect      dialect of the file (default psv; see dsvtool.h)
+ *  -o dialect      convert the records to this dialect (default: print
+ *                  them as they appear in the file)
+ *  -s statefile    start from the offset saved in statefile, and save the
+ *                  offset there after every batch of records printed
+ *  -f              keep following the file until killed, through truncation
+ *                  and rotation (see ua_dsv_follow_new)
+ *
+ * Only complete records are printed, one per line; a record still being
+ * written is printed once it is complete. Without -f, the records complete
+ * now are printed and dsvtail exits.
+ *
+ * The offset is saved only after the records before it were written, so a
+ * dsvtail restarted with the same statefile prints every record at least
+ * once, and only repeats those of a batch it was killed in the middle of.
+ *
+ *  cc -O2 dsvtail.c dsvtool.c gua2csv.c -o dsvtail -lpthread
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dsvtool.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* {{{ REGION: FOLLOWING */
+
+#define TAIL_WAIT 1000          /* ms between polls when nothing happens */
+
+static struct dsvtool_dialect tail_in;
+static struct dsvtool_dialect tail_out;
+static int tail_convert;
+
+struct tail_out {
+    struct dsvtool_buf raw;     /* records as they are */
+    char* conv;                 /* converted records, released with
+                                 * ua_dsv_free */
+    size_t conv_len;
+    size_t conv_cap;
+    int failed;
+};
+
+static int tail_on_record(void* user, const char* record, size_t len,
+                          size_t nfields) {
+    struct tail_out* out = user;
+    (void)nfields;
+    if (!tail_convert) {
+        dsvtool_buf_put(&out->raw, record, len);
+        dsvtool_buf_put(&out->raw, "\n", 1);
+        return TRUE;
+    }
+    /* a complete record on its own is a final input */
+    if (ua_dsv_transcode_u8(record, len, TRUE, tail_in.quote, tail_in.delim,
+                            &out->conv, &out->conv_len, &out->conv_cap,
+                            tail_out.quoting, tail_out.quote, tail_out.delim,
+                            tail_out.escape) == (size_t)-1) {
+        out->failed = TRUE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* the offset saved in @param path, or 0 if there is none */
+static int tail_load(const char* path, uint64_t* offset) {
+    FILE* fp = fopen(path, "r");
+    *offset = 0;
+    if (!fp) return errno == ENOENT;
+    if (fscanf(fp, "%" SCNu64, offset) != 1) {
+        fclose(fp);
+        errno = EINVAL;
+        return FALSE;
+    }
+    fclose(fp);
+    return TRUE;
+}
+
+/* replace @param path with one holding @param offset */
+static int tail_save(const char* path, uint64_t offset) {
+    char* tmp = malloc(strlen(path) + sizeof(".tmp"));
+    FILE* fp;
+    int ok;
+
+    if (!tmp) dsvtool_oom("paths");
+    sprintf(tmp, "%s.tmp", path);
+    fp = fopen(tmp, "w");
+    ok = fp != NULL;
+    if (ok) {
+        ok = fprintf(fp, "%" PRIu64 "\n", offset) > 0;
+        ok = fclose(fp) == 0 && ok;
+        ok = ok && rename(tmp, path) == 0;
+    }
+    free(tmp);
+    return ok;
+}
+
+/* print what @param out collected and save the offset @param f reached */
+static int tail_flush(struct tail_out* out, struct ua_dsv_follower* f,
+                      const char* state) {
+    int ok = tail_convert
+        ? dsvtool_write(STDOUT_FILENO, out->conv, out->conv_len)
+        : dsvtool_write(STDOUT_FILENO, out->raw.s, out->raw.len);
+    if (!ok) {
+        fprintf(stderr, "stdout: %s\n", strerror(errno));
+        return FALSE;
+    }
+    out->raw.len = 0;
+    out->conv_len = 0;
+    if (state && !tail_save(state, ua_dsv_follow_offset(f))) {
+        fprintf(stderr, "%s: %s\n", state, strerror(errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* }}} REGION: FOLLOWING */
+
+/* {{{ REGION: DRIVER */
+
+int main(int argc, char** argv) {
+    const char* in_spec = "psv";
+    const char* out_spec = NULL;
+    const char* state = NULL;
+    const char* path;
+    struct ua_dsv_follower* f;
+    struct tail_out out;
+    uint64_t offset = 0;
+    int follow = FALSE;
+    int opt, ok;
+
+    while ((opt = getopt(argc, argv, "i:o:s:f")) != -1) {
+        switch (opt) {
+            case 'i': in_spec = optarg; break;
+            case 'o': out_spec = optarg; break;
+            case 's': state = optarg; break;
+            case 'f': follow = TRUE; break;
+            default:
+                goto usage;
+        }
+    }
+    if (argc - optind != 1 || !dsvtool_parse_dialect(in_spec, &tail_in) ||
+        (out_spec && !dsvtool_parse_dialect(out_spec, &tail_out))) {
+        goto usage;
+    }
+    path = argv[optind];
+    tail_convert = out_spec != NULL;
+
+    if (state && !tail_load(state, &offset)) {
+        fprintf(stderr, "%s: %s\n", state, strerror(errno));
+        return 1;
+    }
+    memset(&out, 0, sizeof(out));
+    f = ua_dsv_follow_new(path, offset, tail_in.quote, tail_in.delim, NULL,
+                          tail_on_record, &out);
+    if (!f) dsvtool_oom(path);
+
+    for (;;) {
+        long n = ua_dsv_follow_poll(f);
+        if (out.failed) dsvtool_oom(path);
+        ok = n >= 0;
+        if (!ok) {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        } else if (n > 0) {
+            ok = tail_flush(&out, f, state);
+        }
+        if (!ok || !follow) break;
+        /* a timeout or a signal only means polling once more */
+        if (ua_dsv_follow_wait(f, TAIL_WAIT) < 0 && errno != EINTR) {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            ok = FALSE;
+            break;
+        }
+    }
+
+    ua_dsv_follow_free(f);
+    dsvtool_buf_free(&out.raw);
+    ua_dsv_free(out.conv);
+    return ok ? 0 : 1;
+
+usage:
+    fprintf(stderr, "usage: %s [-i dialect] [-o dialect] [-s statefile] "
+                    "[-f] file\n", argv[0]);
+    return 2;
+}
+
+/* }}} REGION: DRIVER */
@@ -0,0 +1,310 @@
+#!/bin/sh
+#############################################################################
+#    Name: dsvtest.sh                                                       #
+#   Title: Delimiter-Separated-Value Tool Checks                            #
+# Purpose: Build the dsv* tools and check their output against POSIX        #
+#          tools, or against expected output where there is no such tool.   #
+#  Author: Peter Schultz (sxpws)                                            #
+#############################################################################
+# UA AUDIT TRAIL                                                            #
+#                                                                           #
+# 2026/10/18 sxpws Initial commit: dsvsort                                  #
+# 2026/10/18 sxpws Check dsvjoin                                            #
+# 2026/10/18 sxpws Check dsvdiff                                            #
+#                                                                           #
+# UA AUDIT TRAIL END                                                        #
+#############################################################################
+
+# Usage: sh dsvtest.sh [tool]...
+#
+# Checks the named tools, or all of them, and prints PASS, or FAIL with the
+# command that failed. The tools are built with $CC (default cc) and
+# $CFLAGS, which must find tmcilib.h:
+#
+#  CFLAGS=-I/path/to/tmcilib sh dsvtest.sh dsvsort
+#
+# Inputs are generated with awk, so that they are large enough for the
+# paths a tool only takes on big inputs, such as spilling to run files,
+# while the memory budget is set very low.
+
+set -u
+
+here=$(cd "$(dirname "$0")" && pwd)
+work=$(mktemp -d "${TMPDIR:-/tmp}/dsvtest.XXXXXX") || exit 2
+trap 'rm -rf "$work"' EXIT
+LC_ALL=C
+export LC_ALL
+
+fail() {
+    echo "FAIL: $*"
+    exit 1
+}
+
+build() {
+    ${CC:-cc} -O2 ${CFLAGS:-} "$here/$1.c" "$here/dsvtool.c" \
+        "$here/gua2csv.c" -o "$work/$1" -lpthread || fail "build $1"
+}
+
+# same <expected> <got> <what>
+same() {
+    cmp -s "$1" "$2" || fail "$3"
+}
+
+# {{{ dsvsort
+
+# id|number|word, with few distinct numbers and words so that most keys tie
+sort_input() {
+    awk -v n="$1" -v seed="$2" 'BEGIN {
+        split("-2.5 0 3 03 10 7.25 -0 -10 0.5 100", num, " ");
+        split("pear apple fig Fig apple2 banana", word, " ");
+        srand(seed);
+        for (i = 1; i <= n; ++i) {
+            printf "r%d|%s|%s\n", i, num[int(rand() * 10) + 1],
+                   word[int(rand() * 6) + 1];
+        }
+    }'
+}
+
+check_dsvsort() {
+    build dsvsort
+    sort_input 60000 7 > "$work/sort.psv"
+    sort_input 3000 8 > "$work/sort2.psv"
+    mkdir "$work/runs"
+
+    # -m 256 sorts in memory; -m 0.05 spills hundreds of runs, more than one
+    # loser tree merges at once
+    for m in "256 -j 1" "0.05 -j 4"; do
+        set -- -m $m -T "$work/runs"
+
+        "$work/dsvsort" "$@" -k 2n -k 1 "$work/sort.psv" > "$work/got" ||
+            fail "dsvsort $* -k 2n -k 1"
+        sort -s -t '|' -k 2,2n -k 1,1 "$work/sort.psv" > "$work/want"
+        same "$work/want" "$work/got" "dsvsort $* -k 2n -k 1"
+
+        # ties keep their input order, across inputs too
+        "$work/dsvsort" "$@" -k 2n "$work/sort.psv" "$work/sort2.psv" \
+            > "$work/got" || fail "dsvsort $* -k 2n"
+        cat "$work/sort.psv" "$work/sort2.psv" |
+            sort -s -t '|' -k 2,2n > "$work/want"
+        same "$work/want" "$work/got" "dsvsort $* -k 2n (stable)"
+
+        "$work/dsvsort" "$@" -k 3 -k 2nr "$work/sort.psv" > "$work/got" ||
+            fail "dsvsort $* -k 3 -k 2nr"
+        sort -s -t '|' -k 3,3 -k 2,2nr "$work/sort.psv" > "$work/want"
+        same "$work/want" "$work/got" "dsvsort $* -k 3 -k 2nr"
+
+        # no keys: every column as text
+        "$work/dsvsort" "$@" "$work/sort.psv" > "$work/got" ||
+            fail "dsvsort $*"
+        sort -s -t '|' -k 1,1 -k 2,2 -k 3,3 "$work/sort.psv" > "$work/want"
+        same "$work/want" "$work/got" "dsvsort $* (no keys)"
+
+        [ -z "$(ls "$work/runs")" ] || fail "dsvsort $* left run files"
+    done
+
+    # keys are values: quotes resolved, delimiters and newlines included;
+    # non-numbers and missing columns sort before numbers
+    printf '%s\n' 'b,"2"' '"a,z",x' '"a' 'b",1' 'c' '"a""",1.5' > "$work/in"
+    printf '%s\n' '"a,z",x' 'c' '"a' 'b",1' '"a""",1.5' 'b,2' > "$work/want"
+    "$work/dsvsort" -i csv -k 2n -m 0.0001 "$work/in" > "$work/got" ||
+        fail "dsvsort -i csv -k 2n"
+    same "$work/want" "$work/got" "dsvsort -i csv -k 2n"
+}
+
+# }}} dsvsort
+
+# {{{ dsvjoin
+
+# key|a|b records, n of them, with keys below keys and b below 3
+join_input() {
+    awk -v n="$1" -v keys="$2" -v seed="$3" 'BEGIN {
+        srand(seed);
+        for (i = 1; i <= n; ++i) {
+            printf "k%d|%d|%d\n", int(rand() * keys), i, int(rand() * 3);
+        }
+    }'
+}
+
+# join_oracle <type> <columns1> <columns2> <file1> <file2>
+#
+# The same join as a nested loop over file2 records by key, in awk. A
+# record without all of its key columns matches nothing.
+join_oracle() {
+    awk -F '|' -v OFS='|' -v type="$1" -v c1="$2" -v c2="$3" '
+        function key(columns,    c, n, i) {
+            n = split(columns, c, ",");
+            k = "";
+            for (i = 1; i <= n; ++i) {
+                if (c[i] > NF) return 0;
+                k = k SUBSEP $c[i];
+            }
+            return 1;
+        }
+        NR == FNR {
+            if (FNR == 1) width = NF;
+            if (key(c2)) recs[k, ++count[k]] = $0;
+            next;
+        }
+        {
+            n = key(c1) ? count[k] + 0 : 0;
+            if (type == "anti") {
+                if (n == 0) print;
+                next;
+            }
+            for (i = 1; i <= n; ++i) print $0, recs[k, i];
+            if (n == 0 && type == "left") {
+                line = $0;
+                for (i = 0; i < width; ++i) line = line OFS;
+                print line;
+            }
+        }' "$5" "$4"
+}
+
+check_dsvjoin() {
+    build dsvjoin
+    join_input 20000 5000 1 > "$work/big.psv"
+    join_input 3000 8000 2 > "$work/small.psv"
+    mkdir "$work/parts"
+
+    # -m 0.01 partitions both files, and the partitions again; either file
+    # may be the smaller one, in the table
+    for pair in "big small" "small big"; do
+        set -- $pair
+        f1=$work/$1.psv
+        f2=$work/$2.psv
+        for t in inner left anti; do
+            for keys in "1 1" "1,3 1,3" "3,1 3,1"; do
+                set -- $keys
+                join_oracle $t "$1" "$2" "$f1" "$f2" | sort > "$work/want"
+                for m in 256 0.01; do
+                    what="dsvjoin -t $t -1 $1 -2 $2 -m $m $pair"
+                    "$work/dsvjoin" -t $t -1 "$1" -2 "$2" -m $m \
+                        -T "$work/parts" "$f1" "$f2" > "$work/got" ||
+                        fail "$what"
+                    sort "$work/got" > "$work/sorted"
+                    same "$work/want" "$work/sorted" "$what"
+                    [ -z "$(ls "$work/parts")" ] ||
+                        fail "$what left partitions"
+                done
+            done
+        done
+    done
+
+    # keys are values: quoted or not, with delimiters inside; a record
+    # without its key column matches nothing, and an empty last field of
+    # a left join is quoted to keep it
+    printf '%s\n' '"x""y",1' '"a,b",2' 'lone' > "$work/in1"
+    printf '%s\n' '7,x"y' '8,"a,b"' '9,' > "$work/in2"
+    printf '%s\n' '"a,b",2,8,"a,b"' 'lone,,""' 'x"y,1,7,x"y' > "$work/want"
+    "$work/dsvjoin" -i csv -t left -2 2 "$work/in1" "$work/in2" |
+        sort > "$work/got"
+    same "$work/want" "$work/got" "dsvjoin -i csv -t left -2 2"
+}
+
+# }}} dsvjoin
+
+# {{{ dsvdiff
+
+# key|a|b records, several to most keys, and a copy of them changed:
+# records dropped, edited and added, and all of them shuffled
+diff_input() {
+    awk -v n="$1" -v old="$2" -v new="$3" 'BEGIN {
+        srand(5);
+        for (i = 1; i <= n; ++i) {
+            line = sprintf("k%d|%d|%d", int(rand() * n / 2), i % 7,
+                           int(rand() * 4));
+            print line > old;
+            r = rand();
+            if (r < 0.05) continue;
+            if (r < 0.10) sub(/[0-9]+$/, "x", line);
+            if (r < 0.12) line = line "\n" line;
+            if (r > 0.98) line = line "\nn" i "|new|0";
+            print rand() "\t" line;
+        }
+    }' | sort | cut -f 2- > "$3"
+}
+
+# diff_oracle <columns> <old> <new>
+#
+# The keys of the two extracts compared as multisets of records, in awk.
+diff_oracle() {
+    awk -F '|' -v OFS='|' -v columns="$1" '
+        BEGIN { n = split(columns, c, ","); }
+        NF > 0 {
+            side = FILENAME == ARGV[1] ? "old" : "new";
+            k = "";
+            for (i = 1; i <= n; ++i) k = k OFS $c[i];
+            keys[k] = 1;
+            has[side, k] = 1;
+            count[k SUBSEP $0] += side == "old" ? -1 : 1;
+            key[k SUBSEP $0] = k;
+        }
+        END {
+            for (r in count) if (count[r]) changed[key[r]] = 1;
+            for (k in keys) {
+                if (!has["old", k]) print "+" k;
+                else if (!has["new", k]) print "-" k;
+                else if (changed[k]) print "~" k;
+            }
+        }' "$2" "$3"
+}
+
+# csv_of <psv> <csv>: the same records, the second value quoted with
+# quotes and a newline in it
+csv_of() {
+    awk -F '|' -v OFS=',' '{
+        if (NF > 1) $2 = "\"" $2 " \"\"q\"\"\nline\"";
+        print;
+    }' "$1" > "$2"
+}
+
+check_dsvdiff() {
+    build dsvdiff
+    diff_input 40000 "$work/old.psv" "$work/new.psv"
+    csv_of "$work/old.psv" "$work/old.csv"
+    csv_of "$work/new.psv" "$work/new.csv"
+
+    # the same differences whatever the chunks and threads, also when
+    # chunks start inside quoted fields
+    for keys in 1 3,1; do
+        diff_oracle $keys "$work/old.psv" "$work/new.psv" | sort \
+            > "$work/want"
+        for run in "-c 8 -j 1" "-c 0.01 -j 4" "-c 0.001 -j 3"; do
+            for form in "psv" "csv -o psv"; do
+                ext=${form%% *}
+                what="dsvdiff -k $keys $run -i $form"
+                "$work/dsvdiff" -k $keys $run -i $form "$work/old.$ext" \
+                    "$work/new.$ext" > "$work/got"
+                [ $? -eq 1 ] || fail "$what: exit status"
+                sort "$work/got" > "$work/sorted"
+                same "$work/want" "$work/sorted" "$what"
+            done
+        done
+    done
+
+    # values are compared, not text: quoting alone is no difference; a key
+    # of several records changes when its records do, in any order
+    printf '%s\n' '1,"a",b' '2,x' '3,p' '3,q' '4,p' '4,q' '5,p' '' \
+        > "$work/in1"
+    printf '%s\n' '"1",a,"b"' '2,"x"' '3,q' '3,p' '4,p' '4,p' '5,p' '5,p' \
+        > "$work/in2"
+    printf '%s\n' '~,4' '~,5' > "$work/want"
+    "$work/dsvdiff" -i csv "$work/in1" "$work/in2" > "$work/got"
+    [ $? -eq 1 ] || fail "dsvdiff -i csv: exit status"
+    sort "$work/got" > "$work/sorted"
+    same "$work/want" "$work/sorted" "dsvdiff -i csv"
+
+    head -n 2 "$work/in1" > "$work/in1a"
+    head -n 2 "$work/in2" > "$work/in2a"
+    "$work/dsvdiff" -i csv "$work/in1a" "$work/in2a" > "$work/got" ||
+        fail "dsvdiff -i csv (quoting only): exit status"
+    [ ! -s "$work/got" ] || fail "dsvdiff -i csv (quoting only)"
+}
+
+# }}} dsvdiff
+
+tools=${*:-dsvsort dsvjoin dsvdiff}
+for tool in $tools; do
+    "check_$tool"
+done
+echo PASS
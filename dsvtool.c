@@ -0,0 +1,573 @@
+
+/*****************************************************************************/
+/*    Name: dsvtool.c                                                        */
+/*   Title: Delimiter-Separated-Value Command-Line Tool Support              */
+/* Purpose: Pieces shared by the dsv* command-line tools built on gua2csv:   */
+/*          dialect options, mapped input files, output buffers and a        */
+/*          work-stealing thread pool.                                       */
+/*  Author: Peter Schultz (sxpws)                                            */
+/*****************************************************************************/
+/* UA AUDIT TRAIL                                                            */
+/*                                                                           */
+/* 2026/10/18 sxpws Initial commit                                           */
+/* 2026/10/18 sxpws Added dsvtool_split_chunks, dsvtool_repair_chunks        */
+/*                                                                           */
+/* UA AUDIT TRAIL END                                                        */
+/*****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dsvtool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* {{{ REGION: DIALECTS */
+
+static const struct {
+    const char* name;
+    struct dsvtool_dialect dialect;
+} dialect_presets[] = {
+    {"csv", {'"', ',', '\0', QUOTE_NEEDED}},
+    {"psv", {'\0', '|', '\0', QUOTE_NONE}},
+    {"tsv", {'\0', '\t', '\0', QUOTE_NONE}}
+};
+
+/* parse the character of an override, which runs to the next '/' */
+static int dialect_char(const char* s, size_t n, char* c) {
+    if (n == 4 && !strncmp(s, "none", 4)) {
+        *c = '\0';
+    } else if (n == 1) {
+        *c = s[0];
+    } else if (n == 2 && s[0] == '\\') {
+        switch (s[1]) {
+            case 't': *c = '\t'; break;
+            case '\\': *c = '\\'; break;
+            case '/': *c = '/'; break;
+            default: return FALSE;
+        }
+    } else if (n > 2 && n <= 4 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        char hex[3] = {0};
+        char* end;
+        memcpy(hex, s+2, n-2);
+        *c = (char)strtoul(hex, &end, 16);
+        if (*end) return FALSE;
+    } else {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+int dsvtool_parse_dialect(const char* spec, struct dsvtool_dialect* dialect) {
+    const char* s = spec;
+    size_t n = strcspn(s, "/");
+    size_t i;
+
+    for (i = 0; i < sizeof(dialect_presets)/sizeof(dialect_presets[0]); ++i) {
+        if (strlen(dialect_presets[i].name) == n &&
+            !strncmp(dialect_presets[i].name, s, n)) {
+            *dialect = dialect_presets[i].dialect;
+            break;
+        }
+    }
+    if (i == sizeof(dialect_presets)/sizeof(dialect_presets[0])) {
+        fprintf(stderr, "bad dialect \"%s\": unknown preset\n", spec);
+        return FALSE;
+    }
+
+    for (s += n; *s == '/'; s += n) {
+        const char* value;
+        size_t klen;
+        int ok = TRUE;
+
+        ++s;
+        n = strcspn(s, "/");
+        value = memchr(s, '=', n);
+        if (!value) {
+            ok = FALSE;
+        } else {
+            klen = (size_t)(value - s);
+            ++value;
+            if (klen == 5 && !strncmp(s, "quote", 5)) {
+                ok = dialect_char(value, n-klen-1, &dialect->quote);
+            } else if (klen == 5 && !strncmp(s, "delim", 5)) {
+                ok = dialect_char(value, n-klen-1, &dialect->delim) &&
+                     dialect->delim != '\0';
+            } else if (klen == 6 && !strncmp(s, "escape", 6)) {
+                ok = dialect_char(value, n-klen-1, &dialect->escape);
+            } else if (klen == 5 && !strncmp(s, "style", 5)) {
+                size_t vlen = n-klen-1;
+                if (vlen == 6 && !strncmp(value, "needed", 6)) {
+                    dialect->quoting = QUOTE_NEEDED;
+                } else if (vlen == 3 && !strncmp(value, "all", 3)) {
+                    dialect->quoting = QUOTE_ALL;
+                } else if (vlen == 4 && !strncmp(value, "none", 4)) {
+                    dialect->quoting = QUOTE_NONE;
+                } else if (vlen == 10 && !strncmp(value, "nonnumeric", 10)) {
+                    dialect->quoting = QUOTE_NONNUMERIC;
+                } else {
+                    ok = FALSE;
+                }
+            } else {
+                ok = FALSE;
+            }
+        }
+        if (!ok) {
+            fprintf(stderr, "bad dialect \"%s\": cannot use \"%.*s\"\n",
+                    spec, (int)n, s);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* }}} REGION: DIALECTS */
+
+/* {{{ REGION: INPUT */
+
+int dsvtool_input_open(const char* path, struct dsvtool_input* input) {
+    struct stat st;
+    char* data = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+    int fd;
+
+    memset(input, 0, sizeof(*input));
+    fd = strcmp(path, "-") ? open(path, O_RDONLY) : STDIN_FILENO;
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return FALSE;
+    }
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+                         fd, 0);
+        if (map != MAP_FAILED) {
+#ifdef POSIX_MADV_SEQUENTIAL
+            posix_madvise(map, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+#endif
+            input->data = map;
+            input->len = (size_t)st.st_size;
+            input->mapped = TRUE;
+            if (fd != STDIN_FILENO) close(fd);
+            return TRUE;
+        }
+    }
+
+    /* not mappable: read it all */
+    for (;;) {
+        ssize_t got;
+        if (len == cap) {
+            char* grown;
+            cap = cap ? cap * 2 : 65536;
+            grown = realloc(data, cap);
+            if (!grown) dsvtool_oom(path);
+            data = grown;
+        }
+        got = read(fd, data + len, cap - len);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            free(data);
+            if (fd != STDIN_FILENO) close(fd);
+            return FALSE;
+        }
+        if (got == 0) break;
+        len += (size_t)got;
+    }
+    if (fd != STDIN_FILENO) close(fd);
+    input->data = data;
+    input->len = len;
+    return TRUE;
+}
+
+void dsvtool_input_close(struct dsvtool_input* input) {
+    if (input->mapped) {
+        munmap((void*)input->data, input->len);
+    } else {
+        free((void*)input->data);
+    }
+    memset(input, 0, sizeof(*input));
+}
+
+/* }}} REGION: INPUT */
+
+/* {{{ REGION: OUTPUT */
+
+void dsvtool_buf_reserve(struct dsvtool_buf* buf, size_t n) {
+    if (buf->cap - buf->len < n) {
+        size_t cap = buf->cap ? buf->cap : 4096;
+        char* s;
+        while (cap - buf->len < n) cap *= 2;
+        s = realloc(buf->s, cap);
+        if (!s) dsvtool_oom("output buffer");
+        buf->s = s;
+        buf->cap = cap;
+    }
+}
+
+void dsvtool_buf_put(struct dsvtool_buf* buf, const char* s, size_t n) {
+    dsvtool_buf_reserve(buf, n);
+    memcpy(buf->s + buf->len, s, n);
+    buf->len += n;
+}
+
+void dsvtool_buf_free(struct dsvtool_buf* buf) {
+    free(buf->s);
+    memset(buf, 0, sizeof(*buf));
+}
+
+void dsvtool_put_record(struct dsvtool_buf* buf, const char* const* fields,
+                        const size_t* lens, size_t n,
+                        const struct dsvtool_dialect* dialect) {
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        /* worst case: delimiter, quotes and every character escaped */
+        dsvtool_buf_reserve(buf, 2 * lens[i] + 3);
+        if (i != 0) {
+            buf->s[buf->len++] = dialect->delim;
+        }
+        buf->len += ua_dsv_format_field_u8(buf->s + buf->len, fields[i],
+                                           lens[i], i+1 == n,
+                                           dialect->quoting, dialect->quote,
+                                           dialect->delim, dialect->escape);
+    }
+    dsvtool_buf_put(buf, "\n", 1);
+}
+
+int dsvtool_write(int fd, const char* s, size_t n) {
+    while (n > 0) {
+        ssize_t put = write(fd, s, n);
+        if (put < 0 && errno == EINTR) continue;
+        if (put < 0) return FALSE;
+        s += put;
+        n -= (size_t)put;
+    }
+    return TRUE;
+}
+
+/* }}} REGION: OUTPUT */
+
+/* {{{ REGION: THREAD POOL */
+
+struct pool_task {
+    dsvtool_task_fn fn;
+    void* arg;
+};
+
+/* tasks [head, tail) of a worker: the owner takes from the tail, thieves
+ * from the head */
+struct pool_deque {
+    pthread_mutex_t lock;
+    struct pool_task* tasks;
+    size_t head;
+    size_t tail;
+    size_t cap;
+};
+
+struct dsvtool_pool {
+    unsigned n;
+    pthread_t* threads;
+    struct pool_deque* deques;
+
+    /* guards everything below */
+    pthread_mutex_t lock;
+    pthread_cond_t work;        /* a task was queued, or stop was set */
+    pthread_cond_t idle;        /* pending dropped to 0 */
+    long queued;                /* tasks in the deques */
+    unsigned long pending;      /* tasks queued or running */
+    unsigned long steals;
+    unsigned next;              /* deque for the next outside submit */
+    int stop;
+};
+
+/* the worker running on this thread, if any */
+static _Thread_local struct dsvtool_pool* pool_self = NULL;
+static _Thread_local unsigned pool_self_id = 0;
+
+static void deque_push(struct pool_deque* d, struct pool_task task) {
+    pthread_mutex_lock(&d->lock);
+    if (d->tail == d->cap) {
+        if (d->head > 0) {
+            /* slide down over the tasks already stolen */
+            memmove(d->tasks, d->tasks + d->head,
+                    (d->tail - d->head) * sizeof(*d->tasks));
+            d->tail -= d->head;
+            d->head = 0;
+        } else {
+            size_t cap = d->cap ? d->cap * 2 : 64;
+            struct pool_task* tasks = realloc(d->tasks, cap * sizeof(*tasks));
+            if (!tasks) dsvtool_oom("thread pool");
+            d->tasks = tasks;
+            d->cap = cap;
+        }
+    }
+    d->tasks[d->tail++] = task;
+    pthread_mutex_unlock(&d->lock);
+}
+
+static int deque_take(struct pool_deque* d, int steal,
+                      struct pool_task* task) {
+    int ok = FALSE;
+    pthread_mutex_lock(&d->lock);
+    if (d->head < d->tail) {
+        *task = steal ? d->tasks[d->head++] : d->tasks[--d->tail];
+        if (d->head == d->tail) {
+            d->head = d->tail = 0;
+        }
+        ok = TRUE;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+/* take a task for worker @param id: its own newest, or another's oldest */
+static int pool_take(struct dsvtool_pool* pool, unsigned id,
+                     struct pool_task* task) {
+    unsigned i;
+    int stolen = FALSE;
+
+    if (!deque_take(&pool->deques[id], FALSE, task)) {
+        for (i = 1; i < pool->n; ++i) {
+            if (deque_take(&pool->deques[(id + i) % pool->n], TRUE, task)) {
+                stolen = TRUE;
+                break;
+            }
+        }
+        if (!stolen) return FALSE;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->queued -= 1;
+    pool->steals += (unsigned long)stolen;
+    pthread_mutex_unlock(&pool->lock);
+    return TRUE;
+}
+
+struct pool_start {
+    struct dsvtool_pool* pool;
+    unsigned id;
+};
+
+static void* pool_worker(void* arg) {
+    struct pool_start* start = arg;
+    struct dsvtool_pool* pool = start->pool;
+    unsigned id = start->id;
+    struct pool_task task;
+
+    free(start);
+    pool_self = pool;
+    pool_self_id = id;
+
+    for (;;) {
+        if (pool_take(pool, id, &task)) {
+            task.fn(task.arg);
+            pthread_mutex_lock(&pool->lock);
+            if (--pool->pending == 0) {
+                pthread_cond_broadcast(&pool->idle);
+            }
+            pthread_mutex_unlock(&pool->lock);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->stop && pool->queued <= 0) {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        if (pool->stop && pool->queued <= 0) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+struct dsvtool_pool* dsvtool_pool_new(unsigned nthreads) {
+    struct dsvtool_pool* pool = calloc(1, sizeof(*pool));
+    unsigned i;
+
+    if (nthreads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = cpus > 0 ? (unsigned)cpus : 1;
+    }
+    if (!pool) dsvtool_oom("thread pool");
+    pool->n = nthreads;
+    pool->threads = calloc(nthreads, sizeof(*pool->threads));
+    pool->deques = calloc(nthreads, sizeof(*pool->deques));
+    if (!pool->threads || !pool->deques) dsvtool_oom("thread pool");
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+
+    for (i = 0; i < nthreads; ++i) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+    for (i = 0; i < nthreads; ++i) {
+        struct pool_start* start = malloc(sizeof(*start));
+        if (!start) dsvtool_oom("thread pool");
+        start->pool = pool;
+        start->id = i;
+        if (pthread_create(&pool->threads[i], NULL, pool_worker, start)) {
+            fprintf(stderr, "cannot start worker thread\n");
+            exit(2);
+        }
+    }
+    return pool;
+}
+
+void dsvtool_pool_submit(struct dsvtool_pool* pool, dsvtool_task_fn fn,
+                         void* arg) {
+    struct pool_task task;
+    unsigned id;
+
+    task.fn = fn;
+    task.arg = arg;
+
+    /* counted as pending before it can possibly run and finish */
+    pthread_mutex_lock(&pool->lock);
+    pool->pending += 1;
+    if (pool_self == pool) {
+        id = pool_self_id;
+    } else {
+        id = pool->next;
+        pool->next = (pool->next + 1) % pool->n;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    deque_push(&pool->deques[id], task);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->queued += 1;
+    pthread_cond_signal(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void dsvtool_pool_wait(struct dsvtool_pool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->idle, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+unsigned dsvtool_pool_size(const struct dsvtool_pool* pool) {
+    return pool->n;
+}
+
+unsigned long dsvtool_pool_steals(struct dsvtool_pool* pool) {
+    unsigned long steals;
+    pthread_mutex_lock(&pool->lock);
+    steals = pool->steals;
+    pthread_mutex_unlock(&pool->lock);
+    return steals;
+}
+
+void dsvtool_pool_free(struct dsvtool_pool* pool) {
+    unsigned i;
+
+    dsvtool_pool_wait(pool);
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = TRUE;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->n; ++i) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (i = 0; i < pool->n; ++i) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->idle);
+    free(pool->deques);
+    free(pool->threads);
+    free(pool);
+}
+
+/* }}} REGION: THREAD POOL */
+
+/* {{{ REGION: CHUNKS */
+
+/* the chunk at @param i of an array of @param size byte chunks */
+static struct dsvtool_chunk* chunk_at(void* chunks, size_t size, size_t i) {
+    return (struct dsvtool_chunk*)((char*)chunks + i * size);
+}
+
+void* dsvtool_split_chunks(const struct dsvtool_input* input,
+                           size_t chunk_size, size_t size, size_t* n) {
+    const char* data = input->data;
+    size_t len = input->len;
+    size_t max = len / chunk_size + 1;
+    struct dsvtool_chunk* prev = NULL;
+    size_t count = 0;
+    void* chunks;
+    size_t k;
+
+    chunks = calloc(max, size);
+    if (!chunks) dsvtool_oom("chunks");
+
+    for (k = 0; k < max; ++k) {
+        struct dsvtool_chunk* c;
+        size_t start = 0;
+        if (k > 0) {
+            const char* nl;
+            size_t from = k * chunk_size;
+            if (from < prev->start) continue;
+            nl = memchr(data + from, '\n', len - from);
+            if (!nl || (size_t)(nl + 1 - data) >= len) break;
+            start = (size_t)(nl + 1 - data);
+            if (start <= prev->start) continue;
+            prev->limit = start;
+        }
+        c = chunk_at(chunks, size, count++);
+        c->start = start;
+        c->limit = len;
+        prev = c;
+    }
+    *n = count;
+    return chunks;
+}
+
+size_t dsvtool_repair_chunks(void* chunks, size_t n, size_t size,
+                             dsvtool_task_fn run) {
+    size_t rerun = 0;
+    size_t i;
+
+    for (i = 1; i < n; ++i) {
+        struct dsvtool_chunk* c = chunk_at(chunks, size, i);
+        size_t end = chunk_at(chunks, size, i - 1)->end;
+        if (c->start == end) continue;
+        c->start = end;
+        run(c);
+        rerun += 1;
+    }
+    return rerun;
+}
+
+/* }}} REGION: CHUNKS */
+
+/* {{{ REGION: MISC */
+
+double dsvtool_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void dsvtool_oom(const char* what) {
+    fprintf(stderr, "out of memory: %s\n", what);
+    exit(2);
+}
+
+/* }}} REGION: MISC */
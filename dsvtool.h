@@ -0,0 +1,262 @@
+
+/*****************************************************************************/
+/*    Name: dsvtool.h                                                        */
+/*   Title: Delimiter-Separated-Value Command-Line Tool Support              */
+/* Purpose: Pieces shared by the dsv* command-line tools built on gua2csv:   */
+/*          dialect options, mapped input files, output buffers, a           */
+/*          work-stealing thread pool and chunks of input to scan with it.   */
+/*  Author: Peter Schultz (sxpws)                                            */
+/*****************************************************************************/
+/* UA AUDIT TRAIL                                                            */
+/*                                                                           */
+/* 2026/10/18 sxpws Initial commit                                           */
+/* 2026/10/18 sxpws Declare dsvtool_oom noreturn                             */
+/* 2026/10/18 sxpws Added dsvtool_split_chunks, dsvtool_repair_chunks        */
+/*                                                                           */
+/* UA AUDIT TRAIL END                                                        */
+/*****************************************************************************/
+
+#ifndef UA_ORAC_DSVTOOL_HEADER_
+#define UA_ORAC_DSVTOOL_HEADER_
+
+#include "gua2csv.h"
+
+#include <stddef.h>
+
+/* Marks functions that do not return, so that compilers know nothing
+ * after a call to one runs. */
+#if defined(__GNUC__) || defined(__clang__)
+#define DSVTOOL_NORETURN __attribute__((noreturn))
+#elif defined(_MSC_VER)
+#define DSVTOOL_NORETURN __declspec(noreturn)
+#else
+#define DSVTOOL_NORETURN
+#endif
+
+/* The tools work on UTF-8 text with the _u8 flavor of the library, and are
+ * built together with it:
+ *
+ *  cc -O2 dsvconv.c dsvtool.c gua2csv.c -o dsvconv -lpthread
+ */
+
+/** @region Dialects **/
+
+/* dsvtool_dialect structure
+ *
+ * The <format-args> of the library as one value. Parsing only uses
+ * @param quote and @param delim.
+ */
+struct dsvtool_dialect {
+    char quote;
+    char delim;
+    char escape;
+    enum UAQuoteStyle quoting;
+};
+
+/* dsvtool_parse_dialect(spec, dialect)
+ *
+ * Parse a dialect option: a preset name, optionally followed by overrides
+ * separated by '/':
+ *
+ *  csv                 '"' quotes, ',' delimits, QUOTE_NEEDED
+ *  psv                 no quotes, '|' delimits, QUOTE_NONE
+ *  tsv                 no quotes, '\t' delimits, QUOTE_NONE
+ *  quote=C             quoting character, or "none"
+ *  delim=C             delimiting character
+ *  escape=C            escape character, or "none" for doubled quotes
+ *  style=S             needed, all, none or nonnumeric
+ *
+ * C is a single character, one of \t \\ \/, or a hex code like 0x1f.
+ * For example "csv/delim=;/style=all" or "psv/quote=\"".
+ *
+ * Returns true on success, false (after printing why) on a bad @param spec.
+ */
+int dsvtool_parse_dialect(const char* spec, struct dsvtool_dialect* dialect);
+
+/** @region Input **/
+
+/* dsvtool_input structure
+ *
+ * An input file, mapped into memory when possible and read otherwise (pipes,
+ * empty files). @param data is not NIL terminated.
+ */
+struct dsvtool_input {
+    const char* data;
+    size_t len;
+    int mapped;
+};
+
+/* dsvtool_input_open(path, input)
+ *
+ * Map or read @param path, or standard input for "-".
+ *
+ * Returns true on success, false (after printing why) on failure.
+ */
+int dsvtool_input_open(const char* path, struct dsvtool_input* input);
+
+/* dsvtool_input_close(input)
+ *
+ * Release @param input.
+ */
+void dsvtool_input_close(struct dsvtool_input* input);
+
+/** @region Output **/
+
+/* dsvtool_buf structure
+ *
+ * A growable character buffer. Zero-initialize before use.
+ */
+struct dsvtool_buf {
+    char* s;
+    size_t len;
+    size_t cap;
+};
+
+/* dsvtool_buf_reserve(buf, n)
+ *
+ * Make room for @param n more characters; exits if out of memory.
+ */
+void dsvtool_buf_reserve(struct dsvtool_buf* buf, size_t n);
+
+/* dsvtool_buf_put(buf, s, n)
+ *
+ * Append @param n characters of @param s.
+ */
+void dsvtool_buf_put(struct dsvtool_buf* buf, const char* s, size_t n);
+
+/* dsvtool_buf_free(buf)
+ *
+ * Release the storage of @param buf, leaving it empty.
+ */
+void dsvtool_buf_free(struct dsvtool_buf* buf);
+
+/* dsvtool_put_record(buf, fields, lens, n, dialect)
+ *
+ * Append @param n fields, formatted as one record of @param dialect with
+ * ua_dsv_format_field_u8, and a '\n'.
+ */
+void dsvtool_put_record(struct dsvtool_buf* buf, const char* const* fields,
+                        const size_t* lens, size_t n,
+                        const struct dsvtool_dialect* dialect);
+
+/* dsvtool_write(fd, s, n)
+ *
+ * Write all @param n characters of @param s to @param fd.
+ *
+ * Returns true on success, false on failure.
+ */
+int dsvtool_write(int fd, const char* s, size_t n);
+
+/** @region Thread pool **/
+
+/* A fixed set of workers, each with its own deque of tasks. A worker runs
+ * the newest task of its own deque and, when that is empty, steals the
+ * oldest task of another worker's; tasks may submit more tasks, which go to
+ * the deque of the worker running them. Large jobs split themselves this
+ * way and idle workers pick up the pieces.
+ */
+struct dsvtool_pool;
+
+typedef void (*dsvtool_task_fn)(void* arg);
+
+/* dsvtool_pool_new(nthreads)
+ *
+ * Start @param nthreads workers (0 for one per online CPU).
+ */
+struct dsvtool_pool* dsvtool_pool_new(unsigned nthreads);
+
+/* dsvtool_pool_submit(pool, fn, arg)
+ *
+ * Queue fn(arg): on the calling worker's deque when called from a task,
+ * otherwise on the workers' deques in turn.
+ */
+void dsvtool_pool_submit(struct dsvtool_pool* pool, dsvtool_task_fn fn,
+                         void* arg);
+
+/* dsvtool_pool_wait(pool)
+ *
+ * Wait until every task, including those submitted by tasks, has run.
+ */
+void dsvtool_pool_wait(struct dsvtool_pool* pool);
+
+/* dsvtool_pool_size(pool)
+ *
+ * Number of workers.
+ */
+unsigned dsvtool_pool_size(const struct dsvtool_pool* pool);
+
+/* dsvtool_pool_steals(pool)
+ *
+ * Number of tasks run by a worker other than the one they were queued on.
+ */
+unsigned long dsvtool_pool_steals(struct dsvtool_pool* pool);
+
+/* dsvtool_pool_free(pool)
+ *
+ * Wait for all tasks, then stop and release the workers.
+ */
+void dsvtool_pool_free(struct dsvtool_pool* pool);
+
+/** @region Chunks **/
+
+/* Chunks of a large input are scanned in parallel before it is known where
+ * records begin: each chunk guesses that a record starts after the first
+ * '\n' in it and takes the records that end by the next chunk's guess. A
+ * guess is right when the chunk before it stopped exactly there; a wrong
+ * one (the '\n' was inside quotes) is scanned again from where the previous
+ * chunk really stopped, once all chunks are done.
+ */
+
+/* dsvtool_chunk structure
+ *
+ * The part of a chunk the splitting and repairing deal with. Tools put one
+ * first in their own chunk structure, and their run function sets @param
+ * end; the last chunk, whose limit is the length of the input, takes
+ * everything that is left.
+ */
+struct dsvtool_chunk {
+    size_t start;               /* where the chunk guesses a record starts */
+    size_t limit;               /* the next chunk's guess, or the end */
+    size_t end;                 /* end of the last record taken */
+};
+
+/* dsvtool_split_chunks(input, chunk_size, size, n)
+ *
+ * Place chunk starts after the first '\n' past every multiple of @param
+ * chunk_size in @param input. The chunks are @param size bytes each and
+ * begin with a struct dsvtool_chunk; all else in them is zero. An input
+ * without a '\n' in the right places, empty ones included, is one chunk.
+ *
+ * Returns the chunks, to release with free, and their number in *@param n.
+ * Exits if out of memory.
+ */
+void* dsvtool_split_chunks(const struct dsvtool_input* input,
+                           size_t chunk_size, size_t size, size_t* n);
+
+/* dsvtool_repair_chunks(chunks, n, size, run)
+ *
+ * Once all @param n chunks have run, call @param run again, in order, for
+ * each chunk whose guess was wrong, after moving its start to where the
+ * chunk before it ended. @param run must first undo what it did the time
+ * before.
+ *
+ * Returns the number of chunks run again.
+ */
+size_t dsvtool_repair_chunks(void* chunks, size_t n, size_t size,
+                             dsvtool_task_fn run);
+
+/** @region Misc **/
+
+/* dsvtool_now()
+ *
+ * Monotonic time in seconds.
+ */
+double dsvtool_now(void);
+
+/* dsvtool_oom(what)
+ *
+ * Report running out of memory in @param what and exit with status 2.
+ */
+DSVTOOL_NORETURN void dsvtool_oom(const char* what);
+
+#endif /* UA_ORAC_DSVTOOL_HEADER_ */
@@ -10,12 +10,57 @@
 /*                                                                           */
 /* 2016/02/12 sxpws Initial commit                                           */
 /* 2016/02/14 sxpws Added ua_free_dsv                                        */
+/* 2026/10/18 sxpws Engine moved to gua2csv.inc, added char/UTF-8 flavor     */
+/* 2026/10/18 sxpws ua_parse_dsv stops at the end of the first record        */
+/* 2026/10/18 sxpws Added ua_dsv_stats instrumentation                       */
+/* 2026/10/18 sxpws Added ua_dsv_export, ua_dsv_select exports through it    */
+/* 2026/10/18 sxpws Route allocations through ua_dsv_allocator               */
+/* 2026/10/18 sxpws Added ua_dsv_row and ua_parse_dsv_into                   */
+/* 2026/10/18 sxpws Added ua_dsv_scan callback API                           */
+/* 2026/10/18 sxpws Added ua_dsv_parser push parser                          */
+/* 2026/10/18 sxpws Formatter no longer escapes delimiters by doubling       */
+/* 2026/10/18 sxpws Added DSV_INLINE and CSV/PSV dialect instantiations      */
+/* 2026/10/18 sxpws Added ua_dsv_transcode                                   */
+/* 2026/10/18 sxpws Added lazy rows                                          */
+/* 2026/10/18 sxpws Added ua_dsv_index                                       */
+/* 2026/10/18 sxpws Added ua_dsv_follower                                    */
+/* 2026/10/18 sxpws Added ua_dsv_agg                                         */
+/* 2026/10/18 sxpws Added ua_dsv_profile                                     */
+/* 2026/10/18 sxpws Added ua_dsv_check                                       */
+/* 2026/10/18 sxpws Added ua_dsv_bin binary rows                             */
+/* 2026/10/18 sxpws Added ua_dsv_arrow                                       */
+/* 2026/10/18 sxpws Distinct estimate no longer needs libm                   */
+/* 2026/10/18 sxpws Fixed aggregation without key columns                    */
+/* 2026/10/18 sxpws ua_dsv_follow_wait reports errors, waits on timeout < 0  */
+/* 2026/10/18 sxpws ua_dsv_check accepts spaces before a closing quote       */
 /*                                                                           */
 /* UA AUDIT TRAIL END                                                        */
 /*****************************************************************************/
 
+/* clock_gettime, for ua_dsv_stats timing; st_mtim and pread, for
+ * ua_dsv_index and ua_dsv_follower */
+#if !defined(_POSIX_C_SOURCE) || _POSIX_C_SOURCE < 200809L
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "gua2csv.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ua_dsv_follow_wait sleeps on inotify where there is one */
+#if defined(__linux__) && !defined(UA_DSV_NO_INOTIFY)
+#define DSV_INOTIFY 1
+#include <sys/inotify.h>
+#endif
+
 /* {{{ REGION: UTIL */
 
 enum {
@@ -35,26 +80,52 @@ enum {
     ESCAPE_IN_QUOTE
 };
 
-static int iseol(TMCHAR c) {
+/* what dsvstep tells a parser to do with a character */
+enum {
+    STEP_SKIP,      /* not part of the field: leading space, pending quote */
+    STEP_OPEN,      /* opening quote */
+    STEP_FIRST,     /* first character of an unquoted field */
+    STEP_CHAR,      /* character of the field */
+    STEP_PAIR,      /* second quote of a doubled quote: one quote */
+    STEP_ROGUE,     /* character after a stray quote: '"' and the character */
+    STEP_END        /* delimiter, EOL or end of input: field is complete */
+};
+
+/* character classes take an int so that both the TMCHAR and the char engine
+ * can share them */
+
+static int iseol(int c) {
     return c == '\n' || c == '\r' || c == '\0';
 }
 
-static int isws(TMCHAR c) {
+static int isws(int c) {
     return c == ' ';
 }
 
-static int isnum(TMCHAR c) {
+static int isnum(int c) {
     return c >= '0' && c <= '9';
 }
 
-static int isnumeric(const TMCHAR* s) {
-    size_t i = 0;
-    while (s[i]) {
-        if (!isnum(s[i])) return FALSE;
-        ++i;
-    }
-    return TRUE;
-}
+/* The engine's inner loops are written once with the dialect as arguments
+ * and forced inline into one instantiation per fixed dialect (CSV and PSV),
+ * where the quote and delimiter are constants the compiler folds away. The
+ * entry points pick an instantiation from their arguments; define
+ * UA_DSV_GENERIC to always use the runtime-dialect one. */
+#if defined(__GNUC__) || defined(__clang__)
+#define DSV_INLINE static inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define DSV_INLINE static __forceinline
+#else
+#define DSV_INLINE static inline
+#endif
+
+#ifdef UA_DSV_GENERIC
+#define DSV_IS_CSV(q, d) 0
+#define DSV_IS_PSV(q, d) 0
+#else
+#define DSV_IS_CSV(q, d) ((q) == CSV_Q && (d) == CSV_D)
+#define DSV_IS_PSV(q, d) ((q) == PSV_Q && (d) == PSV_D)
+#endif
 
 static size_t veclen(const TMCHAR** vec) {
     size_t i = 0;
@@ -64,292 +135,506 @@ static size_t veclen(const TMCHAR** vec) {
 
 /* }}} REGION: UTIL */
 
-/* {{{ REGION: UTIL API */
+/* {{{ REGION: STATS */
 
-int ua_strcount(const TMCHAR* s, TMCHAR ch) {
-    int count = 0;
-    int i;
-    for (i = 0; s[i]; ++i) {
-        if (s[i] == ch) {
-            count += 1;
-        }
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define UA_DSV_TLS _Thread_local
+#elif defined(__GNUC__)
+#define UA_DSV_TLS __thread
+#else
+#define UA_DSV_TLS  /* no thread-local storage: one set of stats per process */
+#endif
+
+/* stats attached to the calling thread, or NULL when not collecting */
+static UA_DSV_TLS struct ua_dsv_stats* dsv_stats = NULL;
+
+static uint64_t dsv_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* count a call to a public API, and start its timer if timing is enabled */
+static uint64_t stats_begin(struct ua_dsv_stats* st, enum UADsvApi api) {
+    if (!st) {
+        return 0;
+    }
+    st->calls[api] += 1;
+    return (st->flags & UA_DSV_STATS_TIMING) ? dsv_clock() : 0;
+}
+
+static void stats_end(struct ua_dsv_stats* st, enum UADsvApi api,
+                      uint64_t start) {
+    if (st && (st->flags & UA_DSV_STATS_TIMING)) {
+        st->nanos[api] += dsv_clock() - start;
     }
-    return count;
 }
 
-/* }}} REGION: UTIL API */
+void ua_dsv_stats_attach(struct ua_dsv_stats* stats) {
+    dsv_stats = stats;
+}
 
-/* {{{ REGION: DSV PARSER */
+struct ua_dsv_stats* ua_dsv_stats_current(void) {
+    return dsv_stats;
+}
 
-const TMCHAR* ua_dsvtok(const TMCHAR* line, const TMCHAR** out,
-                        TMCHAR quot, TMCHAR delim) {
-    const TMCHAR* end = line;
-    int state = START_RECORD;
-    TMCHAR* buffer;
-    TMCHAR* bufpos;
-    int done = FALSE;
+void ua_dsv_stats_reset(struct ua_dsv_stats* stats) {
+    unsigned int flags = stats->flags;
+    memset(stats, 0, sizeof(*stats));
+    stats->flags = flags;
+}
 
-    /* end condition: return an empty string */
-    if (iseol(*line)) {
-        *out = calloc(1, sizeof(TMCHAR));
-        return line;
+void ua_dsv_stats_merge(struct ua_dsv_stats* into,
+                        const struct ua_dsv_stats* from) {
+    int i;
+    into->bytes_scanned += from->bytes_scanned;
+    into->records += from->records;
+    into->fields += from->fields;
+    into->quoted_fields += from->quoted_fields;
+    into->rogue_quotes += from->rogue_quotes;
+    into->records_formatted += from->records_formatted;
+    into->fields_formatted += from->fields_formatted;
+    into->fields_quoted += from->fields_quoted;
+    into->bytes_formatted += from->bytes_formatted;
+    into->allocs += from->allocs;
+    into->alloc_bytes += from->alloc_bytes;
+    into->frees += from->frees;
+    for (i = 0; i < UA_DSV_API_COUNT; ++i) {
+        into->calls[i] += from->calls[i];
+        into->nanos[i] += from->nanos[i];
     }
+}
 
-    /* So, how much memory do we allocate? Well, we're not inserting anything
-     * not already present in the input line, so use that as our upper limit */
-    buffer = bufpos = calloc(tmstrlen(line)+1, sizeof(TMCHAR));
-    if (!buffer) {
-        /* bail immediately if there's an allocation problem */
-        return NULL;
+const char* ua_dsv_stats_api_name(enum UADsvApi api) {
+    static const char* const names[UA_DSV_API_COUNT] = {
+        "ua_strcount",
+        "ua_dsvtok",
+        "ua_parse_dsv",
+        "ua_format_dsv",
+        "ua_dsv_scan",
+        "ua_dsv_feed",
+        "ua_dsv_transcode"
+    };
+    if ((int)api < 0 || api >= UA_DSV_API_COUNT) {
+        return "unknown";
     }
+    return names[api];
+}
 
-    while (!done) {
-        /* parse character pointed to by `end` */
-        TMCHAR c = *end;
-        switch (state) {
-            case START_RECORD: {
-                /* initial state */
-                if (quot && c == quot) {
-                    state = IN_QUOTE;
-                } else if (c == delim || iseol(c)) {
-                    done = TRUE;
-                } else if (isws(c)) {
-                    /* eat initial whitespace */
-                } else {
-                    *bufpos++ = c;
-                    state = IN_UNQUOTE;
-                }
-            } break;
-            case IN_UNQUOTE: {
-                /* main state: inside an unquoted field */
-                if (c == delim || iseol(c)) {
-                    done = TRUE;
-                } else {
-                    *bufpos++ = c;
-                }
-            } break;
-            case IN_QUOTE: {
-                /* main state: inside a quoted field */
-                if (quot && c == quot) {
-                    state = ESCAPE_IN_QUOTE;
-                } else if (c == '\0') {
-                    done = TRUE;
-                } else {
-                    /* no check for \r\n because those are allowed here */
-                    *bufpos++ = c;
-                }
-            } break;
-            case ESCAPE_IN_QUOTE: {
-                /* encountered a quote in a quoted field, could be either an
-                 * escaped dquot or the end of a field */
-                if (quot && c == quot) {
-                    /* escaped quote, emit one quote */
-                    *bufpos++ = c;
-                    state = IN_QUOTE;
-                } else if (c == delim || iseol(c)) {
-                    done = TRUE;
-                } else {
-                    /* rogue quote: quote found, but following character isn't
-                     * special; add character literally */
-                    *bufpos++ = CSV_Q;
-                    *bufpos++ = c;
-                    state = IN_QUOTE;
-                }
-            } break;
-            default:
-                /* unreachable, indicates a serious error */
-                abort();
-                break;
-        }
-        /* never traverse past a NIL */
-        if (c != '\0') {
-            ++end;
+int ua_dsv_stats_fprint(FILE* file, const struct ua_dsv_stats* stats) {
+    int i;
+    fprintf(file,
+            "bytes_scanned=%llu records=%llu fields=%llu quoted_fields=%llu "
+            "rogue_quotes=%llu records_formatted=%llu fields_formatted=%llu "
+            "fields_quoted=%llu bytes_formatted=%llu allocs=%llu "
+            "alloc_bytes=%llu frees=%llu",
+            (unsigned long long)stats->bytes_scanned,
+            (unsigned long long)stats->records,
+            (unsigned long long)stats->fields,
+            (unsigned long long)stats->quoted_fields,
+            (unsigned long long)stats->rogue_quotes,
+            (unsigned long long)stats->records_formatted,
+            (unsigned long long)stats->fields_formatted,
+            (unsigned long long)stats->fields_quoted,
+            (unsigned long long)stats->bytes_formatted,
+            (unsigned long long)stats->allocs,
+            (unsigned long long)stats->alloc_bytes,
+            (unsigned long long)stats->frees);
+    for (i = 0; i < UA_DSV_API_COUNT; ++i) {
+        if (stats->calls[i]) {
+            fprintf(file, " %s.calls=%llu %s.nanos=%llu",
+                    ua_dsv_stats_api_name((enum UADsvApi)i),
+                    (unsigned long long)stats->calls[i],
+                    ua_dsv_stats_api_name((enum UADsvApi)i),
+                    (unsigned long long)stats->nanos[i]);
         }
     }
+    return fputc('\n', file) != EOF;
+}
 
-    /* trim ending whitespace (stopping at empty) */
-    while (tmstrlen(buffer) > 0 && isws(buffer[tmstrlen(buffer)-1])) {
-        buffer[tmstrlen(buffer)-1] = '\0';
-    }
+/* }}} REGION: STATS */
 
-    /* shrink buffer to proper size */
-    *out = realloc(buffer, (tmstrlen(buffer)+1)*sizeof(TMCHAR));
+/* {{{ REGION: ALLOCATOR */
 
-    return end;
+static void* default_alloc(void* ctx, size_t size) {
+    (void)ctx;
+    return calloc(1, size);
 }
 
-const TMCHAR** ua_parse_dsv(const TMCHAR* line, TMCHAR q, TMCHAR d) {
-    /* determine initial size */
-    int size = ua_strcount(line, d) + 1; /* +1 as N delims -> N+1 entries */
-    const TMCHAR** results = NULL;
-    results = calloc(sizeof(const TMCHAR*), size+1); /* +1 for NULL */
-    if (!results) {
+static void* default_resize(void* ctx, void* ptr, size_t size) {
+    (void)ctx;
+    return realloc(ptr, size);
+}
+
+static void default_release(void* ctx, void* ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+static const struct ua_dsv_allocator default_allocator = {
+    default_alloc, default_resize, default_release, NULL
+};
+
+/* allocator installed on the calling thread */
+static UA_DSV_TLS struct ua_dsv_allocator dsv_allocator = {
+    default_alloc, default_resize, default_release, NULL
+};
+
+/* every library allocation goes through these so that it can be counted and
+ * routed to the installed allocator */
+
+static void* dsv_calloc(size_t n, size_t size) {
+    struct ua_dsv_stats* st = dsv_stats;
+    if (size && n > (size_t)-1 / size) {
         return NULL;
     }
+    if (st) {
+        st->allocs += 1;
+        st->alloc_bytes += n * size;
+    }
+    return dsv_allocator.alloc(dsv_allocator.ctx, n * size);
+}
 
-    /* prepare for parsing */
-    const TMCHAR* r = line;
-    const TMCHAR* out = NULL;
+static void* dsv_realloc(void* ptr, size_t size) {
+    struct ua_dsv_stats* st = dsv_stats;
+    if (st) {
+        st->allocs += 1;
+        st->alloc_bytes += size;
+    }
+    return dsv_allocator.resize(dsv_allocator.ctx, ptr, size);
+}
 
-    /* parse each element in sequence */
-    int ridx = 0;
-    while (r && *r) {
-        if (ridx > size) {
-            /* OOB is highly unlikely, and it is a fatal error */
-            tmfprintf(&csvBundle, tmstderr,
-                      _TMC("Error parsing {0}: Out of bounds writing to "
-                           "index {1,%d}. Aborting"),
-                      line, ridx);
-            ua_exit(-1);
-        }
-        /* perform the parsing and store the result */
-        r = ua_dsvtok(r, &out, q, d);
-        results[ridx++] = out;
+static void dsv_free(const void* ptr) {
+    struct ua_dsv_stats* st = dsv_stats;
+    if (!ptr) {
+        return;
     }
+    if (st) {
+        st->frees += 1;
+    }
+    dsv_allocator.release(dsv_allocator.ctx, (void*)ptr);
+}
 
-    return realloc(results, sizeof(const TMCHAR*)*(ridx+1));
+void ua_dsv_set_allocator(const struct ua_dsv_allocator* allocator) {
+    dsv_allocator = allocator ? *allocator : default_allocator;
 }
 
-const TMCHAR** ua_parse_csv(const TMCHAR* line) {
-    return ua_parse_dsv(line, CSV_Q, CSV_D);
+struct ua_dsv_allocator ua_dsv_get_allocator(void) {
+    return dsv_allocator;
+}
+
+void ua_dsv_free(const void* ptr) {
+    dsv_free(ptr);
+}
+
+/* Both the arena and the pool put a header in front of every allocation;
+ * DSV_ALIGN keeps the memory after it suitably aligned for any type. */
+#define DSV_ALIGN 16
+#define DSV_ROUND(n) (((n) + (DSV_ALIGN-1)) & ~(size_t)(DSV_ALIGN-1))
+
+struct arena_block {
+    struct arena_block* next;
+    size_t size;    /* usable bytes after the (aligned) block header */
+    size_t top;     /* bytes in use */
+};
+
+#define ARENA_BLOCK_HEADER DSV_ROUND(sizeof(struct arena_block))
+
+struct ua_dsv_arena {
+    struct arena_block* blocks;     /* most recent first */
+    size_t block;                   /* default block size */
+    unsigned char* last;            /* most recent allocation, or NULL */
+};
+
+static unsigned char* arena_data(struct arena_block* b) {
+    return (unsigned char*)b + ARENA_BLOCK_HEADER;
 }
 
-const TMCHAR** ua_parse_psv(const TMCHAR* line) {
-    return ua_parse_dsv(line, PSV_Q, PSV_D);
+/* allocations are prefixed by their size, rounded to DSV_ALIGN */
+static size_t arena_size(const unsigned char* p) {
+    return *(const size_t*)(p - DSV_ALIGN);
 }
 
-void ua_free_dsv(const TMCHAR** data) {
-    const TMCHAR** curr = data;
-    while (*curr) {
-        free((void*)*curr);
-        ++curr;
+static struct arena_block* arena_grow(struct ua_dsv_arena* a, size_t need) {
+    size_t size = need > a->block ? need : a->block;
+    struct arena_block* b = malloc(ARENA_BLOCK_HEADER + size);
+    if (!b) {
+        return NULL;
     }
-    free((void*)data);
+    b->next = a->blocks;
+    b->size = size;
+    b->top = 0;
+    a->blocks = b;
+    return b;
 }
 
-/* }}} REGION: DSV PARSER */
+static void* arena_alloc(void* ctx, size_t size) {
+    struct ua_dsv_arena* a = ctx;
+    struct arena_block* b = a->blocks;
+    size_t need = DSV_ALIGN + DSV_ROUND(size);
+    unsigned char* p;
 
-/* {{{ REGION: DSV FORMATTER */
+    if (!b || b->size - b->top < need) {
+        b = arena_grow(a, need);
+        if (!b) {
+            return NULL;
+        }
+    }
+    p = arena_data(b) + b->top + DSV_ALIGN;
+    b->top += need;
+    *(size_t*)(p - DSV_ALIGN) = DSV_ROUND(size);
+    memset(p, 0, size);
+    a->last = p;
+    return p;
+}
 
-const TMCHAR* ua_format_dsv(const TMCHAR** data,
-                            enum UAQuoteStyle quoting,
-                            TMCHAR quote,
-                            TMCHAR delim,
-                            TMCHAR escape) {
-    TMCHAR* buffer = NULL;
-    size_t buflen = 1; /* 1 for NIL terminator */
-    size_t bufpos = 0;
-    size_t nitems = 0;
-    size_t i, j;
+static void* arena_resize(void* ctx, void* ptr, size_t size) {
+    struct ua_dsv_arena* a = ctx;
+    unsigned char* p = ptr;
+    size_t old;
+    void* moved;
 
-    if (quote == '\0') {
-        quoting = QUOTE_NONE;
-    } else if (escape == '\0') {
-        escape = quote;
+    if (!p) {
+        return arena_alloc(ctx, size);
     }
+    old = arena_size(p);
+    if (p == a->last) {
+        /* the most recent allocation ends at the block's top, so it can
+         * grow or shrink in place as long as it fits */
+        struct arena_block* b = a->blocks;
+        size_t start = (size_t)(p - arena_data(b));
+        if (start + DSV_ROUND(size) <= b->size) {
+            b->top = start + DSV_ROUND(size);
+            *(size_t*)(p - DSV_ALIGN) = DSV_ROUND(size);
+            return p;
+        }
+    } else if (size <= old) {
+        return p;
+    }
+    moved = arena_alloc(ctx, size);
+    if (moved) {
+        memcpy(moved, p, old < size ? old : size);
+    }
+    return moved;
+}
 
-    /* 1) calculate amount of space to allocate for buffer */
-    for (i = 0; data[i]; ++i) {
-        buflen += tmstrlen(data[i]) + 1 /* delim */ + 2 /* quotes */;
-        nitems += 1;
+static void arena_release(void* ctx, void* ptr) {
+    struct ua_dsv_arena* a = ctx;
+    if (ptr && ptr == a->last) {
+        a->blocks->top -= DSV_ALIGN + arena_size(a->last);
+        a->last = NULL;
+    }
+}
+
+struct ua_dsv_arena* ua_dsv_arena_new(size_t block) {
+    struct ua_dsv_arena* a = calloc(1, sizeof(*a));
+    if (!a) {
+        return NULL;
     }
+    a->block = block ? block : 65536;
+    if (!arena_grow(a, a->block)) {
+        free(a);
+        return NULL;
+    }
+    return a;
+}
 
-    /* worst case: every single character needs escaping */
-    buflen *= 2;
+struct ua_dsv_allocator ua_dsv_arena_allocator(struct ua_dsv_arena* arena) {
+    struct ua_dsv_allocator allocator = {
+        arena_alloc, arena_resize, arena_release, NULL
+    };
+    allocator.ctx = arena;
+    return allocator;
+}
 
-    /* short-circuit if nothing to write */
-    if (nitems == 0) {
-        return calloc(sizeof(TMCHAR), 1);
+void ua_dsv_arena_reset(struct ua_dsv_arena* arena) {
+    struct arena_block* b = arena->blocks;
+    /* keep only the oldest block, which has the default size */
+    while (b->next) {
+        struct arena_block* next = b->next;
+        free(b);
+        b = next;
     }
+    b->top = 0;
+    arena->blocks = b;
+    arena->last = NULL;
+}
 
-    /* 2) allocate buffer */
-    buffer = calloc(sizeof(TMCHAR), buflen+1);
-    if (!buffer) {
-        /* let the caller handle errors */
-        return NULL;
+void ua_dsv_arena_free(struct ua_dsv_arena* arena) {
+    struct arena_block* b = arena ? arena->blocks : NULL;
+    while (b) {
+        struct arena_block* next = b->next;
+        free(b);
+        b = next;
     }
+    free(arena);
+}
 
-    /* 3) determine which fields to quote */
-    int* should_quote = calloc(sizeof(int), nitems+1);
-    switch (quoting) {
-        case QUOTE_NEEDED:
-            for (i = 0; i < nitems; ++i) {
-                const TMCHAR* datum = data[i];
-                for (j = 0; datum[j]; ++j) {
-                    TMCHAR c = datum[j];
-                    if (c == '\r' || c == '\n' || c == delim) {
-                        should_quote[i] = TRUE;
-                    }
-                    if (j == 0 || datum[j+1] == '\0') {
-                        if (c == quote || c == ' ') {
-                            should_quote[i] = TRUE;
-                        }
-                    }
-                }
-            }
-            break;
-        case QUOTE_ALL:
-            for (i = 0; i < nitems; ++i) {
-                should_quote[i] = TRUE;
-            }
-            break;
-        case QUOTE_NONE:
-            /* noop: calloc already set everything to FALSE */
-            break;
-        case QUOTE_NONNUMERIC:
-            for (i = 0; i < nitems; ++i) {
-                should_quote[i] = !isnumeric(data[i]);
-            }
-            break;
-        default:
-            tmprintf(&csvBundle,
-                     _TMC("{0}:{1,%d}: Error: Invalid quoting style {2,%d}\n"),
-                     __FILE__, __LINE__, quoting);
-            free((void*)buffer);
-            free((void*)should_quote);
-            return NULL;
+/* size classes are 16 << i bytes, 16 through 4096 */
+#define POOL_CLASSES 9
+#define POOL_LARGE POOL_CLASSES
+#define POOL_SLAB 65536
+
+struct pool_slab {
+    struct pool_slab* next;
+};
+
+#define POOL_SLAB_HEADER DSV_ROUND(sizeof(struct pool_slab))
+
+struct ua_dsv_pool {
+    void* free[POOL_CLASSES];   /* free lists, linked through the chunks */
+    struct pool_slab* slabs;
+    unsigned char* carve;       /* unused tail of the newest slab */
+    size_t carve_left;
+};
+
+/* allocations are prefixed by their size class, or POOL_LARGE */
+static size_t pool_class(const unsigned char* p) {
+    return *(const size_t*)(p - DSV_ALIGN);
+}
+
+static size_t pool_class_for(size_t size) {
+    size_t c = 0;
+    while (c < POOL_CLASSES && ((size_t)16 << c) < size) {
+        ++c;
     }
+    return c;
+}
 
-    /* 4) fill the buffer with data */
-    for (i = 0; data[i]; ++i) {
-        if (i != 0) {
-            buffer[bufpos++] = delim;
-        }
-        if (should_quote[i]) {
-            buffer[bufpos++] = quote;
+static void* pool_alloc(void* ctx, size_t size) {
+    struct ua_dsv_pool* pool = ctx;
+    size_t c = pool_class_for(size);
+    unsigned char* chunk;
+
+    if (c == POOL_LARGE) {
+        chunk = calloc(1, DSV_ALIGN + size);
+        if (!chunk) {
+            return NULL;
         }
-        for (j = 0; data[i][j]; ++j) {
-            TMCHAR c = data[i][j];
-            if (c == quote || c == delim || c == escape) {
-                if (escape) {
-                    buffer[bufpos++] = escape;
-                }
+    } else if (pool->free[c]) {
+        chunk = (unsigned char*)pool->free[c] - DSV_ALIGN;
+        pool->free[c] = *(void**)pool->free[c];
+    } else {
+        size_t need = DSV_ALIGN + ((size_t)16 << c);
+        if (pool->carve_left < need) {
+            struct pool_slab* slab = malloc(POOL_SLAB);
+            if (!slab) {
+                return NULL;
             }
-            buffer[bufpos++] = c;
-        }
-        if (should_quote[i]) {
-            buffer[bufpos++] = quote;
+            /* the rest of the old slab is lost until the pool is freed */
+            slab->next = pool->slabs;
+            pool->slabs = slab;
+            pool->carve = (unsigned char*)slab + POOL_SLAB_HEADER;
+            pool->carve_left = POOL_SLAB - POOL_SLAB_HEADER;
         }
+        chunk = pool->carve;
+        pool->carve += need;
+        pool->carve_left -= need;
+    }
+    *(size_t*)chunk = c;
+    if (c != POOL_LARGE) {
+        memset(chunk + DSV_ALIGN, 0, size);
     }
+    return chunk + DSV_ALIGN;
+}
 
-    if (bufpos >= buflen) {
-        tmfprintf(&csvBundle, tmstderr, _TMC("Fatal: buffer out of bounds"));
-        ua_exit(-1);
+static void pool_release(void* ctx, void* ptr) {
+    struct ua_dsv_pool* pool = ctx;
+    size_t c;
+    if (!ptr) {
+        return;
+    }
+    c = pool_class(ptr);
+    if (c == POOL_LARGE) {
+        free((unsigned char*)ptr - DSV_ALIGN);
+    } else {
+        *(void**)ptr = pool->free[c];
+        pool->free[c] = ptr;
+    }
+}
+
+static void* pool_resize(void* ctx, void* ptr, size_t size) {
+    size_t c, have;
+    void* moved;
+
+    if (!ptr) {
+        return pool_alloc(ctx, size);
+    }
+    c = pool_class(ptr);
+    if (c == POOL_LARGE) {
+        if (pool_class_for(size) == POOL_LARGE) {
+            unsigned char* grown = realloc((unsigned char*)ptr - DSV_ALIGN,
+                                           DSV_ALIGN + size);
+            return grown ? grown + DSV_ALIGN : NULL;
+        }
+        /* shrinking into a class: copy below, using the new size */
+        have = size;
+    } else {
+        have = (size_t)16 << c;
+        /* keep the chunk unless the new size fits a class a quarter of its
+         * size or less */
+        if (size <= have && (c == 0 || size > have / 4)) {
+            return ptr;
+        }
     }
+    moved = pool_alloc(ctx, size);
+    if (moved) {
+        memcpy(moved, ptr, have < size ? have : size);
+        pool_release(ctx, ptr);
+    }
+    return moved;
+}
 
-    /* 5) clean up and return result */
-    free((void*)should_quote);
-    return realloc(buffer, sizeof(TMCHAR)*(tmstrlen(buffer)+1));
+struct ua_dsv_pool* ua_dsv_pool_new(void) {
+    return calloc(1, sizeof(struct ua_dsv_pool));
 }
 
-const TMCHAR* ua_format_csv(const TMCHAR** data) {
-    return ua_format_dsv(data, QUOTE_NEEDED, CSV_Q, CSV_D, CSV_E);
+struct ua_dsv_allocator ua_dsv_pool_allocator(struct ua_dsv_pool* pool) {
+    struct ua_dsv_allocator allocator = {
+        pool_alloc, pool_resize, pool_release, NULL
+    };
+    allocator.ctx = pool;
+    return allocator;
 }
 
-const TMCHAR* ua_format_psv(const TMCHAR** data) {
-    return ua_format_dsv(data, QUOTE_NONE, PSV_Q, PSV_D, PSV_E);
+void ua_dsv_pool_free(struct ua_dsv_pool* pool) {
+    struct pool_slab* slab = pool ? pool->slabs : NULL;
+    while (slab) {
+        struct pool_slab* next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    free(pool);
 }
 
+/* }}} REGION: ALLOCATOR */
+
+/* {{{ REGION: TMCHAR ENGINE */
+
+#define DSV_CHAR TMCHAR
+#define DSV_FN(name) name
+#define DSV_STRLEN tmstrlen
+#include "gua2csv.inc"
+#undef DSV_CHAR
+#undef DSV_FN
+#undef DSV_STRLEN
+
+/* }}} REGION: TMCHAR ENGINE */
+
+/* {{{ REGION: UTF-8 ENGINE */
+
+#define DSV_CHAR char
+#define DSV_FN(name) name##_u8
+#define DSV_STRLEN strlen
+#include "gua2csv.inc"
+#undef DSV_CHAR
+#undef DSV_FN
+#undef DSV_STRLEN
+
+/* }}} REGION: UTF-8 ENGINE */
+
+/* {{{ REGION: DSV WRITER */
+
 int ua_write_dsv(const TMCHAR* path, const TMCHAR* mode,
                  const TMCHAR** data, enum UAQuoteStyle quoting,
                  TMCHAR quote, TMCHAR delim, TMCHAR escape) {
@@ -387,8 +672,7 @@ int ua_fwrite_dsv(UFILE* file,
     }
 
     tmfprintf(&csvBundle, file, _TMC("{0}\n"), buffer);
-    tmfclose(file);
-    free(buffer);
+    dsv_free(buffer);
     return TRUE;
 }
 
@@ -400,136 +684,3456 @@ int ua_fwrite_psv(UFILE* file, const TMCHAR** data) {
     return ua_fwrite_dsv(file, data, QUOTE_NONE, PSV_Q, PSV_D, PSV_E);
 }
 
-/* }}} REGION: DSV FORMATTER */
+int ua_write_dsv_u8(const char* path, const char* mode,
+                    const char** data, enum UAQuoteStyle quoting,
+                    char quote, char delim, char escape) {
+    FILE* f = fopen(path, mode);
+    if (!f) {
+        return FALSE;
+    }
 
-/* {{{ REGION: DSV SELECT */
-#if 0
+    /* fclose() is technically allowed to modify errno, so save it */
+    if (!ua_fwrite_dsv_u8(f, data, quoting, quote, delim, escape)) {
+        int save_errno = errno;
+        fclose(f);
+        errno = save_errno;
+        return FALSE;
+    }
 
-/* What do we have here, you ask?
- *
- * Well, I'd like to be able to run something akin to:
- *
- * ua_dsv_select(UFILE* file, const TMCHAR* query, const TMCHAR** args,
- *               enum UAQuoteStyle quoting, TMCHAR quotechar,
- *               TMCHAR delimchar, TMCHAR escapechar)
- *
- * and have it be called as
- *
- * const TMCHAR** args = {_TMC("31168931"), NULL};
- * ua_dsv_select(tmstdout, _TMC(
- *      "SELECT spriden_first_name, "
- *             "spriden_mi, "
- *             "spriden_last_name, "
- *             "spriden_id "
- *        "FROM spriden "
- *       "WHERE spriden_id=:id"), args, QUOTE_NEEDED, '"', ',', '\0');
- *
- * which would result in the results of that query being written to stdout as
- * properly formatted CSV.
- *
- * Due to some limitations of PMIG, I can't get this to work quite yet.
- *
- * Due to Pro*C limitations, I doubt this will work with inline SQL without
- * some insane C99 preprocessor hackery, which is turning out to be more
- * trouble than it's worth.
- */
+    return fclose(f) == 0;
+}
 
-static void strnarrow(const TMCHAR* src, char* dest) {
-    while ((*dest++ = (char)*src++)) ;
+int ua_write_csv_u8(const char* path, const char* mode, const char** data) {
+    return ua_write_dsv_u8(path, mode, data, QUOTE_NEEDED, CSV_Q, CSV_D, CSV_E);
 }
 
-static void strwiden(const char* src, TMCHAR* dest) {
-    while ((*dest++ = (TMCHAR)*src++)) ;
+int ua_write_psv_u8(const char* path, const char* mode, const char** data) {
+    return ua_write_dsv_u8(path, mode, data, QUOTE_NONE, PSV_Q, PSV_D, PSV_E);
 }
 
-enum {
-    SQLTYPE_CHAR = 1,
-    SQLTYPE_NUMERIC = 2,
-    SQLTYPE_DECIMAL = 3,
-    SQLTYPE_INTEGER = 4,
-    SQLTYPE_SMALLINT = 5,
-    SQLTYPE_FLOAT = 6,
-    SQLTYPE_REAL = 7,
-    SQLTYPE_DOUBLE = 8,
-    SQLTYPE_DATE = 9,
-    SQLTYPE_VARCHAR = 12,
+int ua_fwrite_dsv_u8(FILE* file,
+                     const char** data, enum UAQuoteStyle quoting,
+                     char quote, char delim, char escape) {
+    const char* buffer = ua_format_dsv_u8(data, quoting, quote, delim, escape);
+    int ok;
+    if (!buffer) {
+        return FALSE;
+    }
 
-    ORATYPE_VARCHAR2 = 1,   /* char[n] */
-    ORATYPE_NUMBER = 2,     /* char[n], n <= 22 */
-    ORATYPE_INTEGER = 3,    /* int */
-    ORATYPE_FLOAT = 4,      /* float */
-    ORATYPE_STRING = 5,     /* char[n+1], char[n]='\0'; */
-    ORATYPE_VARNUM = 6,     /* char[n], n <= 22 */
-    ORATYPE_DECIMAL = 7,
-    ORATYPE_LONG = 8,
-    ORATYPE_VARCHAR = 9,
-    ORATYPE_ROWID = 11,
-    ORATYPE_DATE = 12,
-    ORATYPE_VARRAW = 15,
-    ORATYPE_SQLT_BFLOAT = 21,
-    ORATYPE_SQLT_BDOUBLE = 22,
-    ORATYPE_RAW = 23,
-    ORATYPE_LONG_RAW = 24,
-    ORATYPE_UNSIGNED = 68,
-    ORATYPE_DISPLAY = 91,
-    ORATYPE_LONG_VARCHAR = 94,
-    ORATYPE_LONG_VARRAW = 95,
-    ORATYPE_CHAR = 96,
-    ORATYPE_CHARF = 96,
-    ORATYPE_CHARZ = 97
-};
+    ok = fputs(buffer, file) != EOF && fputc('\n', file) != EOF;
+    dsv_free(buffer);
+    return ok;
+}
 
-void ua_dsv_select(UFILE* out, const TMCHAR* query, const TMCHAR** inputs,
-                   enum UAQuoteStyle quoting, TMCHAR quote, TMCHAR delim,
-                   TMCHAR escape)
-{
-    char* ascquery = calloc(sizeof(char), tmstrlen(query)+1);
-    strnarrow(query, ascquery);
-    EXEC SQL ALLOCATE DESCRIPTOR 'in'; POSTORA;
-    EXEC SQL ALLOCATE DESCRIPTOR 'out'; POSTORA;
+int ua_fwrite_csv_u8(FILE* file, const char** data) {
+    return ua_fwrite_dsv_u8(file, data, QUOTE_NEEDED, CSV_Q, CSV_D, CSV_E);
+}
 
-    EXEC SQL PREPARE s FROM :ascquery; POSTORA;
-    EXEC SQL DESCRIBE INPUT s USING DESCRIPTOR 'in'; POSTORA;
-    EXEC SQL DESCRIBE OUTPUT s USING DESCRIPTOR 'out'; POSTORA;
+int ua_fwrite_psv_u8(FILE* file, const char** data) {
+    return ua_fwrite_dsv_u8(file, data, QUOTE_NONE, PSV_Q, PSV_D, PSV_E);
+}
 
-    int ninputs = veclen(inputs);
-    int nvars_in = 0;
-    int nvars_out = 0;
-    EXEC SQL GET DESCRIPTOR 'in' :nvars_in = COUNT; POSTORA;
-    EXEC SQL GET DESCRIPTOR 'out' :nvars_out = COUNT; POSTORA;
+/* }}} REGION: DSV WRITER */
 
-    if (ninputs < nvars_in) {
-        tmfprintf(&csvBundle, tmstdout, _TMC("ERROR!! Not enough inputs!\n"));
-        ua_exit(-1);
-    } else if (ninputs > nvars_in) {
-        tmfprintf(&csvBundle, tmstdout, _TMC("WARNING!! Too many inputs!\n"));
+/* {{{ REGION: DSV EXPORT */
+
+void ua_dsv_histogram_add(struct ua_dsv_histogram* hist, uint64_t nanos) {
+    uint64_t v = nanos >> 1;
+    int b = 0;
+    while (v && b < UA_DSV_HIST_BUCKETS-1) {
+        v >>= 1;
+        ++b;
+    }
+    if (hist->count == 0 || nanos < hist->min) {
+        hist->min = nanos;
     }
+    if (nanos > hist->max) {
+        hist->max = nanos;
+    }
+    hist->count += 1;
+    hist->sum += nanos;
+    hist->buckets[b] += 1;
+}
 
-    EXEC SQL DECLARE psv_cur CURSOR FOR s; POSTORA;
+uint64_t ua_dsv_histogram_percentile(const struct ua_dsv_histogram* hist,
+                                     double p) {
+    double target;
+    uint64_t rank;
+    uint64_t seen = 0;
+    int b;
 
-    int i = 0;
-    for (i = 1; i < nvars_in+1; ++i) {
-        const int type = SQLTYPE_CHAR;
-        const int length = tmstrlen(inputs[i-1]);
-        const TMCHAR* data = inputs[i-1];
-        char* ascdata = calloc(sizeof(char), length+1);
-        strnarrow(data, ascdata);
-        EXEC SQL SET DESCRIPTOR 'in' VALUE :i
-            TYPE = :type,
-            LENGTH = :length,
-            DATA = :ascdata;
-        POSTORA;
-        free((void*)ascdata);
+    if (hist->count == 0) {
+        return 0;
+    }
+    /* rank of the sample at the percentile, counting from 1 */
+    target = p / 100.0 * (double)hist->count;
+    rank = (uint64_t)target;
+    if ((double)rank < target) {
+        rank += 1;
+    }
+    if (rank < 1) {
+        rank = 1;
+    }
+    for (b = 0; b < UA_DSV_HIST_BUCKETS; ++b) {
+        seen += hist->buckets[b];
+        if (seen >= rank) {
+            uint64_t top = ((uint64_t)2 << b) - 1;
+            return top < hist->max ? top : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+const char* ua_dsv_stage_name(enum UADsvStage stage) {
+    static const char* const names[UA_DSV_STAGE_COUNT] = {
+        "fetch",
+        "transcode",
+        "format",
+        "write"
+    };
+    if ((int)stage < 0 || stage >= UA_DSV_STAGE_COUNT) {
+        return "unknown";
+    }
+    return names[stage];
+}
+
+int ua_dsv_sink_ufile(void* file, const TMCHAR* text, size_t len) {
+    (void)len;
+    tmfprintf(&csvBundle, (UFILE*)file, _TMC("{0}"), text);
+    return TRUE;
+}
+
+/* record one stage of one batch, started at @param start */
+static void export_stage(struct ua_dsv_export_metrics* m,
+                         enum UADsvStage stage, uint64_t origin,
+                         uint64_t start, uint64_t batch, long rows) {
+    uint64_t stop;
+    if (!m) {
+        return;
+    }
+    stop = dsv_clock();
+    ua_dsv_histogram_add(&m->stages[stage], stop - start);
+    if (m->trace) {
+        /* the fetch of the first batch is always the first event */
+        fprintf(m->trace,
+                "%s\n{\"name\":\"%s\",\"cat\":\"ua_dsv_export\",\"ph\":\"X\","
+                "\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,"
+                "\"args\":{\"batch\":%llu,\"rows\":%ld}}",
+                (batch || stage != UA_DSV_STAGE_FETCH) ? "," : "",
+                ua_dsv_stage_name(stage),
+                (double)(start - origin) / 1000.0,
+                (double)(stop - start) / 1000.0,
+                (unsigned long long)batch, rows);
+    }
+}
+
+/* widen a row from the source into a vector ua_free_dsv can release */
+static const TMCHAR** export_widen(const char** row) {
+    const TMCHAR** wide;
+    size_t n = 0;
+    size_t i, j;
+
+    while (row[n]) {
+        ++n;
+    }
+    wide = dsv_calloc(n+1, sizeof(const TMCHAR*));
+    if (!wide) {
+        return NULL;
+    }
+    for (i = 0; i < n; ++i) {
+        size_t len = strlen(row[i]);
+        TMCHAR* field = dsv_calloc(len+1, sizeof(TMCHAR));
+        if (!field) {
+            ua_free_dsv(wide);
+            return NULL;
+        }
+        for (j = 0; j < len; ++j) {
+            field[j] = (TMCHAR)(unsigned char)row[i][j];
+        }
+        wide[i] = field;
+    }
+    return wide;
+}
+
+long ua_dsv_export(const struct ua_dsv_source* source,
+                   const struct ua_dsv_sink* sink, long batch,
+                   enum UAQuoteStyle quoting, TMCHAR quote, TMCHAR delim,
+                   TMCHAR escape, struct ua_dsv_export_metrics* metrics) {
+    const char*** rows;
+    const TMCHAR*** wide;
+    TMCHAR* out = NULL;
+    size_t outcap = 0;
+    uint64_t origin = 0;
+    uint64_t start = 0;
+    uint64_t nbatch = 0;
+    long total = 0;
+    int ok = TRUE;
+    long n, i;
+
+    if (batch < 1) {
+        batch = 1;
+    }
+    rows = dsv_calloc((size_t)batch, sizeof(*rows));
+    wide = dsv_calloc((size_t)batch, sizeof(*wide));
+    if (!rows || !wide) {
+        dsv_free(rows);
+        dsv_free(wide);
+        return -1;
+    }
+
+    if (metrics) {
+        origin = dsv_clock();
+        if (metrics->trace) {
+            fputs("{\"traceEvents\":[", metrics->trace);
+        }
+    }
+
+    while (ok) {
+        size_t outlen = 0;
+
+        /* 1) fetch */
+        if (metrics) start = dsv_clock();
+        n = source->fetch(source->user, rows, batch);
+        export_stage(metrics, UA_DSV_STAGE_FETCH, origin, start, nbatch, n);
+        if (n <= 0 || n > batch) {
+            ok = (n == 0);
+            break;
+        }
+
+        /* 2) transcode */
+        if (metrics) start = dsv_clock();
+        for (i = 0; i < n && ok; ++i) {
+            wide[i] = export_widen(rows[i]);
+            ok = (wide[i] != NULL);
+        }
+        export_stage(metrics, UA_DSV_STAGE_TRANSCODE, origin, start,
+                     nbatch, n);
+
+        /* 3) format the whole batch into one buffer, one record per line */
+        if (metrics) start = dsv_clock();
+        for (i = 0; i < n && ok; ++i) {
+            const TMCHAR* line = ua_format_dsv(wide[i], quoting, quote,
+                                               delim, escape);
+            size_t len;
+            if (!line) {
+                ok = FALSE;
+                break;
+            }
+            len = tmstrlen(line);
+            if (outlen + len + 2 > outcap) {
+                size_t cap = outcap ? outcap : 4096;
+                TMCHAR* grown;
+                while (outlen + len + 2 > cap) {
+                    cap *= 2;
+                }
+                grown = dsv_realloc(out, cap*sizeof(TMCHAR));
+                if (!grown) {
+                    dsv_free(line);
+                    ok = FALSE;
+                    break;
+                }
+                out = grown;
+                outcap = cap;
+            }
+            memcpy(out+outlen, line, len*sizeof(TMCHAR));
+            outlen += len;
+            out[outlen++] = '\n';
+            out[outlen] = '\0';
+            dsv_free(line);
+        }
+        for (i = 0; i < n; ++i) {
+            if (wide[i]) {
+                ua_free_dsv(wide[i]);
+                wide[i] = NULL;
+            }
+        }
+        export_stage(metrics, UA_DSV_STAGE_FORMAT, origin, start, nbatch, n);
+        if (!ok) {
+            break;
+        }
+
+        /* 4) write */
+        if (metrics) start = dsv_clock();
+        ok = sink->write(sink->user, out, outlen);
+        export_stage(metrics, UA_DSV_STAGE_WRITE, origin, start, nbatch, n);
+
+        if (metrics) {
+            metrics->batches += 1;
+            metrics->rows += (uint64_t)n;
+            metrics->chars += outlen;
+        }
+        total += n;
+        nbatch += 1;
+    }
+
+    if (metrics && metrics->trace) {
+        fputs("\n],\"displayTimeUnit\":\"ms\"}\n", metrics->trace);
+    }
+
+    dsv_free(out);
+    dsv_free(wide);
+    dsv_free(rows);
+    return ok ? total : -1;
+}
+
+int ua_dsv_export_report(FILE* file,
+                         const struct ua_dsv_export_metrics* metrics) {
+    uint64_t total = 0;
+    int s;
+
+    for (s = 0; s < UA_DSV_STAGE_COUNT; ++s) {
+        total += metrics->stages[s].sum;
+    }
+    fprintf(file, "%llu batches, %llu rows, %llu chars\n",
+            (unsigned long long)metrics->batches,
+            (unsigned long long)metrics->rows,
+            (unsigned long long)metrics->chars);
+    fprintf(file, "%-10s %8s %12s %6s %12s %12s %12s %12s\n",
+            "stage", "batches", "total_ms", "share",
+            "p50_us", "p90_us", "p99_us", "max_us");
+    for (s = 0; s < UA_DSV_STAGE_COUNT; ++s) {
+        const struct ua_dsv_histogram* h = &metrics->stages[s];
+        fprintf(file, "%-10s %8llu %12.3f %5.1f%% "
+                      "%12.3f %12.3f %12.3f %12.3f\n",
+                ua_dsv_stage_name((enum UADsvStage)s),
+                (unsigned long long)h->count,
+                (double)h->sum / 1e6,
+                total ? 100.0 * (double)h->sum / (double)total : 0.0,
+                (double)ua_dsv_histogram_percentile(h, 50) / 1e3,
+                (double)ua_dsv_histogram_percentile(h, 90) / 1e3,
+                (double)ua_dsv_histogram_percentile(h, 99) / 1e3,
+                (double)h->max / 1e3);
+    }
+    return !ferror(file);
+}
+
+/* }}} REGION: DSV EXPORT */
+
+/* {{{ REGION: DSV INDEX */
+
+/* Index file layout, every integer little-endian:
+ *
+ *  magic       8 bytes, "UADSVIX1"
+ *  quote       1 byte
+ *  delim       1 byte
+ *  reserved    2 bytes, zero
+ *  every       4 bytes
+ *  records     8 bytes
+ *  size        8 bytes
+ *  mtime_sec   8 bytes, two's complement
+ *  mtime_nsec  8 bytes
+ *  end         8 bytes
+ *  noffsets    8 bytes
+ *  reserved    8 bytes, zero
+ *  offsets     8 bytes each
+ */
+static const char index_magic[8] = {'U','A','D','S','V','I','X','1'};
+
+#define INDEX_HEADER 72
+#define INDEX_CHUNK (1u << 20)
+
+#if defined(__APPLE__)
+#define INDEX_MTIME_NSEC(st) ((st).st_mtimespec.tv_nsec)
+#else
+#define INDEX_MTIME_NSEC(st) ((st).st_mtim.tv_nsec)
+#endif
+
+static void index_put64(unsigned char* p, uint64_t v) {
+    int i;
+    for (i = 0; i < 8; ++i) {
+        p[i] = (unsigned char)(v >> (8*i));
+    }
+}
+
+static uint64_t index_get64(const unsigned char* p) {
+    uint64_t v = 0;
+    int i;
+    for (i = 7; i >= 0; --i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+/* called by index_walk for every complete record with its offset and the
+ * offset after its EOL; return false to stop */
+typedef int (*index_record_fn)(void* user, uint64_t start, uint64_t next);
+
+struct index_walk {
+    const char* buf;
+    size_t have;
+    uint64_t base;              /* file offset of buf[0] */
+    int eof;
+    size_t stop;                /* start of the first incomplete record */
+    int held;                   /* a record was held back as incomplete */
+    int quit;                   /* fn returned false */
+    index_record_fn fn;
+    void* user;
+};
+
+static int index_on_record(void* user, const char* record, size_t len,
+                           size_t nfields) {
+    struct index_walk* w = user;
+    const char* end = record + len;
+    const char* limit = w->buf + w->have;
+    size_t eol = 0;
+
+    (void)nfields;
+    /* the record may go on, or be followed by the '\n' of a "\r\n", in
+     * bytes that have not been read yet */
+    if (!w->eof && (end >= limit || (*end == '\r' && end + 1 >= limit))) {
+        w->stop = (size_t)(record - w->buf);
+        w->held = TRUE;
+        return FALSE;
+    }
+    if (end < limit && (*end == '\r' || *end == '\n')) {
+        eol = *end == '\r' && end + 1 < limit && end[1] == '\n' ? 2 : 1;
+    }
+    if (!w->fn(w->user, w->base + (uint64_t)(record - w->buf),
+               w->base + (uint64_t)(end - w->buf) + eol)) {
+        w->quit = TRUE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* read @param file from its current position, which is offset @param base,
+ * and report its records to @param fn until it returns false or the records
+ * end; stores where they end (the end of the file or a NIL) in @param end
+ * when they all were read. Returns false on a read error or out of memory. */
+static int index_walk(FILE* file, uint64_t base, char quote, char delim,
+                      index_record_fn fn, void* user, uint64_t* end) {
+    struct index_walk w;
+    char* buf = NULL;
+    size_t cap = INDEX_CHUNK;
+    int ok = TRUE;
+
+    memset(&w, 0, sizeof(w));
+    w.base = base;
+    w.fn = fn;
+    w.user = user;
+    buf = dsv_realloc(NULL, cap);
+    if (!buf) {
+        return FALSE;
+    }
+
+    for (;;) {
+        size_t used, got;
+
+        got = fread(buf + w.have, 1, cap - w.have, file);
+        if (got == 0 && ferror(file)) {
+            ok = FALSE;
+            break;
+        }
+        w.have += got;
+        w.eof = got == 0 || feof(file);
+        w.buf = buf;
+        w.held = FALSE;
+        used = ua_dsv_scan_u8(buf, w.have, quote, delim,
+                              NULL, index_on_record, &w);
+        if (w.quit) {
+            break;
+        }
+        if (!w.held) {
+            /* everything was scanned: the end of the input, or a NIL */
+            if (w.eof || used < w.have) {
+                if (end) {
+                    *end = w.base + used;
+                }
+                break;
+            }
+            w.stop = w.have;
+        }
+        if (w.stop == 0 && w.have == cap) {
+            /* one record fills the buffer */
+            char* grown = dsv_realloc(buf, cap * 2);
+            if (!grown) {
+                ok = FALSE;
+                break;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+        memmove(buf, buf + w.stop, w.have - w.stop);
+        w.base += w.stop;
+        w.have -= w.stop;
+    }
+
+    dsv_free(buf);
+    return ok;
+}
+
+struct index_build {
+    struct ua_dsv_index* index;
+    size_t cap;
+    int failed;
+};
+
+static int index_build_record(void* user, uint64_t start, uint64_t next) {
+    struct index_build* b = user;
+    struct ua_dsv_index* index = b->index;
+
+    (void)next;
+    if (index->records % index->every == 0) {
+        if (index->noffsets == b->cap) {
+            size_t cap = b->cap ? b->cap * 2 : 256;
+            uint64_t* grown = dsv_realloc(index->offsets,
+                                          cap * sizeof(uint64_t));
+            if (!grown) {
+                b->failed = TRUE;
+                return FALSE;
+            }
+            index->offsets = grown;
+            b->cap = cap;
+        }
+        index->offsets[index->noffsets++] = start;
+    }
+    index->records += 1;
+    return TRUE;
+}
+
+int ua_dsv_index_build(struct ua_dsv_index* index, const char* path,
+                       char quote, char delim, uint32_t every) {
+    struct index_build b;
+    struct stat before, after;
+    FILE* f;
+    int ok;
+
+    memset(index, 0, sizeof(*index));
+    index->quote = quote;
+    index->delim = delim;
+    index->every = every ? every : 1;
+
+    f = fopen(path, "rb");
+    if (!f) {
+        return FALSE;
+    }
+    if (fstat(fileno(f), &before) != 0) {
+        int save_errno = errno;
+        fclose(f);
+        errno = save_errno;
+        return FALSE;
+    }
+
+    memset(&b, 0, sizeof(b));
+    b.index = index;
+    ok = index_walk(f, 0, quote, delim, index_build_record, &b, &index->end);
+    ok = ok && !b.failed;
+    if (ok && (fstat(fileno(f), &after) != 0 ||
+               after.st_size != before.st_size ||
+               after.st_mtime != before.st_mtime ||
+               INDEX_MTIME_NSEC(after) != INDEX_MTIME_NSEC(before))) {
+        /* written to while it was read: the offsets may not agree */
+        errno = EAGAIN;
+        ok = FALSE;
+    }
+    fclose(f);
+
+    if (!ok) {
+        ua_dsv_index_free(index);
+        return FALSE;
+    }
+    index->size = (uint64_t)before.st_size;
+    index->mtime_sec = (int64_t)before.st_mtime;
+    index->mtime_nsec = (long)INDEX_MTIME_NSEC(before);
+    return TRUE;
+}
+
+int ua_dsv_index_save(const struct ua_dsv_index* index, const char* path) {
+    unsigned char header[INDEX_HEADER];
+    unsigned char buf[8 * 512];
+    size_t i, n;
+    FILE* f;
+    int ok;
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, index_magic, sizeof(index_magic));
+    header[8] = (unsigned char)index->quote;
+    header[9] = (unsigned char)index->delim;
+    header[12] = (unsigned char)index->every;
+    header[13] = (unsigned char)(index->every >> 8);
+    header[14] = (unsigned char)(index->every >> 16);
+    header[15] = (unsigned char)(index->every >> 24);
+    index_put64(header + 16, index->records);
+    index_put64(header + 24, index->size);
+    index_put64(header + 32, (uint64_t)index->mtime_sec);
+    index_put64(header + 40, (uint64_t)index->mtime_nsec);
+    index_put64(header + 48, index->end);
+    index_put64(header + 56, index->noffsets);
+    /* header + 64: reserved */
+
+    f = fopen(path, "wb");
+    if (!f) {
+        return FALSE;
+    }
+    ok = fwrite(header, 1, sizeof(header), f) == sizeof(header);
+    for (i = 0; ok && i < index->noffsets; i += n) {
+        size_t j;
+        n = index->noffsets - i < 512 ? index->noffsets - i : 512;
+        for (j = 0; j < n; ++j) {
+            index_put64(buf + 8*j, index->offsets[i + j]);
+        }
+        ok = fwrite(buf, 8, n, f) == n;
+    }
+    if (!ok) {
+        int save_errno = errno;
+        fclose(f);
+        errno = save_errno;
+        return FALSE;
+    }
+    return fclose(f) == 0;
+}
+
+int ua_dsv_index_load(struct ua_dsv_index* index, const char* path) {
+    unsigned char header[INDEX_HEADER];
+    unsigned char buf[8 * 512];
+    uint64_t noffsets;
+    size_t i, n;
+    FILE* f;
+    int ok;
+
+    memset(index, 0, sizeof(*index));
+    f = fopen(path, "rb");
+    if (!f) {
+        return FALSE;
+    }
+    if (fread(header, 1, sizeof(header), f) != sizeof(header) ||
+        memcmp(header, index_magic, sizeof(index_magic)) != 0) {
+        fclose(f);
+        errno = EINVAL;
+        return FALSE;
+    }
+    index->quote = (char)header[8];
+    index->delim = (char)header[9];
+    index->every = (uint32_t)header[12] | (uint32_t)header[13] << 8 |
+                   (uint32_t)header[14] << 16 | (uint32_t)header[15] << 24;
+    index->records = index_get64(header + 16);
+    index->size = index_get64(header + 24);
+    index->mtime_sec = (int64_t)index_get64(header + 32);
+    index->mtime_nsec = (long)index_get64(header + 40);
+    index->end = index_get64(header + 48);
+    noffsets = index_get64(header + 56);
+
+    /* the offsets must be those of the records the header counts */
+    if (index->every == 0 ||
+        noffsets != (index->records + index->every - 1) / index->every ||
+        noffsets > SIZE_MAX / sizeof(uint64_t)) {
+        fclose(f);
+        errno = EINVAL;
+        return FALSE;
+    }
+    ok = TRUE;
+    if (noffsets) {
+        index->offsets = dsv_realloc(NULL, (size_t)noffsets *
+                                           sizeof(uint64_t));
+        ok = index->offsets != NULL;
+    }
+    for (i = 0; ok && i < noffsets; i += n) {
+        size_t j;
+        n = noffsets - i < 512 ? (size_t)noffsets - i : 512;
+        if (fread(buf, 8, n, f) != n) {
+            if (!ferror(f)) {
+                errno = EINVAL;
+            }
+            ok = FALSE;
+        }
+        for (j = 0; ok && j < n; ++j) {
+            index->offsets[i + j] = index_get64(buf + 8*j);
+            if (index->offsets[i + j] >= index->end ||
+                (i + j != 0 &&
+                 index->offsets[i + j] <= index->offsets[i + j - 1])) {
+                errno = EINVAL;
+                ok = FALSE;
+            }
+        }
+    }
+    index->noffsets = (size_t)noffsets;
+    if (!ok) {
+        int save_errno = errno;
+        fclose(f);
+        ua_dsv_index_free(index);
+        errno = save_errno;
+        return FALSE;
+    }
+    fclose(f);
+    return TRUE;
+}
+
+int ua_dsv_index_fresh(const struct ua_dsv_index* index, const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return FALSE;
+    }
+    return (uint64_t)st.st_size == index->size &&
+           (int64_t)st.st_mtime == index->mtime_sec &&
+           (long)INDEX_MTIME_NSEC(st) == index->mtime_nsec;
+}
+
+int ua_dsv_index_open(struct ua_dsv_index* index, const char* path,
+                      const char* index_path, char quote, char delim,
+                      uint32_t every) {
+    char* sidecar = NULL;
+    int ok;
+
+    if (!index_path) {
+        size_t n = strlen(path);
+        sidecar = dsv_realloc(NULL, n + sizeof(".dsvidx"));
+        if (!sidecar) {
+            return FALSE;
+        }
+        memcpy(sidecar, path, n);
+        memcpy(sidecar + n, ".dsvidx", sizeof(".dsvidx"));
+        index_path = sidecar;
+    }
+
+    if (ua_dsv_index_load(index, index_path) &&
+        index->quote == quote && index->delim == delim &&
+        (every == 0 || index->every == every) &&
+        ua_dsv_index_fresh(index, path)) {
+        dsv_free(sidecar);
+        return TRUE;
+    }
+    ua_dsv_index_free(index);
+
+    ok = ua_dsv_index_build(index, path, quote, delim, every);
+    if (ok) {
+        /* an index that cannot be saved is still good to use */
+        int save_errno = errno;
+        ua_dsv_index_save(index, index_path);
+        errno = save_errno;
+    }
+    dsv_free(sidecar);
+    return ok;
+}
+
+struct index_skip {
+    uint64_t left;              /* records still to skip */
+    uint64_t next;              /* offset after the last one skipped */
+};
+
+static int index_skip_record(void* user, uint64_t start, uint64_t next) {
+    struct index_skip* s = user;
+    (void)start;
+    s->next = next;
+    return --s->left != 0;
+}
+
+int ua_dsv_index_seek(const struct ua_dsv_index* index, FILE* file,
+                      uint64_t record) {
+    struct index_skip s;
+    uint64_t start;
+
+    if (record >= index->records) {
+        errno = EINVAL;
+        return FALSE;
+    }
+    start = index->offsets[record / index->every];
+    if (fseeko(file, (off_t)start, SEEK_SET) != 0) {
+        return FALSE;
+    }
+    s.left = record % index->every;
+    s.next = start;
+    if (s.left == 0) {
+        return TRUE;
+    }
+    if (!index_walk(file, start, index->quote, index->delim,
+                    index_skip_record, &s, NULL)) {
+        return FALSE;
+    }
+    if (s.left != 0) {
+        /* the file is shorter than when it was indexed */
+        errno = EINVAL;
+        return FALSE;
+    }
+    return fseeko(file, (off_t)s.next, SEEK_SET) == 0;
+}
+
+size_t ua_dsv_index_split(const struct ua_dsv_index* index, size_t parts,
+                          struct ua_dsv_range* ranges) {
+    size_t n = 0;
+    size_t p;
+    size_t prev = 0;
+
+    if (parts == 0 || index->noffsets == 0) {
+        return 0;
+    }
+    for (p = 1; p <= parts; ++p) {
+        /* the p'th range ends at the indexed record closest to p/parts */
+        size_t cut = (size_t)((uint64_t)index->noffsets * p / parts);
+        uint64_t first, last;
+        if (cut == prev) {
+            continue;
+        }
+        first = (uint64_t)prev * index->every;
+        last = cut == index->noffsets ? index->records
+                                      : (uint64_t)cut * index->every;
+        ranges[n].offset = index->offsets[prev];
+        ranges[n].length = (cut == index->noffsets ? index->end
+                                                   : index->offsets[cut]) -
+                           ranges[n].offset;
+        ranges[n].first = first;
+        ranges[n].records = last - first;
+        n += 1;
+        prev = cut;
+    }
+    return n;
+}
+
+void ua_dsv_index_free(struct ua_dsv_index* index) {
+    dsv_free(index->offsets);
+    index->offsets = NULL;
+    index->noffsets = 0;
+}
+
+/* }}} REGION: DSV INDEX */
+
+/* {{{ REGION: DSV FOLLOW */
+
+#define FOLLOW_READ (64u << 10)
+#define FOLLOW_TICK 20          /* ms between checks without inotify */
+
+struct ua_dsv_follower {
+    char* path;
+    int fd;                     /* -1 while the file does not exist */
+    dev_t dev;
+    ino_t ino;
+    char quote;
+    char delim;
+    ua_dsv_field_fn_u8 on_field;
+    ua_dsv_record_fn_u8 on_record;
+    void* user;
+
+    uint64_t offset;            /* end of the last complete record */
+    char* buf;                  /* bytes read past offset */
+    size_t len;
+    size_t cap;
+    int ended;                  /* a NIL ended the records */
+
+    /* the fields of the record being scanned, reported once it is known to
+     * be complete */
+    const char** fields;
+    size_t* lens;
+    int* flags;
+    size_t nfields;
+    size_t fields_cap;
+
+    /* state of one scan */
+    int final;                  /* the file will not grow any more */
+    size_t done;                /* end of the last record reported */
+    int held;                   /* the last record may not be complete */
+    int stopped;                /* a callback returned false */
+    int failed;                 /* out of memory */
+    long reported;
+
+    int watch;                  /* inotify descriptor, or -1 */
+    int wd;                     /* watch on fd's file, or -1 */
+};
+
+static int follow_on_field(void* user, const char* field, size_t len,
+                           int flags) {
+    struct ua_dsv_follower* f = user;
+    if (f->nfields == f->fields_cap) {
+        size_t cap = f->fields_cap ? f->fields_cap * 2 : 16;
+        const char** fields = dsv_realloc(f->fields, cap * sizeof(*fields));
+        size_t* lens;
+        int* fl;
+        if (!fields) {
+            f->failed = TRUE;
+            return FALSE;
+        }
+        f->fields = fields;
+        lens = dsv_realloc(f->lens, cap * sizeof(*lens));
+        if (!lens) {
+            f->failed = TRUE;
+            return FALSE;
+        }
+        f->lens = lens;
+        fl = dsv_realloc(f->flags, cap * sizeof(*fl));
+        if (!fl) {
+            f->failed = TRUE;
+            return FALSE;
+        }
+        f->flags = fl;
+        f->fields_cap = cap;
+    }
+    f->fields[f->nfields] = field;
+    f->lens[f->nfields] = len;
+    f->flags[f->nfields] = flags;
+    f->nfields += 1;
+    return TRUE;
+}
+
+static int follow_on_record(void* user, const char* record, size_t len,
+                            size_t nfields) {
+    struct ua_dsv_follower* f = user;
+    const char* end = record + len;
+    const char* limit = f->buf + f->len;
+    size_t eol = 0;
+    size_t i;
+
+    /* the record may go on, or be followed by the '\n' of a "\r\n", in
+     * bytes that have not been written yet */
+    if (!f->final && (end >= limit || (*end == '\r' && end + 1 >= limit))) {
+        f->held = TRUE;
+        f->nfields = 0;
+        return FALSE;
+    }
+    if (end < limit && (*end == '\r' || *end == '\n')) {
+        eol = *end == '\r' && end + 1 < limit && end[1] == '\n' ? 2 : 1;
+    }
+
+    for (i = 0; i < f->nfields && !f->stopped; ++i) {
+        if (f->on_field && !f->on_field(f->user, f->fields[i], f->lens[i],
+                                        f->flags[i])) {
+            f->stopped = TRUE;
+        }
+    }
+    if (!f->stopped && f->on_record &&
+        !f->on_record(f->user, record, len, nfields)) {
+        f->stopped = TRUE;
+    }
+    f->nfields = 0;
+    f->done = (size_t)(end - f->buf) + eol;
+    f->reported += 1;
+    return !f->stopped;
+}
+
+/* report the complete records buffered, then drop them from the buffer */
+static int follow_scan(struct ua_dsv_follower* f, int final) {
+    size_t used;
+
+    f->final = final;
+    f->done = 0;
+    f->held = FALSE;
+    f->nfields = 0;
+    used = ua_dsv_scan_u8(f->buf, f->len, f->quote, f->delim,
+                          f->on_field ? follow_on_field : NULL,
+                          follow_on_record, f);
+    if (f->failed) {
+        errno = ENOMEM;
+        return FALSE;
+    }
+    if (!f->held && !f->stopped && used < f->len) {
+        /* a NIL: nothing after it is part of a record */
+        f->ended = TRUE;
+        f->done = used;
+    }
+    if (f->done) {
+        memmove(f->buf, f->buf + f->done, f->len - f->done);
+        f->len -= f->done;
+        f->offset += f->done;
+    }
+    return TRUE;
+}
+
+static void follow_close(struct ua_dsv_follower* f) {
+#ifdef DSV_INOTIFY
+    if (f->wd >= 0) {
+        inotify_rm_watch(f->watch, f->wd);
+        f->wd = -1;
+    }
+#endif
+    if (f->fd >= 0) {
+        close(f->fd);
+        f->fd = -1;
+    }
+}
+
+/* open the file if it exists now; false only on an error */
+static int follow_open(struct ua_dsv_follower* f) {
+    struct stat st;
+
+    f->fd = open(f->path, O_RDONLY | O_CLOEXEC);
+    if (f->fd < 0) {
+        return errno == ENOENT;
+    }
+    if (fstat(f->fd, &st) != 0) {
+        int save_errno = errno;
+        follow_close(f);
+        errno = save_errno;
+        return FALSE;
+    }
+    f->dev = st.st_dev;
+    f->ino = st.st_ino;
+#ifdef DSV_INOTIFY
+    if (f->watch >= 0) {
+        f->wd = inotify_add_watch(f->watch, f->path,
+                                  IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE |
+                                  IN_MOVE_SELF | IN_DELETE_SELF);
+    }
+#endif
+    return TRUE;
+}
+
+/* read and report until the end of the file, a NIL or a stop */
+static int follow_read(struct ua_dsv_follower* f) {
+    for (;;) {
+        ssize_t got;
+        if (!follow_scan(f, FALSE)) {
+            return FALSE;
+        }
+        if (f->stopped || f->ended) {
+            return TRUE;
+        }
+        if (f->cap - f->len < FOLLOW_READ) {
+            size_t cap = f->cap ? f->cap : FOLLOW_READ;
+            char* grown;
+            while (cap - f->len < FOLLOW_READ) {
+                cap *= 2;
+            }
+            grown = dsv_realloc(f->buf, cap);
+            if (!grown) {
+                return FALSE;
+            }
+            f->buf = grown;
+            f->cap = cap;
+        }
+        got = pread(f->fd, f->buf + f->len, f->cap - f->len,
+                    (off_t)(f->offset + f->len));
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return got == 0;
+        }
+        f->len += (size_t)got;
+    }
+}
+
+struct ua_dsv_follower* ua_dsv_follow_new(const char* path, uint64_t offset,
+                                          char quote, char delim,
+                                          ua_dsv_field_fn_u8 on_field,
+                                          ua_dsv_record_fn_u8 on_record,
+                                          void* user) {
+    struct ua_dsv_follower* f = dsv_calloc(1, sizeof(*f));
+    size_t n = strlen(path);
+
+    if (!f) {
+        return NULL;
+    }
+    f->path = dsv_calloc(n + 1, 1);
+    if (!f->path) {
+        dsv_free(f);
+        return NULL;
+    }
+    memcpy(f->path, path, n);
+    f->fd = -1;
+    f->quote = quote;
+    f->delim = delim;
+    f->on_field = on_field;
+    f->on_record = on_record;
+    f->user = user;
+    f->offset = offset;
+    f->watch = -1;
+    f->wd = -1;
+#ifdef DSV_INOTIFY
+    f->watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    return f;
+}
+
+long ua_dsv_follow_poll(struct ua_dsv_follower* f) {
+    struct stat st;
+    int replaced;
+
+    f->reported = 0;
+    f->stopped = FALSE;
+    if (f->fd < 0) {
+        if (!follow_open(f)) {
+            return -1;
+        }
+        if (f->fd < 0) {
+            return 0;
+        }
+    }
+
+    /* a new file under the path; a missing one may yet be created */
+    replaced = stat(f->path, &st) == 0 &&
+               (st.st_dev != f->dev || st.st_ino != f->ino);
+
+    if (fstat(f->fd, &st) != 0) {
+        return -1;
+    }
+    if ((uint64_t)st.st_size < f->offset + f->len) {
+        /* truncated: start over */
+        f->offset = 0;
+        f->len = 0;
+        f->ended = FALSE;
+    }
+    if (!follow_read(f)) {
+        return -1;
+    }
+
+    if (replaced && !f->stopped) {
+        /* the old file is complete, even its last record */
+        if (!f->ended && !follow_scan(f, TRUE)) {
+            return -1;
+        }
+        if (!f->stopped) {
+            follow_close(f);
+            f->offset = 0;
+            f->len = 0;
+            f->ended = FALSE;
+            if (!follow_open(f) || (f->fd >= 0 && !follow_read(f))) {
+                return -1;
+            }
+        }
+    }
+    return f->reported;
+}
+
+/* whether the file looks different from what has been read of it */
+static int follow_changed(const struct ua_dsv_follower* f) {
+    struct stat st;
+    if (stat(f->path, &st) != 0) {
+        return FALSE;
+    }
+    return f->fd < 0 || st.st_dev != f->dev || st.st_ino != f->ino ||
+           (uint64_t)st.st_size != f->offset + f->len;
+}
+
+int ua_dsv_follow_wait(struct ua_dsv_follower* f, int timeout) {
+    int waited = 0;
+
+#ifdef DSV_INOTIFY
+    /* the watch is on the file itself, so it only serves while the file is
+     * open and still under its path */
+    if (f->wd >= 0 && !follow_changed(f)) {
+        struct pollfd p;
+        char events[4096];
+        ssize_t got;
+        int ready;
+        p.fd = f->watch;
+        p.events = POLLIN;
+        p.revents = 0;
+        ready = poll(&p, 1, timeout < 0 ? -1 : timeout);
+        if (ready < 0) {
+            return -1;
+        }
+        if (ready == 0) {
+            return FALSE;
+        }
+        while ((got = read(f->watch, events, sizeof(events))) > 0) {
+            ssize_t i = 0;
+            while (i < got) {
+                const struct inotify_event* e =
+                    (const struct inotify_event*)(events + i);
+                if (e->wd == f->wd &&
+                    (e->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED))) {
+                    /* polling the path from now on, until it is reopened */
+                    inotify_rm_watch(f->watch, f->wd);
+                    f->wd = -1;
+                }
+                i += (ssize_t)(sizeof(*e) + e->len);
+            }
+        }
+        return TRUE;
+    }
+#endif
+
+    while (!follow_changed(f)) {
+        struct timespec tick;
+        if (timeout >= 0 && waited >= timeout) {
+            return FALSE;
+        }
+        tick.tv_sec = 0;
+        tick.tv_nsec = (long)FOLLOW_TICK * 1000000L;
+        if (nanosleep(&tick, NULL) != 0) {
+            return -1;
+        }
+        waited += FOLLOW_TICK;
+    }
+    return TRUE;
+}
+
+uint64_t ua_dsv_follow_offset(const struct ua_dsv_follower* f) {
+    return f->offset;
+}
+
+void ua_dsv_follow_free(struct ua_dsv_follower* f) {
+    if (!f) {
+        return;
+    }
+    follow_close(f);
+#ifdef DSV_INOTIFY
+    if (f->watch >= 0) {
+        close(f->watch);
+    }
+#endif
+    dsv_free(f->buf);
+    dsv_free(f->fields);
+    dsv_free(f->lens);
+    dsv_free(f->flags);
+    dsv_free(f->path);
+    dsv_free(f);
+}
+
+/* }}} REGION: DSV FOLLOW */
+
+/* {{{ REGION: DSV AGGREGATE */
+
+#define AGG_SLOTS 1024          /* initial table size, a power of two */
+#define AGG_PART_BITS 4
+#define AGG_PARTS (1 << AGG_PART_BITS)
+#define AGG_MAX_DEPTH 15        /* partitions take 4 more bits per level */
+
+/* a group in the arena: the record count, nvalues ua_dsv_agg_value and
+ * keylen characters of key, which are the key fields as a size_t length
+ * followed by the characters */
+struct agg_group {
+    uint64_t count;
+    size_t keylen;
+};
+
+struct agg_slot {
+    uint64_t hash;
+    struct agg_group* group;    /* NULL in an empty slot */
+};
+
+struct ua_dsv_agg {
+    char quote;
+    size_t* keys;
+    size_t nkeys;
+    size_t* values;
+    size_t nvalues;
+    size_t budget;
+    char* tmpdir;
+    unsigned depth;             /* partitions of partitions... */
+
+    struct ua_dsv_arena* arena;
+    struct agg_slot* slots;
+    size_t nslots;
+    size_t ngroups;
+    size_t used;                /* bytes of the table and the arena */
+    size_t header;              /* bytes of a group before its key */
+
+    FILE* parts[AGG_PARTS];     /* records of groups not in the table */
+    int spilling;
+    uint64_t spilled;
+
+    /* the record being added */
+    char* key;
+    size_t key_cap;
+    double* nums;
+
+    /* the fields collected by ua_dsv_agg_on_field */
+    size_t ncols;               /* 1 + the highest column used */
+    unsigned char* wanted;
+    size_t* col_off;
+    const char** cols;
+    size_t* lens;
+    size_t col;
+    char* chars;
+    size_t chars_len;
+    size_t chars_cap;
+
+    int error;                  /* errno of the first failure, or 0 */
+};
+
+static uint64_t agg_hash(const char* s, size_t n) {
+    uint64_t h = 0x9e3779b97f4a7c15u ^ n;
+    uint64_t w;
+
+    for (; n >= 8; s += 8, n -= 8) {
+        memcpy(&w, s, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdu;
+        h ^= h >> 29;
+    }
+    if (n > 0) {
+        w = 0;
+        memcpy(&w, s, n);
+        h = (h ^ w) * 0xff51afd7ed558ccdu;
+        h ^= h >> 29;
+    }
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53u;
+    h ^= h >> 33;
+    return h;
+}
+
+/* the number in @param len characters of @param s, or NAN */
+static double agg_number(const char* s, size_t len) {
+    char tmp[64];
+    char* end;
+    double value;
+
+    if (len == 0 || len >= sizeof(tmp)) {
+        return NAN;
+    }
+    memcpy(tmp, s, len);
+    tmp[len] = '\0';
+    value = strtod(tmp, &end);
+    return *end == '\0' ? value : NAN;
+}
+
+static struct ua_dsv_agg_value* agg_values(struct agg_group* g) {
+    return (struct ua_dsv_agg_value*)(g + 1);
+}
+
+static int agg_reserve_key(struct ua_dsv_agg* a, size_t n) {
+    if (n > a->key_cap) {
+        size_t cap = a->key_cap ? a->key_cap : 64;
+        char* grown;
+        while (cap < n) {
+            cap *= 2;
+        }
+        grown = dsv_realloc(a->key, cap);
+        if (!grown) {
+            errno = ENOMEM;
+            return FALSE;
+        }
+        a->key = grown;
+        a->key_cap = cap;
+    }
+    return TRUE;
+}
+
+static struct ua_dsv_agg* agg_create(char quote, const size_t* keys,
+                                     size_t nkeys, const size_t* values,
+                                     size_t nvalues, size_t budget,
+                                     const char* tmpdir, unsigned depth) {
+    struct ua_dsv_agg* a = dsv_calloc(1, sizeof(*a));
+    size_t i;
+
+    if (!a) {
+        return NULL;
+    }
+    a->quote = quote;
+    a->nkeys = nkeys;
+    a->nvalues = nvalues;
+    a->budget = budget;
+    a->depth = depth;
+    a->nslots = AGG_SLOTS;
+    a->header = DSV_ROUND(sizeof(struct agg_group) +
+                          nvalues * sizeof(struct ua_dsv_agg_value));
+    a->keys = dsv_calloc(nkeys + 1, sizeof(size_t));
+    a->values = dsv_calloc(nvalues + 1, sizeof(size_t));
+    a->nums = dsv_calloc(nvalues + 1, sizeof(double));
+    a->tmpdir = dsv_calloc(strlen(tmpdir) + 1, 1);
+    a->slots = dsv_calloc(a->nslots, sizeof(struct agg_slot));
+    a->arena = ua_dsv_arena_new(0);
+    if (!a->keys || !a->values || !a->nums || !a->tmpdir || !a->slots ||
+        !a->arena) {
+        ua_dsv_agg_free(a);
+        return NULL;
+    }
+    memcpy(a->tmpdir, tmpdir, strlen(tmpdir));
+    a->used = a->nslots * sizeof(struct agg_slot);
+
+    for (i = 0; i < nkeys; ++i) {
+        a->keys[i] = keys[i];
+        a->ncols = keys[i] + 1 > a->ncols ? keys[i] + 1 : a->ncols;
+    }
+    for (i = 0; i < nvalues; ++i) {
+        a->values[i] = values[i];
+        a->ncols = values[i] + 1 > a->ncols ? values[i] + 1 : a->ncols;
+    }
+    return a;
+}
+
+/* double the table */
+static int agg_grow(struct ua_dsv_agg* a) {
+    size_t nslots = a->nslots * 2;
+    size_t mask = nslots - 1;
+    struct agg_slot* slots = dsv_calloc(nslots, sizeof(*slots));
+    size_t i;
+
+    if (!slots) {
+        errno = ENOMEM;
+        return FALSE;
+    }
+    for (i = 0; i < a->nslots; ++i) {
+        struct agg_slot* s = &a->slots[i];
+        size_t j;
+        if (!s->group) {
+            continue;
+        }
+        for (j = s->hash & mask; slots[j].group; j = (j + 1) & mask) {
+        }
+        slots[j] = *s;
+    }
+    dsv_free(a->slots);
+    a->slots = slots;
+    a->used += a->nslots * sizeof(*slots);
+    a->nslots = nslots;
+    return TRUE;
+}
+
+/* a temporary file that is removed when it is closed */
+static FILE* agg_tmpfile(const struct ua_dsv_agg* a) {
+    static const char name[] = "/uadsvaggXXXXXX";
+    char* path = dsv_calloc(strlen(a->tmpdir) + sizeof(name), 1);
+    FILE* f = NULL;
+    int fd;
+
+    if (!path) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    strcat(strcpy(path, a->tmpdir), name);
+    fd = mkstemp(path);
+    if (fd >= 0) {
+        unlink(path);
+        f = fdopen(fd, "w+b");
+        if (!f) {
+            int saved = errno;
+            close(fd);
+            errno = saved;
+        }
+    }
+    dsv_free(path);
+    return f;
+}
+
+/* write a record of a group that is not in the table to its partition, as
+ * the key length, the key and the numbers */
+static int agg_spill(struct ua_dsv_agg* a, const char* key, size_t keylen,
+                     uint64_t hash, const double* nums) {
+    unsigned shift = 64 - AGG_PART_BITS * (a->depth + 1);
+    FILE** part = &a->parts[(hash >> shift) & (AGG_PARTS - 1)];
+
+    if (!*part) {
+        *part = agg_tmpfile(a);
+        if (!*part) {
+            return FALSE;
+        }
+    }
+    if (fwrite(&keylen, sizeof(keylen), 1, *part) != 1 ||
+        fwrite(key, 1, keylen, *part) != keylen ||
+        fwrite(nums, sizeof(double), a->nvalues, *part) != a->nvalues) {
+        return FALSE;
+    }
+    a->spilled += 1;
+    return TRUE;
+}
+
+/* add a record with the encoded @param key and the numbers of its value
+ * columns, NAN where there is none */
+static int agg_record(struct ua_dsv_agg* a, const char* key, size_t keylen,
+                      const double* nums) {
+    uint64_t hash = agg_hash(key, keylen);
+    size_t mask = a->nslots - 1;
+    size_t i = hash & mask;
+    size_t size = a->header + keylen;
+    struct ua_dsv_agg_value* v;
+    struct agg_group* g;
+    size_t k;
+
+    for (; a->slots[i].group; i = (i + 1) & mask) {
+        g = a->slots[i].group;
+        /* without key columns there is no key, nor a buffer for one */
+        if (a->slots[i].hash == hash && g->keylen == keylen &&
+            (keylen == 0 || !memcmp((char*)g + a->header, key, keylen))) {
+            break;
+        }
+    }
+    g = a->slots[i].group;
+
+    if (!g) {
+        /* a new group, if it fits; keys that cannot be split any further
+         * stay in memory regardless */
+        size_t grow = (a->ngroups + 1) * 2 > a->nslots
+                    ? a->nslots * 2 * sizeof(struct agg_slot) : 0;
+        if (!a->spilling && a->budget && a->ngroups > 0 &&
+            a->depth < AGG_MAX_DEPTH &&
+            a->used + size + DSV_ALIGN + grow > a->budget) {
+            a->spilling = TRUE;
+        }
+        if (a->spilling && a->depth < AGG_MAX_DEPTH) {
+            return agg_spill(a, key, keylen, hash, nums);
+        }
+        g = arena_alloc(a->arena, size);
+        if (!g) {
+            errno = ENOMEM;
+            return FALSE;
+        }
+        g->keylen = keylen;
+        if (keylen > 0) {
+            memcpy((char*)g + a->header, key, keylen);
+        }
+        a->slots[i].hash = hash;
+        a->slots[i].group = g;
+        a->ngroups += 1;
+        a->used += size + DSV_ALIGN;
+        if (grow && !agg_grow(a)) {
+            return FALSE;
+        }
+    }
+
+    g->count += 1;
+    v = agg_values(g);
+    for (k = 0; k < a->nvalues; ++k) {
+        double x = nums[k];
+        if (isnan(x)) {
+            continue;
+        }
+        if (v[k].count == 0 || x < v[k].min) {
+            v[k].min = x;
+        }
+        if (v[k].count == 0 || x > v[k].max) {
+            v[k].max = x;
+        }
+        v[k].sum += x;
+        v[k].count += 1;
+    }
+    return TRUE;
+}
+
+struct ua_dsv_agg* ua_dsv_agg_new(char quote, const size_t* keys,
+                                  size_t nkeys, const size_t* values,
+                                  size_t nvalues, size_t budget,
+                                  const char* tmpdir) {
+    struct ua_dsv_agg* a;
+
+    if (!tmpdir) {
+        tmpdir = getenv("TMPDIR");
+    }
+    if (!tmpdir || !*tmpdir) {
+        tmpdir = "/tmp";
+    }
+    a = agg_create(quote, keys, nkeys, values, nvalues, budget, tmpdir, 0);
+    if (!a) {
+        return NULL;
+    }
+    a->wanted = dsv_calloc(a->ncols + 1, 1);
+    a->col_off = dsv_calloc(a->ncols + 1, sizeof(size_t));
+    a->cols = dsv_calloc(a->ncols + 1, sizeof(const char*));
+    a->lens = dsv_calloc(a->ncols + 1, sizeof(size_t));
+    if (!a->wanted || !a->col_off || !a->cols || !a->lens) {
+        ua_dsv_agg_free(a);
+        return NULL;
+    }
+    for (nkeys = 0; nkeys < a->nkeys; ++nkeys) {
+        a->wanted[a->keys[nkeys]] = TRUE;
+    }
+    for (nvalues = 0; nvalues < a->nvalues; ++nvalues) {
+        a->wanted[a->values[nvalues]] = TRUE;
+    }
+    return a;
+}
+
+int ua_dsv_agg_add(struct ua_dsv_agg* a, const char* const* fields,
+                   const size_t* lens, size_t nfields) {
+    size_t keylen = 0;
+    size_t i;
+
+    if (a->error) {
+        errno = a->error;
+        return FALSE;
+    }
+    for (i = 0; i < a->nkeys; ++i) {
+        size_t c = a->keys[i];
+        size_t n = c < nfields ? lens[c] : 0;
+        if (!agg_reserve_key(a, keylen + sizeof(n) + n)) {
+            a->error = errno;
+            return FALSE;
+        }
+        memcpy(a->key + keylen, &n, sizeof(n));
+        if (n > 0) {
+            memcpy(a->key + keylen + sizeof(n), fields[c], n);
+        }
+        keylen += sizeof(n) + n;
+    }
+    for (i = 0; i < a->nvalues; ++i) {
+        size_t c = a->values[i];
+        a->nums[i] = c < nfields ? agg_number(fields[c], lens[c]) : NAN;
+    }
+    if (!agg_record(a, a->key, keylen, a->nums)) {
+        a->error = errno ? errno : EIO;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+int ua_dsv_agg_on_field(void* user, const char* field, size_t len,
+                        int flags) {
+    struct ua_dsv_agg* a = user;
+    size_t col = a->col++;
+
+    if (col >= a->ncols || !a->wanted[col]) {
+        return TRUE;
+    }
+    if (a->chars_len + len + 1 > a->chars_cap) {
+        size_t cap = a->chars_cap ? a->chars_cap : 256;
+        char* grown;
+        while (cap < a->chars_len + len + 1) {
+            cap *= 2;
+        }
+        grown = dsv_realloc(a->chars, cap);
+        if (!grown) {
+            a->error = errno = ENOMEM;
+            return FALSE;
+        }
+        a->chars = grown;
+        a->chars_cap = cap;
+    }
+    if (flags & UA_DSV_FIELD_UNESCAPE) {
+        len = ua_dsv_unescape_u8(field, len, a->quote,
+                                 a->chars + a->chars_len);
+    } else {
+        memcpy(a->chars + a->chars_len, field, len);
+    }
+    a->col_off[col] = a->chars_len;
+    a->lens[col] = len;
+    a->chars_len += len;
+    return TRUE;
+}
+
+int ua_dsv_agg_on_record(void* user, const char* record, size_t len,
+                         size_t nfields) {
+    struct ua_dsv_agg* a = user;
+    size_t n = nfields < a->ncols ? nfields : a->ncols;
+    size_t i;
+
+    (void)record;
+    (void)len;
+    /* the characters have stopped moving */
+    for (i = 0; i < n; ++i) {
+        a->cols[i] = a->chars + a->col_off[i];
+    }
+    a->col = 0;
+    a->chars_len = 0;
+    return ua_dsv_agg_add(a, a->cols, a->lens, n);
+}
+
+static int agg_report(struct ua_dsv_agg* a, ua_dsv_group_fn fn, void* user,
+                      int* stopped);
+
+/* aggregate the records spilled to @param part and report their groups */
+static int agg_finish_part(struct ua_dsv_agg* a, FILE* part,
+                           ua_dsv_group_fn fn, void* user, int* stopped) {
+    struct ua_dsv_agg* sub;
+    size_t keylen;
+    int ok = TRUE;
+
+    rewind(part);
+    sub = agg_create(a->quote, a->keys, a->nkeys, a->values, a->nvalues,
+                     a->budget, a->tmpdir, a->depth + 1);
+    if (!sub) {
+        errno = ENOMEM;
+        return FALSE;
+    }
+    while (ok && fread(&keylen, sizeof(keylen), 1, part) == 1) {
+        if (!agg_reserve_key(sub, keylen + 1)) {
+            ok = FALSE;
+        } else if (fread(sub->key, 1, keylen, part) != keylen ||
+                   fread(sub->nums, sizeof(double), a->nvalues,
+                         part) != a->nvalues) {
+            errno = EIO;
+            ok = FALSE;
+        } else {
+            ok = agg_record(sub, sub->key, keylen, sub->nums);
+        }
+    }
+    if (ok && ferror(part)) {
+        errno = EIO;
+        ok = FALSE;
+    }
+    ok = ok && agg_report(sub, fn, user, stopped);
+    if (!ok) {
+        int saved = errno;
+        ua_dsv_agg_free(sub);
+        errno = saved;
+    } else {
+        ua_dsv_agg_free(sub);
+    }
+    return ok;
+}
+
+/* report the groups in the table, then those of each partition */
+static int agg_report(struct ua_dsv_agg* a, ua_dsv_group_fn fn, void* user,
+                      int* stopped) {
+    const char** keys = dsv_calloc(a->nkeys + 1, sizeof(*keys));
+    size_t* lens = dsv_calloc(a->nkeys + 1, sizeof(*lens));
+    size_t i, k;
+    int ok = TRUE;
+
+    if (!keys || !lens) {
+        dsv_free(keys);
+        dsv_free(lens);
+        errno = ENOMEM;
+        return FALSE;
+    }
+    for (i = 0; i < a->nslots && !*stopped; ++i) {
+        struct agg_group* g = a->slots[i].group;
+        const char* p;
+        if (!g) {
+            continue;
+        }
+        p = (const char*)g + a->header;
+        for (k = 0; k < a->nkeys; ++k) {
+            memcpy(&lens[k], p, sizeof(size_t));
+            keys[k] = p + sizeof(size_t);
+            p += sizeof(size_t) + lens[k];
+        }
+        if (!fn(user, keys, lens, a->nkeys, g->count, agg_values(g),
+                a->nvalues)) {
+            *stopped = TRUE;
+        }
+    }
+    dsv_free(keys);
+    dsv_free(lens);
+
+    for (i = 0; i < AGG_PARTS && ok; ++i) {
+        if (a->parts[i] && !*stopped) {
+            int saved;
+            ok = agg_finish_part(a, a->parts[i], fn, user, stopped);
+            saved = errno;
+            fclose(a->parts[i]);
+            a->parts[i] = NULL;
+            errno = saved;
+        }
+    }
+    return ok;
+}
+
+int ua_dsv_agg_finish(struct ua_dsv_agg* a, ua_dsv_group_fn on_group,
+                      void* user) {
+    int stopped = FALSE;
+
+    if (a->error) {
+        errno = a->error;
+        return FALSE;
+    }
+    if (!agg_report(a, on_group, user, &stopped)) {
+        a->error = errno;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+uint64_t ua_dsv_agg_spilled(const struct ua_dsv_agg* a) {
+    return a->spilled;
+}
+
+void ua_dsv_agg_free(struct ua_dsv_agg* a) {
+    size_t i;
+
+    if (!a) {
+        return;
+    }
+    for (i = 0; i < AGG_PARTS; ++i) {
+        if (a->parts[i]) {
+            fclose(a->parts[i]);
+        }
+    }
+    if (a->arena) {
+        ua_dsv_arena_free(a->arena);
+    }
+    dsv_free(a->keys);
+    dsv_free(a->values);
+    dsv_free(a->tmpdir);
+    dsv_free(a->slots);
+    dsv_free(a->key);
+    dsv_free(a->nums);
+    dsv_free(a->wanted);
+    dsv_free(a->col_off);
+    dsv_free(a->cols);
+    dsv_free(a->lens);
+    dsv_free(a->chars);
+    dsv_free(a);
+}
+
+/* }}} REGION: DSV AGGREGATE */
+
+/* {{{ REGION: DSV PROFILE */
+
+#define PROFILE_HLL_BITS 12
+#define PROFILE_HLL_M (1u << PROFILE_HLL_BITS)
+
+/* a value kept by a profile, with room to replace it */
+struct profile_value {
+    char* s;                    /* NULL until there is one */
+    size_t len;
+    size_t cap;
+};
+
+struct profile_column {
+    uint64_t count;
+    uint64_t empty;
+    uint64_t numeric;
+    size_t shortest;
+    size_t longest;
+    struct profile_value min;
+    struct profile_value max;
+    struct profile_value min_number;
+    struct profile_value max_number;
+    unsigned char hll[PROFILE_HLL_M];
+};
+
+struct ua_dsv_profile {
+    char quote;
+    uint64_t records;
+    struct profile_column** columns;
+    size_t ncolumns;
+    size_t columns_cap;
+
+    /* the field being profiled by ua_dsv_profile_on_field */
+    size_t col;
+    char* chars;
+    size_t chars_cap;
+
+    int error;                  /* errno of the first failure, or 0 */
+};
+
+/* true for a field of digits only, as isnumeric in gor2csv.c */
+static int profile_isnumeric(const char* s, size_t len) {
+    size_t i;
+    for (i = 0; i < len; ++i) {
+        if (s[i] < '0' || s[i] > '9') {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* compare two fields byte by byte, a prefix first */
+static int profile_compare(const char* a, size_t alen, const char* b,
+                           size_t blen) {
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    if (c != 0) {
+        return c;
+    }
+    return alen < blen ? -1 : alen > blen;
+}
+
+/* compare two numeric fields as the whole numbers they spell */
+static int profile_compare_number(const char* a, size_t alen, const char* b,
+                                  size_t blen) {
+    while (alen > 1 && *a == '0') {
+        ++a;
+        --alen;
+    }
+    while (blen > 1 && *b == '0') {
+        ++b;
+        --blen;
+    }
+    if (alen != blen) {
+        return alen < blen ? -1 : 1;
+    }
+    return memcmp(a, b, alen);
+}
+
+static int profile_keep(struct profile_value* v, const char* s, size_t len) {
+    if (len > v->cap || !v->s) {
+        size_t cap = len > 16 ? len : 16;
+        char* grown = dsv_realloc(v->s, cap);
+        if (!grown) {
+            errno = ENOMEM;
+            return FALSE;
+        }
+        v->s = grown;
+        v->cap = cap;
+    }
+    memcpy(v->s, s, len);
+    v->len = len;
+    return TRUE;
+}
+
+/* the column @param col, added if the profile has not seen it yet */
+static struct profile_column* profile_column(struct ua_dsv_profile* p,
+                                             size_t col) {
+    while (col >= p->ncolumns) {
+        struct profile_column* c;
+        if (p->ncolumns == p->columns_cap) {
+            size_t cap = p->columns_cap ? p->columns_cap * 2 : 16;
+            struct profile_column** grown =
+                dsv_realloc(p->columns, cap * sizeof(*grown));
+            if (!grown) {
+                errno = ENOMEM;
+                return NULL;
+            }
+            p->columns = grown;
+            p->columns_cap = cap;
+        }
+        c = dsv_calloc(1, sizeof(*c));
+        if (!c) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        c->shortest = (size_t)-1;
+        p->columns[p->ncolumns++] = c;
+    }
+    return p->columns[col];
+}
+
+static void profile_hll_add(unsigned char* hll, uint64_t hash) {
+    uint64_t w = hash << PROFILE_HLL_BITS;
+    unsigned char rank = 1;
+
+    while (rank <= 64 - PROFILE_HLL_BITS && !(w & ((uint64_t)1 << 63))) {
+        w <<= 1;
+        rank += 1;
+    }
+    if (rank > hll[hash >> (64 - PROFILE_HLL_BITS)]) {
+        hll[hash >> (64 - PROFILE_HLL_BITS)] = rank;
+    }
+}
+
+/* the natural logarithm of @param x >= 1, so that the library does not
+ * need libm: x = 2^k * y with 1 <= y < 2, and log(y) = 2 atanh(t) with
+ * t = (y-1)/(y+1) <= 1/3, whose series is exact to a double in 20 terms */
+static double profile_log(double x) {
+    double t, t2, term, sum = 0;
+    int k = 0;
+    int j;
+
+    while (x >= 2) {
+        x /= 2;
+        k += 1;
+    }
+    t = (x - 1) / (x + 1);
+    t2 = t * t;
+    term = t;
+    for (j = 1; j < 40; j += 2) {
+        sum += term / j;
+        term *= t2;
+    }
+    return k * 0.69314718055994530942 + 2 * sum;
+}
+
+/* the HyperLogLog estimate, with linear counting for few values */
+static double profile_hll_estimate(const unsigned char* hll) {
+    double m = PROFILE_HLL_M;
+    double sum = 0;
+    size_t zeros = 0;
+    size_t i;
+    double e;
+
+    for (i = 0; i < PROFILE_HLL_M; ++i) {
+        /* rank is at most 65 - PROFILE_HLL_BITS */
+        sum += 1.0 / (double)((uint64_t)1 << hll[i]);
+        zeros += hll[i] == 0;
+    }
+    e = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    if (e <= 2.5 * m && zeros > 0) {
+        e = m * profile_log(m / (double)zeros);
+    }
+    return e;
+}
+
+static int profile_field(struct ua_dsv_profile* p, size_t col,
+                         const char* s, size_t len) {
+    struct profile_column* c = profile_column(p, col);
+
+    if (!c) {
+        return FALSE;
+    }
+    c->count += 1;
+    if (len < c->shortest) {
+        c->shortest = len;
+    }
+    if (len > c->longest) {
+        c->longest = len;
+    }
+    profile_hll_add(c->hll, agg_hash(s, len));
+    if (len == 0) {
+        c->empty += 1;
+        return TRUE;
+    }
+    if ((!c->min.s || profile_compare(s, len, c->min.s, c->min.len) < 0) &&
+        !profile_keep(&c->min, s, len)) {
+        return FALSE;
+    }
+    if ((!c->max.s || profile_compare(s, len, c->max.s, c->max.len) > 0) &&
+        !profile_keep(&c->max, s, len)) {
+        return FALSE;
+    }
+    if (!profile_isnumeric(s, len)) {
+        return TRUE;
+    }
+    c->numeric += 1;
+    if ((!c->min_number.s ||
+         profile_compare_number(s, len, c->min_number.s,
+                                c->min_number.len) < 0) &&
+        !profile_keep(&c->min_number, s, len)) {
+        return FALSE;
+    }
+    if ((!c->max_number.s ||
+         profile_compare_number(s, len, c->max_number.s,
+                                c->max_number.len) > 0) &&
+        !profile_keep(&c->max_number, s, len)) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+struct ua_dsv_profile* ua_dsv_profile_new(char quote) {
+    struct ua_dsv_profile* p = dsv_calloc(1, sizeof(*p));
+    if (p) {
+        p->quote = quote;
+    }
+    return p;
+}
+
+int ua_dsv_profile_add(struct ua_dsv_profile* p, const char* const* fields,
+                       const size_t* lens, size_t nfields) {
+    size_t i;
+
+    if (p->error) {
+        errno = p->error;
+        return FALSE;
+    }
+    for (i = 0; i < nfields; ++i) {
+        if (!profile_field(p, i, fields[i], lens[i])) {
+            p->error = errno;
+            return FALSE;
+        }
+    }
+    p->records += 1;
+    return TRUE;
+}
+
+int ua_dsv_profile_on_field(void* user, const char* field, size_t len,
+                            int flags) {
+    struct ua_dsv_profile* p = user;
+
+    if (p->error) {
+        errno = p->error;
+        return FALSE;
+    }
+    if (flags & UA_DSV_FIELD_UNESCAPE) {
+        if (len + 1 > p->chars_cap) {
+            char* grown = dsv_realloc(p->chars, len + 1);
+            if (!grown) {
+                p->error = errno = ENOMEM;
+                return FALSE;
+            }
+            p->chars = grown;
+            p->chars_cap = len + 1;
+        }
+        len = ua_dsv_unescape_u8(field, len, p->quote, p->chars);
+        field = p->chars;
+    }
+    if (!profile_field(p, p->col++, field, len)) {
+        p->error = errno;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+int ua_dsv_profile_on_record(void* user, const char* record, size_t len,
+                             size_t nfields) {
+    struct ua_dsv_profile* p = user;
+
+    (void)record;
+    (void)len;
+    (void)nfields;
+    p->col = 0;
+    if (p->error) {
+        errno = p->error;
+        return FALSE;
+    }
+    p->records += 1;
+    return TRUE;
+}
+
+int ua_dsv_profile_merge(struct ua_dsv_profile* p,
+                         const struct ua_dsv_profile* other) {
+    size_t i, j;
+
+    if (p->error) {
+        errno = p->error;
+        return FALSE;
+    }
+    for (i = 0; i < other->ncolumns; ++i) {
+        const struct profile_column* o = other->columns[i];
+        struct profile_column* c = profile_column(p, i);
+
+        if (!c) {
+            return FALSE;
+        }
+        c->count += o->count;
+        c->empty += o->empty;
+        c->numeric += o->numeric;
+        if (o->shortest < c->shortest) {
+            c->shortest = o->shortest;
+        }
+        if (o->longest > c->longest) {
+            c->longest = o->longest;
+        }
+        for (j = 0; j < PROFILE_HLL_M; ++j) {
+            if (o->hll[j] > c->hll[j]) {
+                c->hll[j] = o->hll[j];
+            }
+        }
+        if (o->min.s && (!c->min.s || profile_compare(o->min.s, o->min.len,
+                                                       c->min.s,
+                                                       c->min.len) < 0) &&
+            !profile_keep(&c->min, o->min.s, o->min.len)) {
+            return FALSE;
+        }
+        if (o->max.s && (!c->max.s || profile_compare(o->max.s, o->max.len,
+                                                       c->max.s,
+                                                       c->max.len) > 0) &&
+            !profile_keep(&c->max, o->max.s, o->max.len)) {
+            return FALSE;
+        }
+        if (o->min_number.s &&
+            (!c->min_number.s ||
+             profile_compare_number(o->min_number.s, o->min_number.len,
+                                    c->min_number.s,
+                                    c->min_number.len) < 0) &&
+            !profile_keep(&c->min_number, o->min_number.s,
+                          o->min_number.len)) {
+            return FALSE;
+        }
+        if (o->max_number.s &&
+            (!c->max_number.s ||
+             profile_compare_number(o->max_number.s, o->max_number.len,
+                                    c->max_number.s,
+                                    c->max_number.len) > 0) &&
+            !profile_keep(&c->max_number, o->max_number.s,
+                          o->max_number.len)) {
+            return FALSE;
+        }
+    }
+    p->records += other->records;
+    return TRUE;
+}
+
+uint64_t ua_dsv_profile_records(const struct ua_dsv_profile* p) {
+    return p->records;
+}
+
+size_t ua_dsv_profile_columns(const struct ua_dsv_profile* p) {
+    return p->ncolumns;
+}
+
+int ua_dsv_profile_column(const struct ua_dsv_profile* p, size_t column,
+                          struct ua_dsv_column_profile* out) {
+    const struct profile_column* c;
+
+    if (column >= p->ncolumns) {
+        errno = EINVAL;
+        return FALSE;
+    }
+    c = p->columns[column];
+    out->count = c->count;
+    out->nulls = p->records - c->count;
+    out->empty = c->empty;
+    out->numeric = c->numeric;
+    out->shortest = c->count ? c->shortest : 0;
+    out->longest = c->longest;
+    out->min = c->min.s;
+    out->min_len = c->min.len;
+    out->max = c->max.s;
+    out->max_len = c->max.len;
+    out->min_number = c->min_number.s;
+    out->min_number_len = c->min_number.len;
+    out->max_number = c->max_number.s;
+    out->max_number_len = c->max_number.len;
+    out->distinct = profile_hll_estimate(c->hll);
+    return TRUE;
+}
+
+void ua_dsv_profile_free(struct ua_dsv_profile* p) {
+    size_t i;
+
+    if (!p) {
+        return;
+    }
+    for (i = 0; i < p->ncolumns; ++i) {
+        struct profile_column* c = p->columns[i];
+        dsv_free(c->min.s);
+        dsv_free(c->max.s);
+        dsv_free(c->min_number.s);
+        dsv_free(c->max_number.s);
+        dsv_free(c);
+    }
+    dsv_free(p->columns);
+    dsv_free(p->chars);
+    dsv_free(p);
+}
+
+/* }}} REGION: DSV PROFILE */
+
+/* {{{ REGION: DSV CHECK */
+
+struct check_state {
+    const char* end;            /* of the buffer */
+    char quote;
+    size_t nfields;             /* expected, 0 until known */
+    size_t max_len;
+    ua_dsv_check_fn fn;
+    void* user;
+    uint64_t line;
+
+    /* the record being checked */
+    int problems;
+    char* value;                /* long values, unescaped to measure them */
+    size_t value_cap;
+
+    const char* resume;         /* after an unterminated quote's line */
+    int stopped;                /* by the callback */
+};
+
+static int check_field(void* user, const char* field, size_t len,
+                       int flags) {
+    struct check_state* s = user;
+
+    if (s->max_len && len > s->max_len) {
+        size_t n = len;
+        if (flags & UA_DSV_FIELD_UNESCAPE) {
+            if (len + 1 > s->value_cap) {
+                char* grown = dsv_realloc(s->value, len + 1);
+                if (grown) {
+                    s->value = grown;
+                    s->value_cap = len + 1;
+                }
+            }
+            /* without room, the span is the nearest bound there is */
+            if (len + 1 <= s->value_cap) {
+                n = ua_dsv_unescape_u8(field, len, s->quote, s->value);
+            }
+        }
+        if (n > s->max_len) {
+            s->problems |= UA_DSV_BAD_LENGTH;
+        }
+    }
+    /* a quoted field that closed ends right before its quote, but for the
+     * trailing spaces left out of the span */
+    if (flags & UA_DSV_FIELD_QUOTED) {
+        const char* close = field + len;
+        while (close < s->end && isws(*close)) {
+            ++close;
+        }
+        if (close >= s->end || *close != s->quote) {
+            s->problems |= UA_DSV_BAD_QUOTE;
+        }
+    }
+    return TRUE;
+}
+
+static int check_record(void* user, const char* record, size_t len,
+                        size_t nfields) {
+    struct check_state* s = user;
+    const char* end = record + len;
+    const char* nl = record;
+    uint64_t line = s->line;
+    int problems = s->problems;
+    size_t eol = 0;
+
+    s->problems = 0;
+    if (problems & UA_DSV_BAD_QUOTE) {
+        /* only the first line of it is the bad record */
+        while (nl < s->end && *nl != '\n' && *nl != '\r') {
+            ++nl;
+        }
+        if (nl < s->end) {
+            nl += *nl == '\r' && nl + 1 < s->end && nl[1] == '\n' ? 2 : 1;
+        }
+        s->resume = nl;
+        s->line += 1;
+        /* what it took from the lines after it does not count */
+        s->stopped = !s->fn(s->user, record, (size_t)(nl - record), line,
+                            nfields, UA_DSV_BAD_QUOTE);
+        return FALSE;
+    }
+
+    if (end < s->end && (*end == '\r' || *end == '\n')) {
+        eol = *end == '\r' && end + 1 < s->end && end[1] == '\n' ? 2 : 1;
+        s->line += 1;
+    }
+    while ((nl = memchr(nl, '\n', (size_t)(end - nl))) != NULL) {
+        s->line += 1;
+        ++nl;
+    }
+    if (s->nfields == 0) {
+        s->nfields = nfields;
+    }
+    if (nfields == 0 || nfields != s->nfields) {
+        problems |= UA_DSV_BAD_FIELDS;
+    }
+    if (!s->fn(s->user, record, len + eol, line, nfields, problems)) {
+        s->stopped = TRUE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+size_t ua_dsv_check_u8(const char* buffer, size_t len, char quote,
+                       char delim, size_t nfields, size_t max_len,
+                       ua_dsv_check_fn on_record, void* user) {
+    struct check_state s;
+    size_t pos = 0;
+
+    memset(&s, 0, sizeof(s));
+    s.end = buffer + len;
+    s.quote = quote;
+    s.nfields = nfields;
+    s.max_len = max_len;
+    s.fn = on_record;
+    s.user = user;
+    s.line = 1;
+
+    while (pos < len) {
+        size_t used;
+        s.resume = NULL;
+        used = ua_dsv_scan_u8(buffer + pos, len - pos, quote, delim,
+                              check_field, check_record, &s);
+        if (s.resume) {
+            pos = (size_t)(s.resume - buffer);
+        } else {
+            pos += used;
+        }
+        /* the end, a NIL, or the callback said so */
+        if (s.stopped || !s.resume) {
+            break;
+        }
+    }
+    dsv_free(s.value);
+    return pos;
+}
+
+/* }}} REGION: DSV CHECK */
+
+/* {{{ REGION: DSV BINARY */
+
+/* The layout is in gua2csv.h. Integers are read and written a byte at a
+ * time, so streams need no alignment and read the same on any host. */
+static const char bin_magic[8] = {'U','A','D','S','V','B','R','1'};
+
+static void bin_put32(char* p, uint32_t v) {
+    p[0] = (char)(v & 0xff);
+    p[1] = (char)((v >> 8) & 0xff);
+    p[2] = (char)((v >> 16) & 0xff);
+    p[3] = (char)((v >> 24) & 0xff);
+}
+
+static uint32_t bin_get32(const char* p) {
+    const unsigned char* u = (const unsigned char*)p;
+    return (uint32_t)u[0] | (uint32_t)u[1] << 8 | (uint32_t)u[2] << 16 |
+           (uint32_t)u[3] << 24;
+}
+
+void ua_dsv_bin_row_init(struct ua_dsv_bin_row* row) {
+    memset(row, 0, sizeof(*row));
+}
+
+void ua_dsv_bin_row_free(struct ua_dsv_bin_row* row) {
+    dsv_free(row->fields);
+    dsv_free(row->lens);
+    memset(row, 0, sizeof(*row));
+}
+
+size_t ua_dsv_bin_put_row(char* out, const char* const* fields,
+                          const size_t* lens, size_t nfields) {
+    size_t nulls = nfields / 8 + (nfields % 8 != 0);
+    uint64_t size = 4 + (uint64_t)nulls;
+    char* p;
+    size_t i;
+
+    if ((uint64_t)nfields > UINT32_MAX) {
+        errno = EOVERFLOW;
+        return 0;
+    }
+    for (i = 0; i < nfields; ++i) {
+        if (fields[i]) {
+            size += 4 + (uint64_t)lens[i];
+        }
+    }
+    /* a field too large is caught by the size of its row */
+    if (size > UINT32_MAX || size + 4 > SIZE_MAX) {
+        errno = EOVERFLOW;
+        return 0;
+    }
+    if (!out) {
+        return (size_t)size + 4;
+    }
+
+    bin_put32(out, (uint32_t)size);
+    bin_put32(out + 4, (uint32_t)nfields);
+    memset(out + 8, 0, nulls);
+    p = out + 8 + nulls;
+    for (i = 0; i < nfields; ++i) {
+        if (!fields[i]) {
+            out[8 + i/8] = (char)(out[8 + i/8] | 1 << (i % 8));
+            continue;
+        }
+        bin_put32(p, (uint32_t)lens[i]);
+        memcpy(p + 4, fields[i], lens[i]);
+        p += 4 + lens[i];
+    }
+    return (size_t)size + 4;
+}
+
+size_t ua_dsv_bin_put_header(char* out, const char* const* names,
+                             const size_t* lens, size_t ncolumns) {
+    size_t n = ua_dsv_bin_put_row(out ? out + sizeof(bin_magic) : NULL,
+                                  names, lens, ncolumns);
+    if (n == 0) {
+        return 0;
+    }
+    if (out) {
+        memcpy(out, bin_magic, sizeof(bin_magic));
+    }
+    return sizeof(bin_magic) + n;
+}
+
+/* read the row at @param data, of at most @param avail bytes, into
+ * @param row; returns its size, or 0 if it is not a whole row or out of
+ * memory */
+static size_t bin_read(const char* data, size_t avail,
+                       struct ua_dsv_bin_row* row) {
+    const char* p;
+    const char* end;
+    size_t size, n, nulls, i;
+
+    row->nfields = 0;
+    if (avail < 8) {
+        errno = EINVAL;
+        return 0;
+    }
+    size = bin_get32(data);
+    n = bin_get32(data + 4);
+    nulls = n / 8 + (n % 8 != 0);
+    if (size < 4 || size > avail - 4 || nulls > size - 4) {
+        errno = EINVAL;
+        return 0;
+    }
+    if (n > row->fields_cap) {
+        size_t cap = row->fields_cap ? row->fields_cap : 8;
+        const char** fields;
+        size_t* lens;
+        while (cap < n) {
+            cap *= 2;
+        }
+        fields = dsv_realloc((void*)row->fields, cap * sizeof(*fields));
+        if (fields) {
+            row->fields = fields;
+        }
+        lens = fields ? dsv_realloc(row->lens, cap * sizeof(*lens)) : NULL;
+        if (!lens) {
+            errno = ENOMEM;
+            return 0;
+        }
+        row->lens = lens;
+        row->fields_cap = cap;
+    }
+
+    p = data + 8 + nulls;
+    end = data + 4 + size;
+    for (i = 0; i < n; ++i) {
+        size_t len;
+        if (data[8 + i/8] & 1 << (i % 8)) {
+            row->fields[i] = NULL;
+            row->lens[i] = 0;
+            continue;
+        }
+        if (end - p < 4) {
+            errno = EINVAL;
+            return 0;
+        }
+        len = bin_get32(p);
+        p += 4;
+        if (len > (size_t)(end - p)) {
+            errno = EINVAL;
+            return 0;
+        }
+        row->fields[i] = p;
+        row->lens[i] = len;
+        p += len;
+    }
+    if (p != end) {
+        errno = EINVAL;
+        return 0;
+    }
+    row->nfields = n;
+    return 4 + size;
+}
+
+int ua_dsv_bin_open(struct ua_dsv_bin_reader* reader, const char* data,
+                    size_t len) {
+    size_t used;
+
+    memset(reader, 0, sizeof(*reader));
+    ua_dsv_bin_row_init(&reader->columns);
+    if (len < sizeof(bin_magic) ||
+        memcmp(data, bin_magic, sizeof(bin_magic)) != 0) {
+        errno = EINVAL;
+        return FALSE;
+    }
+    used = bin_read(data + sizeof(bin_magic), len - sizeof(bin_magic),
+                    &reader->columns);
+    if (used == 0) {
+        ua_dsv_bin_row_free(&reader->columns);
+        return FALSE;
+    }
+    reader->data = data;
+    reader->len = len;
+    reader->offset = sizeof(bin_magic) + used;
+    return TRUE;
+}
+
+int ua_dsv_bin_next(struct ua_dsv_bin_reader* reader,
+                    struct ua_dsv_bin_row* row) {
+    size_t used;
+
+    if (reader->offset >= reader->len) {
+        row->nfields = 0;
+        return 0;
+    }
+    used = bin_read(reader->data + reader->offset,
+                    reader->len - reader->offset, row);
+    if (used == 0) {
+        return -1;
+    }
+    reader->offset += used;
+    return 1;
+}
+
+void ua_dsv_bin_close(struct ua_dsv_bin_reader* reader) {
+    ua_dsv_bin_row_free(&reader->columns);
+}
+
+/* }}} REGION: DSV BINARY */
+
+/* {{{ REGION: DSV ARROW */
+
+/* A stream is a run of messages, each laid out as the Arrow columnar format
+ * specification has it:
+ *
+ *  marker      0xFFFFFFFF
+ *  size        int32 size of the metadata, padded to a multiple of 8
+ *  metadata    a Message flatbuffer holding a Schema, a DictionaryBatch or
+ *              a RecordBatch
+ *  body        the buffers the metadata points to, each padded to 8 bytes
+ *
+ * after which a marker and a size of 0 end the stream. The schema comes
+ * first, and the dictionaries of a batch go right before it.
+ *
+ * Generated flatbuffer code builds back to front. The few tables here are
+ * written front to back instead, each before the objects it refers to,
+ * which is all that references (unsigned offsets, pointing forward) need;
+ * a vtable goes right before its table. Integers are little-endian, in the
+ * metadata and in the body alike. */
+
+#define ARROW_BATCH 65536
+#define ARROW_MAX_CHARS 0x7fffffffu     /* reach of int32 offsets */
+
+/* flatbuffer and Arrow enumerations */
+#define ARROW_V5 4
+#define ARROW_MSG_SCHEMA 1
+#define ARROW_MSG_DICTIONARY 2
+#define ARROW_MSG_BATCH 3
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_FLOAT 3
+#define ARROW_TYPE_UTF8 5
+#define ARROW_DOUBLE 2
+
+struct arrow_buf {
+    char* s;
+    size_t len;
+    size_t cap;
+    int failed;                 /* out of memory since it was emptied */
+};
+
+/* the strings of a dictionary column, for the whole stream */
+struct arrow_dict {
+    struct arrow_buf chars;
+    uint32_t* offsets;          /* count + 1 of them */
+    size_t count;
+    size_t offsets_cap;
+    uint32_t* slots;            /* index + 1 of each string, 0 for none */
+    size_t nslots;
+    size_t sent;                /* strings already in a dictionary batch */
+};
+
+/* the values of a column for the batch being filled */
+struct arrow_column {
+    char* name;
+    enum UADsvArrowType type;
+    struct arrow_buf valid;     /* one bit per row, set if not null */
+    struct arrow_buf data;      /* values, indices or string offsets */
+    struct arrow_buf chars;     /* characters of the strings */
+    size_t nulls;
+    struct arrow_dict dict;
+};
+
+struct ua_dsv_arrow_writer {
+    FILE* file;
+    struct arrow_column* columns;
+    size_t ncolumns;
+    size_t batch_rows;
+    size_t rows;                /* in the batch being filled */
+    uint64_t total;
+    uint64_t batches;
+    int error;                  /* errno of a failure that sticks */
+    int finished;
+
+    /* for ua_dsv_arrow_add: parsed values, and room to NIL terminate */
+    uint64_t* values;
+    char* number;
+    size_t number_cap;
+    struct arrow_buf meta;      /* the metadata of a message */
+    struct arrow_buf scratch;   /* rebased dictionary offsets */
+};
+
+static int arrow_reserve(struct arrow_buf* b, size_t n) {
+    if (b->cap - b->len < n) {
+        size_t cap = b->cap ? b->cap : 256;
+        char* s;
+        while (cap - b->len < n) {
+            cap *= 2;
+        }
+        s = dsv_realloc(b->s, cap);
+        if (!s) {
+            b->failed = TRUE;
+            errno = ENOMEM;
+            return FALSE;
+        }
+        b->s = s;
+        b->cap = cap;
+    }
+    return TRUE;
+}
+
+static void arrow_put_le(char* p, uint64_t v, unsigned size) {
+    unsigned i;
+    for (i = 0; i < size; ++i) {
+        p[i] = (char)((v >> (8*i)) & 0xff);
+    }
+}
+
+/* append @param size bytes of @param v, little-endian */
+static int arrow_append(struct arrow_buf* b, uint64_t v, unsigned size) {
+    if (!arrow_reserve(b, size)) {
+        return FALSE;
+    }
+    arrow_put_le(b->s + b->len, v, size);
+    b->len += size;
+    return TRUE;
+}
+
+static int arrow_append_bit(struct arrow_buf* b, size_t row, int set) {
+    if (row % 8 == 0 && !arrow_append(b, 0, 1)) {
+        return FALSE;
+    }
+    if (set) {
+        b->s[row / 8] = (char)(b->s[row / 8] | 1 << (row % 8));
+    }
+    return TRUE;
+}
+
+/* zeroed room for @param n bytes at a position that is @param mod past a
+ * multiple of @param align; returns the position, or 0 if out of memory,
+ * where no object but the root offset starts */
+static size_t fb_alloc(struct arrow_buf* b, size_t n, size_t align,
+                       size_t mod) {
+    size_t pad = (align + mod - b->len % align) % align;
+    size_t pos;
+    if (!arrow_reserve(b, pad + n)) {
+        return 0;
+    }
+    memset(b->s + b->len, 0, pad + n);
+    pos = b->len + pad;
+    b->len = pos + n;
+    return pos;
+}
+
+/* point the reference at @param slot to @param target, which follows it */
+static void fb_ref(struct arrow_buf* b, size_t slot, size_t target) {
+    if (slot && target) {
+        arrow_put_le(b->s + slot, target - slot, 4);
+    }
+}
+
+/* a table field: its size (1, 2, 4 or 8 bytes, 0 if absent) and value,
+ * or a reference to fill in with fb_ref once its object is written */
+struct fb_field {
+    unsigned size;
+    uint64_t value;
+    int ref;
+};
+
+/* write a vtable and its table of @param n fields, widest first so that
+ * every field is aligned, and store where each reference goes in
+ * @param slots; returns where the table is */
+static size_t fb_table(struct arrow_buf* b, const struct fb_field* fields,
+                       size_t n, size_t* slots) {
+    size_t at[8];
+    size_t size = 4;
+    size_t vtable, table, i;
+    unsigned width;
+
+    for (width = 8; width > 0; width /= 2) {
+        for (i = 0; i < n; ++i) {
+            if (fields[i].size == width) {
+                at[i] = size;
+                size += width;
+            }
+        }
+    }
+    vtable = fb_alloc(b, 4 + 2*n, 2, 0);
+    /* 4 past a multiple of 8, so that 8-byte fields follow aligned */
+    table = vtable ? fb_alloc(b, size, 8, 4) : 0;
+    if (!table) {
+        return 0;
+    }
+    arrow_put_le(b->s + table, table - vtable, 4);
+    arrow_put_le(b->s + vtable, 4 + 2*n, 2);
+    arrow_put_le(b->s + vtable + 2, size, 2);
+    for (i = 0; i < n; ++i) {
+        if (!fields[i].size) {
+            continue;
+        }
+        arrow_put_le(b->s + vtable + 4 + 2*i, at[i], 2);
+        if (fields[i].ref) {
+            slots[i] = table + at[i];
+        } else {
+            arrow_put_le(b->s + table + at[i], fields[i].value,
+                         fields[i].size);
+        }
+    }
+    return table;
+}
+
+/* a vector of @param count elements of @param size bytes, aligned to
+ * @param align; returns where its length is, with the elements after it */
+static size_t fb_vector(struct arrow_buf* b, size_t count, size_t size,
+                        size_t align) {
+    size_t pos = align == 8 ? fb_alloc(b, 4 + count*size, 8, 4)
+                            : fb_alloc(b, 4 + count*size, 4, 0);
+    if (pos) {
+        arrow_put_le(b->s + pos, count, 4);
+    }
+    return pos;
+}
+
+/* a string, NIL terminated past its length */
+static size_t fb_string(struct arrow_buf* b, const char* s, size_t n) {
+    size_t pos = fb_vector(b, n + 1, 1, 4);
+    if (pos) {
+        arrow_put_le(b->s + pos, n, 4);
+        memcpy(b->s + pos + 4, s, n);
+    }
+    return pos;
+}
+
+/* start the metadata of a message with its root offset and its Message
+ * table; returns where the reference to its header goes */
+static size_t arrow_message(struct arrow_buf* b, unsigned header,
+                            uint64_t body_len) {
+    const struct fb_field fields[4] = {
+        {2, ARROW_V5, 0},           /* version */
+        {1, header, 0},             /* header_type */
+        {4, 0, 1},                  /* header */
+        {8, body_len, 0}            /* bodyLength */
+    };
+    size_t slots[4] = {0};
+    size_t table;
+
+    b->len = 0;
+    b->failed = FALSE;
+    if (!arrow_reserve(b, 4)) {
+        return 0;
+    }
+    b->len = 4;
+    table = fb_table(b, fields, 4, slots);
+    if (!table) {
+        return 0;
+    }
+    arrow_put_le(b->s, table, 4);
+    return slots[2];
+}
+
+/* an Int type table: @param bits wide, signed */
+static size_t arrow_int_type(struct arrow_buf* b, unsigned bits) {
+    const struct fb_field fields[2] = {{4, bits, 0}, {1, 1, 0}};
+    return fb_table(b, fields, 2, NULL);
+}
+
+/* one Field of the schema, with what it refers to after it */
+static size_t arrow_field(struct arrow_buf* b, const struct arrow_column* c,
+                          uint64_t id) {
+    unsigned type = c->type == UA_ARROW_INT64 ? ARROW_TYPE_INT :
+                    c->type == UA_ARROW_FLOAT64 ? ARROW_TYPE_FLOAT :
+                    ARROW_TYPE_UTF8;
+    const struct fb_field fields[7] = {
+        {4, 0, 1},                              /* name */
+        {1, 1, 0},                              /* nullable */
+        {1, type, 0},                           /* type_type */
+        {4, 0, 1},                              /* type */
+        {c->type == UA_ARROW_DICT ? 4 : 0, 0, 1}, /* dictionary */
+        {4, 0, 1},                              /* children */
+        {0, 0, 0}                               /* custom_metadata */
+    };
+    size_t slots[7] = {0};
+    size_t field = fb_table(b, fields, 7, slots);
+
+    fb_ref(b, slots[0], fb_string(b, c->name, strlen(c->name)));
+    if (c->type == UA_ARROW_INT64) {
+        fb_ref(b, slots[3], arrow_int_type(b, 64));
+    } else if (c->type == UA_ARROW_FLOAT64) {
+        const struct fb_field precision[1] = {{2, ARROW_DOUBLE, 0}};
+        fb_ref(b, slots[3], fb_table(b, precision, 1, NULL));
+    } else {
+        fb_ref(b, slots[3], fb_table(b, NULL, 0, NULL));
+    }
+    if (c->type == UA_ARROW_DICT) {
+        const struct fb_field encoding[3] = {
+            {8, id, 0},                         /* id */
+            {4, 0, 1},                          /* indexType */
+            {1, 0, 0}                           /* isOrdered */
+        };
+        size_t refs[3] = {0};
+        fb_ref(b, slots[4], fb_table(b, encoding, 3, refs));
+        fb_ref(b, refs[1], arrow_int_type(b, 32));
+    }
+    fb_ref(b, slots[5], fb_vector(b, 0, 4, 4));
+    return field;
+}
+
+/* a buffer of a message body */
+struct arrow_span {
+    const char* s;
+    size_t len;
+};
+
+#define ARROW_PAD8(n) (((n) + 7) & ~(size_t)7)
+
+/* a RecordBatch table of @param length rows, with a FieldNode per
+ * column (length and null count) and the body offsets of @param spans */
+static size_t arrow_batch(struct arrow_buf* b, uint64_t length,
+                          const uint64_t* nulls, size_t nnodes,
+                          const struct arrow_span* spans, size_t nspans) {
+    const struct fb_field fields[3] = {
+        {8, length, 0},                         /* length */
+        {4, 0, 1},                              /* nodes */
+        {4, 0, 1}                               /* buffers */
+    };
+    size_t slots[3] = {0};
+    size_t table = fb_table(b, fields, 3, slots);
+    size_t nodes = fb_vector(b, nnodes, 16, 8);
+    size_t buffers = fb_vector(b, nspans, 16, 8);
+    uint64_t offset = 0;
+    size_t i;
+
+    if (!nodes || !buffers) {
+        return 0;
+    }
+    for (i = 0; i < nnodes; ++i) {
+        arrow_put_le(b->s + nodes + 4 + 16*i, length, 8);
+        arrow_put_le(b->s + nodes + 12 + 16*i, nulls[i], 8);
+    }
+    for (i = 0; i < nspans; ++i) {
+        arrow_put_le(b->s + buffers + 4 + 16*i, offset, 8);
+        arrow_put_le(b->s + buffers + 12 + 16*i, spans[i].len, 8);
+        offset += ARROW_PAD8(spans[i].len);
+    }
+    fb_ref(b, slots[1], nodes);
+    fb_ref(b, slots[2], buffers);
+    return table;
+}
+
+/* write the message whose metadata is in w->meta, and its body */
+static int arrow_write_message(struct ua_dsv_arrow_writer* w,
+                               const struct arrow_span* spans,
+                               size_t nspans) {
+    static const char zeros[8] = {0};
+    char prefix[8];
+    size_t meta_len = ARROW_PAD8(w->meta.len);
+    size_t i;
+
+    if (meta_len > ARROW_MAX_CHARS || !arrow_reserve(&w->meta, 8)) {
+        errno = meta_len > ARROW_MAX_CHARS ? EOVERFLOW : ENOMEM;
+        return FALSE;
+    }
+    memset(w->meta.s + w->meta.len, 0, meta_len - w->meta.len);
+    arrow_put_le(prefix, 0xffffffffu, 4);
+    arrow_put_le(prefix + 4, meta_len, 4);
+    if (fwrite(prefix, 1, 8, w->file) != 8 ||
+        fwrite(w->meta.s, 1, meta_len, w->file) != meta_len) {
+        return FALSE;
+    }
+    for (i = 0; i < nspans; ++i) {
+        size_t pad = ARROW_PAD8(spans[i].len) - spans[i].len;
+        if ((spans[i].len &&
+             fwrite(spans[i].s, 1, spans[i].len, w->file) != spans[i].len) ||
+            (pad && fwrite(zeros, 1, pad, w->file) != pad)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static uint64_t arrow_body_len(const struct arrow_span* spans, size_t n) {
+    uint64_t len = 0;
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        len += ARROW_PAD8(spans[i].len);
+    }
+    return len;
+}
+
+static int arrow_write_schema(struct ua_dsv_arrow_writer* w) {
+    const struct fb_field fields[2] = {
+        {2, 0, 0},                              /* endianness: Little */
+        {4, 0, 1}                               /* fields */
+    };
+    size_t slots[2] = {0};
+    size_t header = arrow_message(&w->meta, ARROW_MSG_SCHEMA, 0);
+    size_t schema = header ? fb_table(&w->meta, fields, 2, slots) : 0;
+    size_t vector = schema ? fb_vector(&w->meta, w->ncolumns, 4, 4) : 0;
+    size_t i;
+
+    if (!vector) {
+        return FALSE;
+    }
+    fb_ref(&w->meta, header, schema);
+    fb_ref(&w->meta, slots[1], vector);
+    for (i = 0; i < w->ncolumns; ++i) {
+        size_t field = arrow_field(&w->meta, &w->columns[i], i);
+        if (!field) {
+            return FALSE;
+        }
+        fb_ref(&w->meta, vector + 4 + 4*i, field);
+    }
+    return !w->meta.failed && arrow_write_message(w, NULL, 0);
+}
+
+/* send the strings of @param column's dictionary that no dictionary batch
+ * has sent yet: all of them for the first batch, a delta after it */
+static int arrow_write_dict(struct ua_dsv_arrow_writer* w, size_t column) {
+    struct arrow_dict* d = &w->columns[column].dict;
+    const struct fb_field fields[3] = {
+        {8, column, 0},                         /* id */
+        {4, 0, 1},                              /* data */
+        {1, d->sent > 0, 0}                     /* isDelta */
+    };
+    size_t slots[3] = {0};
+    struct arrow_span spans[3];
+    uint64_t nulls = 0;
+    size_t header, table, i;
+    uint32_t base = d->offsets ? d->offsets[d->sent] : 0;
+    size_t count = d->count - d->sent;
+
+    w->scratch.len = 0;
+    for (i = 0; i <= count; ++i) {
+        uint32_t offset = d->offsets ? d->offsets[d->sent + i] : 0;
+        if (!arrow_append(&w->scratch, offset - base, 4)) {
+            return FALSE;
+        }
+    }
+    spans[0].s = NULL;                          /* validity: none null */
+    spans[0].len = 0;
+    spans[1].s = w->scratch.s;
+    spans[1].len = w->scratch.len;
+    spans[2].s = d->chars.s ? d->chars.s + base : NULL;
+    spans[2].len = (d->offsets ? d->offsets[d->count] : 0) - base;
+
+    header = arrow_message(&w->meta, ARROW_MSG_DICTIONARY,
+                           arrow_body_len(spans, 3));
+    table = header ? fb_table(&w->meta, fields, 3, slots) : 0;
+    if (!table) {
+        return FALSE;
+    }
+    fb_ref(&w->meta, header, table);
+    fb_ref(&w->meta, slots[1],
+           arrow_batch(&w->meta, count, &nulls, 1, spans, 3));
+    if (w->meta.failed || !arrow_write_message(w, spans, 3)) {
+        return FALSE;
+    }
+    d->sent = d->count;
+    return TRUE;
+}
+
+/* write the rows added since the last batch, after the dictionaries they
+ * need, and start the next batch */
+static int arrow_flush(struct ua_dsv_arrow_writer* w) {
+    struct arrow_span* spans;
+    uint64_t* nulls;
+    size_t nspans = 0, header, i;
+    int ok;
+
+    for (i = 0; i < w->ncolumns; ++i) {
+        const struct arrow_column* c = &w->columns[i];
+        if (c->type == UA_ARROW_DICT &&
+            (w->batches == 0 || c->dict.count > c->dict.sent) &&
+            !arrow_write_dict(w, i)) {
+            return FALSE;
+        }
+    }
+
+    spans = dsv_calloc(3 * w->ncolumns + 1, sizeof(*spans));
+    nulls = dsv_calloc(w->ncolumns + 1, sizeof(*nulls));
+    ok = spans && nulls;
+    for (i = 0; ok && i < w->ncolumns; ++i) {
+        const struct arrow_column* c = &w->columns[i];
+        nulls[i] = c->nulls;
+        spans[nspans].s = c->valid.s;
+        spans[nspans++].len = c->nulls ? c->valid.len : 0;
+        spans[nspans].s = c->data.s;
+        spans[nspans++].len = c->data.len;
+        if (c->type == UA_ARROW_UTF8) {
+            spans[nspans].s = c->chars.s;
+            spans[nspans++].len = c->chars.len;
+        }
+    }
+    if (!ok) {
+        errno = ENOMEM;
+    }
+    header = ok ? arrow_message(&w->meta, ARROW_MSG_BATCH,
+                                arrow_body_len(spans, nspans)) : 0;
+    if (header) {
+        fb_ref(&w->meta, header, arrow_batch(&w->meta, w->rows, nulls,
+                                             w->ncolumns, spans, nspans));
+    }
+    ok = header && !w->meta.failed && arrow_write_message(w, spans, nspans);
+    dsv_free(spans);
+    dsv_free(nulls);
+    if (!ok) {
+        return FALSE;
+    }
+
+    for (i = 0; i < w->ncolumns; ++i) {
+        struct arrow_column* c = &w->columns[i];
+        c->valid.len = 0;
+        c->data.len = 0;
+        c->chars.len = 0;
+        c->nulls = 0;
+        /* string offsets start every batch at 0 */
+        if (c->type == UA_ARROW_UTF8 && !arrow_append(&c->data, 0, 4)) {
+            return FALSE;
+        }
+    }
+    w->rows = 0;
+    w->batches += 1;
+    return TRUE;
+}
+
+/* the index of @param s in @param d, added if it is not there; returns
+ * false if out of memory */
+static int arrow_dict_index(struct arrow_dict* d, const char* s, size_t n,
+                            uint32_t* index) {
+    size_t mask, i;
+
+    if (d->count + 1 > d->nslots / 2) {
+        size_t nslots = d->nslots ? 2 * d->nslots : 64;
+        uint32_t* slots = dsv_calloc(nslots, sizeof(*slots));
+        if (!slots) {
+            errno = ENOMEM;
+            return FALSE;
+        }
+        for (i = 0; i < d->count; ++i) {
+            const char* e = d->chars.s + d->offsets[i];
+            size_t j = agg_hash(e, d->offsets[i+1] - d->offsets[i]);
+            while (slots[j & (nslots - 1)]) {
+                ++j;
+            }
+            slots[j & (nslots - 1)] = (uint32_t)i + 1;
+        }
+        dsv_free(d->slots);
+        d->slots = slots;
+        d->nslots = nslots;
+    }
+    if (d->count + 2 > d->offsets_cap) {
+        size_t cap = d->offsets_cap ? 2 * d->offsets_cap : 64;
+        uint32_t* offsets = dsv_realloc(d->offsets, cap * sizeof(*offsets));
+        if (!offsets) {
+            errno = ENOMEM;
+            return FALSE;
+        }
+        if (!d->offsets) {
+            offsets[0] = 0;
+        }
+        d->offsets = offsets;
+        d->offsets_cap = cap;
+    }
+
+    mask = d->nslots - 1;
+    for (i = agg_hash(s, n); d->slots[i & mask]; ++i) {
+        uint32_t k = d->slots[i & mask] - 1;
+        if (d->offsets[k+1] - d->offsets[k] == n &&
+            memcmp(d->chars.s + d->offsets[k], s, n) == 0) {
+            *index = k;
+            return TRUE;
+        }
+    }
+    if (!arrow_reserve(&d->chars, n)) {
+        return FALSE;
+    }
+    memcpy(d->chars.s + d->chars.len, s, n);
+    d->chars.len += n;
+    d->offsets[d->count + 1] = (uint32_t)d->chars.len;
+    d->slots[i & mask] = (uint32_t)d->count + 1;
+    *index = (uint32_t)d->count++;
+    return TRUE;
+}
+
+/* parse a whole number of @param n characters, with an optional sign */
+static int arrow_int64(const char* s, size_t n, uint64_t* out) {
+    uint64_t v = 0, limit = (uint64_t)INT64_MAX;
+    int negative = n > 0 && s[0] == '-';
+    size_t i = n > 0 && (s[0] == '-' || s[0] == '+');
+
+    if (i == n) {
+        return FALSE;
+    }
+    limit += negative;
+    for (; i < n; ++i) {
+        unsigned digit = (unsigned char)s[i] - '0';
+        if (digit > 9 || v > (limit - digit) / 10) {
+            return FALSE;
+        }
+        v = v * 10 + digit;
+    }
+    *out = negative ? (uint64_t)0 - v : v;
+    return TRUE;
+}
+
+static int arrow_float64(struct ua_dsv_arrow_writer* w, const char* s,
+                         size_t n, uint64_t* out) {
+    int save_errno = errno;
+    double d;
+    char* end;
+
+    if (n + 1 > w->number_cap) {
+        char* number = dsv_realloc(w->number, n + 1);
+        if (!number) {
+            w->error = ENOMEM;
+            return FALSE;
+        }
+        w->number = number;
+        w->number_cap = n + 1;
+    }
+    memcpy(w->number, s, n);
+    w->number[n] = '\0';
+    d = strtod(w->number, &end);
+    errno = save_errno;
+    /* strtod would skip leading white space */
+    if (end != w->number + n || (unsigned char)*s <= ' ') {
+        return FALSE;
+    }
+    memcpy(out, &d, sizeof(d));
+    return TRUE;
+}
+
+struct ua_dsv_arrow_writer* ua_dsv_arrow_new(
+        FILE* file, const struct ua_dsv_arrow_column* columns,
+        size_t ncolumns, size_t batch_rows) {
+    struct ua_dsv_arrow_writer* w = dsv_calloc(1, sizeof(*w));
+    size_t i;
+
+    if (!w) {
+        return NULL;
+    }
+    w->file = file;
+    w->ncolumns = ncolumns;
+    w->batch_rows = batch_rows ? batch_rows : ARROW_BATCH;
+    w->columns = dsv_calloc(ncolumns + 1, sizeof(*w->columns));
+    w->values = dsv_calloc(ncolumns + 1, sizeof(*w->values));
+    if (!w->columns || !w->values) {
+        ua_dsv_arrow_free(w);
+        errno = ENOMEM;
+        return NULL;
+    }
+    for (i = 0; i < ncolumns; ++i) {
+        struct arrow_column* c = &w->columns[i];
+        size_t n = strlen(columns[i].name);
+        c->type = columns[i].type;
+        c->name = dsv_calloc(n + 1, 1);
+        if (!c->name ||
+            (c->type == UA_ARROW_UTF8 && !arrow_append(&c->data, 0, 4))) {
+            ua_dsv_arrow_free(w);
+            errno = ENOMEM;
+            return NULL;
+        }
+        memcpy(c->name, columns[i].name, n);
+    }
+    if (!arrow_write_schema(w)) {
+        int save_errno = errno;
+        ua_dsv_arrow_free(w);
+        errno = save_errno;
+        return NULL;
+    }
+    return w;
+}
+
+int ua_dsv_arrow_add(struct ua_dsv_arrow_writer* w,
+                     const char* const* fields, const size_t* lens,
+                     size_t nfields) {
+    size_t i;
+
+    if (w->error || w->finished) {
+        errno = w->error ? w->error : EINVAL;
+        return FALSE;
+    }
+
+    /* parse and check everything before adding anything */
+    for (i = 0; i < w->ncolumns; ++i) {
+        const struct arrow_column* c = &w->columns[i];
+        const char* field = i < nfields ? fields[i] : NULL;
+        size_t len = field ? lens[i] : 0;
+        int ok = TRUE;
+
+        if (!field || (len == 0 && c->type != UA_ARROW_UTF8 &&
+                       c->type != UA_ARROW_DICT)) {
+            continue;
+        }
+        if (c->type == UA_ARROW_INT64) {
+            ok = arrow_int64(field, len, &w->values[i]);
+        } else if (c->type == UA_ARROW_FLOAT64) {
+            ok = arrow_float64(w, field, len, &w->values[i]);
+        } else if (c->type == UA_ARROW_DICT) {
+            ok = len <= ARROW_MAX_CHARS - c->dict.chars.len;
+        } else if (len > ARROW_MAX_CHARS - c->chars.len) {
+            /* a batch of its own may hold it */
+            if (w->rows > 0 && !arrow_flush(w)) {
+                w->error = errno;
+                return FALSE;
+            }
+            ok = len <= ARROW_MAX_CHARS - c->chars.len;
+        }
+        if (!ok) {
+            if (w->error) {
+                errno = w->error;
+            } else {
+                errno = c->type == UA_ARROW_INT64 ||
+                        c->type == UA_ARROW_FLOAT64 ? EINVAL : EOVERFLOW;
+            }
+            return FALSE;
+        }
+    }
+
+    for (i = 0; i < w->ncolumns; ++i) {
+        struct arrow_column* c = &w->columns[i];
+        const char* field = i < nfields ? fields[i] : NULL;
+        size_t len = field ? lens[i] : 0;
+        int null = !field || (len == 0 && (c->type == UA_ARROW_INT64 ||
+                                           c->type == UA_ARROW_FLOAT64));
+        uint32_t index = 0;
+        int ok = arrow_append_bit(&c->valid, w->rows, !null);
+
+        c->nulls += null;
+        switch (c->type) {
+            case UA_ARROW_INT64:
+            case UA_ARROW_FLOAT64:
+                ok = ok && arrow_append(&c->data, null ? 0 : w->values[i], 8);
+                break;
+            case UA_ARROW_DICT:
+                ok = ok && (null || arrow_dict_index(&c->dict, field, len,
+                                                     &index)) &&
+                     arrow_append(&c->data, index, 4);
+                break;
+            default:
+                ok = ok && arrow_reserve(&c->chars, len);
+                if (ok && len) {
+                    memcpy(c->chars.s + c->chars.len, field, len);
+                    c->chars.len += len;
+                }
+                ok = ok && arrow_append(&c->data, c->chars.len, 4);
+                break;
+        }
+        if (!ok) {
+            w->error = errno;
+            return FALSE;
+        }
+    }
+    w->rows += 1;
+    w->total += 1;
+    if (w->rows >= w->batch_rows && !arrow_flush(w)) {
+        w->error = errno;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+int ua_dsv_arrow_add_row(struct ua_dsv_arrow_writer* w,
+                         const char* const* row) {
+    size_t lens[16] = {0};
+    size_t* all = lens;
+    size_t n = 0, i;
+    int ok;
+
+    while (row[n]) {
+        ++n;
+    }
+    if (n > sizeof(lens) / sizeof(lens[0])) {
+        all = dsv_calloc(n, sizeof(*all));
+        if (!all) {
+            w->error = ENOMEM;
+            errno = ENOMEM;
+            return FALSE;
+        }
+    }
+    for (i = 0; i < n; ++i) {
+        all[i] = strlen(row[i]);
+    }
+    ok = ua_dsv_arrow_add(w, row, all, n);
+    if (all != lens) {
+        int save_errno = errno;
+        dsv_free(all);
+        errno = save_errno;
+    }
+    return ok;
+}
+
+int ua_dsv_arrow_finish(struct ua_dsv_arrow_writer* w) {
+    char end[8];
+
+    if (w->error || w->finished) {
+        errno = w->error ? w->error : EINVAL;
+        return FALSE;
+    }
+    w->finished = TRUE;
+    if (w->rows > 0 && !arrow_flush(w)) {
+        w->error = errno;
+        return FALSE;
+    }
+    arrow_put_le(end, 0xffffffffu, 4);
+    arrow_put_le(end + 4, 0, 4);
+    if (fwrite(end, 1, 8, w->file) != 8 || fflush(w->file) != 0) {
+        w->error = errno;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+uint64_t ua_dsv_arrow_rows(const struct ua_dsv_arrow_writer* w) {
+    return w->total;
+}
+
+void ua_dsv_arrow_free(struct ua_dsv_arrow_writer* w) {
+    size_t i;
+
+    if (!w) {
+        return;
+    }
+    for (i = 0; w->columns && i < w->ncolumns; ++i) {
+        struct arrow_column* c = &w->columns[i];
+        dsv_free(c->name);
+        dsv_free(c->valid.s);
+        dsv_free(c->data.s);
+        dsv_free(c->chars.s);
+        dsv_free(c->dict.chars.s);
+        dsv_free(c->dict.offsets);
+        dsv_free(c->dict.slots);
+    }
+    dsv_free(w->columns);
+    dsv_free(w->values);
+    dsv_free(w->number);
+    dsv_free(w->meta.s);
+    dsv_free(w->scratch.s);
+    dsv_free(w);
+}
+
+/* }}} REGION: DSV ARROW */
+
+/* {{{ REGION: DSV SELECT */
+#if 0
+
+/* What do we have here, you ask?
+ *
+ * Well, I'd like to be able to run something akin to:
+ *
+ * ua_dsv_select(UFILE* file, const TMCHAR* query, const TMCHAR** args,
+ *               enum UAQuoteStyle quoting, TMCHAR quotechar,
+ *               TMCHAR delimchar, TMCHAR escapechar,
+ *               struct ua_dsv_export_metrics* metrics)
+ *
+ * and have it be called as
+ *
+ * const TMCHAR** args = {_TMC("31168931"), NULL};
+ * ua_dsv_select(tmstdout, _TMC(
+ *      "SELECT spriden_first_name, "
+ *             "spriden_mi, "
+ *             "spriden_last_name, "
+ *             "spriden_id "
+ *        "FROM spriden "
+ *       "WHERE spriden_id=:id"), args, QUOTE_NEEDED, '"', ',', '\0', NULL);
+ *
+ * which would result in the results of that query being written to stdout as
+ * properly formatted CSV. The cursor is a ua_dsv_source, so passing metrics
+ * shows how long the database, the formatter and the file each took.
+ *
+ * Due to some limitations of PMIG, I can't get this to work quite yet.
+ *
+ * Due to Pro*C limitations, I doubt this will work with inline SQL without
+ * some insane C99 preprocessor hackery, which is turning out to be more
+ * trouble than it's worth.
+ */
+
+static void strnarrow(const TMCHAR* src, char* dest) {
+    while ((*dest++ = (char)*src++)) ;
+}
+
+enum {
+    SQLTYPE_CHAR = 1,
+    SQLTYPE_NUMERIC = 2,
+    SQLTYPE_DECIMAL = 3,
+    SQLTYPE_INTEGER = 4,
+    SQLTYPE_SMALLINT = 5,
+    SQLTYPE_FLOAT = 6,
+    SQLTYPE_REAL = 7,
+    SQLTYPE_DOUBLE = 8,
+    SQLTYPE_DATE = 9,
+    SQLTYPE_VARCHAR = 12,
+
+    ORATYPE_VARCHAR2 = 1,   /* char[n] */
+    ORATYPE_NUMBER = 2,     /* char[n], n <= 22 */
+    ORATYPE_INTEGER = 3,    /* int */
+    ORATYPE_FLOAT = 4,      /* float */
+    ORATYPE_STRING = 5,     /* char[n+1], char[n]='\0'; */
+    ORATYPE_VARNUM = 6,     /* char[n], n <= 22 */
+    ORATYPE_DECIMAL = 7,
+    ORATYPE_LONG = 8,
+    ORATYPE_VARCHAR = 9,
+    ORATYPE_ROWID = 11,
+    ORATYPE_DATE = 12,
+    ORATYPE_VARRAW = 15,
+    ORATYPE_SQLT_BFLOAT = 21,
+    ORATYPE_SQLT_BDOUBLE = 22,
+    ORATYPE_RAW = 23,
+    ORATYPE_LONG_RAW = 24,
+    ORATYPE_UNSIGNED = 68,
+    ORATYPE_DISPLAY = 91,
+    ORATYPE_LONG_VARCHAR = 94,
+    ORATYPE_LONG_VARRAW = 95,
+    ORATYPE_CHAR = 96,
+    ORATYPE_CHARF = 96,
+    ORATYPE_CHARZ = 97
+};
+
+/* rows fetched from psv_cur per batch */
+#define SELECT_BATCH 256
+
+/* rows of the current batch, kept until the next fetch */
+struct select_cursor {
+    int nvars_out;
+    char*** rows;
+    long nrows;
+};
+
+static void select_release(struct select_cursor* cur) {
+    long r;
+    for (r = 0; r < cur->nrows; ++r) {
+        char** row = cur->rows[r];
+        int i;
+        for (i = 0; row[i]; ++i) {
+            free((void*)row[i]);
+        }
+        free((void*)row);
+    }
+    cur->nrows = 0;
+}
+
+static long select_fetch(void* user, const char*** rows, long max) {
+    struct select_cursor* cur = user;
+    int i;
+
+    select_release(cur);
+    if (!cur->rows) {
+        cur->rows = calloc(sizeof(char**), max);
     }
 
-    EXEC SQL OPEN psv_cur USING DESCRIPTOR 'in'; POSTORA;
     EXEC SQL WHENEVER NOT FOUND DO BREAK; POSTORA;
-    while (1) {
+    while (cur->nrows < max) {
         EXEC SQL FETCH psv_cur INTO DESCRIPTOR 'out'; POSTORA;
         if (NO_ROWS_FOUND) break;
 
-        TMCHAR **row = calloc(sizeof(TMCHAR*), nvars_out+1);
-        for (i = 1; i < nvars_out+1; ++i) {
+        char** row = calloc(sizeof(char*), cur->nvars_out+1);
+        for (i = 1; i < cur->nvars_out+1; ++i) {
             int colsize = 0;
             int coltype = 0;
             EXEC SQL GET DESCRIPTOR 'out' VALUE :i
@@ -563,15 +4167,70 @@ void ua_dsv_select(UFILE* out, const TMCHAR* query, const TMCHAR** inputs,
                 value[j--] = '\0';
             }
 
-            row[i-1] = calloc(sizeof(TMCHAR), colsize+1);
-            strwiden(value, row[i-1]);
-            free((void*)value);
+            /* ua_dsv_export widens the row to TMCHAR */
+            row[i-1] = value;
         }
 
-        ua_fwrite_dsv(out, row, quoting, quote, delim, escape);
-        ua_free_dsv(row);
+        cur->rows[cur->nrows] = row;
+        rows[cur->nrows] = (const char**)row;
+        cur->nrows += 1;
+    }
+    return cur->nrows;
+}
+
+void ua_dsv_select(UFILE* out, const TMCHAR* query, const TMCHAR** inputs,
+                   enum UAQuoteStyle quoting, TMCHAR quote, TMCHAR delim,
+                   TMCHAR escape, struct ua_dsv_export_metrics* metrics)
+{
+    char* ascquery = calloc(sizeof(char), tmstrlen(query)+1);
+    strnarrow(query, ascquery);
+    EXEC SQL ALLOCATE DESCRIPTOR 'in'; POSTORA;
+    EXEC SQL ALLOCATE DESCRIPTOR 'out'; POSTORA;
+
+    EXEC SQL PREPARE s FROM :ascquery; POSTORA;
+    EXEC SQL DESCRIBE INPUT s USING DESCRIPTOR 'in'; POSTORA;
+    EXEC SQL DESCRIBE OUTPUT s USING DESCRIPTOR 'out'; POSTORA;
+
+    int ninputs = veclen(inputs);
+    int nvars_in = 0;
+    int nvars_out = 0;
+    EXEC SQL GET DESCRIPTOR 'in' :nvars_in = COUNT; POSTORA;
+    EXEC SQL GET DESCRIPTOR 'out' :nvars_out = COUNT; POSTORA;
+
+    if (ninputs < nvars_in) {
+        tmfprintf(&csvBundle, tmstdout, _TMC("ERROR!! Not enough inputs!\n"));
+        ua_exit(-1);
+    } else if (ninputs > nvars_in) {
+        tmfprintf(&csvBundle, tmstdout, _TMC("WARNING!! Too many inputs!\n"));
+    }
+
+    EXEC SQL DECLARE psv_cur CURSOR FOR s; POSTORA;
+
+    int i = 0;
+    for (i = 1; i < nvars_in+1; ++i) {
+        const int type = SQLTYPE_CHAR;
+        const int length = tmstrlen(inputs[i-1]);
+        const TMCHAR* data = inputs[i-1];
+        char* ascdata = calloc(sizeof(char), length+1);
+        strnarrow(data, ascdata);
+        EXEC SQL SET DESCRIPTOR 'in' VALUE :i
+            TYPE = :type,
+            LENGTH = :length,
+            DATA = :ascdata;
+        POSTORA;
+        free((void*)ascdata);
     }
 
+    EXEC SQL OPEN psv_cur USING DESCRIPTOR 'in'; POSTORA;
+
+    struct select_cursor cursor = {nvars_out, NULL, 0};
+    struct ua_dsv_source source = {select_fetch, &cursor};
+    struct ua_dsv_sink sink = {ua_dsv_sink_ufile, out};
+    ua_dsv_export(&source, &sink, SELECT_BATCH, quoting, quote, delim, escape,
+                  metrics);
+    select_release(&cursor);
+    free(cursor.rows);
+
     EXEC SQL CLOSE psv_cur; POSTORA;
     EXEC SQL DEALLOCATE DESCRIPTOR 'in'; POSTORA;
     EXEC SQL DEALLOCATE DESCRIPTOR 'out'; POSTORA;
@@ -582,3 +4241,915 @@ void ua_dsv_select(UFILE* out, const TMCHAR* query, const TMCHAR** inputs,
 /* }}} REGION: DSV SELECT */
 
 
+
+/* {{{ REGION: TESTS */
+#ifdef TEST
+
+#include <assert.h>
+
+/* Test vectors are written once, as char, and run through both engines. The
+ * TMCHAR engine gets a widened copy of every string. */
+
+struct parse_vector {
+    const char* input;
+    char quote;
+    char delim;
+    const char* expected[6];
+};
+
+struct format_vector {
+    const char* fields[6];
+    enum UAQuoteStyle quoting;
+    char quote;
+    char delim;
+    char escape;
+    const char* expected;
+};
+
+static const struct parse_vector parse_vectors[] = {
+    {"one,two,three", CSV_Q, CSV_D, {"one", "two", "three", NULL}},
+    {"one,\"two\",three", CSV_Q, CSV_D, {"one", "two", "three", NULL}},
+    {"\"one\",\"two\",\"three\"", CSV_Q, CSV_D, {"one", "two", "three", NULL}},
+    {"one|two|three", PSV_Q, PSV_D, {"one", "two", "three", NULL}},
+    {"  one  ,  two  ,  three  ", CSV_Q, CSV_D, {"one", "two", "three", NULL}},
+    {"one,t\"w\"o,\"th\"\"r\"\"ee\"", CSV_Q, CSV_D,
+        {"one", "t\"w\"o", "th\"r\"ee", NULL}},
+    {"one|t\"w\"o|th\"r\"ee", PSV_Q, PSV_D,
+        {"one", "t\"w\"o", "th\"r\"ee", NULL}},
+    {"one,\"entry \"number\" two\",three", CSV_Q, CSV_D,
+        {"one", "entry \"number\" two", "three", NULL}},
+    {"one,\"two\nthree\",four", CSV_Q, CSV_D,
+        {"one", "two\nthree", "four", NULL}},
+    {"one,\"\",three", CSV_Q, CSV_D, {"one", "", "three", NULL}},
+    {"one,,three", CSV_Q, CSV_D, {"one", "", "three", NULL}},
+    {"one||three", PSV_Q, PSV_D, {"one", "", "three", NULL}},
+    {",\"\",\"three\",\"\"", CSV_Q, CSV_D, {"", "", "three", "", NULL}},
+    {",,three,", CSV_Q, CSV_D, {"", "", "three", NULL}},
+    {"||three|", PSV_Q, PSV_D, {"", "", "three", NULL}},
+    {"one,two\n", CSV_Q, CSV_D, {"one", "two", NULL}},
+    {"one,two\r\nthree", CSV_Q, CSV_D, {"one", "two", NULL}},
+    {"one,\nthree", CSV_Q, CSV_D, {"one", NULL}},
+    {"one, \nthree", CSV_Q, CSV_D, {"one", "", NULL}},
+    {"\"one\ntwo\"\nthree", CSV_Q, CSV_D, {"one\ntwo", NULL}},
+    {"\"a,b\",a\"b,\"\"\"a\"", CSV_Q, CSV_D, {"a,b", "a\"b", "\"a", NULL}},
+    {"", CSV_Q, CSV_D, {NULL}}
+};
+
+static const struct format_vector format_vectors[] = {
+    {{"one", "two", "three", NULL}, QUOTE_NEEDED, CSV_Q, CSV_D, CSV_E,
+        "one,two,three"},
+    {{"one", "two", "three", NULL}, QUOTE_NONE, PSV_Q, PSV_D, PSV_E,
+        "one|two|three"},
+    {{"one", "two", "three", NULL}, QUOTE_ALL, CSV_Q, CSV_D, CSV_E,
+        "\"one\",\"two\",\"three\""},
+    {{"one", "two\nthree", "four", NULL}, QUOTE_NEEDED, CSV_Q, CSV_D, CSV_E,
+        "one,\"two\nthree\",four"},
+    {{" one", "", "three ", NULL}, QUOTE_NEEDED, CSV_Q, CSV_D, CSV_E,
+        "\" one\",,\"three \""},
+    {{"12", "ab", "", NULL}, QUOTE_NONNUMERIC, CSV_Q, CSV_D, CSV_E,
+        "12,\"ab\","},
+    {{"a,b", "a\"b", "\"a", NULL}, QUOTE_NEEDED, CSV_Q, CSV_D, CSV_E,
+        "\"a,b\",a\"b,\"\"\"a\""},
+    {{"one", "", NULL}, QUOTE_NEEDED, CSV_Q, CSV_D, CSV_E, "one,\"\""},
+    {{"a\"b", "", "c", NULL}, QUOTE_ALL, CSV_Q, CSV_D, CSV_E,
+        "\"a\"\"b\",\"\",\"c\""},
+    {{"", "two", NULL}, QUOTE_NEEDED, CSV_Q, CSV_D, CSV_E, ",two"},
+    {{"a,b", "c\\d", NULL}, QUOTE_NONE, CSV_Q, CSV_D, '\\',
+        "a\\,b,c\\\\d"},
+    {{NULL}, QUOTE_NEEDED, CSV_Q, CSV_D, CSV_E, ""}
+};
+
+static TMCHAR* test_widen(const char* s) {
+    size_t i, n = strlen(s);
+    TMCHAR* w = calloc(n+1, sizeof(TMCHAR));
+    for (i = 0; i < n; ++i) {
+        w[i] = (TMCHAR)(unsigned char)s[i];
+    }
+    return w;
+}
+
+static int test_equal(const TMCHAR* w, const char* s) {
+    size_t i;
+    for (i = 0; s[i]; ++i) {
+        if (w[i] != (TMCHAR)(unsigned char)s[i]) {
+            return FALSE;
+        }
+    }
+    return w[i] == '\0';
+}
+
+static void test_parse(const struct parse_vector* v) {
+    struct ua_dsv_lazy_row_u8 l8;
+    struct ua_dsv_lazy_row lw;
+    const char** r8;
+    const TMCHAR** rw;
+    TMCHAR* input;
+    size_t i, n, len;
+
+    r8 = ua_parse_dsv_u8(v->input, v->quote, v->delim);
+    assert(r8);
+    for (i = 0; v->expected[i]; ++i) {
+        assert(r8[i] && !strcmp(r8[i], v->expected[i]));
+    }
+    assert(r8[i] == NULL);
+    ua_free_dsv_u8(r8);
+
+    /* lazily, last field first; values are resolved once */
+    n = i;
+    ua_dsv_lazy_init_u8(&l8);
+    assert(ua_parse_dsv_lazy_u8(&l8, v->input, v->quote, v->delim));
+    assert(l8.nfields == n && !ua_dsv_lazy_get_u8(&l8, n, NULL));
+    for (i = n; i-- > 0; ) {
+        const char* value = ua_dsv_lazy_get_u8(&l8, i, &len);
+        assert(!strcmp(value, v->expected[i]) && len == strlen(value));
+        assert(ua_dsv_lazy_get_u8(&l8, i, NULL) == value);
+    }
+    ua_dsv_lazy_free_u8(&l8);
+
+    input = test_widen(v->input);
+    rw = ua_parse_dsv(input, v->quote, v->delim);
+    assert(rw);
+    for (i = 0; v->expected[i]; ++i) {
+        assert(rw[i] && test_equal(rw[i], v->expected[i]));
+    }
+    assert(rw[i] == NULL);
+    ua_free_dsv(rw);
+
+    ua_dsv_lazy_init(&lw);
+    assert(ua_parse_dsv_lazy(&lw, input, v->quote, v->delim));
+    assert(lw.nfields == n);
+    for (i = n; i-- > 0; ) {
+        assert(test_equal(ua_dsv_lazy_get(&lw, i, NULL), v->expected[i]));
+    }
+    ua_dsv_lazy_free(&lw);
+    free((void*)input);
+}
+
+static void test_format(const struct format_vector* v) {
+    const TMCHAR* wide[6];
+    const char* r8;
+    const TMCHAR* rw;
+    size_t i;
+
+    r8 = ua_format_dsv_u8((const char**)v->fields, v->quoting,
+                          v->quote, v->delim, v->escape);
+    assert(r8 && !strcmp(r8, v->expected));
+    ua_dsv_free(r8);
+
+    for (i = 0; v->fields[i]; ++i) {
+        wide[i] = test_widen(v->fields[i]);
+    }
+    wide[i] = NULL;
+    rw = ua_format_dsv(wide, v->quoting, v->quote, v->delim, v->escape);
+    assert(rw && test_equal(rw, v->expected));
+    ua_dsv_free(rw);
+    for (i = 0; wide[i]; ++i) {
+        free((void*)wide[i]);
+    }
+}
+
+static void test_stats(void) {
+    static const char* fields[] = {"a b", "c\nd", NULL};
+    struct ua_dsv_stats stats;
+    const char** r8;
+    const char* f8;
+
+    memset(&stats, 0, sizeof(stats));
+    stats.flags = UA_DSV_STATS_TIMING;
+    ua_dsv_stats_attach(&stats);
+    r8 = ua_parse_csv_u8("one,\"t\"x\",three\nfour");
+    f8 = ua_format_csv_u8(fields);
+    ua_free_dsv_u8(r8);
+    ua_dsv_free(f8);
+    ua_dsv_stats_attach(NULL);
+
+    assert(stats.records == 1 && stats.fields == 3);
+    assert(stats.quoted_fields == 1 && stats.rogue_quotes == 1);
+    assert(stats.bytes_scanned == 16);
+    assert(stats.records_formatted == 1 && stats.fields_formatted == 2);
+    assert(stats.fields_quoted == 1 && stats.bytes_formatted == 9);
+    assert(stats.calls[UA_DSV_API_PARSE] == 1);
+    assert(stats.calls[UA_DSV_API_FORMAT] == 1);
+    assert(stats.calls[UA_DSV_API_DSVTOK] == 0);
+    /* three fields, the vector, the format scratch and the string */
+    assert(stats.allocs > 0 && stats.frees == 5);
+
+    ua_dsv_stats_reset(&stats);
+    assert(stats.fields == 0 && stats.flags == UA_DSV_STATS_TIMING);
+}
+
+static void test_row(void) {
+    struct ua_dsv_row_u8 row;
+    struct ua_dsv_stats stats;
+    size_t i, j;
+
+    /* one row reused for every vector, largest or not */
+    ua_dsv_row_init_u8(&row);
+    for (i = 0; i < sizeof(parse_vectors)/sizeof(parse_vectors[0]); ++i) {
+        const struct parse_vector* v = &parse_vectors[i];
+        assert(ua_parse_dsv_into_u8(&row, v->input, v->quote, v->delim));
+        for (j = 0; v->expected[j]; ++j) {
+            assert(row.fields[j] && !strcmp(row.fields[j], v->expected[j]));
+            assert(row.lens[j] == strlen(v->expected[j]));
+        }
+        assert(row.fields[j] == NULL && row.nfields == j);
+    }
+
+    /* steady state: rows no larger than before cost nothing */
+    memset(&stats, 0, sizeof(stats));
+    ua_dsv_stats_attach(&stats);
+    for (i = 0; i < 100; ++i) {
+        assert(ua_parse_dsv_into_u8(&row, "1,\"two\",3\n", CSV_Q, CSV_D));
+        assert(row.nfields == 3 && !strcmp(row.fields[1], "two"));
+    }
+    ua_dsv_stats_attach(NULL);
+    assert(stats.allocs == 0 && stats.records == 100);
+    ua_dsv_row_free_u8(&row);
+}
+
+struct test_scan {
+    char fields[8][16];
+    int flags[8];
+    char records[4][16];
+    size_t nfields[4];
+    size_t nf;
+    size_t nr;
+    size_t stop_after;  /* records to scan, or 0 for all */
+};
+
+static int test_scan_field(void* user, const char* field, size_t len,
+                           int flags) {
+    struct test_scan* t = user;
+    if (flags & UA_DSV_FIELD_UNESCAPE) {
+        ua_dsv_unescape_u8(field, len, CSV_Q, t->fields[t->nf]);
+    } else {
+        memcpy(t->fields[t->nf], field, len);
+    }
+    t->flags[t->nf++] = flags;
+    return TRUE;
+}
+
+static int test_scan_record(void* user, const char* record, size_t len,
+                            size_t nfields) {
+    struct test_scan* t = user;
+    memcpy(t->records[t->nr], record, len);
+    t->nfields[t->nr++] = nfields;
+    return t->nr != t->stop_after;
+}
+
+static void test_scan(void) {
+    static const char input[] = "a,\"b\"\"c\"\r\n\n  d  ,e";
+    struct ua_dsv_stats stats;
+    struct test_scan t;
+
+    memset(&t, 0, sizeof(t));
+    memset(&stats, 0, sizeof(stats));
+    ua_dsv_stats_attach(&stats);
+    assert(ua_dsv_scan_u8(input, strlen(input), CSV_Q, CSV_D,
+                          test_scan_field, test_scan_record, &t) ==
+           strlen(input));
+    ua_dsv_stats_attach(NULL);
+    assert(stats.allocs == 0 && stats.records == 3 && stats.fields == 4);
+
+    assert(t.nf == 4 && t.nr == 3);
+    assert(!strcmp(t.fields[0], "a") && t.flags[0] == 0);
+    assert(!strcmp(t.fields[1], "b\"c"));
+    assert(t.flags[1] == (UA_DSV_FIELD_QUOTED | UA_DSV_FIELD_UNESCAPE));
+    assert(!strcmp(t.fields[2], "d") && !strcmp(t.fields[3], "e"));
+    assert(!strcmp(t.records[0], "a,\"b\"\"c\"") && t.nfields[0] == 2);
+    assert(!strcmp(t.records[1], "") && t.nfields[1] == 0);
+    assert(!strcmp(t.records[2], "  d  ,e") && t.nfields[2] == 2);
+
+    /* stopping after the first record consumes its CRLF */
+    memset(&t, 0, sizeof(t));
+    t.stop_after = 1;
+    assert(ua_dsv_scan_u8(input, strlen(input), CSV_Q, CSV_D,
+                          test_scan_field, test_scan_record, &t) == 10);
+}
+
+/* first record of the input, as seen by the push parser */
+struct test_push {
+    char fields[6][32];
+    size_t nf;
+    size_t nr;
+};
+
+static int test_push_field(void* user, const char* field, size_t len,
+                           int flags) {
+    struct test_push* t = user;
+    (void)flags;
+    assert(strlen(field) == len && len < 32);
+    if (t->nr == 0) {
+        assert(t->nf < 6);
+        strcpy(t->fields[t->nf++], field);
+    }
+    return TRUE;
+}
+
+static int test_push_record(void* user, const char* record, size_t len,
+                            size_t nfields) {
+    struct test_push* t = user;
+    (void)len;
+    assert(record == NULL);
+    assert(t->nr != 0 || nfields == t->nf);
+    t->nr += 1;
+    return TRUE;
+}
+
+static void test_push_split(const struct parse_vector* v, size_t split,
+                            size_t step) {
+    struct test_push t;
+    struct ua_dsv_parser_u8* p;
+    size_t len = strlen(v->input);
+    size_t i;
+
+    memset(&t, 0, sizeof(t));
+    p = ua_dsv_parser_new_u8(v->quote, v->delim,
+                             test_push_field, test_push_record, &t);
+    assert(p);
+    /* everything before the split at once, then the rest by step */
+    assert(ua_dsv_feed_u8(p, v->input, split));
+    for (i = split; i < len; i += step) {
+        assert(ua_dsv_feed_u8(p, v->input + i,
+                              len - i < step ? len - i : step));
+    }
+    assert(ua_dsv_finish_u8(p));
+    ua_dsv_parser_free_u8(p);
+
+    for (i = 0; v->expected[i]; ++i) {
+        assert(i < t.nf && !strcmp(t.fields[i], v->expected[i]));
+    }
+    assert(i == t.nf);
+}
+
+static void test_push(void) {
+    size_t i, split;
+    for (i = 0; i < sizeof(parse_vectors)/sizeof(parse_vectors[0]); ++i) {
+        const struct parse_vector* v = &parse_vectors[i];
+        for (split = 0; split <= strlen(v->input); ++split) {
+            test_push_split(v, split, strlen(v->input) + 1);
+            test_push_split(v, split, 1);
+        }
+    }
+}
+
+static void test_transcode(void) {
+    static const char input[] = "a|b c|\n\r\n\"x|y\"\"\"|12\r";
+    char* out = NULL;
+    size_t len = 0, cap = 0;
+
+    /* the record ending in '\r' may still get its '\n' */
+    assert(ua_dsv_transcode_u8(input, strlen(input), FALSE, '"', '|',
+                               &out, &len, &cap,
+                               QUOTE_NEEDED, CSV_Q, CSV_D, 0) == 9);
+    assert(len == 7 && !memcmp(out, "a,b c\n\n", len));
+    assert(ua_dsv_transcode_u8(input + 9, strlen(input) - 9, TRUE,
+                               '"', '|', &out, &len, &cap,
+                               QUOTE_NEEDED, CSV_Q, CSV_D, 0) ==
+           strlen(input) - 9);
+    assert(len == 18 && !memcmp(out + 7, "\"x|y\"\"\",12\n", 11));
+
+    /* and back, with a distinct escape character */
+    len = 0;
+    assert(ua_dsv_transcode_u8("\"a,b\",c\\d", 9, TRUE, CSV_Q, CSV_D,
+                               &out, &len, &cap,
+                               QUOTE_NONE, 0, PSV_D, '\\') == 9);
+    assert(len == 9 && !memcmp(out, "a,b|c\\\\d\n", len));
+    ua_dsv_free(out);
+}
+
+static void test_vectors(void) {
+    size_t i;
+    for (i = 0; i < sizeof(parse_vectors)/sizeof(parse_vectors[0]); ++i) {
+        test_parse(&parse_vectors[i]);
+    }
+    for (i = 0; i < sizeof(format_vectors)/sizeof(format_vectors[0]); ++i) {
+        test_format(&format_vectors[i]);
+    }
+}
+
+static void test_allocators(void) {
+    /* small arena blocks so that the vectors spill into new blocks */
+    struct ua_dsv_arena* arena = ua_dsv_arena_new(64);
+    struct ua_dsv_pool* pool = ua_dsv_pool_new();
+    struct ua_dsv_allocator allocator;
+    char* big;
+    size_t i;
+
+    allocator = ua_dsv_arena_allocator(arena);
+    ua_dsv_set_allocator(&allocator);
+    for (i = 0; i < 3; ++i) {
+        test_vectors();
+        ua_dsv_arena_reset(arena);
+    }
+
+    allocator = ua_dsv_pool_allocator(pool);
+    ua_dsv_set_allocator(&allocator);
+    for (i = 0; i < 3; ++i) {
+        test_vectors();
+    }
+    /* fields beyond the largest size class fall back to malloc */
+    big = calloc(10000, 1);
+    memset(big, 'x', 9999);
+    big[5000] = ',';
+    {
+        const char** r8 = ua_parse_csv_u8(big);
+        assert(r8 && strlen(r8[0]) == 5000 && strlen(r8[1]) == 4998);
+        ua_free_dsv_u8(r8);
+    }
+    free(big);
+
+    ua_dsv_set_allocator(NULL);
+    assert(ua_dsv_get_allocator().ctx == NULL);
+    ua_dsv_arena_free(arena);
+    ua_dsv_pool_free(pool);
+}
+
+/* stand-in for a database cursor: the same row, nrows times */
+struct test_source {
+    long nrows;
+    long next;
+};
+
+static long test_fetch(void* user, const char*** rows, long max) {
+    static const char* row[] = {"alpha", "be ta", "7", NULL};
+    struct test_source* src = user;
+    long n = 0;
+    while (n < max && src->next < src->nrows) {
+        rows[n++] = row;
+        src->next += 1;
+    }
+    return n;
+}
+
+/* sink standing in for a slow disk */
+struct test_sink {
+    long delay_ns;
+    size_t chars;
+};
+
+static int test_write(void* user, const TMCHAR* text, size_t len) {
+    struct test_sink* sink = user;
+    struct timespec delay;
+    delay.tv_sec = 0;
+    delay.tv_nsec = sink->delay_ns;
+    nanosleep(&delay, NULL);
+    assert(tmstrlen(text) == len);
+    sink->chars += len;
+    return TRUE;
+}
+
+static void test_export(void) {
+    struct test_source src = {250, 0};
+    struct test_sink out = {1000000, 0};
+    struct ua_dsv_source source = {test_fetch, &src};
+    struct ua_dsv_sink sink = {test_write, &out};
+    struct ua_dsv_export_metrics metrics;
+    char trace[8192];
+    size_t len;
+    const char* p;
+    int events = 0;
+
+    memset(&metrics, 0, sizeof(metrics));
+    metrics.trace = tmpfile();
+    assert(metrics.trace);
+    assert(ua_dsv_export(&source, &sink, 64, QUOTE_NEEDED,
+                         CSV_Q, CSV_D, CSV_E, &metrics) == 250);
+
+    /* "alpha,be ta,7\n" per row, in 4 batches and 5 fetches */
+    assert(out.chars == 250*14 && metrics.chars == out.chars);
+    assert(metrics.rows == 250 && metrics.batches == 4);
+    assert(metrics.stages[UA_DSV_STAGE_FETCH].count == 5);
+    assert(metrics.stages[UA_DSV_STAGE_WRITE].count == 4);
+    assert(metrics.stages[UA_DSV_STAGE_WRITE].min >= 1000000);
+    assert(ua_dsv_histogram_percentile(
+               &metrics.stages[UA_DSV_STAGE_WRITE], 50) >= 1000000);
+    assert(ua_dsv_histogram_percentile(
+               &metrics.stages[UA_DSV_STAGE_WRITE], 100) ==
+           metrics.stages[UA_DSV_STAGE_WRITE].max);
+
+    rewind(metrics.trace);
+    len = fread(trace, 1, sizeof(trace)-1, metrics.trace);
+    trace[len] = '\0';
+    fclose(metrics.trace);
+    assert(!strncmp(trace, "{\"traceEvents\":[", 16));
+    for (p = trace; (p = strstr(p, "\"ph\":\"X\"")); ++p) {
+        events += 1;
+    }
+    assert(events == 5 + 3*4);
+    assert(strstr(trace, "\n],\"displayTimeUnit\":\"ms\"}\n"));
+}
+
+static void test_index(void) {
+    static const char path[] = "gua2csv-test-index.csv";
+    static const char data[] = "a,\"b\nc\"\r\n\nd\n";
+    struct ua_dsv_index index, loaded;
+    struct ua_dsv_range ranges[3];
+    FILE* f = fopen(path, "wb");
+
+    assert(f && fputs(data, f) != EOF && fclose(f) == 0);
+    assert(ua_dsv_index_build(&index, path, CSV_Q, CSV_D, 2));
+    assert(index.records == 3 && index.end == strlen(data));
+    assert(index.noffsets == 2);
+    assert(index.offsets[0] == 0 && index.offsets[1] == 10);
+
+    /* built and saved, then loaded */
+    assert(ua_dsv_index_open(&loaded, path, NULL, CSV_Q, CSV_D, 2));
+    ua_dsv_index_free(&loaded);
+    assert(ua_dsv_index_open(&loaded, path, NULL, CSV_Q, CSV_D, 0));
+    assert(loaded.records == 3 && loaded.noffsets == 2);
+    assert(loaded.offsets[1] == 10 && ua_dsv_index_fresh(&loaded, path));
+
+    /* record 1 is the blank line after the quoted newline */
+    f = fopen(path, "rb");
+    assert(ua_dsv_index_seek(&loaded, f, 1) && ftell(f) == 9);
+    assert(ua_dsv_index_seek(&loaded, f, 2) && ftell(f) == 10);
+    assert(!ua_dsv_index_seek(&loaded, f, 3));
+    fclose(f);
+
+    assert(ua_dsv_index_split(&loaded, 3, ranges) == 2);
+    assert(ranges[0].offset == 0 && ranges[0].length == 10);
+    assert(ranges[0].first == 0 && ranges[0].records == 2);
+    assert(ranges[1].offset == 10 && ranges[1].length == 2);
+    assert(ranges[1].first == 2 && ranges[1].records == 1);
+
+    ua_dsv_index_free(&index);
+    ua_dsv_index_free(&loaded);
+    remove("gua2csv-test-index.csv.dsvidx");
+    remove(path);
+}
+
+/* records reported by a follower, as "field|field;" */
+struct test_follow {
+    char text[128];
+};
+
+static int test_follow_field(void* user, const char* field, size_t len,
+                             int flags) {
+    struct test_follow* t = user;
+    (void)flags;
+    strncat(t->text, field, len);
+    strcat(t->text, "|");
+    return TRUE;
+}
+
+static int test_follow_record(void* user, const char* record, size_t len,
+                              size_t nfields) {
+    struct test_follow* t = user;
+    (void)record;
+    (void)len;
+    (void)nfields;
+    strcat(t->text, ";");
+    return TRUE;
+}
+
+static void test_follow_append(const char* path, const char* mode,
+                               const char* data) {
+    FILE* f = fopen(path, mode);
+    assert(f && fputs(data, f) != EOF && fclose(f) == 0);
+}
+
+static void test_follow(void) {
+    static const char path[] = "gua2csv-test-follow.csv";
+    struct test_follow t;
+    struct ua_dsv_follower* f;
+
+    remove(path);
+    memset(&t, 0, sizeof(t));
+    f = ua_dsv_follow_new(path, 0, CSV_Q, CSV_D, test_follow_field,
+                          test_follow_record, &t);
+    assert(f && ua_dsv_follow_poll(f) == 0);
+
+    /* the quoted newline and the lone '\r' do not end the record yet */
+    test_follow_append(path, "wb", "a,\"b\nc");
+    assert(ua_dsv_follow_poll(f) == 0 && ua_dsv_follow_offset(f) == 0);
+    test_follow_append(path, "ab", "\",d\r");
+    assert(ua_dsv_follow_poll(f) == 0);
+    test_follow_append(path, "ab", "\ne,f\ng");
+    assert(ua_dsv_follow_poll(f) == 2 && ua_dsv_follow_offset(f) == 15);
+    assert(!strcmp(t.text, "a|b\nc|d|;e|f|;"));
+    assert(ua_dsv_follow_poll(f) == 0);
+
+    /* nothing new times out, once the events of the appends above are
+     * drained; something new ends even an endless wait */
+    assert(ua_dsv_follow_wait(f, 0) >= 0);
+    assert(ua_dsv_follow_wait(f, 0) == FALSE);
+    assert(ua_dsv_follow_wait(f, FOLLOW_TICK + 1) == FALSE);
+    test_follow_append(path, "ab", "\n");
+    assert(ua_dsv_follow_wait(f, -1) == TRUE);
+    assert(ua_dsv_follow_poll(f) == 1 && ua_dsv_follow_offset(f) == 17);
+    t.text[0] = '\0';
+
+    /* truncated to something shorter: read again from the start */
+    t.text[0] = '\0';
+    test_follow_append(path, "wb", "h\n");
+    assert(ua_dsv_follow_poll(f) == 1 && !strcmp(t.text, "h|;"));
+    assert(ua_dsv_follow_offset(f) == 2);
+    ua_dsv_follow_free(f);
+
+    /* resumed from a saved offset */
+    t.text[0] = '\0';
+    test_follow_append(path, "ab", "i\n");
+    f = ua_dsv_follow_new(path, 2, CSV_Q, CSV_D, test_follow_field,
+                          test_follow_record, &t);
+    assert(f && ua_dsv_follow_poll(f) == 1 && !strcmp(t.text, "i|;"));
+    ua_dsv_follow_free(f);
+    remove(path);
+}
+
+/* groups reported by an aggregation, as "key=count/n:sum:min:max;" */
+struct test_agg {
+    char text[256];
+};
+
+static int test_agg_group(void* user, const char* const* keys,
+                          const size_t* lens, size_t nkeys, uint64_t count,
+                          const struct ua_dsv_agg_value* values,
+                          size_t nvalues) {
+    struct test_agg* t = user;
+    char* end = t->text + strlen(t->text);
+    assert(nkeys <= 1 && nvalues == 1);
+    sprintf(end, "%.*s=%u/%u:%g:%g:%g;", nkeys ? (int)lens[0] : 0,
+            nkeys ? keys[0] : "",
+            (unsigned)count, (unsigned)values[0].count, values[0].sum,
+            values[0].min, values[0].max);
+    return TRUE;
+}
+
+static void test_agg(void) {
+    static const char data[] = "a,1\nb,2\n\"a\",3\nc,x\nb,\n\"d,e\",5\n";
+    static const char* const groups[] = {
+        "a=2/2:4:1:3;", "b=2/1:2:2:2;", "c=1/0:0:0:0;", "d,e=1/1:5:5:5;"
+    };
+    const size_t key = 0;
+    const size_t value = 1;
+    size_t budget, i;
+
+    /* all in memory, then spilled after the first group */
+    for (budget = 0; budget < 2; ++budget) {
+        struct test_agg t;
+        struct ua_dsv_agg* a = ua_dsv_agg_new(CSV_Q, &key, 1, &value, 1,
+                                              budget, NULL);
+        memset(&t, 0, sizeof(t));
+        assert(a);
+        ua_dsv_scan_u8(data, strlen(data), CSV_Q, CSV_D, ua_dsv_agg_on_field,
+                       ua_dsv_agg_on_record, a);
+        assert(ua_dsv_agg_spilled(a) == (budget ? 4 : 0));
+        assert(ua_dsv_agg_finish(a, test_agg_group, &t));
+        for (i = 0; i < sizeof(groups) / sizeof(groups[0]); ++i) {
+            assert(strstr(t.text, groups[i]));
+        }
+        assert(strlen(t.text) == strlen(groups[0]) + strlen(groups[1]) +
+                                 strlen(groups[2]) + strlen(groups[3]));
+        ua_dsv_agg_free(a);
+    }
+
+    /* no key columns: one group of every record, which is never spilled */
+    for (budget = 0; budget < 2; ++budget) {
+        struct test_agg t;
+        struct ua_dsv_agg* a = ua_dsv_agg_new(CSV_Q, NULL, 0, &value, 1,
+                                              budget, NULL);
+        memset(&t, 0, sizeof(t));
+        assert(a);
+        ua_dsv_scan_u8(data, strlen(data), CSV_Q, CSV_D, ua_dsv_agg_on_field,
+                       ua_dsv_agg_on_record, a);
+        assert(ua_dsv_agg_spilled(a) == 0);
+        assert(ua_dsv_agg_finish(a, test_agg_group, &t));
+        assert(!strcmp(t.text, "=6/4:11:1:5;"));
+        ua_dsv_agg_free(a);
+    }
+}
+
+static void test_profile(void) {
+    static const char data[] = "a,10\nb,9\n\"a\",010\n\"\",x\nc\n";
+    struct ua_dsv_profile* whole = ua_dsv_profile_new(CSV_Q);
+    struct ua_dsv_profile* part = ua_dsv_profile_new(CSV_Q);
+    struct ua_dsv_column_profile c;
+
+    /* the first two records on their own, merged into the rest */
+    assert(whole && part);
+    ua_dsv_scan_u8(data, 9, CSV_Q, CSV_D, ua_dsv_profile_on_field,
+                   ua_dsv_profile_on_record, part);
+    ua_dsv_scan_u8(data + 9, strlen(data) - 9, CSV_Q, CSV_D,
+                   ua_dsv_profile_on_field, ua_dsv_profile_on_record, whole);
+    assert(ua_dsv_profile_merge(whole, part));
+    assert(ua_dsv_profile_records(whole) == 5);
+    assert(ua_dsv_profile_columns(whole) == 2);
+
+    assert(ua_dsv_profile_column(whole, 0, &c));
+    assert(c.count == 5 && c.nulls == 0 && c.empty == 1 && c.numeric == 0);
+    assert(c.shortest == 0 && c.longest == 1);
+    assert(c.min_len == 1 && *c.min == 'a' && *c.max == 'c');
+    assert(!c.min_number && !c.max_number);
+    assert(c.distinct > 3.5 && c.distinct < 4.5);
+
+    assert(ua_dsv_profile_column(whole, 1, &c));
+    assert(c.count == 4 && c.nulls == 1 && c.empty == 0 && c.numeric == 3);
+    assert(c.shortest == 1 && c.longest == 3);
+    assert(c.min_len == 3 && !memcmp(c.min, "010", 3));
+    assert(c.max_len == 1 && *c.max == 'x');
+    assert(c.min_number_len == 1 && *c.min_number == '9');
+    /* 10 and 010 tie; the profile merged into keeps its own */
+    assert(c.max_number_len == 3 && !memcmp(c.max_number, "010", 3));
+    assert(!ua_dsv_profile_column(whole, 2, &c) && errno == EINVAL);
+
+    ua_dsv_profile_free(whole);
+    ua_dsv_profile_free(part);
+}
+
+static void test_profile_distinct(void) {
+    struct ua_dsv_profile* p = ua_dsv_profile_new(CSV_Q);
+    struct ua_dsv_column_profile c;
+    char record[32];
+    unsigned long i;
+
+    /* against log(2), log(10) and log(4096) */
+    assert(profile_log(1) == 0);
+    assert(profile_log(2) - 0.6931471805599453 < 1e-15 &&
+           profile_log(2) - 0.6931471805599453 > -1e-15);
+    assert(profile_log(10) - 2.302585092994046 < 1e-14 &&
+           profile_log(10) - 2.302585092994046 > -1e-14);
+    assert(profile_log(4096) - 8.317766166719343 < 1e-14 &&
+           profile_log(4096) - 8.317766166719343 > -1e-14);
+
+    /* linear counting for few values, HyperLogLog for many */
+    assert(p);
+    for (i = 0; i < 100000; ++i) {
+        size_t len = (size_t)sprintf(record, "v%lu\n", i);
+        ua_dsv_scan_u8(record, len, CSV_Q, CSV_D, ua_dsv_profile_on_field,
+                       ua_dsv_profile_on_record, p);
+        if (i == 999) {
+            assert(ua_dsv_profile_column(p, 0, &c));
+            assert(c.distinct > 980 && c.distinct < 1020);
+        }
+    }
+    assert(ua_dsv_profile_column(p, 0, &c));
+    assert(c.distinct > 95000 && c.distinct < 105000);
+    ua_dsv_profile_free(p);
+}
+
+struct test_check {
+    char text[256];
+    char records[256];
+};
+
+static int test_check_record(void* user, const char* record, size_t len,
+                             uint64_t line, size_t nfields, int problems) {
+    struct test_check* t = user;
+    size_t n = strlen(t->text);
+    (void)nfields;
+    sprintf(t->text + n, "%lu:%d;", (unsigned long)line, problems);
+    strncat(t->records, record, len);
+    return TRUE;
+}
+
+static void test_check(void) {
+    static const char data[] = "a,b\n1,2,3\n\"x\"\"y\",z\r\n\nlongvalue,q\n"
+                               "\"k  \",\" \"\nu,\"open\nv,w\n";
+    struct test_check t;
+
+    /* every record is reported, and only the line of the open quote */
+    memset(&t, 0, sizeof(t));
+    assert(ua_dsv_check_u8(data, strlen(data), CSV_Q, CSV_D, 0, 5,
+                           test_check_record, &t) == strlen(data));
+    assert(!strcmp(t.text, "1:0;2:1;3:0;4:1;5:2;6:0;7:4;8:0;"));
+    assert(!strcmp(t.records, data));
+}
+
+static void test_bin(void) {
+    static const char* const names[2] = {"id", "name"};
+    static const size_t name_lens[2] = {2, 4};
+    static const char* const rows[3][4] = {
+        {"1", "a|b\n\"c\"", NULL, NULL},
+        {"2", NULL, NULL, NULL},
+        {"", "x", NULL, "y"}
+    };
+    static const size_t nfields[4] = {2, 2, 4, 0};
+    struct ua_dsv_bin_reader reader;
+    struct ua_dsv_bin_row row;
+    char data[256];
+    size_t len, lens[4], i, j;
+
+    /* header, three rows, and a row without fields */
+    len = ua_dsv_bin_put_header(data, names, name_lens, 2);
+    assert(len == ua_dsv_bin_put_header(NULL, names, name_lens, 2));
+    for (i = 0; i < 4; ++i) {
+        const char* const* fields = i < 3 ? rows[i] : NULL;
+        size_t n;
+        for (j = 0; j < nfields[i]; ++j) {
+            lens[j] = fields[j] ? strlen(fields[j]) : 0;
+        }
+        n = ua_dsv_bin_put_row(data + len, fields, lens, nfields[i]);
+        assert(n == ua_dsv_bin_put_row(NULL, fields, lens, nfields[i]));
+        len += n;
+    }
+
+    ua_dsv_bin_row_init(&row);
+    assert(ua_dsv_bin_open(&reader, data, len));
+    assert(reader.columns.nfields == 2);
+    assert(reader.columns.lens[1] == 4);
+    assert(!memcmp(reader.columns.fields[1], "name", 4));
+    for (i = 0; i < 4; ++i) {
+        assert(ua_dsv_bin_next(&reader, &row) == 1);
+        assert(row.nfields == nfields[i]);
+        for (j = 0; j < row.nfields; ++j) {
+            const char* want = rows[i][j];
+            if (!want) {
+                assert(!row.fields[j]);
+            } else {
+                assert(row.fields[j] && row.lens[j] == strlen(want));
+                assert(!memcmp(row.fields[j], want, row.lens[j]));
+                /* in place, not copied */
+                assert(row.fields[j] > data && row.fields[j] < data + len);
+            }
+        }
+    }
+    assert(ua_dsv_bin_next(&reader, &row) == 0);
+    ua_dsv_bin_close(&reader);
+
+    /* a stream cut short, and one that is not a stream */
+    assert(ua_dsv_bin_open(&reader, data, len - 1));
+    for (i = 0; i < 3; ++i) {
+        assert(ua_dsv_bin_next(&reader, &row) == 1);
+    }
+    errno = 0;
+    assert(ua_dsv_bin_next(&reader, &row) == -1 && errno == EINVAL);
+    ua_dsv_bin_close(&reader);
+    data[0] = 'X';
+    errno = 0;
+    assert(!ua_dsv_bin_open(&reader, data, len) && errno == EINVAL);
+    ua_dsv_bin_row_free(&row);
+}
+
+static void test_arrow(void) {
+    static const struct ua_dsv_arrow_column columns[3] = {
+        {"id", UA_ARROW_INT64}, {"name", UA_ARROW_UTF8},
+        {"state", UA_ARROW_DICT}
+    };
+    static const char* const good[] = {"-12", "ann", "OR", NULL};
+    static const char* const bad[] = {"12x", "bob", "WA", NULL};
+    static const char* const short_row[] = {"", NULL};
+    struct ua_dsv_arrow_writer* w;
+    unsigned char data[2048];
+    size_t len, pos, messages = 0;
+    FILE* f = tmpfile();
+
+    assert(f);
+    w = ua_dsv_arrow_new(f, columns, 3, 2);
+    assert(w);
+    assert(ua_dsv_arrow_add_row(w, good));
+    errno = 0;
+    assert(!ua_dsv_arrow_add_row(w, bad) && errno == EINVAL);
+    assert(ua_dsv_arrow_add_row(w, short_row));
+    assert(ua_dsv_arrow_add_row(w, good));
+    assert(ua_dsv_arrow_rows(w) == 3);
+    assert(ua_dsv_arrow_finish(w));
+    ua_dsv_arrow_free(w);
+
+    /* schema, dictionary, batch, delta-free batch, end: every message is
+     * a marker, an 8-aligned metadata size and a body the metadata sizes */
+    rewind(f);
+    len = fread(data, 1, sizeof(data), f);
+    fclose(f);
+    for (pos = 0; pos + 8 <= len; ++messages) {
+        uint32_t size = data[pos+4] | data[pos+5] << 8 | data[pos+6] << 16 |
+                        (uint32_t)data[pos+7] << 24;
+        uint64_t body;
+        assert(!memcmp(data + pos, "\xff\xff\xff\xff", 4));
+        if (size == 0) {
+            break;
+        }
+        assert(size % 8 == 0);
+        /* bodyLength is the 8-byte field of the Message table, first in
+         * it after the soffset */
+        body = index_get64(data + pos + 8 +
+                           (data[pos+8] | data[pos+9] << 8) + 4);
+        assert(body % 8 == 0);
+        pos += 8 + size + body;
+    }
+    assert(messages == 4 && pos + 8 == len);
+}
+
+int main(void) {
+    test_vectors();
+    test_row();
+    test_scan();
+    test_push();
+    test_transcode();
+    test_index();
+    test_follow();
+    test_agg();
+    test_profile();
+    test_profile_distinct();
+    test_check();
+    test_bin();
+    test_arrow();
+    test_allocators();
+    test_stats();
+    test_export();
+    fprintf(stderr, "PASS\n");
+    return 0;
+}
+
+#endif /* def TEST */
+/* }}} REGION: TESTS */
@@ -10,6 +10,25 @@
 /*                                                                           */
 /* 2016/02/12 sxpws Initial commit                                           */
 /* 2016/02/14 sxpws Added ua_free_dsv                                        */
+/* 2026/10/18 sxpws Added char/UTF-8 flavor of the parser and formatter      */
+/* 2026/10/18 sxpws ua_parse_dsv stops at the end of the first record        */
+/* 2026/10/18 sxpws Added ua_dsv_stats instrumentation                       */
+/* 2026/10/18 sxpws Added ua_dsv_export with per-stage latency histograms    */
+/* 2026/10/18 sxpws Added pluggable allocators, arena and size-class pool    */
+/* 2026/10/18 sxpws Added ua_dsv_row and ua_parse_dsv_into                   */
+/* 2026/10/18 sxpws Added ua_dsv_scan callback API                           */
+/* 2026/10/18 sxpws Added ua_dsv_parser push parser                          */
+/* 2026/10/18 sxpws Added ua_dsv_format_field; gua2csv.hpp C++ wrapper       */
+/* 2026/10/18 sxpws Added ua_dsv_transcode dialect converter                 */
+/* 2026/10/18 sxpws Added ua_dsv_lazy_row and ua_parse_dsv_lazy              */
+/* 2026/10/18 sxpws Added ua_dsv_index sidecar record index                  */
+/* 2026/10/18 sxpws Added ua_dsv_follower for files that are appended to     */
+/* 2026/10/18 sxpws Added ua_dsv_agg hash aggregation                        */
+/* 2026/10/18 sxpws Added ua_dsv_profile column profiler                     */
+/* 2026/10/18 sxpws Added ua_dsv_check record shape validation               */
+/* 2026/10/18 sxpws Added ua_dsv_bin binary row format                       */
+/* 2026/10/18 sxpws Added ua_dsv_arrow Arrow IPC stream writer               */
+/* 2026/10/18 sxpws ua_dsv_follow_wait reports errors, waits on timeout < 0  */
 /*                                                                           */
 /* UA AUDIT TRAIL END                                                        */
 /*****************************************************************************/
@@ -23,6 +42,9 @@ static struct TMBundle csvBundle = {"gua2csv.h", NULL, NULL, NULL, NULL};
 #define csvBundle_EXISTS
 #endif
 
+#include <stdint.h>
+#include <stdio.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* def __cplusplus */
@@ -89,6 +111,11 @@ const TMCHAR* ua_dsvtok(const TMCHAR* line,     /* parse this */
  *
  * Returns a NULL-terminated array of NULL-terminated strings or NULL on
  * error. Use ua_free_dsv to free the returned array.
+ *
+ * Parsing stops at the end of the first record: an end-of-line ('\r' or
+ * '\n') outside of quotes. A delimiter at the very end of the record does
+ * not produce a trailing empty field, so "a,b," and "a,b,\n" both parse as
+ * ["a", "b"].
  */
 const TMCHAR** ua_parse_dsv(const TMCHAR* line, TMCHAR quote, TMCHAR delim);
 
@@ -110,6 +137,280 @@ const TMCHAR** ua_parse_psv(const TMCHAR* line);
  */
 void ua_free_dsv(const TMCHAR** data);
 
+/* ua_dsv_row structure
+ *
+ * One parsed record whose storage is kept between calls to ua_parse_dsv_into,
+ * so that a loop over many rows of a similar shape stops allocating once the
+ * storage has grown to fit them. Storage only ever grows.
+ *
+ *  fields      NULL-terminated vector of the record's fields, usable wherever
+ *              a vector from ua_parse_dsv is (except ua_free_dsv)
+ *  lens        length of each field, not counting its NIL
+ *  nfields     number of fields
+ *  fields_cap  capacity of fields and lens, including the NULL
+ *  chars       characters of every field, each followed by a NIL
+ *  chars_len   characters of chars in use
+ *  chars_cap   capacity of chars
+ *
+ * Every pointer is invalidated by the next ua_parse_dsv_into on the row.
+ */
+struct ua_dsv_row {
+    const TMCHAR** fields;
+    size_t* lens;
+    size_t nfields;
+    size_t fields_cap;
+    TMCHAR* chars;
+    size_t chars_len;
+    size_t chars_cap;
+};
+
+/* ua_dsv_row_init(row)
+ *
+ * Initialize @param row to an empty row without storage.
+ */
+void ua_dsv_row_init(struct ua_dsv_row* row);
+
+/* ua_dsv_row_free(row)
+ *
+ * Release the storage of @param row, leaving it empty.
+ */
+void ua_dsv_row_free(struct ua_dsv_row* row);
+
+/* ua_parse_dsv_into(row, line, quotechar, delimchar)
+ *
+ * Parse the first record of @param line exactly as ua_parse_dsv does, but
+ * into @param row, overwriting whatever it held and growing its storage only
+ * if it is too small.
+ *
+ * @param row       row to overwrite, initialized with ua_dsv_row_init
+ * @param line      input text to parse
+ * @param quote     quoting character to use (or '\0' to disable quoting)
+ * @param delim     delimiting character to use
+ *
+ * Returns true on success, false if out of memory.
+ *
+ * Like ua_parse_dsv, this sizes its storage from the whole of @param line, so
+ * it should be given one line at a time rather than an entire file.
+ */
+int ua_parse_dsv_into(struct ua_dsv_row* row, const TMCHAR* line,
+                      TMCHAR quote, TMCHAR delim);
+
+/* ua_dsv_lazy_field structure
+ *
+ * Where one field of a lazy row lies in its line, and its value once
+ * resolved.
+ *
+ *  offset      start of the field's characters in the line, past any
+ *              opening quote and leading spaces
+ *  len         characters of the span; of the value once resolved
+ *  flags       UA_DSV_FIELD_* bits of the span (see ua_dsv_scan)
+ *  value       NIL-terminated value, or NULL until ua_dsv_lazy_get
+ */
+struct ua_dsv_lazy_field {
+    size_t offset;
+    size_t len;
+    int flags;
+    const TMCHAR* value;
+};
+
+/* ua_dsv_lazy_row structure
+ *
+ * One record whose fields have been located but not copied, for wide rows
+ * of which only a few fields are read. Parsing only records where each
+ * field lies; a field is unescaped and copied the first time it is asked
+ * for, and the value is kept until the row is parsed again. Storage is kept
+ * between calls and only ever grows, as with ua_dsv_row.
+ *
+ *  line        the text given to ua_parse_dsv_lazy, which is not copied
+ *  quote       quoting character the line was parsed with
+ *  fields      the record's fields
+ *  nfields     number of fields
+ *  fields_cap  capacity of fields
+ *  chars       storage of the resolved values
+ *  chars_cap   capacity of chars
+ */
+struct ua_dsv_lazy_row {
+    const TMCHAR* line;
+    TMCHAR quote;
+    struct ua_dsv_lazy_field* fields;
+    size_t nfields;
+    size_t fields_cap;
+    TMCHAR* chars;
+    size_t chars_cap;
+};
+
+/* ua_dsv_lazy_init(row)
+ *
+ * Initialize @param row to an empty lazy row without storage.
+ */
+void ua_dsv_lazy_init(struct ua_dsv_lazy_row* row);
+
+/* ua_dsv_lazy_free(row)
+ *
+ * Release the storage of @param row, leaving it empty.
+ */
+void ua_dsv_lazy_free(struct ua_dsv_lazy_row* row);
+
+/* ua_parse_dsv_lazy(row, line, quotechar, delimchar)
+ *
+ * Locate the fields of the first record of @param line, which ua_parse_dsv
+ * would return, in one pass and without copying them.
+ *
+ * @param row       row to overwrite, initialized with ua_dsv_lazy_init
+ * @param line      input text to parse, which must outlive the use of the
+ *                  row's values
+ * @param quote     quoting character to use (or '\0' to disable quoting)
+ * @param delim     delimiting character to use
+ *
+ * Returns true on success, false if out of memory.
+ */
+int ua_parse_dsv_lazy(struct ua_dsv_lazy_row* row, const TMCHAR* line,
+                      TMCHAR quote, TMCHAR delim);
+
+/* ua_dsv_lazy_get(row, index, len)
+ *
+ * Resolve field @param index of @param row, the first time it is asked for,
+ * and store its length in @param len unless that is NULL.
+ *
+ * Returns the NIL-terminated value, exactly as ua_parse_dsv returns it, or
+ * NULL if the record has no such field. The value stays valid until the next
+ * ua_parse_dsv_lazy or ua_dsv_lazy_free on @param row.
+ */
+const TMCHAR* ua_dsv_lazy_get(struct ua_dsv_lazy_row* row, size_t index,
+                              size_t* len);
+
+/** @region Scanning functions **/
+
+/* ua_dsv_scan field flags
+ *
+ *  UA_DSV_FIELD_QUOTED     the field was enclosed in quotes
+ *  UA_DSV_FIELD_UNESCAPE   the span still holds doubled or stray quotes;
+ *                          pass it through ua_dsv_unescape to get the value
+ *                          ua_parse_dsv would have returned
+ */
+#define UA_DSV_FIELD_QUOTED   0x1
+#define UA_DSV_FIELD_UNESCAPE 0x2
+
+/* ua_dsv_field_fn(user, field, len, flags)
+ *
+ * Called by ua_dsv_scan for each field, in order. @param field points into
+ * the scanned buffer and is not NIL terminated: it is @param len characters
+ * long, without the enclosing quotes, leading spaces or trailing spaces.
+ *
+ * Return true to continue scanning, false to stop.
+ */
+typedef int (*ua_dsv_field_fn)(void* user, const TMCHAR* field, size_t len,
+                               int flags);
+
+/* ua_dsv_record_fn(user, record, len, nfields)
+ *
+ * Called by ua_dsv_scan after the last field of each record. @param record
+ * is the raw text of the record in the scanned buffer, @param len characters
+ * long without its terminating EOL, and held @param nfields fields.
+ *
+ * Return true to continue scanning, false to stop.
+ */
+typedef int (*ua_dsv_record_fn)(void* user, const TMCHAR* record, size_t len,
+                                size_t nfields);
+
+/* ua_dsv_scan(buffer, len, quotechar, delimchar, on_field, on_record, user)
+ *
+ * Run the parser over every record of @param buffer, reporting each field
+ * and each record through callbacks instead of building vectors. Nothing is
+ * allocated and nothing is copied; fields are reported as spans of
+ * @param buffer.
+ *
+ * @param buffer    text to scan; it need not be NIL terminated, but a NIL
+ *                  ends the scan as it would end a string
+ * @param len       number of characters in @param buffer
+ * @param quote     quoting character (or '\0' to disable quoting)
+ * @param delim     delimiting character
+ * @param on_field  called for every field, or NULL
+ * @param on_record called at the end of every record, or NULL
+ * @param user      passed to the callbacks unchanged
+ *
+ * Records end at an EOL outside of quotes, with "\r\n" counting as one, and
+ * hold exactly the fields ua_parse_dsv returns for them: a blank line is a
+ * record with no fields, and a delimiter at the end of a record does not
+ * start another field. The end of the buffer ends the last record.
+ *
+ * Returns the number of characters consumed: @param len (or the position of
+ * a NIL) when the whole buffer was scanned, or the position after the field
+ * or record whose callback returned false.
+ */
+size_t ua_dsv_scan(const TMCHAR* buffer, size_t len,
+                   TMCHAR quote, TMCHAR delim,
+                   ua_dsv_field_fn on_field, ua_dsv_record_fn on_record,
+                   void* user);
+
+/* ua_dsv_unescape(field, len, quotechar, out)
+ *
+ * Resolve the quotes in a field reported by ua_dsv_scan with
+ * UA_DSV_FIELD_UNESCAPE, writing the value ua_parse_dsv would have returned
+ * into @param out, which must have room for @param len + 1 characters.
+ *
+ * Returns the length of the value, which is NIL terminated.
+ */
+size_t ua_dsv_unescape(const TMCHAR* field, size_t len, TMCHAR quote,
+                       TMCHAR* out);
+
+/* Push parser
+ *
+ * For input that arrives in pieces of any size, such as from a pipe. Each
+ * piece is given to ua_dsv_feed as it arrives, and fields and records are
+ * reported through the ua_dsv_scan callbacks as soon as they are complete.
+ * The parser saves its state between pieces, even in the middle of a quoted
+ * field or right after a quote, and only ever buffers the field it is in.
+ *
+ * Records and fields are exactly those ua_dsv_scan reports for the whole
+ * input, except that:
+ *  - fields are already unescaped (UA_DSV_FIELD_UNESCAPE is never set) and
+ *    NIL terminated, and are only valid during the callback
+ *  - the record callback receives NULL for the record text; its length is
+ *    still the number of characters the record spanned
+ */
+struct ua_dsv_parser;
+
+/* ua_dsv_parser_new(quotechar, delimchar, on_field, on_record, user)
+ *
+ * Create a push parser with the given dialect and callbacks (see
+ * ua_dsv_scan). Returns NULL if out of memory.
+ */
+struct ua_dsv_parser* ua_dsv_parser_new(TMCHAR quote, TMCHAR delim,
+                                        ua_dsv_field_fn on_field,
+                                        ua_dsv_record_fn on_record,
+                                        void* user);
+
+/* ua_dsv_feed(parser, data, n)
+ *
+ * Parse the next @param n characters of input. A NIL ends the input as
+ * ua_dsv_finish does; anything fed after it is ignored.
+ *
+ * Returns true, or false once a callback has returned false or the parser
+ * ran out of memory, after which the parser ignores further input.
+ */
+int ua_dsv_feed(struct ua_dsv_parser* parser, const TMCHAR* data, size_t n);
+
+/* ua_dsv_finish(parser)
+ *
+ * Mark the end of the input, completing the last record if it did not end
+ * with an EOL. Returns as ua_dsv_feed does.
+ */
+int ua_dsv_finish(struct ua_dsv_parser* parser);
+
+/* ua_dsv_parser_offset(parser)
+ *
+ * Returns the number of characters fed up to the end of the last completed
+ * record, including its EOL: where to resume if the rest must be re-read.
+ */
+size_t ua_dsv_parser_offset(const struct ua_dsv_parser* parser);
+
+/* ua_dsv_parser_free(parser)
+ *
+ * Release @param parser. Does not call ua_dsv_finish.
+ */
+void ua_dsv_parser_free(struct ua_dsv_parser* parser);
+
 /* UAQuoteStyle enumeration
  *
  * Values:
@@ -127,6 +428,7 @@ void ua_free_dsv(const TMCHAR** data);
  *      The field begins or ends with a space character: ' '
  *      The field contains the delimiting character
  *      The field contains an EOL character: either '\r' or '\n'
+ *      The field is empty and the last one of the record
  *
  * This is to ensure that a round-trip format-parse-format yields exactly the
  * same data.
@@ -161,7 +463,8 @@ enum UAQuoteStyle {
  * character escaping completely.
  *
  * Passing '\0' to just @param escape results in the quoting character being
- * used for escaping.
+ * used for escaping: quote characters inside quoted fields are doubled and
+ * nothing else is escaped.
  *
  * Passing '\0' to just @param quote results in disabled quoting and enabled
  * escaping of special characters.
@@ -173,6 +476,22 @@ const TMCHAR* ua_format_dsv(const TMCHAR** data,
                             TMCHAR delim,
                             TMCHAR escape);
 
+/* ua_dsv_format_field(out, field, len, last, <format-args>)
+ *
+ * Format a single field of @param len characters the way ua_format_dsv
+ * would, without a delimiter and without a NUL terminator. @param field need
+ * not be NUL-terminated. @param last tells whether this is the final field
+ * of its record, which matters to QUOTE_NEEDED for empty fields.
+ *
+ * Writes to @param out, which must have room for 2 * @param len + 2
+ * characters, or only measures the field when @param out is NULL.
+ *
+ * Returns the number of characters of the formatted field.
+ */
+size_t ua_dsv_format_field(TMCHAR* out, const TMCHAR* field, size_t len,
+                           int last, enum UAQuoteStyle quoting,
+                           TMCHAR quote, TMCHAR delim, TMCHAR escape);
+
 /* ua_write_dsv(path, mode, <format-args>);
  *
  * Calls ua_format_dsv with <format-args> and writes the results to
@@ -235,6 +554,1214 @@ int ua_write_psv(const TMCHAR* path, const TMCHAR* mode, const TMCHAR** data);
  */
 int ua_fwrite_psv(UFILE* file, const TMCHAR** data);
 
+/** @region Transcoding **/
+
+/* ua_dsv_transcode(in, len, final, in_quote, in_delim,
+ *                  out, out_len, out_cap, <format-args>)
+ *
+ * Convert the records in the first @param len characters of @param in from
+ * the dialect of @param in_quote and @param in_delim to the one of
+ * <format-args>, one '\n'-terminated line per record, without building
+ * field vectors. Fields that need no quoting or escaping in the output are
+ * copied as they are; only the others are unescaped and formatted, exactly
+ * as ua_format_dsv would. Records are split as ua_dsv_scan splits them, and
+ * conversion stops early at a NUL.
+ *
+ * The output is appended to the @param out_len characters of @param out,
+ * a buffer of @param out_cap characters that is grown as needed (start
+ * with NULL, 0, 0) and released with ua_dsv_free. It is not NUL terminated.
+ *
+ * When @param final is false, more input may follow: a last record that
+ * runs to the end of @param in is left unconverted, so that the caller can
+ * pass it again together with the rest of the data.
+ *
+ * Returns the number of input characters converted, which ends on a record
+ * boundary, or (size_t)-1 if out of memory; @param out_len then only covers
+ * the records before the failure.
+ */
+size_t ua_dsv_transcode(const TMCHAR* in, size_t len, int final,
+                        TMCHAR in_quote, TMCHAR in_delim,
+                        TMCHAR** out, size_t* out_len, size_t* out_cap,
+                        enum UAQuoteStyle quoting,
+                        TMCHAR quote, TMCHAR delim, TMCHAR escape);
+
+/** @region UTF-8 functions **/
+
+/* The parser and formatter are built a second time over plain char, for data
+ * that is read and written as UTF-8 (or any other ASCII-compatible encoding)
+ * and never needs to be widened to TMCHAR. Every function below behaves
+ * exactly as its TMCHAR counterpart above; only the character type differs.
+ *
+ * Multi-byte UTF-8 sequences never contain bytes in the ASCII range, so they
+ * pass through the state machine untouched as long as the quote, delimiter
+ * and escape characters are themselves ASCII.
+ *
+ * Strings and vectors returned by the _u8 functions are released the same
+ * way as their TMCHAR counterparts, using ua_free_dsv_u8 for vectors.
+ *
+ * The _u8 writers use stdio instead of UFILE, so that file-to-file jobs
+ * never touch TMCHAR at all.
+ */
+int ua_strcount_u8(const char* s, char c);
+
+const char* ua_dsvtok_u8(const char* line, const char** out,
+                         char quot, char delim);
+const char** ua_parse_dsv_u8(const char* line, char quote, char delim);
+const char** ua_parse_csv_u8(const char* line);
+const char** ua_parse_psv_u8(const char* line);
+void ua_free_dsv_u8(const char** data);
+
+struct ua_dsv_row_u8 {
+    const char** fields;
+    size_t* lens;
+    size_t nfields;
+    size_t fields_cap;
+    char* chars;
+    size_t chars_len;
+    size_t chars_cap;
+};
+
+void ua_dsv_row_init_u8(struct ua_dsv_row_u8* row);
+void ua_dsv_row_free_u8(struct ua_dsv_row_u8* row);
+int ua_parse_dsv_into_u8(struct ua_dsv_row_u8* row, const char* line,
+                         char quote, char delim);
+
+struct ua_dsv_lazy_field_u8 {
+    size_t offset;
+    size_t len;
+    int flags;
+    const char* value;
+};
+
+struct ua_dsv_lazy_row_u8 {
+    const char* line;
+    char quote;
+    struct ua_dsv_lazy_field_u8* fields;
+    size_t nfields;
+    size_t fields_cap;
+    char* chars;
+    size_t chars_cap;
+};
+
+void ua_dsv_lazy_init_u8(struct ua_dsv_lazy_row_u8* row);
+void ua_dsv_lazy_free_u8(struct ua_dsv_lazy_row_u8* row);
+int ua_parse_dsv_lazy_u8(struct ua_dsv_lazy_row_u8* row, const char* line,
+                         char quote, char delim);
+const char* ua_dsv_lazy_get_u8(struct ua_dsv_lazy_row_u8* row, size_t index,
+                               size_t* len);
+
+typedef int (*ua_dsv_field_fn_u8)(void* user, const char* field, size_t len,
+                                  int flags);
+typedef int (*ua_dsv_record_fn_u8)(void* user, const char* record,
+                                   size_t len, size_t nfields);
+size_t ua_dsv_scan_u8(const char* buffer, size_t len, char quote, char delim,
+                      ua_dsv_field_fn_u8 on_field,
+                      ua_dsv_record_fn_u8 on_record, void* user);
+size_t ua_dsv_unescape_u8(const char* field, size_t len, char quote,
+                          char* out);
+
+struct ua_dsv_parser_u8;
+struct ua_dsv_parser_u8* ua_dsv_parser_new_u8(char quote, char delim,
+                                              ua_dsv_field_fn_u8 on_field,
+                                              ua_dsv_record_fn_u8 on_record,
+                                              void* user);
+int ua_dsv_feed_u8(struct ua_dsv_parser_u8* parser, const char* data,
+                   size_t n);
+int ua_dsv_finish_u8(struct ua_dsv_parser_u8* parser);
+size_t ua_dsv_parser_offset_u8(const struct ua_dsv_parser_u8* parser);
+void ua_dsv_parser_free_u8(struct ua_dsv_parser_u8* parser);
+
+const char* ua_format_dsv_u8(const char** data, enum UAQuoteStyle quoting,
+                             char quote, char delim, char escape);
+const char* ua_format_csv_u8(const char** data);
+size_t ua_dsv_format_field_u8(char* out, const char* field, size_t len,
+                              int last, enum UAQuoteStyle quoting,
+                              char quote, char delim, char escape);
+const char* ua_format_psv_u8(const char** data);
+size_t ua_dsv_transcode_u8(const char* in, size_t len, int final,
+                           char in_quote, char in_delim,
+                           char** out, size_t* out_len, size_t* out_cap,
+                           enum UAQuoteStyle quoting,
+                           char quote, char delim, char escape);
+
+int ua_write_dsv_u8(const char* path, const char* mode,
+                    const char** data, enum UAQuoteStyle quoting,
+                    char quote, char delim, char escape);
+int ua_write_csv_u8(const char* path, const char* mode, const char** data);
+int ua_write_psv_u8(const char* path, const char* mode, const char** data);
+
+int ua_fwrite_dsv_u8(FILE* file,
+                     const char** data, enum UAQuoteStyle quoting,
+                     char quote, char delim, char escape);
+int ua_fwrite_csv_u8(FILE* file, const char** data);
+int ua_fwrite_psv_u8(FILE* file, const char** data);
+
+/** @region Instrumentation **/
+
+/* UADsvApi enumeration
+ *
+ * Public entry points timed by ua_dsv_stats. Both flavors of a function share
+ * one slot, so ua_parse_dsv and ua_parse_dsv_u8 are counted together.
+ */
+enum UADsvApi {
+    UA_DSV_API_STRCOUNT = 0,    /* ua_strcount */
+    UA_DSV_API_DSVTOK,          /* ua_dsvtok */
+    UA_DSV_API_PARSE,           /* ua_parse_dsv (csv/psv, _into, _lazy) */
+    UA_DSV_API_FORMAT,          /* ua_format_dsv (and csv/psv) */
+    UA_DSV_API_SCAN,            /* ua_dsv_scan */
+    UA_DSV_API_FEED,            /* ua_dsv_feed */
+    UA_DSV_API_TRANSCODE,       /* ua_dsv_transcode */
+    UA_DSV_API_COUNT
+};
+
+/* ua_dsv_stats flags */
+#define UA_DSV_STATS_TIMING 0x1     /* also record time spent in each API */
+
+/* ua_dsv_stats structure
+ *
+ * Counters collected while a ua_dsv_stats is attached to the calling thread
+ * with ua_dsv_stats_attach. Nothing is collected while no stats are attached,
+ * and counting only costs a few increments per field when they are; timing
+ * reads the monotonic clock twice per call and is enabled separately with
+ * UA_DSV_STATS_TIMING.
+ *
+ * Parser counters:
+ *  bytes_scanned       characters consumed by the tokenizer
+ *  records             records returned by ua_parse_dsv
+ *  fields              fields produced by the tokenizer
+ *  quoted_fields       fields that began with the quote character
+ *  rogue_quotes        quotes inside a quoted field that neither closed the
+ *                      field nor escaped another quote
+ *
+ * Formatter counters (ua_dsv_transcode counts as a formatter too):
+ *  records_formatted   records formatted by ua_format_dsv
+ *  fields_formatted    fields written by ua_format_dsv
+ *  fields_quoted       fields ua_format_dsv enclosed in quotes
+ *  bytes_formatted     characters produced, excluding the NIL terminator
+ *
+ * Heap counters (any library allocation, including the vectors and strings
+ * handed to the caller):
+ *  allocs              calloc and realloc calls
+ *  alloc_bytes         bytes requested by those calls
+ *  frees               non-NULL pointers released by the library
+ *
+ * calls and nanos are indexed by UADsvApi.
+ */
+struct ua_dsv_stats {
+    unsigned int flags;
+
+    uint64_t bytes_scanned;
+    uint64_t records;
+    uint64_t fields;
+    uint64_t quoted_fields;
+    uint64_t rogue_quotes;
+
+    uint64_t records_formatted;
+    uint64_t fields_formatted;
+    uint64_t fields_quoted;
+    uint64_t bytes_formatted;
+
+    uint64_t allocs;
+    uint64_t alloc_bytes;
+    uint64_t frees;
+
+    uint64_t calls[UA_DSV_API_COUNT];
+    uint64_t nanos[UA_DSV_API_COUNT];
+};
+
+/* ua_dsv_stats_attach(stats)
+ *
+ * Collect counters for every call made from the calling thread into
+ * @param stats, or stop collecting if @param stats is NULL. Each thread keeps
+ * its own attachment, so threads either use separate stats and merge them
+ * with ua_dsv_stats_merge, or must not share one without locking.
+ *
+ * @param stats     zero-initialized (or reset) stats to fill, or NULL
+ */
+void ua_dsv_stats_attach(struct ua_dsv_stats* stats);
+
+/* ua_dsv_stats_current()
+ *
+ * Returns the stats attached to the calling thread, or NULL.
+ */
+struct ua_dsv_stats* ua_dsv_stats_current(void);
+
+/* ua_dsv_stats_reset(stats)
+ *
+ * Zero every counter in @param stats, keeping its flags.
+ */
+void ua_dsv_stats_reset(struct ua_dsv_stats* stats);
+
+/* ua_dsv_stats_merge(into, from)
+ *
+ * Add every counter in @param from to @param into.
+ */
+void ua_dsv_stats_merge(struct ua_dsv_stats* into,
+                        const struct ua_dsv_stats* from);
+
+/* ua_dsv_stats_api_name(api)
+ *
+ * Returns the function name for @param api, for reports.
+ */
+const char* ua_dsv_stats_api_name(enum UADsvApi api);
+
+/* ua_dsv_stats_fprint(file, stats)
+ *
+ * Write @param stats to @param file as a single line of key=value pairs.
+ * APIs that were never called are omitted.
+ *
+ * Returns true on success, false on failure.
+ */
+int ua_dsv_stats_fprint(FILE* file, const struct ua_dsv_stats* stats);
+
+/** @region Export pipeline **/
+
+/* ua_dsv_export moves rows from a source (usually a database cursor) to a
+ * sink (usually a file) in batches, and can time every stage of every batch:
+ *
+ *  fetch       the source fills a batch with rows
+ *  transcode   the batch is widened from char to TMCHAR
+ *  format      every row is formatted and appended to one output buffer
+ *  write       the sink receives the whole buffer
+ *
+ * Each stage is recorded in a log2-bucketed latency histogram, which is
+ * enough to tell whether a slow export is waiting on the database, the
+ * formatter or the disk. A Chrome trace (chrome://tracing, Perfetto) of every
+ * stage of every batch can be written as well.
+ */
+
+/* ua_dsv_source structure
+ *
+ *  fetch       store up to @param max rows into @param rows and return how
+ *              many were stored, 0 when there are no more rows, or -1 on
+ *              error. Each row is a NULL-terminated vector of char strings
+ *              and must stay valid until the next call to fetch.
+ *  user        passed to fetch unchanged
+ */
+struct ua_dsv_source {
+    long (*fetch)(void* user, const char*** rows, long max);
+    void* user;
+};
+
+/* ua_dsv_sink structure
+ *
+ *  write       write @param len characters of @param text (which is also
+ *              NIL terminated), returning true on success
+ *  user        passed to write unchanged
+ *
+ * ua_dsv_sink_ufile can be used as write with a UFILE* as user.
+ */
+struct ua_dsv_sink {
+    int (*write)(void* user, const TMCHAR* text, size_t len);
+    void* user;
+};
+
+/* UADsvStage enumeration
+ *
+ * Stages of ua_dsv_export, in the order they run for each batch.
+ */
+enum UADsvStage {
+    UA_DSV_STAGE_FETCH = 0,
+    UA_DSV_STAGE_TRANSCODE,
+    UA_DSV_STAGE_FORMAT,
+    UA_DSV_STAGE_WRITE,
+    UA_DSV_STAGE_COUNT
+};
+
+#define UA_DSV_HIST_BUCKETS 40
+
+/* ua_dsv_histogram structure
+ *
+ * Latency histogram in nanoseconds. Bucket 0 counts samples below 2ns and
+ * bucket i counts samples in [2^i, 2^(i+1)) nanoseconds; the last bucket also
+ * counts everything above it (about 18 minutes).
+ */
+struct ua_dsv_histogram {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[UA_DSV_HIST_BUCKETS];
+};
+
+/* ua_dsv_export_metrics structure
+ *
+ * Zero-initialize before passing to ua_dsv_export, then set trace to write
+ * a Chrome trace JSON document to that file. Metrics accumulate over several
+ * exports unless zeroed again; each export writes its own trace document.
+ */
+struct ua_dsv_export_metrics {
+    struct ua_dsv_histogram stages[UA_DSV_STAGE_COUNT];
+    uint64_t batches;
+    uint64_t rows;
+    uint64_t chars;     /* characters handed to the sink */
+    FILE* trace;        /* Chrome trace output, or NULL */
+};
+
+/* ua_dsv_export(source, sink, batch, <format-args>, metrics)
+ *
+ * Fetch rows from @param source @param batch at a time, format them with
+ * ua_format_dsv(<format-args>), one record per line, and write each batch to
+ * @param sink with a single call.
+ *
+ * @param metrics   receives per-stage timings, or NULL to skip timing
+ *
+ * Returns the number of rows exported, or -1 if the source, the sink or the
+ * formatter failed.
+ */
+long ua_dsv_export(const struct ua_dsv_source* source,
+                   const struct ua_dsv_sink* sink, long batch,
+                   enum UAQuoteStyle quoting, TMCHAR quote, TMCHAR delim,
+                   TMCHAR escape, struct ua_dsv_export_metrics* metrics);
+
+/* ua_dsv_sink_ufile(file, text, len)
+ *
+ * Sink write function writing to the UFILE* passed as @param file.
+ */
+int ua_dsv_sink_ufile(void* file, const TMCHAR* text, size_t len);
+
+/* ua_dsv_histogram_add(hist, nanos)
+ *
+ * Record one sample of @param nanos nanoseconds in @param hist.
+ */
+void ua_dsv_histogram_add(struct ua_dsv_histogram* hist, uint64_t nanos);
+
+/* ua_dsv_histogram_percentile(hist, p)
+ *
+ * Returns an upper bound, in nanoseconds, on the @param p th percentile
+ * (0-100) of @param hist: the top of the bucket holding it, clamped to the
+ * largest sample. Returns 0 for an empty histogram.
+ */
+uint64_t ua_dsv_histogram_percentile(const struct ua_dsv_histogram* hist,
+                                     double p);
+
+/* ua_dsv_stage_name(stage)
+ *
+ * Returns the name of @param stage, as used in reports and traces.
+ */
+const char* ua_dsv_stage_name(enum UADsvStage stage);
+
+/* ua_dsv_export_report(file, metrics)
+ *
+ * Write a table of @param metrics to @param file: one line per stage with
+ * the batch count, total time, share of the export, p50, p90, p99 and max.
+ *
+ * Returns true on success, false on failure.
+ */
+int ua_dsv_export_report(FILE* file,
+                         const struct ua_dsv_export_metrics* metrics);
+
+/** @region Record index **/
+
+/* A record index is a sidecar file that holds where every Kth record of a
+ * DSV file starts, how many records there are and the size and modification
+ * time the file had when it was indexed. Records are those ua_dsv_scan_u8
+ * finds, so newlines inside quotes do not start records. With an index,
+ * counting records is free, seeking to record n only scans fewer than K
+ * records, and a file splits into ranges of whole records for parallel
+ * readers without being read at all.
+ *
+ * Indexes work on bytes, with the dialect of the _u8 functions, and use the
+ * library's allocator. Functions that fail leave errno set; an index file
+ * that is not one, or that does not match its data file, sets EINVAL.
+ */
+
+/* ua_dsv_index structure
+ *
+ *  quote       dialect the file was indexed with
+ *  delim
+ *  every       K: records between two indexed offsets
+ *  records     number of records in the file
+ *  size        size of the file when indexed, in bytes
+ *  mtime_sec   modification time of the file when indexed
+ *  mtime_nsec
+ *  end         where the records end: size, or the offset of a NIL
+ *  offsets     offsets[i] is where record i*every starts
+ *  noffsets    number of offsets: ceil(records / every)
+ */
+struct ua_dsv_index {
+    char quote;
+    char delim;
+    uint32_t every;
+    uint64_t records;
+    uint64_t size;
+    int64_t mtime_sec;
+    long mtime_nsec;
+    uint64_t end;
+    uint64_t* offsets;
+    size_t noffsets;
+};
+
+/* ua_dsv_range structure
+ *
+ * A run of whole records: @param length bytes from @param offset, holding
+ * @param records records starting with record number @param first.
+ */
+struct ua_dsv_range {
+    uint64_t offset;
+    uint64_t length;
+    uint64_t first;
+    uint64_t records;
+};
+
+/* ua_dsv_index_build(index, path, quotechar, delimchar, every)
+ *
+ * Read the file @param path once and index every @param every'th record
+ * (every one for 0) into @param index, which is overwritten.
+ *
+ * Returns true on success, false on failure, including when the file
+ * changed while it was read.
+ */
+int ua_dsv_index_build(struct ua_dsv_index* index, const char* path,
+                       char quote, char delim, uint32_t every);
+
+/* ua_dsv_index_save(index, path)
+ *
+ * Write @param index to the index file @param path.
+ *
+ * Returns true on success, false on failure.
+ */
+int ua_dsv_index_save(const struct ua_dsv_index* index, const char* path);
+
+/* ua_dsv_index_load(index, path)
+ *
+ * Read the index file @param path into @param index, which is overwritten.
+ * The index is not checked against its data file; see ua_dsv_index_fresh.
+ *
+ * Returns true on success, false on failure.
+ */
+int ua_dsv_index_load(struct ua_dsv_index* index, const char* path);
+
+/* ua_dsv_index_fresh(index, path)
+ *
+ * Returns true if the file @param path still has the size and modification
+ * time @param index was built from, false if it changed or cannot be read.
+ */
+int ua_dsv_index_fresh(const struct ua_dsv_index* index, const char* path);
+
+/* ua_dsv_index_open(index, path, index_path, quotechar, delimchar, every)
+ *
+ * Load the index of @param path from @param index_path (or, if NULL, the
+ * sidecar @param path followed by ".dsvidx"), and use it if it is fresh and
+ * was built for the same dialect and @param every (0 takes any). Otherwise
+ * build the index again and save it there; an index that cannot be saved is
+ * still returned.
+ *
+ * Returns true on success, false if the file could not be indexed.
+ */
+int ua_dsv_index_open(struct ua_dsv_index* index, const char* path,
+                      const char* index_path, char quote, char delim,
+                      uint32_t every);
+
+/* ua_dsv_index_seek(index, file, record)
+ *
+ * Position @param file, the indexed file opened for reading, at the start of
+ * record number @param record (counting from 0), by seeking to the closest
+ * indexed record before it and scanning the rest of the way.
+ *
+ * Returns true on success, false on failure or if there is no such record.
+ */
+int ua_dsv_index_seek(const struct ua_dsv_index* index, FILE* file,
+                      uint64_t record);
+
+/* ua_dsv_index_split(index, parts, ranges)
+ *
+ * Split the indexed file into at most @param parts ranges of whole records
+ * of about the same number of records, starting at indexed records, and
+ * store them in @param ranges. Fewer ranges result when the file has fewer
+ * indexed records than @param parts.
+ *
+ * Returns the number of ranges stored.
+ */
+size_t ua_dsv_index_split(const struct ua_dsv_index* index, size_t parts,
+                          struct ua_dsv_range* ranges);
+
+/* ua_dsv_index_free(index)
+ *
+ * Release the offsets of @param index, leaving it empty.
+ */
+void ua_dsv_index_free(struct ua_dsv_index* index);
+
+/** @region Following files **/
+
+/* A follower reads a DSV file that another process keeps appending to, such
+ * as an extract written by a long-running job, the way tail -F does. Each
+ * poll reads only the bytes appended since the last one and reports the
+ * records they complete through the ua_dsv_scan_u8 callbacks; a record that
+ * is still being written stays buffered until a later poll completes it.
+ *
+ * The follower remembers the offset just past its last complete record. A
+ * reader that saves ua_dsv_follow_offset and passes it to ua_dsv_follow_new
+ * the next time it runs picks up exactly where it left off.
+ *
+ * A file that shrinks below the followed offset was truncated and is read
+ * again from the start. A file replaced under the same path (renamed away
+ * and created again) is read to its end, including an unterminated last
+ * record, before the new one is followed from its start. A NIL byte ends
+ * the records, as it does for ua_dsv_scan.
+ */
+struct ua_dsv_follower;
+
+/* ua_dsv_follow_new(path, offset, quotechar, delimchar, on_field,
+ *                   on_record, user)
+ *
+ * Follow @param path from @param offset, which should be 0 or an offset
+ * returned by ua_dsv_follow_offset. The file need not exist yet.
+ *
+ * Records and fields are exactly those ua_dsv_scan_u8 reports, with spans
+ * into a buffer that is only valid during the callback, but only complete
+ * records are reported: the fields of a record are not reported before the
+ * record is known to be complete. Either callback may be NULL; returning
+ * false from one ends the poll after the current record.
+ *
+ * Returns NULL if out of memory.
+ */
+struct ua_dsv_follower* ua_dsv_follow_new(const char* path, uint64_t offset,
+                                          char quote, char delim,
+                                          ua_dsv_field_fn_u8 on_field,
+                                          ua_dsv_record_fn_u8 on_record,
+                                          void* user);
+
+/* ua_dsv_follow_poll(follower)
+ *
+ * Read what was appended to the file since the last poll and report the
+ * records it completes. A file that does not exist (yet) has no records.
+ *
+ * Returns the number of records reported, or -1 on a read error or out of
+ * memory, with errno set.
+ */
+long ua_dsv_follow_poll(struct ua_dsv_follower* follower);
+
+/* ua_dsv_follow_wait(follower, timeout)
+ *
+ * Wait up to @param timeout milliseconds for the file to change, or for as
+ * long as it takes when @param timeout is negative. Uses inotify where the
+ * system has it, and otherwise checks the size of the file every few
+ * milliseconds.
+ *
+ * Returns true if the file may have changed and should be polled, false if
+ * the timeout expired, or -1 with errno set if the wait failed (EINTR when
+ * a signal interrupted it).
+ */
+int ua_dsv_follow_wait(struct ua_dsv_follower* follower, int timeout);
+
+/* ua_dsv_follow_offset(follower)
+ *
+ * Returns the offset just past the last complete record reported.
+ */
+uint64_t ua_dsv_follow_offset(const struct ua_dsv_follower* follower);
+
+/* ua_dsv_follow_free(follower)
+ *
+ * Close the file and release @param follower. A partial record still
+ * buffered is dropped; it is read again by a follower resuming from
+ * ua_dsv_follow_offset.
+ */
+void ua_dsv_follow_free(struct ua_dsv_follower* follower);
+
+/** @region Aggregation **/
+
+/* An aggregation groups records by the values of some key columns and
+ * keeps, for each group, the number of records and the count, sum, minimum
+ * and maximum of the numbers in some value columns, in one pass over the
+ * records and without keeping them.
+ *
+ * Groups live in an open-addressing hash table whose keys are stored in an
+ * arena. Once the table and its keys would take more than the memory
+ * budget, records of groups that are not in the table yet are written to
+ * one of 16 temporary partition files by their hash instead; groups
+ * already in the table keep being updated in memory. Each partition is
+ * aggregated on its own when the groups are reported, splitting it again by
+ * other bits of the hash if it does not fit either.
+ */
+struct ua_dsv_agg;
+
+/* ua_dsv_agg_value structure
+ *
+ * The numbers of one value column of a group: fields that are not a number
+ * strtod accepts as a whole, and columns a record does not have, are left
+ * out. @param sum, @param min and @param max are 0 when @param count is.
+ */
+struct ua_dsv_agg_value {
+    uint64_t count;
+    double sum;
+    double min;
+    double max;
+};
+
+/* ua_dsv_group_fn(user, keys, lens, nkeys, count, values, nvalues)
+ *
+ * Called by ua_dsv_agg_finish for each group, with the @param nkeys key
+ * values of the group (not NIL terminated; a column a record does not have
+ * is empty), the number of records in it and one ua_dsv_agg_value for each
+ * value column. Everything is only valid during the callback.
+ *
+ * Return true to continue, false to stop.
+ */
+typedef int (*ua_dsv_group_fn)(void* user, const char* const* keys,
+                               const size_t* lens, size_t nkeys,
+                               uint64_t count,
+                               const struct ua_dsv_agg_value* values,
+                               size_t nvalues);
+
+/* ua_dsv_agg_new(quotechar, keys, nkeys, values, nvalues, budget, tmpdir)
+ *
+ * Create an aggregation grouping by the @param nkeys columns in @param keys
+ * and summarizing the @param nvalues columns in @param values, counting
+ * columns from 0; a column may appear in both. With no keys, all records
+ * are one group.
+ *
+ * @param budget is the memory, in bytes, the table and its keys may take
+ * before partitions are spilled (0 for no limit), and @param tmpdir where
+ * partitions are written (NULL for $TMPDIR or /tmp). @param quote resolves
+ * fields ua_dsv_scan_u8 reports with UA_DSV_FIELD_UNESCAPE.
+ *
+ * Returns NULL if out of memory.
+ */
+struct ua_dsv_agg* ua_dsv_agg_new(char quote, const size_t* keys,
+                                  size_t nkeys, const size_t* values,
+                                  size_t nvalues, size_t budget,
+                                  const char* tmpdir);
+
+/* ua_dsv_agg_add(agg, fields, lens, nfields)
+ *
+ * Add the record of @param nfields fields, @param lens characters long.
+ *
+ * Returns true on success, false on a failure to write a partition or out
+ * of memory, with errno set, after which every call on @param agg fails.
+ */
+int ua_dsv_agg_add(struct ua_dsv_agg* agg, const char* const* fields,
+                   const size_t* lens, size_t nfields);
+
+/* ua_dsv_agg_on_field(agg, field, len, flags)
+ * ua_dsv_agg_on_record(agg, record, len, nfields)
+ *
+ * Callbacks for ua_dsv_scan_u8, ua_dsv_parser_new_u8 or ua_dsv_follow_new
+ * that add the records they report to the aggregation passed as their
+ * user pointer. Only the fields of key and value columns are kept, until
+ * the end of the record. They return false, stopping the scan, once
+ * ua_dsv_agg_add would.
+ */
+int ua_dsv_agg_on_field(void* agg, const char* field, size_t len,
+                        int flags);
+int ua_dsv_agg_on_record(void* agg, const char* record, size_t len,
+                         size_t nfields);
+
+/* ua_dsv_agg_finish(agg, on_group, user)
+ *
+ * Report every group once, in no particular order, through @param on_group.
+ * Groups held in memory come first, then those of each partition. Call it
+ * once, after the last record.
+ *
+ * Returns true when all groups were reported or the callback stopped, false
+ * if a record could not be added or a partition could not be read or
+ * aggregated, with errno set.
+ */
+int ua_dsv_agg_finish(struct ua_dsv_agg* agg, ua_dsv_group_fn on_group,
+                      void* user);
+
+/* ua_dsv_agg_spilled(agg)
+ *
+ * Returns the number of records written to partitions so far.
+ */
+uint64_t ua_dsv_agg_spilled(const struct ua_dsv_agg* agg);
+
+/* ua_dsv_agg_free(agg)
+ *
+ * Release @param agg and remove its partitions.
+ */
+void ua_dsv_agg_free(struct ua_dsv_agg* agg);
+
+/** @region Profiling **/
+
+/* A profile summarizes every column of the records added to it in one pass:
+ * how many records have the column and how many of those fields are empty
+ * or numeric, the range of their lengths and values, and an estimate of the
+ * number of distinct values from a HyperLogLog sketch of 4096 registers
+ * (about 1.6% standard error). Profiles of parts of the same input, built
+ * by separate threads, merge into the profile of the whole.
+ */
+struct ua_dsv_profile;
+
+/* ua_dsv_column_profile structure
+ *
+ * The profile of one column. A field is numeric when it is all digits, as
+ * the isnumeric check of gor2csv.c has it, and not empty; numeric fields
+ * compare as the whole numbers they spell. Values are not NIL terminated,
+ * and are NULL when no field qualified.
+ */
+struct ua_dsv_column_profile {
+    uint64_t count;             /* records with the column */
+    uint64_t nulls;             /* records without it */
+    uint64_t empty;
+    uint64_t numeric;
+    size_t shortest;            /* length of the fields, empty ones too */
+    size_t longest;
+    const char* min;            /* of non-empty fields, byte by byte */
+    size_t min_len;
+    const char* max;
+    size_t max_len;
+    const char* min_number;     /* of numeric fields */
+    size_t min_number_len;
+    const char* max_number;
+    size_t max_number_len;
+    double distinct;            /* estimated, empty fields included */
+};
+
+/* ua_dsv_profile_new(quotechar)
+ *
+ * Create an empty profile. @param quote resolves fields ua_dsv_scan_u8
+ * reports with UA_DSV_FIELD_UNESCAPE.
+ *
+ * Returns NULL if out of memory.
+ */
+struct ua_dsv_profile* ua_dsv_profile_new(char quote);
+
+/* ua_dsv_profile_add(profile, fields, lens, nfields)
+ *
+ * Add the record of @param nfields fields, @param lens characters long.
+ *
+ * Returns true on success, false out of memory, with errno set, after
+ * which every call on @param profile fails.
+ */
+int ua_dsv_profile_add(struct ua_dsv_profile* profile,
+                       const char* const* fields, const size_t* lens,
+                       size_t nfields);
+
+/* ua_dsv_profile_on_field(profile, field, len, flags)
+ * ua_dsv_profile_on_record(profile, record, len, nfields)
+ *
+ * Callbacks for ua_dsv_scan_u8, ua_dsv_parser_new_u8 or ua_dsv_follow_new
+ * that add the records they report to the profile passed as their user
+ * pointer. Fields are profiled as they come, so every field reported must
+ * belong to a record that is reported too. They return false, stopping the
+ * scan, once ua_dsv_profile_add would.
+ */
+int ua_dsv_profile_on_field(void* profile, const char* field, size_t len,
+                            int flags);
+int ua_dsv_profile_on_record(void* profile, const char* record, size_t len,
+                             size_t nfields);
+
+/* ua_dsv_profile_merge(profile, other)
+ *
+ * Add everything added to @param other to @param profile, as if the
+ * records had been added to it. @param other is left as it is.
+ *
+ * Returns true on success, false out of memory, with errno set.
+ */
+int ua_dsv_profile_merge(struct ua_dsv_profile* profile,
+                         const struct ua_dsv_profile* other);
+
+/* ua_dsv_profile_records(profile)
+ * ua_dsv_profile_columns(profile)
+ *
+ * Return the number of records added and the number of columns seen, which
+ * is the number of fields of the longest record.
+ */
+uint64_t ua_dsv_profile_records(const struct ua_dsv_profile* profile);
+size_t ua_dsv_profile_columns(const struct ua_dsv_profile* profile);
+
+/* ua_dsv_profile_column(profile, column, out)
+ *
+ * Fill @param out with the profile of @param column, counting from 0. The
+ * values it points to are valid until @param profile is changed or freed.
+ *
+ * Returns true on success, false with errno set to EINVAL for a column
+ * past ua_dsv_profile_columns.
+ */
+int ua_dsv_profile_column(const struct ua_dsv_profile* profile,
+                          size_t column, struct ua_dsv_column_profile* out);
+
+/* ua_dsv_profile_free(profile)
+ *
+ * Release @param profile.
+ */
+void ua_dsv_profile_free(struct ua_dsv_profile* profile);
+
+/** @region Validation **/
+
+/* ua_dsv_check problems
+ *
+ *  UA_DSV_BAD_FIELDS   the record does not have the expected number of
+ *                      fields; a blank line has none
+ *  UA_DSV_BAD_LENGTH   a field value is longer than the maximum
+ *  UA_DSV_BAD_QUOTE    a quoted field is not closed by a quote followed by
+ *                      a delimiter or EOL, so it runs to the end of the
+ *                      input
+ */
+#define UA_DSV_BAD_FIELDS 0x1
+#define UA_DSV_BAD_LENGTH 0x2
+#define UA_DSV_BAD_QUOTE  0x4
+
+/* ua_dsv_check_fn(user, record, len, line, nfields, problems)
+ *
+ * Called by ua_dsv_check_u8 for each record, good or bad. @param record is
+ * its raw text in the checked buffer, @param len characters long with its
+ * EOL if it has one, starting on line @param line (counting from 1) and
+ * holding @param nfields fields. @param problems is 0 for a good record, or
+ * the UA_DSV_BAD_* flags that apply.
+ *
+ * Return true to continue checking, false to stop.
+ */
+typedef int (*ua_dsv_check_fn)(void* user, const char* record, size_t len,
+                               uint64_t line, size_t nfields, int problems);
+
+/* ua_dsv_check_u8(buffer, len, quotechar, delimchar, nfields, max_len,
+ *                 on_record, user)
+ *
+ * Check the shape of every record of @param buffer in one scan, reporting
+ * each one through @param on_record: every record must have @param nfields
+ * fields (0 for as many as the first record has) and no field value more
+ * than @param max_len characters (0 for no limit).
+ *
+ * Checking goes on past bad records. A record with an unterminated quote
+ * would take the rest of the input, so only its first line is reported,
+ * as the bad record, and checking starts again on the next line; each one
+ * costs a scan of the rest of the input.
+ *
+ * Returns the number of characters checked, which is @param len (or the
+ * position of a NIL) unless @param on_record stopped the check.
+ */
+size_t ua_dsv_check_u8(const char* buffer, size_t len, char quote,
+                       char delim, size_t nfields, size_t max_len,
+                       ua_dsv_check_fn on_record, void* user);
+
+/** @region Binary rows **/
+
+/* A binary row stream carries records between programs without quoting:
+ * every field is prefixed with its length, so writing one is a copy and
+ * reading one is a walk over the prefixes, with no state machine and no
+ * unescaping. Fields may also be null, which DSV has no way to say.
+ *
+ * Layout, every integer a little-endian uint32:
+ *
+ *  magic       8 bytes, "UADSVBR1"
+ *  schema      a row of the column names
+ *  rows        until the end of the stream
+ *
+ * and each row is:
+ *
+ *  size        bytes of the row after this integer
+ *  nfields     number of fields, which may differ from row to row
+ *  nulls       (nfields + 7) / 8 bytes, bit i % 8 of byte i / 8 set for
+ *              each field i that is null
+ *  fields      for each field that is not null, its length and its bytes
+ *
+ * Streams work on bytes and use the library's allocator. Functions that
+ * fail leave errno set; a stream that is not one, or is cut short, sets
+ * EINVAL, and a field or row too large for the format sets EOVERFLOW.
+ */
+
+/* ua_dsv_bin_row structure
+ *
+ * One row of a binary stream, read in place: the fields point into the
+ * stream and are not NIL terminated. Storage is kept between calls to
+ * ua_dsv_bin_next, as for ua_dsv_row, and only ever grows.
+ *
+ *  fields      the fields, NULL for a null field
+ *  lens        length of each field, 0 for a null field
+ *  nfields     number of fields
+ *  fields_cap  capacity of fields and lens
+ */
+struct ua_dsv_bin_row {
+    const char** fields;
+    size_t* lens;
+    size_t nfields;
+    size_t fields_cap;
+};
+
+/* ua_dsv_bin_row_init(row)
+ *
+ * Initialize @param row to an empty row without storage.
+ */
+void ua_dsv_bin_row_init(struct ua_dsv_bin_row* row);
+
+/* ua_dsv_bin_row_free(row)
+ *
+ * Release the storage of @param row, leaving it empty.
+ */
+void ua_dsv_bin_row_free(struct ua_dsv_bin_row* row);
+
+/* ua_dsv_bin_put_header(out, names, lens, ncolumns)
+ *
+ * Write the start of a stream whose schema names @param ncolumns columns,
+ * @param names of @param lens bytes each, to @param out, or only measure it
+ * when @param out is NULL.
+ *
+ * Returns the number of bytes of the header, or 0 if it is too large.
+ */
+size_t ua_dsv_bin_put_header(char* out, const char* const* names,
+                             const size_t* lens, size_t ncolumns);
+
+/* ua_dsv_bin_put_row(out, fields, lens, nfields)
+ *
+ * Write a row of @param nfields fields, @param fields of @param lens bytes
+ * each and NULL for null fields, to @param out, or only measure it when
+ * @param out is NULL.
+ *
+ * Returns the number of bytes of the row, or 0 if it is too large.
+ */
+size_t ua_dsv_bin_put_row(char* out, const char* const* fields,
+                          const size_t* lens, size_t nfields);
+
+/* ua_dsv_bin_reader structure
+ *
+ *  data        the stream, which must outlive the reader and its rows
+ *  len         bytes of the stream
+ *  offset      where the next row starts
+ *  columns     the schema: the column names, in place
+ */
+struct ua_dsv_bin_reader {
+    const char* data;
+    size_t len;
+    size_t offset;
+    struct ua_dsv_bin_row columns;
+};
+
+/* ua_dsv_bin_open(reader, data, len)
+ *
+ * Start reading the stream of @param len bytes at @param data, such as a
+ * mapped file, into @param reader, which is overwritten. Nothing is copied.
+ *
+ * Returns true on success, false if @param data does not start with a
+ * stream header, or if out of memory.
+ */
+int ua_dsv_bin_open(struct ua_dsv_bin_reader* reader, const char* data,
+                    size_t len);
+
+/* ua_dsv_bin_next(reader, row)
+ *
+ * Read the next row of @param reader into @param row, overwriting whatever
+ * it held.
+ *
+ * Returns 1 for a row, 0 at the end of the stream, or -1 if the row is cut
+ * short or malformed (EINVAL) or out of memory (ENOMEM).
+ */
+int ua_dsv_bin_next(struct ua_dsv_bin_reader* reader,
+                    struct ua_dsv_bin_row* row);
+
+/* ua_dsv_bin_close(reader)
+ *
+ * Release the schema storage of @param reader. The stream is not touched.
+ */
+void ua_dsv_bin_close(struct ua_dsv_bin_reader* reader);
+
+/** @region Arrow streams **/
+
+/* An Arrow writer turns records into an Apache Arrow IPC stream of typed
+ * record batches, the format pyarrow.ipc.open_stream and Arrow's
+ * RecordBatchStreamReader read, so that columnar tools load an extract, or
+ * map it from disk, instead of parsing text again. The encoder stands
+ * alone: it writes the flatbuffer metadata itself and needs nothing from
+ * Arrow.
+ *
+ * Every column is declared with a type, and values are parsed into it as
+ * records are added. A record with fewer fields than there are columns has
+ * nulls for the rest, and fields past the last column are ignored. A
+ * dictionary column sends each distinct string once, in a dictionary batch
+ * before the first record batch and then in delta dictionary batches, and
+ * holds int32 indices into it, which suits columns with few distinct
+ * values.
+ *
+ * Writers work on bytes, which should be UTF-8, and use the library's
+ * allocator. Functions that fail leave errno set.
+ */
+
+/* UADsvArrowType enumeration
+ *
+ * Values:
+ *  UA_ARROW_UTF8       string, as it is (utf8)
+ *  UA_ARROW_INT64      whole number with an optional sign (int64)
+ *  UA_ARROW_FLOAT64    number as strtod reads it (float64)
+ *  UA_ARROW_DICT       string, dictionary encoded (dictionary<values=utf8,
+ *                      indices=int32>)
+ *
+ * A NULL field is null in any column. An empty field is null in a numeric
+ * column and an empty string in the others.
+ */
+enum UADsvArrowType {
+    UA_ARROW_UTF8 = 0,
+    UA_ARROW_INT64,
+    UA_ARROW_FLOAT64,
+    UA_ARROW_DICT
+};
+
+/* ua_dsv_arrow_column structure
+ *
+ * The declaration of one column: its name, NIL terminated, and its type.
+ */
+struct ua_dsv_arrow_column {
+    const char* name;
+    enum UADsvArrowType type;
+};
+
+struct ua_dsv_arrow_writer;
+
+/* ua_dsv_arrow_new(file, columns, ncolumns, batch_rows)
+ *
+ * Start a stream on @param file by writing the schema of the @param
+ * ncolumns @param columns. Records are written in record batches of
+ * @param batch_rows rows (65536 for 0).
+ *
+ * Returns NULL if out of memory or the schema could not be written.
+ */
+struct ua_dsv_arrow_writer* ua_dsv_arrow_new(
+        FILE* file, const struct ua_dsv_arrow_column* columns,
+        size_t ncolumns, size_t batch_rows);
+
+/* ua_dsv_arrow_add(writer, fields, lens, nfields)
+ *
+ * Add the record of @param nfields fields, @param lens characters long,
+ * writing a batch when it is full.
+ *
+ * Returns true on success. Returns false with errno set to EINVAL when a
+ * field is not a number of its column's type, or to EOVERFLOW when the
+ * strings of a column grow past what int32 offsets reach; the record is
+ * then not added and the writer goes on. Returns false with errno set on a
+ * write error or out of memory, after which every call on @param writer
+ * fails.
+ */
+int ua_dsv_arrow_add(struct ua_dsv_arrow_writer* writer,
+                     const char* const* fields, const size_t* lens,
+                     size_t nfields);
+
+/* ua_dsv_arrow_add_row(writer, row)
+ *
+ * Add the NULL-terminated vector @param row, as ua_parse_dsv_u8 returns and
+ * a ua_dsv_source fetches, the way ua_dsv_arrow_add does.
+ */
+int ua_dsv_arrow_add_row(struct ua_dsv_arrow_writer* writer,
+                         const char* const* row);
+
+/* ua_dsv_arrow_finish(writer)
+ *
+ * Write the records not yet written and the end of the stream, and flush
+ * the file, which is left open. Nothing can be added afterwards.
+ *
+ * Returns true on success, false on failure.
+ */
+int ua_dsv_arrow_finish(struct ua_dsv_arrow_writer* writer);
+
+/* ua_dsv_arrow_rows(writer)
+ *
+ * Returns the number of records added.
+ */
+uint64_t ua_dsv_arrow_rows(const struct ua_dsv_arrow_writer* writer);
+
+/* ua_dsv_arrow_free(writer)
+ *
+ * Release @param writer. A stream that was not finished is left cut short.
+ */
+void ua_dsv_arrow_free(struct ua_dsv_arrow_writer* writer);
+
+/** @region Allocation **/
+
+/* ua_dsv_allocator structure
+ *
+ * Every allocation made by the library, including the vectors and strings it
+ * returns, goes through the allocator installed on the calling thread:
+ *
+ *  alloc       return @param size bytes of zeroed memory, or NULL
+ *  resize      like realloc: grow or shrink @param ptr (allocated by this
+ *              allocator) to @param size bytes, keeping its contents
+ *  release     release @param ptr, which may be NULL
+ *  ctx         passed to every function unchanged
+ *
+ * Memory must be released by the allocator that provided it: free results
+ * with ua_free_dsv (vectors) or ua_dsv_free (strings) while the same
+ * allocator is installed.
+ */
+struct ua_dsv_allocator {
+    void* (*alloc)(void* ctx, size_t size);
+    void* (*resize)(void* ctx, void* ptr, size_t size);
+    void (*release)(void* ctx, void* ptr);
+    void* ctx;
+};
+
+/* ua_dsv_set_allocator(allocator)
+ *
+ * Install a copy of @param allocator for every call made from the calling
+ * thread, or restore the default (calloc, realloc and free) if it is NULL.
+ */
+void ua_dsv_set_allocator(const struct ua_dsv_allocator* allocator);
+
+/* ua_dsv_get_allocator()
+ *
+ * Returns the allocator installed on the calling thread.
+ */
+struct ua_dsv_allocator ua_dsv_get_allocator(void);
+
+/* ua_dsv_free(ptr)
+ *
+ * Release memory returned by the library, such as the strings returned by
+ * ua_format_dsv and ua_dsvtok, using the current allocator.
+ */
+void ua_dsv_free(const void* ptr);
+
+/* Bump-pointer arena
+ *
+ * Allocation is a pointer increment; memory is reclaimed all at once with
+ * ua_dsv_arena_reset. The most recent allocation can still be resized in
+ * place or released, which covers the parser's allocate-then-shrink pattern,
+ * while releasing anything else is a no-op. Suited to per-row loops that
+ * reset the arena once the row is done.
+ */
+struct ua_dsv_arena;
+
+/* ua_dsv_arena_new(block)
+ *
+ * Create an arena that grows @param block bytes at a time (0 for a default
+ * of 64KiB). Returns NULL if out of memory.
+ */
+struct ua_dsv_arena* ua_dsv_arena_new(size_t block);
+
+/* ua_dsv_arena_allocator(arena)
+ *
+ * Returns an allocator serving memory from @param arena.
+ */
+struct ua_dsv_allocator ua_dsv_arena_allocator(struct ua_dsv_arena* arena);
+
+/* ua_dsv_arena_reset(arena)
+ *
+ * Invalidate everything allocated from @param arena, keeping its first block
+ * for reuse.
+ */
+void ua_dsv_arena_reset(struct ua_dsv_arena* arena);
+
+/* ua_dsv_arena_free(arena)
+ *
+ * Release @param arena and everything allocated from it.
+ */
+void ua_dsv_arena_free(struct ua_dsv_arena* arena);
+
+/* Size-class pool
+ *
+ * Allocations up to 4KiB are rounded up to a power of two and served from
+ * per-class free lists carved out of larger slabs, so that freed memory is
+ * reused without returning to malloc. Larger allocations go straight to
+ * malloc. Unlike the arena, memory may be released in any order.
+ */
+struct ua_dsv_pool;
+
+/* ua_dsv_pool_new()
+ *
+ * Create an empty pool. Returns NULL if out of memory.
+ */
+struct ua_dsv_pool* ua_dsv_pool_new(void);
+
+/* ua_dsv_pool_allocator(pool)
+ *
+ * Returns an allocator serving memory from @param pool.
+ */
+struct ua_dsv_allocator ua_dsv_pool_allocator(struct ua_dsv_pool* pool);
+
+/* ua_dsv_pool_free(pool)
+ *
+ * Release @param pool and its slabs. Allocations larger than 4KiB that were
+ * never released are not tracked by the pool and leak.
+ */
+void ua_dsv_pool_free(struct ua_dsv_pool* pool);
+
 #ifdef __cplusplus
 }   /* extern "C" */
 #endif
@@ -0,0 +1,871 @@
+
+/*****************************************************************************/
+/*    Name: gua2csv.hpp                                                      */
+/*   Title: Delimiter-Separated-Value Library C++ Wrapper                    */
+/* Purpose: Header-only C++17 access to gua2csv: owning row types, range-for */
+/*          iteration over records and fields as string views, and a writer */
+/*          formatting any range of strings straight into its output.       */
+/*  Author: Peter Schultz (sxpws)                                            */
+/*****************************************************************************/
+/* UA AUDIT TRAIL                                                            */
+/*                                                                           */
+/* 2026/10/18 sxpws Initial commit                                           */
+/* 2026/10/18 sxpws Added C++20 coroutine record generators                  */
+/*                                                                           */
+/* UA AUDIT TRAIL END                                                        */
+/*****************************************************************************/
+
+#ifndef UA_ORAC_GUA2CSV_HPP_
+#define UA_ORAC_GUA2CSV_HPP_
+
+#include "gua2csv.h"
+
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && \
+    defined(__has_include)
+#if __has_include(<coroutine>) && __has_include(<span>)
+#define UA_DSV_COROUTINES
+#include <coroutine>
+#include <cstdio>
+#include <span>
+#include <stdexcept>
+#endif
+#endif
+
+/* Everything is a template on the character type, which must be either
+ * TMCHAR or char; char selects the UTF-8 (_u8) flavor of each function.
+ * Where the C library returns NULL or false for lack of memory, the wrapper
+ * throws std::bad_alloc. Nothing else throws, except for the generators,
+ * which throw std::runtime_error when their input fails.
+ *
+ * The names without a prefix are the TMCHAR flavor, as in the C library:
+ *
+ *     ua::dsv::records_u8 records(text);
+ *     for (const auto& record : records) {
+ *         for (std::string_view field : record) { ... }
+ *     }
+ */
+
+namespace ua {
+namespace dsv {
+
+/** @region Library binding **/
+
+namespace detail {
+
+template <typename CharT>
+inline constexpr bool is_u8 = std::is_same_v<CharT, char>;
+
+template <typename CharT>
+inline constexpr bool is_supported =
+    std::is_same_v<CharT, char> || std::is_same_v<CharT, TMCHAR>;
+
+template <typename CharT>
+using c_row = std::conditional_t<is_u8<CharT>,
+                                 struct ua_dsv_row_u8, struct ua_dsv_row>;
+
+template <typename CharT>
+using field_fn = std::conditional_t<is_u8<CharT>,
+                                    ua_dsv_field_fn_u8, ua_dsv_field_fn>;
+
+template <typename CharT>
+using record_fn = std::conditional_t<is_u8<CharT>,
+                                     ua_dsv_record_fn_u8, ua_dsv_record_fn>;
+
+template <typename CharT>
+inline const CharT** parse_dsv(const CharT* line, CharT q, CharT d) {
+    if constexpr (is_u8<CharT>) return ua_parse_dsv_u8(line, q, d);
+    else return ua_parse_dsv(line, q, d);
+}
+
+template <typename CharT>
+inline void free_dsv(const CharT** data) {
+    if constexpr (is_u8<CharT>) ua_free_dsv_u8(data);
+    else ua_free_dsv(data);
+}
+
+template <typename CharT>
+inline void row_init(c_row<CharT>* row) {
+    if constexpr (is_u8<CharT>) ua_dsv_row_init_u8(row);
+    else ua_dsv_row_init(row);
+}
+
+template <typename CharT>
+inline void row_free(c_row<CharT>* row) {
+    if constexpr (is_u8<CharT>) ua_dsv_row_free_u8(row);
+    else ua_dsv_row_free(row);
+}
+
+template <typename CharT>
+inline int parse_into(c_row<CharT>* row, const CharT* line, CharT q, CharT d) {
+    if constexpr (is_u8<CharT>) return ua_parse_dsv_into_u8(row, line, q, d);
+    else return ua_parse_dsv_into(row, line, q, d);
+}
+
+template <typename CharT>
+inline std::size_t scan(const CharT* buffer, std::size_t len, CharT q,
+                        CharT d, field_fn<CharT> on_field,
+                        record_fn<CharT> on_record, void* user) {
+    if constexpr (is_u8<CharT>) {
+        return ua_dsv_scan_u8(buffer, len, q, d, on_field, on_record, user);
+    } else {
+        return ua_dsv_scan(buffer, len, q, d, on_field, on_record, user);
+    }
+}
+
+template <typename CharT>
+inline std::size_t unescape(const CharT* field, std::size_t len, CharT q,
+                            CharT* out) {
+    if constexpr (is_u8<CharT>) return ua_dsv_unescape_u8(field, len, q, out);
+    else return ua_dsv_unescape(field, len, q, out);
+}
+
+template <typename CharT>
+inline std::size_t format_field(CharT* out, const CharT* field,
+                                std::size_t len, int last,
+                                enum UAQuoteStyle quoting,
+                                CharT q, CharT d, CharT e) {
+    if constexpr (is_u8<CharT>) {
+        return ua_dsv_format_field_u8(out, field, len, last, quoting, q, d, e);
+    } else {
+        return ua_dsv_format_field(out, field, len, last, quoting, q, d, e);
+    }
+}
+
+/* random access over anything with size() and operator[] returning a view */
+template <typename Container, typename CharT>
+class index_iterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::basic_string_view<CharT>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    index_iterator() noexcept = default;
+    index_iterator(const Container* c, std::size_t i) noexcept
+        : c_(c), i_(i) {}
+
+    reference operator*() const { return (*c_)[i_]; }
+    reference operator[](difference_type n) const { return (*c_)[i_ + n]; }
+
+    index_iterator& operator++() noexcept { ++i_; return *this; }
+    index_iterator operator++(int) noexcept { auto t = *this; ++i_; return t; }
+    index_iterator& operator--() noexcept { --i_; return *this; }
+    index_iterator operator--(int) noexcept { auto t = *this; --i_; return t; }
+    index_iterator& operator+=(difference_type n) noexcept {
+        i_ += n;
+        return *this;
+    }
+    index_iterator& operator-=(difference_type n) noexcept {
+        i_ -= n;
+        return *this;
+    }
+    friend index_iterator operator+(index_iterator it, difference_type n) {
+        return it += n;
+    }
+    friend index_iterator operator-(index_iterator it, difference_type n) {
+        return it -= n;
+    }
+    friend difference_type operator-(const index_iterator& a,
+                                     const index_iterator& b) noexcept {
+        return static_cast<difference_type>(a.i_) -
+               static_cast<difference_type>(b.i_);
+    }
+    friend bool operator==(const index_iterator& a,
+                           const index_iterator& b) noexcept {
+        return a.i_ == b.i_;
+    }
+    friend bool operator!=(const index_iterator& a,
+                           const index_iterator& b) noexcept {
+        return a.i_ != b.i_;
+    }
+    friend bool operator<(const index_iterator& a,
+                          const index_iterator& b) noexcept {
+        return a.i_ < b.i_;
+    }
+
+private:
+    const Container* c_ = nullptr;
+    std::size_t i_ = 0;
+};
+
+} /* namespace detail */
+
+/* basic_dialect
+ *
+ * The <format-args> of the C library in one value. Parsing only looks at
+ * @param quote and @param delim.
+ */
+template <typename CharT>
+struct basic_dialect {
+    static_assert(detail::is_supported<CharT>,
+                  "gua2csv.hpp works on TMCHAR or char");
+
+    CharT quote;
+    CharT delim;
+    CharT escape;
+    enum UAQuoteStyle quoting;
+
+    /* '"' quotes, ',' delimits, quotes are escaped by doubling */
+    static constexpr basic_dialect csv() noexcept {
+        return {CharT('"'), CharT(','), CharT('\0'), QUOTE_NEEDED};
+    }
+
+    /* '|' delimits, no quoting or escaping */
+    static constexpr basic_dialect psv() noexcept {
+        return {CharT('\0'), CharT('|'), CharT('\0'), QUOTE_NONE};
+    }
+};
+
+/** @region Rows **/
+
+/* basic_fields
+ *
+ * Owns the vector returned by ua_parse_dsv and releases it with ua_free_dsv.
+ * Move-only. Fields are NIL terminated, so c_str() may be handed back to C.
+ */
+template <typename CharT>
+class basic_fields {
+public:
+    using value_type = std::basic_string_view<CharT>;
+    using const_iterator = detail::index_iterator<basic_fields, CharT>;
+    using iterator = const_iterator;
+
+    basic_fields() noexcept = default;
+
+    /* take ownership of @param data, as returned by ua_parse_dsv */
+    explicit basic_fields(const CharT** data) noexcept : data_(data) {
+        while (data_ && data_[size_]) ++size_;
+    }
+
+    basic_fields(basic_fields&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)) {}
+
+    basic_fields& operator=(basic_fields&& other) noexcept {
+        if (this != &other) {
+            reset();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    basic_fields(const basic_fields&) = delete;
+    basic_fields& operator=(const basic_fields&) = delete;
+
+    ~basic_fields() { reset(); }
+
+    /* parse the first record of @param line, like ua_parse_dsv */
+    static basic_fields parse(const CharT* line,
+                              basic_dialect<CharT> d =
+                                  basic_dialect<CharT>::csv()) {
+        const CharT** data = detail::parse_dsv<CharT>(line, d.quote, d.delim);
+        if (!data) throw std::bad_alloc();
+        return basic_fields(data);
+    }
+
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    value_type operator[](std::size_t i) const noexcept {
+        return value_type(data_[i]);
+    }
+    const CharT* c_str(std::size_t i) const noexcept { return data_[i]; }
+
+    const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    const_iterator end() const noexcept { return const_iterator(this, size_); }
+
+    /* the NULL-terminated vector, still owned by this object */
+    const CharT** get() const noexcept { return data_; }
+
+    /* give up ownership; free the result with ua_free_dsv */
+    const CharT** release() noexcept {
+        size_ = 0;
+        return std::exchange(data_, nullptr);
+    }
+
+    void reset() noexcept {
+        if (data_) detail::free_dsv<CharT>(data_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+private:
+    const CharT** data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+/* basic_row
+ *
+ * Owns a ua_dsv_row. Parsing into the same row again reuses its storage, so
+ * a loop over lines allocates only while the row is still growing.
+ * Move-only; a moved-from row is empty.
+ */
+template <typename CharT>
+class basic_row {
+public:
+    using value_type = std::basic_string_view<CharT>;
+    using const_iterator = detail::index_iterator<basic_row, CharT>;
+    using iterator = const_iterator;
+
+    basic_row() noexcept { detail::row_init<CharT>(&row_); }
+
+    basic_row(basic_row&& other) noexcept : row_(other.row_) {
+        detail::row_init<CharT>(&other.row_);
+    }
+
+    basic_row& operator=(basic_row&& other) noexcept {
+        if (this != &other) {
+            detail::row_free<CharT>(&row_);
+            row_ = other.row_;
+            detail::row_init<CharT>(&other.row_);
+        }
+        return *this;
+    }
+
+    basic_row(const basic_row&) = delete;
+    basic_row& operator=(const basic_row&) = delete;
+
+    ~basic_row() { detail::row_free<CharT>(&row_); }
+
+    /* overwrite the row with the first record of @param line, like
+     * ua_parse_dsv_into */
+    void parse(const CharT* line,
+               basic_dialect<CharT> d = basic_dialect<CharT>::csv()) {
+        if (!detail::parse_into<CharT>(&row_, line, d.quote, d.delim)) {
+            throw std::bad_alloc();
+        }
+    }
+
+    void parse(const std::basic_string<CharT>& line,
+               basic_dialect<CharT> d = basic_dialect<CharT>::csv()) {
+        parse(line.c_str(), d);
+    }
+
+    std::size_t size() const noexcept { return row_.nfields; }
+    bool empty() const noexcept { return row_.nfields == 0; }
+
+    value_type operator[](std::size_t i) const noexcept {
+        return value_type(row_.fields[i], row_.lens[i]);
+    }
+    const CharT* c_str(std::size_t i) const noexcept { return row_.fields[i]; }
+
+    const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    const_iterator end() const noexcept {
+        return const_iterator(this, row_.nfields);
+    }
+
+    /* the underlying ua_dsv_row, for the C functions */
+    detail::c_row<CharT>* get() noexcept { return &row_; }
+    const detail::c_row<CharT>* get() const noexcept { return &row_; }
+
+private:
+    detail::c_row<CharT> row_;
+};
+
+/** @region Record iteration **/
+
+/* basic_records
+ *
+ * A range over every record of a buffer, read with ua_dsv_scan one record at
+ * a time. Each record is a range of fields as string views: fields without
+ * quotes to resolve point straight into the buffer, the others into storage
+ * the range reuses from record to record. A record and its fields are valid
+ * until the iterator advances.
+ *
+ * The buffer must outlive the range. The range is single-pass: begin() may
+ * only be called once.
+ */
+template <typename CharT>
+class basic_records {
+public:
+    using view_type = std::basic_string_view<CharT>;
+
+    class record {
+    public:
+        using value_type = view_type;
+        using const_iterator =
+            typename std::vector<view_type>::const_iterator;
+        using iterator = const_iterator;
+
+        std::size_t size() const noexcept { return owner_->fields_.size(); }
+        bool empty() const noexcept { return owner_->fields_.empty(); }
+        view_type operator[](std::size_t i) const noexcept {
+            return owner_->fields_[i];
+        }
+        const_iterator begin() const noexcept {
+            return owner_->fields_.begin();
+        }
+        const_iterator end() const noexcept { return owner_->fields_.end(); }
+
+        /* the raw text of the record, without its EOL */
+        view_type text() const noexcept { return owner_->text_; }
+
+        /* the fields as one contiguous array of size() views */
+        const view_type* data() const noexcept {
+            return owner_->fields_.data();
+        }
+
+        /* offset of the record in the buffer */
+        std::size_t offset() const noexcept { return owner_->start_; }
+
+    private:
+        friend class basic_records;
+        explicit record(const basic_records* owner) noexcept
+            : owner_(owner) {}
+        const basic_records* owner_;
+    };
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = record;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const record*;
+        using reference = const record&;
+
+        iterator() noexcept = default;
+
+        reference operator*() const noexcept { return owner_->record_; }
+        pointer operator->() const noexcept { return &owner_->record_; }
+
+        iterator& operator++() {
+            if (!owner_->next()) owner_ = nullptr;
+            return *this;
+        }
+
+        friend bool operator==(const iterator& a, const iterator& b) noexcept {
+            return a.owner_ == b.owner_;
+        }
+        friend bool operator!=(const iterator& a, const iterator& b) noexcept {
+            return a.owner_ != b.owner_;
+        }
+
+    private:
+        friend class basic_records;
+        explicit iterator(basic_records* owner) noexcept : owner_(owner) {}
+        basic_records* owner_ = nullptr;
+    };
+
+    explicit basic_records(view_type buffer,
+                           basic_dialect<CharT> d =
+                               basic_dialect<CharT>::csv())
+        : buffer_(buffer), dialect_(d), record_(this) {}
+
+    /* the record pointers refer back to this object */
+    basic_records(const basic_records&) = delete;
+    basic_records& operator=(const basic_records&) = delete;
+
+    iterator begin() {
+        pos_ = 0;
+        return next() ? iterator(this) : iterator();
+    }
+    iterator end() noexcept { return iterator(); }
+
+    /* characters consumed so far */
+    std::size_t offset() const noexcept { return pos_; }
+
+private:
+    struct span {
+        const CharT* ptr;   /* into the buffer, or NULL if in scratch_ */
+        std::size_t off;    /* offset into scratch_ */
+        std::size_t len;
+    };
+
+    /* read the record at pos_; false at the end of the buffer */
+    bool next() {
+        std::size_t n;
+
+        spans_.clear();
+        scratch_.clear();
+        have_ = false;
+        n = detail::scan<CharT>(buffer_.data() + pos_, buffer_.size() - pos_,
+                                dialect_.quote, dialect_.delim,
+                                &on_field, &on_record, this);
+        if (error_) std::rethrow_exception(std::exchange(error_, nullptr));
+        if (!have_) {
+            pos_ = buffer_.size();
+            return false;
+        }
+        start_ = pos_;
+        pos_ += n;
+
+        /* scratch_ has stopped growing, so views into it are now stable */
+        fields_.clear();
+        for (const span& s : spans_) {
+            fields_.emplace_back(s.ptr ? s.ptr : scratch_.data() + s.off,
+                                 s.len);
+        }
+        return true;
+    }
+
+    static int on_field(void* user, const CharT* field, std::size_t len,
+                        int flags) {
+        basic_records* self = static_cast<basic_records*>(user);
+        try {
+            if (flags & UA_DSV_FIELD_UNESCAPE) {
+                std::size_t off = self->scratch_.size();
+                self->scratch_.resize(off + len + 1);
+                len = detail::unescape<CharT>(field, len,
+                                              self->dialect_.quote,
+                                              &self->scratch_[off]);
+                self->scratch_.resize(off + len);
+                self->spans_.push_back(span{nullptr, off, len});
+            } else {
+                self->spans_.push_back(span{field, 0, len});
+            }
+        } catch (...) {
+            /* never unwind through the C scanner */
+            self->error_ = std::current_exception();
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    static int on_record(void* user, const CharT* text, std::size_t len,
+                         std::size_t nfields) {
+        basic_records* self = static_cast<basic_records*>(user);
+        (void)nfields;
+        self->text_ = view_type(text, len);
+        self->have_ = true;
+        return FALSE; /* one record per step */
+    }
+
+    view_type buffer_;
+    basic_dialect<CharT> dialect_;
+    std::size_t pos_ = 0;
+    std::size_t start_ = 0;
+    bool have_ = false;
+    std::exception_ptr error_;
+    std::vector<span> spans_;
+    std::basic_string<CharT> scratch_;
+    std::vector<view_type> fields_;
+    view_type text_;
+    record record_;
+};
+
+/** @region Writing **/
+
+/* basic_writer
+ *
+ * Formats records with ua_dsv_format_field straight from the caller's
+ * strings into one reused line buffer, and hands each line, EOL included, to
+ * @param sink as a std::basic_string_view<CharT>.
+ *
+ * A record is any forward range whose elements convert to
+ * std::basic_string_view<CharT>: std::basic_string, string views, or
+ * NIL-terminated CharT pointers. Fields need not be NIL terminated.
+ */
+template <typename CharT, typename Sink>
+class basic_writer {
+public:
+    using view_type = std::basic_string_view<CharT>;
+
+    explicit basic_writer(Sink sink,
+                          basic_dialect<CharT> d =
+                              basic_dialect<CharT>::csv())
+        : sink_(std::move(sink)), dialect_(d) {}
+
+    /* format @param fields as one line, without EOL; the view is valid until
+     * the next call */
+    template <typename Range>
+    view_type format(const Range& fields) {
+        line_.clear();
+        append(fields);
+        return view_type(line_);
+    }
+
+    /* format @param fields and pass the line, with EOL, to the sink */
+    template <typename Range>
+    void write(const Range& fields) {
+        line_.clear();
+        append(fields);
+        line_.push_back(CharT('\n'));
+        sink_(view_type(line_));
+    }
+
+    Sink& sink() noexcept { return sink_; }
+
+private:
+    template <typename Range>
+    void append(const Range& fields) {
+        using std::begin;
+        using std::end;
+        auto it = begin(fields);
+        auto stop = end(fields);
+        bool first = true;
+
+        while (it != stop) {
+            view_type field(*it);
+            std::size_t pos;
+
+            ++it;
+            if (!first) line_.push_back(dialect_.delim);
+            first = false;
+            pos = line_.size();
+            line_.resize(pos + 2 * field.size() + 2);
+            pos += detail::format_field<CharT>(&line_[pos], field.data(),
+                                               field.size(), it == stop,
+                                               dialect_.quoting,
+                                               dialect_.quote, dialect_.delim,
+                                               dialect_.escape);
+            line_.resize(pos);
+        }
+    }
+
+    Sink sink_;
+    basic_dialect<CharT> dialect_;
+    std::basic_string<CharT> line_;
+};
+
+/* make_writer<CharT>(sink, dialect)
+ *
+ * Deduce the sink type of a basic_writer, e.g. from a lambda.
+ */
+template <typename CharT, typename Sink>
+basic_writer<CharT, std::decay_t<Sink>>
+make_writer(Sink&& sink,
+            basic_dialect<CharT> d = basic_dialect<CharT>::csv()) {
+    return basic_writer<CharT, std::decay_t<Sink>>(std::forward<Sink>(sink),
+                                                   d);
+}
+
+#ifdef UA_DSV_COROUTINES
+
+/** @region Generators **/
+
+/* generator
+ *
+ * A coroutine yielding values of type T, one at a time, and only running
+ * when the consumer asks for the next one. The yielded value lives until
+ * the iterator is advanced. Move-only and single-pass.
+ */
+template <typename T>
+class generator {
+public:
+    struct promise_type {
+        const T* value = nullptr;
+        std::exception_ptr error;
+
+        generator get_return_object() noexcept {
+            return generator(
+                std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(const T& v) noexcept {
+            value = std::addressof(v);
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {
+            error = std::current_exception();
+        }
+    };
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() noexcept = default;
+
+        reference operator*() const noexcept { return *h_.promise().value; }
+        pointer operator->() const noexcept { return h_.promise().value; }
+
+        iterator& operator++() {
+            advance(h_);
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        friend bool operator==(const iterator& it,
+                               std::default_sentinel_t) noexcept {
+            return !it.h_ || it.h_.done();
+        }
+
+    private:
+        friend class generator;
+        explicit iterator(handle_type h) noexcept : h_(h) {}
+        handle_type h_;
+    };
+
+    generator(generator&& other) noexcept
+        : h_(std::exchange(other.h_, nullptr)) {}
+
+    generator& operator=(generator&& other) noexcept {
+        if (this != &other) {
+            if (h_) h_.destroy();
+            h_ = std::exchange(other.h_, nullptr);
+        }
+        return *this;
+    }
+
+    generator(const generator&) = delete;
+    generator& operator=(const generator&) = delete;
+
+    ~generator() {
+        if (h_) h_.destroy();
+    }
+
+    /* runs the coroutine up to its first value */
+    iterator begin() {
+        advance(h_);
+        return iterator(h_);
+    }
+    std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+    explicit generator(handle_type h) noexcept : h_(h) {}
+
+    static void advance(handle_type h) {
+        h.resume();
+        if (h.done() && h.promise().error) {
+            std::rethrow_exception(std::exchange(h.promise().error, nullptr));
+        }
+    }
+
+    handle_type h_;
+};
+
+/* the fields of one record, as yielded by the generators below */
+template <typename CharT>
+using basic_record_span = std::span<const std::basic_string_view<CharT>>;
+
+/* records_of(region, dialect)
+ *
+ * Yield the records of @param region, e.g. a mapped file, which must outlive
+ * the generator. Fields point into @param region where they can.
+ */
+template <typename CharT>
+generator<basic_record_span<CharT>>
+records_of(std::basic_string_view<CharT> region,
+           basic_dialect<CharT> d = basic_dialect<CharT>::csv()) {
+    basic_records<CharT> records(region, d);
+    for (const auto& record : records) {
+        co_yield basic_record_span<CharT>(record.data(), record.size());
+    }
+}
+
+/* read_records(read, dialect, chunk)
+ *
+ * Yield the records of a stream, calling @param read(buffer, n) for at most
+ * @param n more characters whenever the records already read run out; it
+ * returns how many it stored, or 0 at the end of the stream.
+ *
+ * Only the unconsumed tail of the stream is buffered: a chunk, plus any
+ * record that does not fit in one. A record that reaches the end of the
+ * buffer is held back until more is read, as it may continue there.
+ */
+template <typename CharT, typename Read>
+generator<basic_record_span<CharT>>
+read_records(Read read,
+             basic_dialect<CharT> d = basic_dialect<CharT>::csv(),
+             std::size_t chunk = 65536) {
+    std::basic_string<CharT> buffer;
+    bool eof = false;
+
+    while (!eof) {
+        std::size_t have = buffer.size();
+        std::size_t got;
+        std::size_t used = 0;
+
+        buffer.resize(have + chunk);
+        got = read(buffer.data() + have, chunk);
+        buffer.resize(have + got);
+        eof = got == 0;
+
+        basic_records<CharT> records(
+            std::basic_string_view<CharT>(buffer), d);
+        for (const auto& record : records) {
+            if (!eof && records.offset() >= buffer.size()) {
+                break;
+            }
+            used = records.offset();
+            co_yield basic_record_span<CharT>(record.data(), record.size());
+        }
+        buffer.erase(0, used);
+    }
+}
+
+/* read_records(file, dialect, chunk)
+ *
+ * read_records over a stdio stream of UTF-8 text.
+ */
+inline generator<basic_record_span<char>>
+read_records(std::FILE* file,
+             basic_dialect<char> d = basic_dialect<char>::csv(),
+             std::size_t chunk = 65536) {
+    auto read = [file](char* buffer, std::size_t n) {
+        std::size_t got = std::fread(buffer, 1, n, file);
+        if (got == 0 && std::ferror(file)) {
+            throw std::runtime_error("gua2csv: read error");
+        }
+        return got;
+    };
+    return read_records<char>(read, d, chunk);
+}
+
+/* fetch_records(source, batch)
+ *
+ * Yield the rows of a ua_dsv_source, such as a database cursor, fetching
+ * @param batch rows at a time and only once the previous batch has been
+ * consumed.
+ */
+inline generator<basic_record_span<char>>
+fetch_records(struct ua_dsv_source source, long batch = 256) {
+    std::vector<const char**> rows(static_cast<std::size_t>(batch));
+    std::vector<std::string_view> fields;
+
+    for (;;) {
+        long n = source.fetch(source.user, rows.data(), batch);
+        if (n < 0) {
+            throw std::runtime_error("gua2csv: fetch error");
+        }
+        if (n == 0) {
+            co_return;
+        }
+        for (long i = 0; i < n; ++i) {
+            fields.clear();
+            for (const char** field = rows[i]; *field; ++field) {
+                fields.emplace_back(*field);
+            }
+            co_yield basic_record_span<char>(fields);
+        }
+    }
+}
+
+#endif /* UA_DSV_COROUTINES */
+
+/** @region Flavors **/
+
+using dialect = basic_dialect<TMCHAR>;
+using fields = basic_fields<TMCHAR>;
+using row = basic_row<TMCHAR>;
+using records = basic_records<TMCHAR>;
+
+using dialect_u8 = basic_dialect<char>;
+using fields_u8 = basic_fields<char>;
+using row_u8 = basic_row<char>;
+using records_u8 = basic_records<char>;
+
+} /* namespace dsv */
+} /* namespace ua */
+
+#endif /* UA_ORAC_GUA2CSV_HPP_ */
@@ -0,0 +1,341 @@
+/*****************************************************************************/
+/*    Name: gua2csvtest.cpp                                                  */
+/*   Title: Delimiter-Separated-Value Library C++ Wrapper Tests              */
+/* Purpose: Exercise gua2csv.hpp the way gua2csv.c -DTEST exercises the C    */
+/*          library: owning rows, record iteration, the writer and, under    */
+/*          C++20, the record generators.                                    */
+/*  Author: Peter Schultz (sxpws)                                            */
+/*****************************************************************************/
+/* UA AUDIT TRAIL                                                            */
+/*                                                                           */
+/* 2026/10/18 sxpws Initial commit                                           */
+/* 2026/10/18 sxpws Test the C++20 record generators                         */
+/*                                                                           */
+/* UA AUDIT TRAIL END                                                        */
+/*****************************************************************************/
+
+/* Build and run:
+ *
+ *  cc -c gua2csv.c
+ *  c++ -std=c++17 gua2csvtest.cpp gua2csv.o -o gua2csvtest -lpthread
+ *  ./gua2csvtest
+ *
+ * Built with -std=c++20 instead, it also tests the generators, which only
+ * exist where gua2csv.hpp finds coroutine support.
+ *
+ * Every check is an assert, as in the C tests; the program prints PASS when
+ * they all hold.
+ */
+
+#include "gua2csv.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dsv = ua::dsv;
+
+using strings = std::vector<std::string>;
+
+/* {{{ REGION: TESTS */
+
+/* every record of @param text, as strings */
+static std::vector<strings> read_all(std::string_view text,
+                                     dsv::dialect_u8 d =
+                                         dsv::dialect_u8::csv()) {
+    std::vector<strings> out;
+    dsv::records_u8 records(text, d);
+    for (const auto& record : records) {
+        out.emplace_back(record.begin(), record.end());
+    }
+    return out;
+}
+
+static void test_fields(void) {
+    dsv::fields_u8 fields = dsv::fields_u8::parse("one,\"t,wo\",  three \n4");
+    const char** data;
+
+    assert(fields.size() == 3 && !fields.empty());
+    assert(fields[0] == "one" && fields[1] == "t,wo" && fields[2] == "three");
+    assert(!std::strcmp(fields.c_str(1), "t,wo"));
+    assert(strings(fields.begin(), fields.end()) ==
+           (strings{"one", "t,wo", "three"}));
+    assert(fields.end() - fields.begin() == 3);
+
+    /* moving hands the vector over and leaves an empty object */
+    dsv::fields_u8 moved(std::move(fields));
+    assert(fields.empty() && fields.get() == nullptr);
+    assert(moved.size() == 3 && moved[2] == "three");
+    fields = std::move(moved);
+    assert(moved.empty() && fields.size() == 3);
+
+    /* released vectors are the caller's to free */
+    data = fields.release();
+    assert(fields.empty() && data && !std::strcmp(data[0], "one"));
+    ua_free_dsv_u8(data);
+
+    fields = dsv::fields_u8::parse("a|b", dsv::dialect_u8::psv());
+    assert(fields.size() == 2 && fields[1] == "b");
+    fields.reset();
+    assert(fields.empty());
+
+    dsv::fields wide = dsv::fields::parse(_TMC("x,\"y\""));
+    assert(wide.size() == 2 && wide[1] == std::basic_string_view<TMCHAR>(
+                                              _TMC("y")));
+}
+
+static void test_row(void) {
+    dsv::row_u8 row;
+    const char* capacity;
+
+    assert(row.empty());
+    row.parse("a,\"b\"\"c\",d\n");
+    assert(row.size() == 3 && row[1] == "b\"c" && row[1].size() == 3);
+    capacity = row.c_str(0);
+
+    /* a row no larger than before reuses its storage */
+    row.parse(std::string("x,y"));
+    assert(row.size() == 2 && row[0] == "x" && row[1] == "y");
+    assert(row.c_str(0) == capacity);
+    assert(strings(row.begin(), row.end()) == (strings{"x", "y"}));
+    assert(row.get()->nfields == 2);
+
+    dsv::row_u8 moved(std::move(row));
+    assert(row.empty() && moved.size() == 2);
+    row = std::move(moved);
+    assert(moved.empty() && row[1] == "y");
+
+    /* the moved-from row is still usable */
+    moved.parse("1|2|3", dsv::dialect_u8::psv());
+    assert(moved.size() == 3 && moved[2] == "3");
+}
+
+static void test_records(void) {
+    static const char text[] =
+        "id,name,note\r\n"
+        "1,\"Smith, J\",\"said \"\"hi\"\"\"\n"
+        "\n"
+        "2,\"two\nlines\",plain\n"
+        "3,,\"\"";
+    std::vector<strings> all = read_all(text);
+    std::vector<std::size_t> offsets;
+    std::vector<std::string> texts;
+
+    assert(all.size() == 5);
+    assert(all[0] == (strings{"id", "name", "note"}));
+    assert(all[1] == (strings{"1", "Smith, J", "said \"hi\""}));
+    assert(all[2].empty());
+    assert(all[3] == (strings{"2", "two\nlines", "plain"}));
+    assert(all[4] == (strings{"3", "", ""}));
+
+    /* offsets and raw text, EOL left out */
+    dsv::records_u8 records(text);
+    for (const auto& record : records) {
+        offsets.push_back(record.offset());
+        texts.emplace_back(record.text());
+        assert(record.data() == &*record.begin() || record.empty());
+    }
+    assert(offsets == (std::vector<std::size_t>{0, 14, 41, 42, 62}));
+    assert(texts[1] == "1,\"Smith, J\",\"said \"\"hi\"\"\"");
+    assert(texts[2].empty() && texts[4] == "3,,\"\"");
+    assert(records.offset() == sizeof(text) - 1);
+
+    /* nothing to read */
+    assert(read_all("").empty());
+    assert(read_all("a|b\nc", dsv::dialect_u8::psv()) ==
+           (std::vector<strings>{{"a", "b"}, {"c"}}));
+}
+
+static void test_writer(void) {
+    std::string out;
+    auto writer = dsv::make_writer<char>(
+        [&out](std::string_view line) { out += line; });
+    const char* cstrings[] = {"x\"y", " pad"};
+    strings fields = {"a,b", "x\"y", " pad", ""};
+
+    /* every kind of string-like, and an empty last field kept by quoting */
+    assert(writer.format(fields) == "\"a,b\",x\"y,\" pad\",\"\"");
+    assert(writer.format(std::vector<std::string_view>{"1", "2"}) == "1,2");
+    assert(writer.format(cstrings) == "x\"y,\" pad\"");
+    assert(writer.format(strings{}) == "");
+
+    writer.write(fields);
+    writer.write(strings{"two\nlines", "q\"\"q"});
+    assert(out == "\"a,b\",x\"y,\" pad\",\"\"\n"
+                  "\"two\nlines\",q\"\"q\n");
+
+    /* what the writer writes reads back as it was */
+    assert(read_all(out) ==
+           (std::vector<strings>{fields, {"two\nlines", "q\"\"q"}}));
+
+    /* other dialects */
+    dsv::dialect_u8 all = dsv::dialect_u8::csv();
+    all.quoting = QUOTE_ALL;
+    auto quoted = dsv::make_writer<char>([](std::string_view) {}, all);
+    assert(quoted.format(strings{"a\"b", "1"}) == "\"a\"\"b\",\"1\"");
+
+    std::string piped;
+    auto psv = dsv::make_writer<char>(
+        [&piped](std::string_view line) { piped += line; },
+        dsv::dialect_u8::psv());
+    psv.write(strings{"a", "b", ""});
+    assert(piped == "a|b|\n");
+}
+
+#ifdef UA_DSV_COROUTINES
+
+/* quotes, doubled quotes, delimiters and EOLs inside fields, CRLF, blank
+ * lines and an unterminated last record, so that chunks split all of them */
+static std::string generator_input(void) {
+    std::string text;
+    for (int i = 0; i < 300; ++i) {
+        text += std::to_string(i) + ",";
+        switch (i % 5) {
+            case 0: text += "\"multi\nline \"\"quoted\"\"\",x\r\n"; break;
+            case 1: text += "plain,\"a,b\"\n"; break;
+            case 2: text += "\"\",\"\r\n\"\n\n"; break;
+            case 3: text += "\"\"\"\"\"\",tail \n"; break;
+            default: text += "\"" + std::string(i, 'z') + "\"\n"; break;
+        }
+    }
+    return text + "last,\"one\"";
+}
+
+template <typename Generator>
+static std::vector<strings> drain(Generator&& records) {
+    std::vector<strings> out;
+    for (const auto& record : records) {
+        out.emplace_back(record.begin(), record.end());
+    }
+    return out;
+}
+
+struct test_fetch {
+    std::vector<std::vector<const char*>> rows;
+    std::size_t next;
+    int calls;
+    bool fail;
+};
+
+static long test_fetch_rows(void* user, const char*** rows, long max) {
+    test_fetch* f = static_cast<test_fetch*>(user);
+    long n = 0;
+    f->calls += 1;
+    if (f->fail) return -1;
+    while (n < max && f->next < f->rows.size()) {
+        rows[n++] = f->rows[f->next++].data();
+    }
+    return n;
+}
+
+static void test_generators(void) {
+    const std::string text = generator_input();
+    const std::vector<strings> expected = read_all(text);
+    std::size_t chunk;
+
+    assert(expected.size() == 361);
+    assert(expected[0] == (strings{"0", "multi\nline \"quoted\"", "x"}));
+    assert(expected.back() == (strings{"last", "one"}));
+
+    /* a region */
+    assert(drain(dsv::records_of<char>(text)) == expected);
+
+    /* a stream read in chunks that cut records anywhere, and shorter reads
+     * than asked for */
+    for (chunk = 1; chunk <= 4096; chunk = chunk * 3 + 1) {
+        std::size_t pos = 0;
+        auto read = [&](char* buffer, std::size_t n) {
+            n = std::min({n, text.size() - pos, chunk % 7 + 1});
+            std::memcpy(buffer, text.data() + pos, n);
+            pos += n;
+            return n;
+        };
+        assert(drain(dsv::read_records<char>(read, dsv::dialect_u8::csv(),
+                                             chunk)) == expected);
+        assert(pos == text.size());
+    }
+
+    /* a stdio stream */
+    std::FILE* file = std::tmpfile();
+    assert(file);
+    assert(std::fwrite(text.data(), 1, text.size(), file) == text.size());
+    for (chunk = 5; chunk <= 65536; chunk *= 16) {
+        std::rewind(file);
+        assert(drain(dsv::read_records(file, dsv::dialect_u8::csv(),
+                                       chunk)) == expected);
+    }
+    std::fclose(file);
+
+    /* a stream that cannot be read */
+    file = std::fopen("/dev/null", "w");
+    assert(file);
+    try {
+        drain(dsv::read_records(file));
+        assert(!"read error not reported");
+    } catch (const std::runtime_error&) {
+    }
+    std::fclose(file);
+
+    /* a cursor, fetched a batch at a time and only when needed */
+    test_fetch f = {{}, 0, 0, false};
+    std::vector<std::string> values;
+    for (int i = 0; i < 10; ++i) values.push_back(std::to_string(i));
+    for (int i = 0; i < 10; ++i) {
+        f.rows.push_back({values[i].c_str(), "a,\"b\"\n", nullptr});
+    }
+    f.rows[4] = {nullptr};
+    {
+        auto records = dsv::fetch_records({test_fetch_rows, &f}, 3);
+        auto it = records.begin();
+        assert(f.calls == 1 && (*it)[0] == "0" && (*it)[1] == "a,\"b\"\n");
+        ++it;
+        ++it;
+        assert(f.calls == 1);
+        ++it;
+        assert(f.calls == 2 && it->size() == 2 && (*it)[0] == "3");
+        ++it;
+        assert(it->empty());
+    }
+    f.next = 0;
+    f.calls = 0;
+    std::vector<strings> fetched = drain(dsv::fetch_records(
+        {test_fetch_rows, &f}, 4));
+    assert(fetched.size() == 10 && fetched[9][0] == "9" && f.calls == 4);
+
+    f.fail = true;
+    try {
+        drain(dsv::fetch_records({test_fetch_rows, &f}));
+        assert(!"fetch error not reported");
+    } catch (const std::runtime_error&) {
+    }
+
+    /* leaving early, and moving a generator that has started */
+    auto records = dsv::records_of<char>(text);
+    auto moved = std::move(records);
+    for (const auto& record : moved) {
+        assert(record.size() == 3 && record[0] == "0");
+        break;
+    }
+}
+
+#endif /* UA_DSV_COROUTINES */
+
+int main(void) {
+    test_fields();
+    test_row();
+    test_records();
+    test_writer();
+#ifdef UA_DSV_COROUTINES
+    test_generators();
+#endif
+    std::puts("PASS");
+    return 0;
+}
+
+/* }}} REGION: TESTS */